@@ -252,13 +252,8 @@ LSTATUS WINAPI RegQueryMultipleValuesA( HKEY hkey, PVALENTA val_list, DWORD num_
 }
 
 
-/******************************************************************************
- * RegQueryMultipleValuesW   [ADVAPI32.@]
- *
- * See RegQueryMultipleValuesA.
- */
-LSTATUS WINAPI RegQueryMultipleValuesW( HKEY hkey, PVALENTW val_list, DWORD num_vals,
-                                        LPWSTR lpValueBuf, LPDWORD ldwTotsize )
+static LSTATUS query_multiple_values_one_by_one( HKEY hkey, PVALENTW val_list, DWORD num_vals,
+                                                 LPWSTR lpValueBuf, LPDWORD ldwTotsize )
 {
     unsigned int i;
     DWORD maxBytes = *ldwTotsize;
@@ -266,8 +261,6 @@ LSTATUS WINAPI RegQueryMultipleValuesW( HKEY hkey, PVALENTW val_list, DWORD num_
     LPSTR bufptr = (LPSTR)lpValueBuf;
     *ldwTotsize = 0;
 
-    TRACE("(%p,%p,%d,%p,%p=%d)\n", hkey, val_list, num_vals, lpValueBuf, ldwTotsize, *ldwTotsize);
-
     for(i=0; i < num_vals; ++i)
     {
         val_list[i].ve_valuelen=0;
@@ -297,6 +290,57 @@ LSTATUS WINAPI RegQueryMultipleValuesW( HKEY hkey, PVALENTW val_list, DWORD num_
 }
 
 
+/******************************************************************************
+ * RegQueryMultipleValuesW   [ADVAPI32.@]
+ *
+ * See RegQueryMultipleValuesA.
+ */
+LSTATUS WINAPI RegQueryMultipleValuesW( HKEY hkey, PVALENTW val_list, DWORD num_vals,
+                                        LPWSTR lpValueBuf, LPDWORD ldwTotsize )
+{
+    KEY_MULTIPLE_VALUE_INFORMATION *info;
+    UNICODE_STRING *names;
+    NTSTATUS status;
+    ULONG len = 0;
+    LSTATUS ret;
+    unsigned int i;
+
+    TRACE("(%p,%p,%d,%p,%p=%d)\n", hkey, val_list, num_vals, lpValueBuf, ldwTotsize, *ldwTotsize);
+
+    /* predefined keys are only resolved by kernelbase */
+    if ((ULONG_PTR)hkey >= (ULONG_PTR)HKEY_CLASSES_ROOT && (ULONG_PTR)hkey <= (ULONG_PTR)HKEY_DYN_DATA)
+        return query_multiple_values_one_by_one( hkey, val_list, num_vals, lpValueBuf, ldwTotsize );
+
+    if (!(info = HeapAlloc( GetProcessHeap(), 0, num_vals * (sizeof(*info) + sizeof(*names)) )))
+        return ERROR_NOT_ENOUGH_MEMORY;
+    names = (UNICODE_STRING *)(info + num_vals);
+    for (i = 0; i < num_vals; i++)
+    {
+        RtlInitUnicodeString( &names[i], val_list[i].ve_valuename );
+        info[i].ValueName = &names[i];
+    }
+
+    /* all the values are retrieved in a single batch of server calls */
+    status = NtQueryMultipleValueKey( hkey, info, num_vals, lpValueBuf,
+                                      lpValueBuf ? *ldwTotsize : 0, &len );
+    if (!status || status == STATUS_BUFFER_OVERFLOW)
+    {
+        for (i = 0; i < num_vals; i++)
+        {
+            val_list[i].ve_valuelen = info[i].DataLength;
+            val_list[i].ve_type = info[i].Type;
+            if (!status) val_list[i].ve_valueptr = (DWORD_PTR)((char *)lpValueBuf + info[i].DataOffset);
+        }
+        *ldwTotsize = len;
+    }
+    ret = status == STATUS_BUFFER_OVERFLOW ? ERROR_MORE_DATA : RtlNtStatusToDosError( status );
+    if (!ret && !lpValueBuf) ret = ERROR_MORE_DATA;
+
+    HeapFree( GetProcessHeap(), 0, info );
+    return ret;
+}
+
+
 /******************************************************************************
  * RegQueryReflectionKey   [ADVAPI32.@]
  */
@@ -1755,6 +1755,47 @@ cleanup:
     RegCloseKey(subkey);
 }
 
+static void test_reg_query_multiple_values(void)
+{
+    static const WCHAR dataW[] = L"wine";
+    DWORD dword = 0x12345678, size;
+    VALENTW values[3];
+    WCHAR buffer[64];
+    LONG ret;
+
+    ret = RegSetValueExW(hkey_main, L"multi_dword", 0, REG_DWORD, (const BYTE *)&dword, sizeof(dword));
+    ok(ret == ERROR_SUCCESS, "Got unexpected error %d.\n", ret);
+    ret = RegSetValueExW(hkey_main, L"multi_string", 0, REG_SZ, (const BYTE *)dataW, sizeof(dataW));
+    ok(ret == ERROR_SUCCESS, "Got unexpected error %d.\n", ret);
+
+    memset(values, 0, sizeof(values));
+    values[0].ve_valuename = (WCHAR *)L"multi_dword";
+    values[1].ve_valuename = (WCHAR *)L"multi_string";
+    size = sizeof(buffer);
+    ret = RegQueryMultipleValuesW(hkey_main, values, 2, buffer, &size);
+    ok(ret == ERROR_SUCCESS, "Got unexpected error %d.\n", ret);
+    ok(size >= sizeof(dword) + sizeof(dataW), "Got unexpected size %u.\n", size);
+    ok(values[0].ve_type == REG_DWORD, "Got unexpected type %u.\n", values[0].ve_type);
+    ok(values[0].ve_valuelen == sizeof(dword), "Got unexpected length %u.\n", values[0].ve_valuelen);
+    ok(*(DWORD *)values[0].ve_valueptr == dword, "Got unexpected data %#x.\n", *(DWORD *)values[0].ve_valueptr);
+    ok(values[1].ve_type == REG_SZ, "Got unexpected type %u.\n", values[1].ve_type);
+    ok(values[1].ve_valuelen == sizeof(dataW), "Got unexpected length %u.\n", values[1].ve_valuelen);
+    ok(!memcmp((void *)values[1].ve_valueptr, dataW, sizeof(dataW)), "Got unexpected data.\n");
+
+    size = sizeof(dword);
+    ret = RegQueryMultipleValuesW(hkey_main, values, 2, buffer, &size);
+    ok(ret == ERROR_MORE_DATA, "Got unexpected error %d.\n", ret);
+    ok(size >= sizeof(dword) + sizeof(dataW), "Got unexpected size %u.\n", size);
+
+    values[1].ve_valuename = (WCHAR *)L"multi_missing";
+    size = sizeof(buffer);
+    ret = RegQueryMultipleValuesW(hkey_main, values, 2, buffer, &size);
+    ok(ret == ERROR_FILE_NOT_FOUND, "Got unexpected error %d.\n", ret);
+
+    RegDeleteValueW(hkey_main, L"multi_dword");
+    RegDeleteValueW(hkey_main, L"multi_string");
+}
+
 static void test_reg_query_info(void)
 {
     HKEY subkey;
@@ -4149,6 +4190,7 @@ START_TEST(registry)
     test_reg_close_key();
     test_reg_delete_key();
     test_reg_query_value();
+    test_reg_query_multiple_values();
     test_reg_query_info();
     test_string_termination();
     test_symlinks();
@@ -13292,6 +13292,144 @@ static void test_resource_map(void)
     ok(!refcount, "Device has %u references left.\n", refcount);
 }
 
+static void test_dynamic_buffer_map(void)
+{
+    static const struct vec4 colors[] =
+    {
+        {1.0f, 0.0f, 0.0f, 1.0f},
+        {0.0f, 1.0f, 0.0f, 1.0f},
+        {0.0f, 0.0f, 1.0f, 1.0f},
+        {1.0f, 1.0f, 0.0f, 1.0f},
+    };
+    static const DWORD expected_colors[] =
+    {
+        0xff0000ff, 0xff00ff00, 0xffff0000, 0xff00ffff,
+    };
+    static const struct vec3 quads[] =
+    {
+        {-1.0f, -1.0f, 0.0f},
+        {-1.0f,  1.0f, 0.0f},
+        { 0.0f, -1.0f, 0.0f},
+        { 0.0f,  1.0f, 0.0f},
+
+        { 0.0f, -1.0f, 0.0f},
+        { 0.0f,  1.0f, 0.0f},
+        { 1.0f, -1.0f, 0.0f},
+        { 1.0f,  1.0f, 0.0f},
+    };
+    static const float white[] = {1.0f, 1.0f, 1.0f, 1.0f};
+
+    struct d3d11_test_context test_context;
+    D3D11_MAPPED_SUBRESOURCE map_desc;
+    ID3D11DeviceContext *context;
+    D3D11_BUFFER_DESC buffer_desc;
+    ID3D11Buffer *cb, *vb;
+    unsigned int i, stride, offset;
+    ID3D11Device *device;
+    DWORD color;
+    HRESULT hr;
+
+    if (!init_test_context(&test_context, NULL))
+        return;
+
+    device = test_context.device;
+    context = test_context.immediate_context;
+
+    /* UpdateSubresource() data must be visible to the draws issued after it,
+     * and only to those. */
+    ID3D11DeviceContext_ClearRenderTargetView(context, test_context.backbuffer_rtv, white);
+    for (i = 0; i < ARRAY_SIZE(colors); ++i)
+    {
+        set_viewport(context, i * 160.0f, 0.0f, 160.0f, 480.0f, 0.0f, 1.0f);
+        draw_color_quad(&test_context, &colors[i]);
+    }
+    for (i = 0; i < ARRAY_SIZE(colors); ++i)
+    {
+        color = get_texture_color(test_context.backbuffer, i * 160 + 80, 240);
+        ok(compare_color(color, expected_colors[i], 1),
+                "Test %u: Got unexpected color 0x%08x.\n", i, color);
+    }
+
+    buffer_desc.ByteWidth = sizeof(*colors);
+    buffer_desc.Usage = D3D11_USAGE_DYNAMIC;
+    buffer_desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+    buffer_desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+    buffer_desc.MiscFlags = 0;
+    buffer_desc.StructureByteStride = 0;
+    hr = ID3D11Device_CreateBuffer(device, &buffer_desc, NULL, &cb);
+    ok(SUCCEEDED(hr), "Failed to create buffer, hr %#x.\n", hr);
+    ID3D11DeviceContext_PSSetConstantBuffers(context, 0, 1, &cb);
+
+    /* Each WRITE_DISCARD map renames the buffer; earlier draws keep
+     * seeing their own contents. */
+    ID3D11DeviceContext_ClearRenderTargetView(context, test_context.backbuffer_rtv, white);
+    for (i = 0; i < ARRAY_SIZE(colors); ++i)
+    {
+        hr = ID3D11DeviceContext_Map(context, (ID3D11Resource *)cb, 0, D3D11_MAP_WRITE_DISCARD, 0, &map_desc);
+        ok(SUCCEEDED(hr), "Failed to map buffer, hr %#x.\n", hr);
+        memcpy(map_desc.pData, &colors[i], sizeof(*colors));
+        ID3D11DeviceContext_Unmap(context, (ID3D11Resource *)cb, 0);
+
+        set_viewport(context, i * 160.0f, 0.0f, 160.0f, 480.0f, 0.0f, 1.0f);
+        draw_quad(&test_context);
+    }
+    for (i = 0; i < ARRAY_SIZE(colors); ++i)
+    {
+        color = get_texture_color(test_context.backbuffer, i * 160 + 80, 240);
+        ok(compare_color(color, expected_colors[i], 1),
+                "Test %u: Got unexpected color 0x%08x.\n", i, color);
+    }
+
+    /* WRITE_NO_OVERWRITE appends to the data already used by earlier
+     * draws. */
+    buffer_desc.ByteWidth = sizeof(quads);
+    buffer_desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+    hr = ID3D11Device_CreateBuffer(device, &buffer_desc, NULL, &vb);
+    ok(SUCCEEDED(hr), "Failed to create buffer, hr %#x.\n", hr);
+    stride = sizeof(*quads);
+    offset = 0;
+    ID3D11DeviceContext_IASetVertexBuffers(context, 0, 1, &vb, &stride, &offset);
+    set_viewport(context, 0.0f, 0.0f, 640.0f, 480.0f, 0.0f, 1.0f);
+
+    ID3D11DeviceContext_ClearRenderTargetView(context, test_context.backbuffer_rtv, white);
+    for (i = 0; i < 2; ++i)
+    {
+        hr = ID3D11DeviceContext_Map(context, (ID3D11Resource *)vb, 0,
+                i ? D3D11_MAP_WRITE_NO_OVERWRITE : D3D11_MAP_WRITE_DISCARD, 0, &map_desc);
+        ok(SUCCEEDED(hr), "Failed to map buffer, hr %#x.\n", hr);
+        memcpy((struct vec3 *)map_desc.pData + i * 4, &quads[i * 4], 4 * sizeof(*quads));
+        ID3D11DeviceContext_Unmap(context, (ID3D11Resource *)vb, 0);
+
+        hr = ID3D11DeviceContext_Map(context, (ID3D11Resource *)cb, 0, D3D11_MAP_WRITE_DISCARD, 0, &map_desc);
+        ok(SUCCEEDED(hr), "Failed to map buffer, hr %#x.\n", hr);
+        memcpy(map_desc.pData, &colors[i + 1], sizeof(*colors));
+        ID3D11DeviceContext_Unmap(context, (ID3D11Resource *)cb, 0);
+
+        ID3D11DeviceContext_Draw(context, 4, i * 4);
+    }
+    color = get_texture_color(test_context.backbuffer, 160, 240);
+    ok(compare_color(color, expected_colors[1], 1), "Got unexpected color 0x%08x.\n", color);
+    color = get_texture_color(test_context.backbuffer, 480, 240);
+    ok(compare_color(color, expected_colors[2], 1), "Got unexpected color 0x%08x.\n", color);
+
+    /* Many small per-draw updates, the common pattern for constant
+     * buffers. */
+    ID3D11DeviceContext_IASetVertexBuffers(context, 0, 1, &test_context.vb, &stride, &offset);
+    for (i = 0; i < 1000; ++i)
+    {
+        hr = ID3D11DeviceContext_Map(context, (ID3D11Resource *)cb, 0, D3D11_MAP_WRITE_DISCARD, 0, &map_desc);
+        ok(SUCCEEDED(hr), "Failed to map buffer, hr %#x.\n", hr);
+        memcpy(map_desc.pData, &colors[i % ARRAY_SIZE(colors)], sizeof(*colors));
+        ID3D11DeviceContext_Unmap(context, (ID3D11Resource *)cb, 0);
+        ID3D11DeviceContext_Draw(context, 4, 0);
+    }
+    check_texture_color(test_context.backbuffer, expected_colors[(i - 1) % ARRAY_SIZE(colors)], 1);
+
+    ID3D11Buffer_Release(vb);
+    ID3D11Buffer_Release(cb);
+    release_test_context(&test_context);
+}
+
 #define check_resource_cpu_access(a, b, c, d, e) check_resource_cpu_access_(__LINE__, a, b, c, d, e)
 static void check_resource_cpu_access_(unsigned int line, ID3D11DeviceContext *context,
         ID3D11Resource *resource, D3D11_USAGE usage, UINT bind_flags, UINT cpu_access)
@@ -30163,6 +30301,7 @@ START_TEST(d3d11)
     queue_test(test_copy_subresource_region_1d);
     queue_test(test_copy_subresource_region_3d);
     queue_test(test_resource_map);
+    queue_test(test_dynamic_buffer_map);
     queue_for_each_feature_level(test_resource_access);
     queue_test(test_check_multisample_quality_levels);
     queue_for_each_feature_level(test_swapchain_formats);
@@ -37,6 +37,31 @@
 
 WINE_DEFAULT_DEBUG_CHANNEL(d3dx);
 
+/* Bounding volume hierarchy over the faces of a mesh, used for ray picking.
+ * Inner nodes have count == 0, their left child follows them and "first" is
+ * the index of the right child. Leaves reference "count" triangles starting
+ * at "first". */
+struct mesh_bvh_node
+{
+    D3DXVECTOR3 min, max;
+    DWORD first;
+    DWORD count;
+};
+
+struct mesh_bvh_triangle
+{
+    D3DXVECTOR3 v0, edge1, edge2;
+    DWORD face;
+};
+
+struct mesh_bvh
+{
+    struct mesh_bvh_node *nodes;
+    DWORD node_count;
+    struct mesh_bvh_triangle *triangles;
+    DWORD triangle_count;
+};
+
 struct d3dx9_mesh
 {
     ID3DXMesh ID3DXMesh_iface;
@@ -55,8 +80,17 @@ struct d3dx9_mesh
     IDirect3DIndexBuffer9 *index_buffer;
     DWORD *attrib_buffer;
     int attrib_buffer_lock_count;
+    int vertex_buffer_lock_count;
+    int index_buffer_lock_count;
+    BOOL vertex_buffer_written;
+    BOOL index_buffer_written;
     DWORD attrib_table_size;
     D3DXATTRIBUTERANGE *attrib_table;
+
+    /* Built on the first D3DXIntersect() call, dropped when the vertex or
+     * index buffer is locked for writing, and again once it is unlocked, in
+     * case it was rebuilt from partially written data in the meantime. */
+    struct mesh_bvh *bvh;
 };
 
 static const UINT d3dx_decltype_size[] =
@@ -85,6 +119,22 @@ static inline struct d3dx9_mesh *impl_from_ID3DXMesh(ID3DXMesh *iface)
     return CONTAINING_RECORD(iface, struct d3dx9_mesh, ID3DXMesh_iface);
 }
 
+static void mesh_bvh_destroy(struct mesh_bvh *bvh)
+{
+    if (!bvh)
+        return;
+
+    HeapFree(GetProcessHeap(), 0, bvh->nodes);
+    HeapFree(GetProcessHeap(), 0, bvh->triangles);
+    HeapFree(GetProcessHeap(), 0, bvh);
+}
+
+static void d3dx9_mesh_invalidate_bvh(struct d3dx9_mesh *mesh)
+{
+    mesh_bvh_destroy(mesh->bvh);
+    mesh->bvh = NULL;
+}
+
 static HRESULT WINAPI d3dx9_mesh_QueryInterface(ID3DXMesh *iface, REFIID riid, void **out)
 {
     TRACE("iface %p, riid %s, out %p.\n", iface, debugstr_guid(riid), out);
@@ -129,6 +179,7 @@ static ULONG WINAPI d3dx9_mesh_Release(ID3DXMesh *iface)
         IDirect3DDevice9_Release(mesh->device);
         HeapFree(GetProcessHeap(), 0, mesh->attrib_buffer);
         HeapFree(GetProcessHeap(), 0, mesh->attrib_table);
+        mesh_bvh_destroy(mesh->bvh);
         HeapFree(GetProcessHeap(), 0, mesh);
     }
 
@@ -799,37 +850,79 @@ static HRESULT WINAPI d3dx9_mesh_GetIndexBuffer(struct ID3DXMesh *iface,
 static HRESULT WINAPI d3dx9_mesh_LockVertexBuffer(ID3DXMesh *iface, DWORD flags, void **data)
 {
     struct d3dx9_mesh *mesh = impl_from_ID3DXMesh(iface);
+    HRESULT hr;
 
     TRACE("iface %p, flags %#x, data %p.\n", iface, flags, data);
 
-    return IDirect3DVertexBuffer9_Lock(mesh->vertex_buffer, 0, 0, data, flags);
+    if (FAILED(hr = IDirect3DVertexBuffer9_Lock(mesh->vertex_buffer, 0, 0, data, flags)))
+        return hr;
+
+    ++mesh->vertex_buffer_lock_count;
+    if (!(flags & D3DLOCK_READONLY))
+    {
+        d3dx9_mesh_invalidate_bvh(mesh);
+        mesh->vertex_buffer_written = TRUE;
+    }
+
+    return hr;
 }
 
 static HRESULT WINAPI d3dx9_mesh_UnlockVertexBuffer(ID3DXMesh *iface)
 {
     struct d3dx9_mesh *mesh = impl_from_ID3DXMesh(iface);
+    HRESULT hr;
 
     TRACE("iface %p.\n", iface);
 
-    return IDirect3DVertexBuffer9_Unlock(mesh->vertex_buffer);
+    if (FAILED(hr = IDirect3DVertexBuffer9_Unlock(mesh->vertex_buffer)))
+        return hr;
+
+    if (mesh->vertex_buffer_lock_count && !--mesh->vertex_buffer_lock_count && mesh->vertex_buffer_written)
+    {
+        d3dx9_mesh_invalidate_bvh(mesh);
+        mesh->vertex_buffer_written = FALSE;
+    }
+
+    return hr;
 }
 
 static HRESULT WINAPI d3dx9_mesh_LockIndexBuffer(ID3DXMesh *iface, DWORD flags, void **data)
 {
     struct d3dx9_mesh *mesh = impl_from_ID3DXMesh(iface);
+    HRESULT hr;
 
     TRACE("iface %p, flags %#x, data %p.\n", iface, flags, data);
 
-    return IDirect3DIndexBuffer9_Lock(mesh->index_buffer, 0, 0, data, flags);
+    if (FAILED(hr = IDirect3DIndexBuffer9_Lock(mesh->index_buffer, 0, 0, data, flags)))
+        return hr;
+
+    ++mesh->index_buffer_lock_count;
+    if (!(flags & D3DLOCK_READONLY))
+    {
+        d3dx9_mesh_invalidate_bvh(mesh);
+        mesh->index_buffer_written = TRUE;
+    }
+
+    return hr;
 }
 
 static HRESULT WINAPI d3dx9_mesh_UnlockIndexBuffer(ID3DXMesh *iface)
 {
     struct d3dx9_mesh *mesh = impl_from_ID3DXMesh(iface);
+    HRESULT hr;
 
     TRACE("iface %p.\n", iface);
 
-    return IDirect3DIndexBuffer9_Unlock(mesh->index_buffer);
+    if (FAILED(hr = IDirect3DIndexBuffer9_Unlock(mesh->index_buffer)))
+        return hr;
+
+    if (mesh->index_buffer_lock_count && !--mesh->index_buffer_lock_count && mesh->index_buffer_written)
+    {
+        d3dx9_mesh_invalidate_bvh(mesh);
+        mesh->index_buffer_written = FALSE;
+    }
+
+    return hr;
 }
 
 /* FIXME: This looks just wrong, we never check *attrib_table_size before
@@ -1397,6 +1490,7 @@ static HRESULT WINAPI d3dx9_mesh_UpdateSemantics(ID3DXMesh *iface, D3DVERTEXELEM
 
     This->num_elem = i + 1;
     copy_declaration(This->cached_declaration, declaration, This->num_elem);
+    d3dx9_mesh_invalidate_bvh(This);
 
     if (This->vertex_declaration)
         IDirect3DVertexDeclaration9_Release(This->vertex_declaration);
@@ -1634,6 +1728,331 @@ static HRESULT remap_faces_for_attrsort(struct d3dx9_mesh *This, const DWORD *in
     return D3D_OK;
 }
 
+/* Vertex cache optimisation, based on Tom Forsyth's "Linear-Speed Vertex
+ * Cache Optimisation". Faces are emitted greedily; each vertex is scored by
+ * its position in a simulated LRU cache and by the number of faces still
+ * using it, and the face with the highest sum of vertex scores among the
+ * faces touching the cache is emitted next. */
+#define VERTEX_CACHE_SIZE 32
+
+static float vertex_cache_score(int cache_position, DWORD remaining_faces)
+{
+    static const float cache_decay_power = 1.5f;
+    static const float last_face_score = 0.75f;
+    static const float valence_boost_scale = 2.0f;
+    static const float valence_boost_power = 0.5f;
+    float score = 0.0f;
+
+    if (!remaining_faces)
+        return -1.0f;
+
+    if (cache_position >= 0)
+    {
+        /* The vertices of the last face are not boosted, so that strips
+         * don't get stuck going back and forth over the same edge. */
+        if (cache_position < 3)
+            score = last_face_score;
+        else
+            score = powf(1.0f - (cache_position - 3) * (1.0f / (VERTEX_CACHE_SIZE - 3)), cache_decay_power);
+    }
+
+    return score + valence_boost_scale * powf(remaining_faces, -valence_boost_power);
+}
+
+static HRESULT optimize_faces_for_vertex_cache(const DWORD *indices, DWORD num_faces,
+        DWORD num_vertices, DWORD *face_remap)
+{
+    DWORD cache[VERTEX_CACHE_SIZE + 3], new_cache[VERTEX_CACHE_SIZE + 3];
+    DWORD cache_size = 0, new_cache_size;
+    DWORD *face_offsets, *vertex_faces, *remaining_faces;
+    DWORD next_face = num_faces, best_face = ~0u;
+    int *cache_positions;
+    float *vertex_scores;
+    BYTE *face_added;
+    DWORD i, j, k;
+
+    if (!num_faces)
+        return D3D_OK;
+
+    for (i = 0; i < num_faces * 3; ++i)
+    {
+        if (indices[i] >= num_vertices)
+        {
+            WARN("Index %u of face %u is out of range.\n", indices[i], i / 3);
+            return D3DERR_INVALIDCALL;
+        }
+    }
+
+    face_offsets = HeapAlloc(GetProcessHeap(), 0, (num_vertices + 1) * sizeof(*face_offsets));
+    remaining_faces = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, num_vertices * sizeof(*remaining_faces));
+    vertex_faces = HeapAlloc(GetProcessHeap(), 0, num_faces * 3 * sizeof(*vertex_faces));
+    cache_positions = HeapAlloc(GetProcessHeap(), 0, num_vertices * sizeof(*cache_positions));
+    vertex_scores = HeapAlloc(GetProcessHeap(), 0, num_vertices * sizeof(*vertex_scores));
+    face_added = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, num_faces * sizeof(*face_added));
+    if (!face_offsets || !remaining_faces || !vertex_faces || !cache_positions || !vertex_scores || !face_added)
+    {
+        HeapFree(GetProcessHeap(), 0, face_offsets);
+        HeapFree(GetProcessHeap(), 0, remaining_faces);
+        HeapFree(GetProcessHeap(), 0, vertex_faces);
+        HeapFree(GetProcessHeap(), 0, cache_positions);
+        HeapFree(GetProcessHeap(), 0, vertex_scores);
+        HeapFree(GetProcessHeap(), 0, face_added);
+        return E_OUTOFMEMORY;
+    }
+
+    /* Build the list of faces using each vertex. The faces not emitted yet
+     * are kept at the start of each vertex's list. */
+    for (i = 0; i < num_faces * 3; ++i)
+        ++remaining_faces[indices[i]];
+    face_offsets[0] = 0;
+    for (i = 0; i < num_vertices; ++i)
+    {
+        face_offsets[i + 1] = face_offsets[i] + remaining_faces[i];
+        remaining_faces[i] = 0;
+    }
+    for (i = 0; i < num_faces * 3; ++i)
+    {
+        DWORD vertex = indices[i];
+        vertex_faces[face_offsets[vertex] + remaining_faces[vertex]++] = i / 3;
+    }
+
+    for (i = 0; i < num_vertices; ++i)
+    {
+        cache_positions[i] = -1;
+        vertex_scores[i] = vertex_cache_score(-1, remaining_faces[i]);
+    }
+
+    for (i = 0; i < num_faces; ++i)
+    {
+        float best_score = -1.0f;
+
+        if (best_face == ~0u)
+        {
+            /* Nothing in the cache is usable; start again from the last face
+             * which hasn't been emitted yet. */
+            while (face_added[--next_face]);
+            best_face = next_face;
+        }
+
+        face_remap[i] = best_face;
+        face_added[best_face] = 1;
+
+        new_cache_size = 0;
+        for (j = 0; j < 3; ++j)
+        {
+            DWORD vertex = indices[best_face * 3 + j];
+            DWORD *faces = vertex_faces + face_offsets[vertex];
+
+            for (k = 0; k < remaining_faces[vertex]; ++k)
+            {
+                if (faces[k] == best_face)
+                {
+                    faces[k] = faces[--remaining_faces[vertex]];
+                    break;
+                }
+            }
+
+            for (k = 0; k < new_cache_size; ++k)
+            {
+                if (new_cache[k] == vertex)
+                    break;
+            }
+            if (k == new_cache_size)
+                new_cache[new_cache_size++] = vertex;
+        }
+        for (j = 0; j < cache_size; ++j)
+        {
+            DWORD vertex = cache[j];
+
+            if (vertex != indices[best_face * 3] && vertex != indices[best_face * 3 + 1]
+                    && vertex != indices[best_face * 3 + 2])
+                new_cache[new_cache_size++] = vertex;
+        }
+
+        /* Vertices pushed out of the cache are rescored as well, so that the
+         * faces using them are ranked correctly if they come back. */
+        for (j = 0; j < new_cache_size; ++j)
+        {
+            DWORD vertex = new_cache[j];
+
+            cache_positions[vertex] = j < VERTEX_CACHE_SIZE ? j : -1;
+            vertex_scores[vertex] = vertex_cache_score(cache_positions[vertex], remaining_faces[vertex]);
+        }
+        cache_size = min(new_cache_size, VERTEX_CACHE_SIZE);
+        memcpy(cache, new_cache, cache_size * sizeof(*cache));
+
+        best_face = ~0u;
+        for (j = 0; j < cache_size; ++j)
+        {
+            DWORD vertex = cache[j];
+            const DWORD *faces = vertex_faces + face_offsets[vertex];
+
+            for (k = 0; k < remaining_faces[vertex]; ++k)
+            {
+                DWORD face = faces[k];
+                float score = vertex_scores[indices[face * 3]] + vertex_scores[indices[face * 3 + 1]]
+                        + vertex_scores[indices[face * 3 + 2]];
+
+                if (score > best_score || (score == best_score && face > best_face))
+                {
+                    best_score = score;
+                    best_face = face;
+                }
+            }
+        }
+    }
+
+    HeapFree(GetProcessHeap(), 0, face_offsets);
+    HeapFree(GetProcessHeap(), 0, remaining_faces);
+    HeapFree(GetProcessHeap(), 0, vertex_faces);
+    HeapFree(GetProcessHeap(), 0, cache_positions);
+    HeapFree(GetProcessHeap(), 0, vertex_scores);
+    HeapFree(GetProcessHeap(), 0, face_added);
+
+    return D3D_OK;
+}
+
+static HRESULT optimize_vertices_for_fetch(const DWORD *indices, DWORD num_faces,
+        DWORD num_vertices, DWORD *vertex_remap, DWORD *num_used_vertices)
+{
+    DWORD *new_indices;
+    DWORD i, count = 0;
+
+    if (!(new_indices = HeapAlloc(GetProcessHeap(), 0, num_vertices * sizeof(*new_indices))))
+        return E_OUTOFMEMORY;
+    memset(new_indices, 0xff, num_vertices * sizeof(*new_indices));
+
+    /* Vertices are numbered in the order in which they are first used. */
+    for (i = 0; i < num_faces * 3; ++i)
+    {
+        DWORD vertex = indices[i];
+
+        if (vertex >= num_vertices)
+        {
+            WARN("Index %u of face %u is out of range.\n", vertex, i / 3);
+            HeapFree(GetProcessHeap(), 0, new_indices);
+            return D3DERR_INVALIDCALL;
+        }
+        if (new_indices[vertex] == ~0u)
+        {
+            new_indices[vertex] = count;
+            vertex_remap[count++] = vertex;
+        }
+    }
+    *num_used_vertices = count;
+
+    for (i = 0; i < num_vertices; ++i)
+    {
+        if (new_indices[i] == ~0u)
+            vertex_remap[count++] = i;
+    }
+
+    HeapFree(GetProcessHeap(), 0, new_indices);
+
+    return D3D_OK;
+}
+
+/* Reorder the faces within each attribute range for the vertex cache. On input
+ * face_remap is the old -> new mapping of remap_faces_for_attrsort(). */
+static HRESULT remap_faces_for_vertex_cache(struct d3dx9_mesh *This, const DWORD *indices,
+        const DWORD *sorted_attrib_buffer, DWORD *face_remap)
+{
+    DWORD *sorted_indices, *range_remap;
+    DWORD start, end, i;
+    HRESULT hr = D3D_OK;
+
+    sorted_indices = HeapAlloc(GetProcessHeap(), 0, This->numfaces * 3 * sizeof(*sorted_indices));
+    range_remap = HeapAlloc(GetProcessHeap(), 0, This->numfaces * sizeof(*range_remap));
+    if (!sorted_indices || !range_remap)
+    {
+        HeapFree(GetProcessHeap(), 0, sorted_indices);
+        HeapFree(GetProcessHeap(), 0, range_remap);
+        return E_OUTOFMEMORY;
+    }
+
+    for (i = 0; i < This->numfaces; i++)
+        memcpy(sorted_indices + face_remap[i] * 3, indices + i * 3, 3 * sizeof(*sorted_indices));
+
+    for (start = 0; start < This->numfaces; start = end)
+    {
+        for (end = start + 1; end < This->numfaces; end++)
+        {
+            if (sorted_attrib_buffer[end] != sorted_attrib_buffer[start])
+                break;
+        }
+
+        hr = optimize_faces_for_vertex_cache(sorted_indices + start * 3, end - start,
+                This->numvertices, range_remap + start);
+        if (FAILED(hr)) goto cleanup;
+
+        for (i = start; i < end; i++)
+            range_remap[i] += start;
+    }
+
+    /* range_remap is new -> sorted, compose its inverse with face_remap. */
+    for (i = 0; i < This->numfaces; i++)
+        sorted_indices[range_remap[i]] = i;
+    for (i = 0; i < This->numfaces; i++)
+        face_remap[i] = sorted_indices[face_remap[i]];
+
+cleanup:
+    HeapFree(GetProcessHeap(), 0, sorted_indices);
+    HeapFree(GetProcessHeap(), 0, range_remap);
+    return hr;
+}
+
+/* Renumber the vertices in the order in which the reordered faces use them,
+ * dropping the unused vertices if compacting. */
+static HRESULT remap_vertices_for_fetch(struct d3dx9_mesh *This, DWORD *indices, const DWORD *face_remap,
+        BOOL compact, DWORD *new_num_vertices, ID3DXBuffer **vertex_remap)
+{
+    DWORD *new_indices, *old_to_new, *vertex_remap_ptr;
+    DWORD num_used_vertices;
+    DWORD i;
+    HRESULT hr;
+
+    hr = D3DXCreateBuffer(This->numvertices * sizeof(DWORD), vertex_remap);
+    if (FAILED(hr)) return hr;
+    vertex_remap_ptr = ID3DXBuffer_GetBufferPointer(*vertex_remap);
+
+    new_indices = HeapAlloc(GetProcessHeap(), 0, This->numfaces * 3 * sizeof(*new_indices));
+    old_to_new = HeapAlloc(GetProcessHeap(), 0, This->numvertices * sizeof(*old_to_new));
+    if (!new_indices || !old_to_new)
+    {
+        hr = E_OUTOFMEMORY;
+        goto cleanup;
+    }
+
+    for (i = 0; i < This->numfaces; i++)
+        memcpy(new_indices + face_remap[i] * 3, indices + i * 3, 3 * sizeof(*new_indices));
+
+    hr = optimize_vertices_for_fetch(new_indices, This->numfaces, This->numvertices,
+            vertex_remap_ptr, &num_used_vertices);
+    if (FAILED(hr)) goto cleanup;
+
+    if (!compact)
+        num_used_vertices = This->numvertices;
+    for (i = 0; i < num_used_vertices; i++)
+        old_to_new[vertex_remap_ptr[i]] = i;
+    for (i = num_used_vertices; i < This->numvertices; i++)
+        vertex_remap_ptr[i] = -1;
+
+    for (i = 0; i < This->numfaces * 3; i++)
+        indices[i] = old_to_new[indices[i]];
+
+    *new_num_vertices = num_used_vertices;
+
+cleanup:
+    HeapFree(GetProcessHeap(), 0, new_indices);
+    HeapFree(GetProcessHeap(), 0, old_to_new);
+    if (FAILED(hr))
+    {
+        ID3DXBuffer_Release(*vertex_remap);
+        *vertex_remap = NULL;
+    }
+    return hr;
+}
+
 static HRESULT WINAPI d3dx9_mesh_OptimizeInplace(ID3DXMesh *iface, DWORD flags, const DWORD *adjacency_in,
         DWORD *adjacency_out, DWORD *face_remap_out, ID3DXBuffer **vertex_remap_out)
 {
@@ -1660,12 +2079,9 @@ static HRESULT WINAPI d3dx9_mesh_OptimizeInplace(ID3DXMesh *iface, DWORD flags,
     if ((flags & (D3DXMESHOPT_VERTEXCACHE | D3DXMESHOPT_STRIPREORDER)) == (D3DXMESHOPT_VERTEXCACHE | D3DXMESHOPT_STRIPREORDER))
         return D3DERR_INVALIDCALL;
 
-    if (flags & (D3DXMESHOPT_VERTEXCACHE | D3DXMESHOPT_STRIPREORDER))
+    if (flags & D3DXMESHOPT_STRIPREORDER)
     {
-        if (flags & D3DXMESHOPT_VERTEXCACHE)
-            FIXME("D3DXMESHOPT_VERTEXCACHE not implemented.\n");
-        if (flags & D3DXMESHOPT_STRIPREORDER)
-            FIXME("D3DXMESHOPT_STRIPREORDER not implemented.\n");
+        FIXME("D3DXMESHOPT_STRIPREORDER not implemented.\n");
         return E_NOTIMPL;
     }
 
@@ -1682,13 +2098,14 @@ static HRESULT WINAPI d3dx9_mesh_OptimizeInplace(ID3DXMesh *iface, DWORD flags,
             dword_indices[i] = *word_indices++;
     }
 
-    if ((flags & (D3DXMESHOPT_COMPACT | D3DXMESHOPT_IGNOREVERTS | D3DXMESHOPT_ATTRSORT)) == D3DXMESHOPT_COMPACT)
+    if ((flags & (D3DXMESHOPT_COMPACT | D3DXMESHOPT_IGNOREVERTS | D3DXMESHOPT_ATTRSORT | D3DXMESHOPT_VERTEXCACHE))
+            == D3DXMESHOPT_COMPACT)
     {
         new_num_alloc_vertices = This->numvertices;
         hr = compact_mesh(This, dword_indices, &new_num_vertices, &vertex_remap);
         if (FAILED(hr)) goto cleanup;
-    } else if (flags & D3DXMESHOPT_ATTRSORT) {
-        if (!(flags & D3DXMESHOPT_IGNOREVERTS))
+    } else if (flags & (D3DXMESHOPT_ATTRSORT | D3DXMESHOPT_VERTEXCACHE)) {
+        if (!(flags & (D3DXMESHOPT_IGNOREVERTS | D3DXMESHOPT_VERTEXCACHE)))
         {
             FIXME("D3DXMESHOPT_ATTRSORT vertex reordering not implemented.\n");
             hr = E_NOTIMPL;
@@ -1700,6 +2117,20 @@ static HRESULT WINAPI d3dx9_mesh_OptimizeInplace(ID3DXMesh *iface, DWORD flags,
 
         hr = remap_faces_for_attrsort(This, dword_indices, attrib_buffer, &sorted_attrib_buffer, &face_remap);
         if (FAILED(hr)) goto cleanup;
+
+        if (flags & D3DXMESHOPT_VERTEXCACHE)
+        {
+            hr = remap_faces_for_vertex_cache(This, dword_indices, sorted_attrib_buffer, face_remap);
+            if (FAILED(hr)) goto cleanup;
+
+            if (!(flags & D3DXMESHOPT_IGNOREVERTS))
+            {
+                new_num_alloc_vertices = This->numvertices;
+                hr = remap_vertices_for_fetch(This, dword_indices, face_remap, flags & D3DXMESHOPT_COMPACT,
+                        &new_num_vertices, &vertex_remap);
+                if (FAILED(hr)) goto cleanup;
+            }
+        }
     }
 
     if (vertex_remap)
@@ -1742,7 +2173,7 @@ static HRESULT WINAPI d3dx9_mesh_OptimizeInplace(ID3DXMesh *iface, DWORD flags,
             *vertex_remap_ptr++ = i;
     }
 
-    if (flags & D3DXMESHOPT_ATTRSORT)
+    if (flags & (D3DXMESHOPT_ATTRSORT | D3DXMESHOPT_VERTEXCACHE))
     {
         D3DXATTRIBUTERANGE *attrib_table;
         DWORD attrib_table_size;
@@ -1792,9 +2223,10 @@ static HRESULT WINAPI d3dx9_mesh_OptimizeInplace(ID3DXMesh *iface, DWORD flags,
             for (i = 0; i < This->numfaces; i++) {
                 DWORD old_pos = i * 3;
                 DWORD new_pos = face_remap[i] * 3;
-                adjacency_out[new_pos++] = face_remap[adjacency_in[old_pos++]];
-                adjacency_out[new_pos++] = face_remap[adjacency_in[old_pos++]];
-                adjacency_out[new_pos++] = face_remap[adjacency_in[old_pos++]];
+                DWORD j;
+
+                for (j = 0; j < 3; j++, old_pos++)
+                    adjacency_out[new_pos++] = adjacency_in[old_pos] == -1 ? -1 : face_remap[adjacency_in[old_pos]];
             }
         } else {
             memcpy(adjacency_out, adjacency_in, This->numfaces * 3 * sizeof(*adjacency_out));
@@ -7188,6 +7620,29 @@ cleanup:
     return hr;
 }
 
+static DWORD *get_dword_indices(const void *indices, DWORD num_indices, BOOL indices_are_32bit)
+{
+    DWORD *dword_indices;
+    DWORD i;
+
+    if (!(dword_indices = HeapAlloc(GetProcessHeap(), 0, num_indices * sizeof(*dword_indices))))
+        return NULL;
+
+    if (indices_are_32bit)
+    {
+        memcpy(dword_indices, indices, num_indices * sizeof(*dword_indices));
+    }
+    else
+    {
+        const WORD *word_indices = indices;
+
+        for (i = 0; i < num_indices; ++i)
+            dword_indices[i] = word_indices[i];
+    }
+
+    return dword_indices;
+}
+
 /*************************************************************************
  * D3DXOptimizeFaces    (D3DX9_36.@)
  *
@@ -7204,52 +7659,90 @@ cleanup:
  *   Success: D3D_OK.
  *   Failure: D3DERR_INVALIDCALL.
  *
- * BUGS
- *   The face re-ordering does not use the vertex cache optimally.
- *
  */
 HRESULT WINAPI D3DXOptimizeFaces(const void *indices, UINT num_faces,
         UINT num_vertices, BOOL indices_are_32bit, DWORD *face_remap)
 {
-    UINT i;
-    UINT j = num_faces - 1;
     UINT limit_16_bit = 2 << 15; /* According to MSDN */
-    HRESULT hr = D3D_OK;
+    DWORD *dword_indices;
+    HRESULT hr;
 
-    FIXME("indices %p, num_faces %u, num_vertices %u, indices_are_32bit %#x, face_remap %p semi-stub. "
-            "Face order will not be optimal.\n",
+    TRACE("indices %p, num_faces %u, num_vertices %u, indices_are_32bit %#x, face_remap %p.\n",
             indices, num_faces, num_vertices, indices_are_32bit, face_remap);
 
     if (!indices_are_32bit && num_faces >= limit_16_bit)
     {
         WARN("Number of faces must be less than %d when using 16-bit indices.\n",
              limit_16_bit);
-        hr = D3DERR_INVALIDCALL;
-        goto error;
+        return D3DERR_INVALIDCALL;
     }
 
     if (!face_remap)
     {
         WARN("Face remap pointer is NULL.\n");
-        hr = D3DERR_INVALIDCALL;
-        goto error;
+        return D3DERR_INVALIDCALL;
     }
 
-    /* The faces are drawn in reverse order for simple meshes. This ordering
-     * is not optimal for complicated meshes, but will not break anything
-     * either. The ordering should be changed to take advantage of the vertex
-     * cache on the graphics card.
-     *
-     * TODO Re-order to take advantage of vertex cache.
-     */
-    for (i = 0; i < num_faces; i++)
+    if (!(dword_indices = get_dword_indices(indices, num_faces * 3, indices_are_32bit)))
+        return E_OUTOFMEMORY;
+
+    hr = optimize_faces_for_vertex_cache(dword_indices, num_faces, num_vertices, face_remap);
+
+    HeapFree(GetProcessHeap(), 0, dword_indices);
+
+    return hr;
+}
+
+/*************************************************************************
+ * D3DXOptimizeVertices    (D3DX9_36.@)
+ *
+ * Re-orders the vertices so they are fetched sequentially.
+ *
+ * PARAMS
+ *   indices           [I] Pointer to an index buffer belonging to a mesh.
+ *   num_faces         [I] Number of faces in the mesh.
+ *   num_vertices      [I] Number of vertices in the mesh.
+ *   indices_are_32bit [I] Specifies whether indices are 32- or 16-bit.
+ *   vertex_remap      [I/O] For each new vertex, the index of the old vertex.
+ *
+ * RETURNS
+ *   Success: D3D_OK.
+ *   Failure: D3DERR_INVALIDCALL.
+ *
+ * NOTES
+ *   Vertices not referenced by any face are moved to the end.
+ *
+ */
+HRESULT WINAPI D3DXOptimizeVertices(const void *indices, UINT num_faces,
+        UINT num_vertices, BOOL indices_are_32bit, DWORD *vertex_remap)
+{
+    UINT limit_16_bit = 2 << 15; /* According to MSDN */
+    DWORD *dword_indices, num_used_vertices;
+    HRESULT hr;
+
+    TRACE("indices %p, num_faces %u, num_vertices %u, indices_are_32bit %#x, vertex_remap %p.\n",
+            indices, num_faces, num_vertices, indices_are_32bit, vertex_remap);
+
+    if (!indices_are_32bit && num_faces >= limit_16_bit)
     {
-        face_remap[i] = j--;
+        WARN("Number of faces must be less than %d when using 16-bit indices.\n",
+             limit_16_bit);
+        return D3DERR_INVALIDCALL;
     }
 
-    return D3D_OK;
+    if (!vertex_remap)
+    {
+        WARN("Vertex remap pointer is NULL.\n");
+        return D3DERR_INVALIDCALL;
+    }
+
+    if (!(dword_indices = get_dword_indices(indices, num_faces * 3, indices_are_32bit)))
+        return E_OUTOFMEMORY;
+
+    hr = optimize_vertices_for_fetch(dword_indices, num_faces, num_vertices, vertex_remap, &num_used_vertices);
+
+    HeapFree(GetProcessHeap(), 0, dword_indices);
 
-error:
     return hr;
 }
 
@@ -7530,16 +8023,444 @@ HRESULT WINAPI D3DXComputeNormals(struct ID3DXBaseMesh *mesh, const DWORD *adjac
             adjacency, -1.01f, -0.01f, -1.01f, NULL, NULL);
 }
 
+#define MESH_BVH_LEAF_SIZE 4
+#define MESH_BVH_MAX_DEPTH 64
+
+static float mesh_bvh_triangle_centroid(const struct mesh_bvh_triangle *triangle, unsigned int axis)
+{
+    const float *v0 = &triangle->v0.x, *edge1 = &triangle->edge1.x, *edge2 = &triangle->edge2.x;
+
+    return v0[axis] + (edge1[axis] + edge2[axis]) * (1.0f / 3.0f);
+}
+
+/* Partially sort the triangles along "axis", so that the triangle with the
+ * nth centroid ends up at index "nth". */
+static void mesh_bvh_select(struct mesh_bvh_triangle *triangles, DWORD start, DWORD end,
+        DWORD nth, unsigned int axis)
+{
+    struct mesh_bvh_triangle tmp;
+    DWORD lt, gt, i;
+    float pivot, c;
+
+    while (end - start > 1)
+    {
+        pivot = mesh_bvh_triangle_centroid(&triangles[start + (end - start) / 2], axis);
+        lt = i = start;
+        gt = end;
+        while (i < gt)
+        {
+            c = mesh_bvh_triangle_centroid(&triangles[i], axis);
+            if (c < pivot)
+            {
+                tmp = triangles[lt]; triangles[lt++] = triangles[i]; triangles[i++] = tmp;
+            }
+            else if (c > pivot)
+            {
+                tmp = triangles[--gt]; triangles[gt] = triangles[i]; triangles[i] = tmp;
+            }
+            else
+            {
+                ++i;
+            }
+        }
+
+        if (nth < lt)
+            end = lt;
+        else if (nth >= gt)
+            start = gt;
+        else
+            return;
+    }
+}
+
+static DWORD mesh_bvh_build_node(struct mesh_bvh *bvh, DWORD start, DWORD end)
+{
+    DWORD node_idx = bvh->node_count++, mid, i;
+    struct mesh_bvh_node *node = &bvh->nodes[node_idx];
+    D3DXVECTOR3 centroid_min, centroid_max, extent, v;
+    unsigned int axis;
+
+    node->min.x = node->min.y = node->min.z = centroid_min.x = centroid_min.y = centroid_min.z = FLT_MAX;
+    node->max.x = node->max.y = node->max.z = centroid_max.x = centroid_max.y = centroid_max.z = -FLT_MAX;
+    for (i = start; i < end; ++i)
+    {
+        const struct mesh_bvh_triangle *triangle = &bvh->triangles[i];
+
+        D3DXVec3Minimize(&node->min, &node->min, &triangle->v0);
+        D3DXVec3Maximize(&node->max, &node->max, &triangle->v0);
+        D3DXVec3Add(&v, &triangle->v0, &triangle->edge1);
+        D3DXVec3Minimize(&node->min, &node->min, &v);
+        D3DXVec3Maximize(&node->max, &node->max, &v);
+        D3DXVec3Add(&v, &triangle->v0, &triangle->edge2);
+        D3DXVec3Minimize(&node->min, &node->min, &v);
+        D3DXVec3Maximize(&node->max, &node->max, &v);
+
+        v.x = mesh_bvh_triangle_centroid(triangle, 0);
+        v.y = mesh_bvh_triangle_centroid(triangle, 1);
+        v.z = mesh_bvh_triangle_centroid(triangle, 2);
+        D3DXVec3Minimize(&centroid_min, &centroid_min, &v);
+        D3DXVec3Maximize(&centroid_max, &centroid_max, &v);
+    }
+
+    D3DXVec3Subtract(&extent, &centroid_max, &centroid_min);
+    if (end - start <= MESH_BVH_LEAF_SIZE || (!extent.x && !extent.y && !extent.z))
+    {
+        node->first = start;
+        node->count = end - start;
+        return node_idx;
+    }
+
+    /* Median split along the longest axis keeps the tree balanced, so its
+     * depth stays logarithmic in the face count. */
+    axis = extent.x >= extent.y ? (extent.x >= extent.z ? 0 : 2) : (extent.y >= extent.z ? 1 : 2);
+    mid = start + (end - start) / 2;
+    mesh_bvh_select(bvh->triangles, start, end, mid, axis);
+
+    mesh_bvh_build_node(bvh, start, mid);
+    node->first = mesh_bvh_build_node(bvh, mid, end);
+    node->count = 0;
+
+    return node_idx;
+}
+
+static HRESULT mesh_bvh_create(struct d3dx9_mesh *mesh, struct mesh_bvh **out)
+{
+    const D3DVERTEXELEMENT9 *position = NULL;
+    DWORD vertex_size, i, j, index[3];
+    struct mesh_bvh *bvh;
+    BYTE *vertices;
+    void *indices;
+    HRESULT hr;
+
+    for (i = 0; mesh->cached_declaration[i].Stream != 0xff; ++i)
+    {
+        if (mesh->cached_declaration[i].Usage == D3DDECLUSAGE_POSITION
+                && !mesh->cached_declaration[i].UsageIndex)
+        {
+            position = &mesh->cached_declaration[i];
+            break;
+        }
+    }
+    if (!position || (position->Type != D3DDECLTYPE_FLOAT3 && position->Type != D3DDECLTYPE_FLOAT4))
+    {
+        WARN("Mesh has no usable position element.\n");
+        return D3DERR_INVALIDCALL;
+    }
+    vertex_size = mesh->vertex_declaration_size;
+
+    if (!(bvh = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(*bvh))))
+        return E_OUTOFMEMORY;
+    bvh->triangles = HeapAlloc(GetProcessHeap(), 0, max(mesh->numfaces, 1) * sizeof(*bvh->triangles));
+    bvh->nodes = HeapAlloc(GetProcessHeap(), 0, max(2 * mesh->numfaces, 1) * sizeof(*bvh->nodes));
+    if (!bvh->triangles || !bvh->nodes)
+    {
+        mesh_bvh_destroy(bvh);
+        return E_OUTOFMEMORY;
+    }
+
+    if (FAILED(hr = IDirect3DIndexBuffer9_Lock(mesh->index_buffer, 0, 0, &indices, D3DLOCK_READONLY)))
+    {
+        mesh_bvh_destroy(bvh);
+        return hr;
+    }
+    if (FAILED(hr = IDirect3DVertexBuffer9_Lock(mesh->vertex_buffer, 0, 0, (void **)&vertices, D3DLOCK_READONLY)))
+    {
+        IDirect3DIndexBuffer9_Unlock(mesh->index_buffer);
+        mesh_bvh_destroy(bvh);
+        return hr;
+    }
+
+    for (i = 0; i < mesh->numfaces; ++i)
+    {
+        struct mesh_bvh_triangle *triangle = &bvh->triangles[bvh->triangle_count];
+        D3DXVECTOR3 p[3];
+
+        for (j = 0; j < 3; ++j)
+        {
+            index[j] = read_ib(indices, mesh->options & D3DXMESH_32BIT, i * 3 + j);
+            if (index[j] >= mesh->numvertices)
+                break;
+            p[j] = *(const D3DXVECTOR3 *)(vertices + index[j] * vertex_size + position->Offset);
+        }
+        if (j < 3)
+        {
+            WARN("Skipping face %u with out of range index %u.\n", i, index[j]);
+            continue;
+        }
+
+        triangle->v0 = p[0];
+        D3DXVec3Subtract(&triangle->edge1, &p[1], &p[0]);
+        D3DXVec3Subtract(&triangle->edge2, &p[2], &p[0]);
+        triangle->face = i;
+        ++bvh->triangle_count;
+    }
+
+    IDirect3DVertexBuffer9_Unlock(mesh->vertex_buffer);
+    IDirect3DIndexBuffer9_Unlock(mesh->index_buffer);
+
+    if (bvh->triangle_count)
+        mesh_bvh_build_node(bvh, 0, bvh->triangle_count);
+
+    TRACE("Built BVH with %u nodes for %u faces.\n", bvh->node_count, bvh->triangle_count);
+
+    *out = bvh;
+    return D3D_OK;
+}
+
+/* Same result as D3DXIntersectTri(), using the Moller-Trumbore test. */
+static BOOL mesh_bvh_intersect_triangle(const struct mesh_bvh_triangle *triangle,
+        const D3DXVECTOR3 *ray_pos, const D3DXVECTOR3 *ray_dir, float *u, float *v, float *dist)
+{
+    D3DXVECTOR3 p, q, s;
+    float det, inv_det;
+
+    D3DXVec3Cross(&p, ray_dir, &triangle->edge2);
+    if (!(det = D3DXVec3Dot(&triangle->edge1, &p)))
+        return FALSE;
+    inv_det = 1.0f / det;
+
+    D3DXVec3Subtract(&s, ray_pos, &triangle->v0);
+    *u = D3DXVec3Dot(&s, &p) * inv_det;
+    if (*u < 0.0f || *u > 1.0f)
+        return FALSE;
+
+    D3DXVec3Cross(&q, &s, &triangle->edge1);
+    *v = D3DXVec3Dot(ray_dir, &q) * inv_det;
+    if (*v < 0.0f || *u + *v > 1.0f)
+        return FALSE;
+
+    *dist = D3DXVec3Dot(&triangle->edge2, &q) * inv_det;
+    return *dist >= 0.0f;
+}
+
+/* Slab test. The comparisons are false for the NaNs coming from rays lying on
+ * a slab plane, which keeps the test conservative. */
+static BOOL mesh_bvh_intersect_node(const struct mesh_bvh_node *node, const D3DXVECTOR3 *ray_pos,
+        const D3DXVECTOR3 *inv_dir, float max_dist)
+{
+    const float *min = &node->min.x, *max = &node->max.x, *pos = &ray_pos->x, *inv = &inv_dir->x;
+    float t1, t2, tmp, t_min = 0.0f, t_max = max_dist;
+    unsigned int i;
+
+    for (i = 0; i < 3; ++i)
+    {
+        t1 = (min[i] - pos[i]) * inv[i];
+        t2 = (max[i] - pos[i]) * inv[i];
+        if (t1 > t2)
+        {
+            tmp = t1; t1 = t2; t2 = tmp;
+        }
+        if (t1 > t_min)
+            t_min = t1;
+        if (t2 < t_max)
+            t_max = t2;
+    }
+
+    return t_min <= t_max;
+}
+
+struct mesh_intersect_hits
+{
+    BOOL find_all;
+    D3DXINTERSECTINFO closest;
+    D3DXINTERSECTINFO *hits;
+    DWORD count, size;
+};
+
+static int __cdecl intersect_info_compare(const void *a, const void *b)
+{
+    const D3DXINTERSECTINFO *info_a = a, *info_b = b;
+
+    return info_a->FaceIndex < info_b->FaceIndex ? -1 : info_a->FaceIndex > info_b->FaceIndex;
+}
+
+/* Trace a ray through the BVH. Only the closest hit is looked for unless
+ * hits->find_all is set. Every hit is recorded if hits->hits is non-NULL. */
+static HRESULT mesh_bvh_intersect(const struct mesh_bvh *bvh, const DWORD *attrib_buffer, DWORD attrib_id,
+        const D3DXVECTOR3 *ray_pos, const D3DXVECTOR3 *ray_dir, struct mesh_intersect_hits *hits)
+{
+    DWORD stack[MESH_BVH_MAX_DEPTH], stack_size = 0, i;
+    D3DXVECTOR3 inv_dir;
+    float u, v, dist;
+
+    hits->count = 0;
+    hits->closest.Dist = FLT_MAX;
+    if (!bvh->triangle_count)
+        return D3D_OK;
+
+    inv_dir.x = 1.0f / ray_dir->x;
+    inv_dir.y = 1.0f / ray_dir->y;
+    inv_dir.z = 1.0f / ray_dir->z;
+
+    stack[stack_size++] = 0;
+    while (stack_size)
+    {
+        const struct mesh_bvh_node *node = &bvh->nodes[stack[--stack_size]];
+
+        if (!mesh_bvh_intersect_node(node, ray_pos, &inv_dir, hits->find_all ? FLT_MAX : hits->closest.Dist))
+            continue;
+
+        if (node->count)
+        {
+            for (i = node->first; i < node->first + node->count; ++i)
+            {
+                const struct mesh_bvh_triangle *triangle = &bvh->triangles[i];
+
+                if (attrib_buffer && attrib_buffer[triangle->face] != attrib_id)
+                    continue;
+                if (!mesh_bvh_intersect_triangle(triangle, ray_pos, ray_dir, &u, &v, &dist))
+                    continue;
+
+                if (dist < hits->closest.Dist || (dist == hits->closest.Dist && triangle->face < hits->closest.FaceIndex))
+                {
+                    hits->closest.FaceIndex = triangle->face;
+                    hits->closest.U = u;
+                    hits->closest.V = v;
+                    hits->closest.Dist = dist;
+                }
+
+                if (hits->hits)
+                {
+                    if (hits->count == hits->size)
+                    {
+                        D3DXINTERSECTINFO *new_hits;
+
+                        if (!(new_hits = HeapReAlloc(GetProcessHeap(), 0, hits->hits, 2 * hits->size * sizeof(*new_hits))))
+                            return E_OUTOFMEMORY;
+                        hits->hits = new_hits;
+                        hits->size *= 2;
+                    }
+                    hits->hits[hits->count].FaceIndex = triangle->face;
+                    hits->hits[hits->count].U = u;
+                    hits->hits[hits->count].V = v;
+                    hits->hits[hits->count].Dist = dist;
+                }
+                ++hits->count;
+            }
+        }
+        else
+        {
+            stack[stack_size++] = node->first;
+            stack[stack_size++] = node - bvh->nodes + 1;
+        }
+    }
+
+    if (hits->hits)
+        qsort(hits->hits, hits->count, sizeof(*hits->hits), intersect_info_compare);
+
+    return D3D_OK;
+}
+
+static HRESULT mesh_intersect(ID3DXBaseMesh *iface, const DWORD *attrib_id, const D3DXVECTOR3 *ray_pos,
+        const D3DXVECTOR3 *ray_dir, BOOL *hit, DWORD *face_index, float *u, float *v, float *distance,
+        ID3DXBuffer **all_hits, DWORD *count_of_hits)
+{
+    struct mesh_intersect_hits hits = {0};
+    struct d3dx9_mesh *mesh;
+    HRESULT hr;
+
+    if (!iface || !ray_pos || !ray_dir || !hit)
+        return D3DERR_INVALIDCALL;
+
+    if ((ID3DXMeshVtbl *)iface->lpVtbl != &D3DXMesh_Vtbl)
+    {
+        ERR("Invalid virtual table\n");
+        return D3DERR_INVALIDCALL;
+    }
+    mesh = impl_from_ID3DXMesh((ID3DXMesh *)iface);
+
+    if (!mesh->bvh && FAILED(hr = mesh_bvh_create(mesh, &mesh->bvh)))
+        return hr;
+
+    hits.find_all = all_hits || count_of_hits;
+    if (all_hits)
+    {
+        hits.size = 16;
+        if (!(hits.hits = HeapAlloc(GetProcessHeap(), 0, hits.size * sizeof(*hits.hits))))
+            return E_OUTOFMEMORY;
+    }
+
+    if (FAILED(hr = mesh_bvh_intersect(mesh->bvh, attrib_id ? mesh->attrib_buffer : NULL,
+            attrib_id ? *attrib_id : 0, ray_pos, ray_dir, &hits)))
+    {
+        HeapFree(GetProcessHeap(), 0, hits.hits);
+        return hr;
+    }
+
+    *hit = !!hits.count;
+    if (hits.count)
+    {
+        if (face_index) *face_index = hits.closest.FaceIndex;
+        if (u) *u = hits.closest.U;
+        if (v) *v = hits.closest.V;
+        if (distance) *distance = hits.closest.Dist;
+    }
+    if (count_of_hits)
+        *count_of_hits = hits.count;
+    if (all_hits)
+    {
+        *all_hits = NULL;
+        if (hits.count && SUCCEEDED(hr = D3DXCreateBuffer(hits.count * sizeof(*hits.hits), all_hits)))
+            memcpy(ID3DXBuffer_GetBufferPointer(*all_hits), hits.hits, hits.count * sizeof(*hits.hits));
+    }
+
+    HeapFree(GetProcessHeap(), 0, hits.hits);
+
+    return hr;
+}
+
 /*************************************************************************
  * D3DXIntersect    (D3DX9_36.@)
+ *
+ * Intersects a ray with a mesh.
+ *
+ * PARAMS
+ *   mesh          [I] Mesh to intersect.
+ *   ray_pos       [I] Origin of the ray.
+ *   ray_dir       [I] Direction of the ray.
+ *   hit           [O] Whether the ray hits any face.
+ *   face_index    [O] Index of the closest face hit.
+ *   u, v          [O] Barycentric coordinates of the closest hit.
+ *   distance      [O] Distance to the closest hit, in units of ray_dir.
+ *   all_hits      [O] Buffer of D3DXINTERSECTINFO for every face hit.
+ *   count_of_hits [O] Number of faces hit.
+ *
+ * RETURNS
+ *   Success: D3D_OK.
+ *   Failure: D3DERR_INVALIDCALL or E_OUTOFMEMORY.
+ *
+ * NOTES
+ *   A bounding volume hierarchy of the faces is built on the first call
+ *   and kept with the mesh until the vertex or index buffer is locked for
+ *   writing through the mesh.
+ *
  */
 HRESULT WINAPI D3DXIntersect(ID3DXBaseMesh *mesh, const D3DXVECTOR3 *ray_pos, const D3DXVECTOR3 *ray_dir,
         BOOL *hit, DWORD *face_index, float *u, float *v, float *distance, ID3DXBuffer **all_hits, DWORD *count_of_hits)
 {
-    FIXME("mesh %p, ray_pos %p, ray_dir %p, hit %p, face_index %p, u %p, v %p, distance %p, all_hits %p, "
-            "count_of_hits %p stub!\n", mesh, ray_pos, ray_dir, hit, face_index, u, v, distance, all_hits, count_of_hits);
+    TRACE("mesh %p, ray_pos %p, ray_dir %p, hit %p, face_index %p, u %p, v %p, distance %p, all_hits %p, "
+            "count_of_hits %p.\n", mesh, ray_pos, ray_dir, hit, face_index, u, v, distance, all_hits, count_of_hits);
 
-    return E_NOTIMPL;
+    return mesh_intersect(mesh, NULL, ray_pos, ray_dir, hit, face_index, u, v, distance, all_hits, count_of_hits);
+}
+
+/*************************************************************************
+ * D3DXIntersectSubset    (D3DX9_36.@)
+ *
+ * Same as D3DXIntersect(), only considering the faces with the given
+ * attribute.
+ *
+ */
+HRESULT WINAPI D3DXIntersectSubset(ID3DXBaseMesh *mesh, DWORD attribute_id, const D3DXVECTOR3 *ray_pos,
+        const D3DXVECTOR3 *ray_dir, BOOL *hit, DWORD *face_index, float *u, float *v, float *distance,
+        ID3DXBuffer **all_hits, DWORD *count_of_hits)
+{
+    TRACE("mesh %p, attribute_id %u, ray_pos %p, ray_dir %p, hit %p, face_index %p, u %p, v %p, distance %p, "
+            "all_hits %p, count_of_hits %p.\n", mesh, attribute_id, ray_pos, ray_dir, hit, face_index, u, v,
+            distance, all_hits, count_of_hits);
+
+    return mesh_intersect(mesh, &attribute_id, ray_pos, ray_dir, hit, face_index, u, v, distance,
+            all_hits, count_of_hits);
 }
 
 HRESULT WINAPI D3DXTessellateNPatches(ID3DXMesh *mesh, const DWORD *adjacency_in, float num_segs,
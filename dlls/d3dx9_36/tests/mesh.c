@@ -10556,6 +10556,368 @@ static void test_optimize_faces(void)
     ok(hr == D3DERR_INVALIDCALL, "Got unexpected hr %#x.\n", hr);
 }
 
+/* Average number of vertex cache misses per face, for a 16 entries FIFO cache. */
+static float get_acmr(const void *indices, BOOL indices_are_32bit, const DWORD *face_remap, DWORD num_faces)
+{
+    DWORD cache[16], cache_pos = 0, misses = 0;
+    DWORD i, j, k;
+
+    memset(cache, 0xff, sizeof(cache));
+    for (i = 0; i < num_faces; ++i)
+    {
+        DWORD face = face_remap ? face_remap[i] : i;
+
+        for (j = 0; j < 3; ++j)
+        {
+            DWORD index = indices_are_32bit ? ((const DWORD *)indices)[face * 3 + j]
+                    : ((const WORD *)indices)[face * 3 + j];
+
+            for (k = 0; k < ARRAY_SIZE(cache); ++k)
+            {
+                if (cache[k] == index)
+                    break;
+            }
+            if (k == ARRAY_SIZE(cache))
+            {
+                cache[cache_pos] = index;
+                cache_pos = (cache_pos + 1) % ARRAY_SIZE(cache);
+                ++misses;
+            }
+        }
+    }
+
+    return (float)misses / num_faces;
+}
+
+static BOOL is_permutation(const DWORD *remap, DWORD count)
+{
+    BOOL ret = TRUE;
+    BYTE *used;
+    DWORD i;
+
+    used = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, count);
+    for (i = 0; i < count; ++i)
+    {
+        if (remap[i] >= count || used[remap[i]])
+        {
+            ret = FALSE;
+            break;
+        }
+        used[remap[i]] = 1;
+    }
+    HeapFree(GetProcessHeap(), 0, used);
+
+    return ret;
+}
+
+static void test_optimize_vertex_cache(void)
+{
+    static const char *mesh_names[] = {"box", "sphere", "cylinder", "torus"};
+    float acmr, optimized_acmr, shuffled_acmr;
+    struct test_context *test_context;
+    DWORD num_faces, num_vertices;
+    ID3DXBuffer *vertex_remap_buffer;
+    DWORD *face_remap, *vertex_remap;
+    WORD *shuffled_indices, *indices;
+    ID3DXBuffer *adjacency;
+    IDirect3DDevice9 *device;
+    DWORD i, j, seed;
+    ID3DXMesh *mesh;
+    HRESULT hr;
+
+    if (!(test_context = new_test_context()))
+    {
+        skip("Couldn't create test context.\n");
+        return;
+    }
+    device = test_context->device;
+
+    for (i = 0; i < ARRAY_SIZE(mesh_names); ++i)
+    {
+        switch (i)
+        {
+            case 0:
+                hr = D3DXCreateBox(device, 1.0f, 1.0f, 1.0f, &mesh, &adjacency);
+                break;
+            case 1:
+                hr = D3DXCreateSphere(device, 1.0f, 32, 32, &mesh, &adjacency);
+                break;
+            case 2:
+                hr = D3DXCreateCylinder(device, 1.0f, 0.5f, 2.0f, 32, 16, &mesh, &adjacency);
+                break;
+            default:
+                hr = D3DXCreateTorus(device, 0.5f, 1.0f, 32, 32, &mesh, &adjacency);
+                break;
+        }
+        ok(hr == D3D_OK, "Failed to create %s, hr %#x.\n", mesh_names[i], hr);
+        ok(!(mesh->lpVtbl->GetOptions(mesh) & D3DXMESH_32BIT), "Got unexpected 32-bit indices.\n");
+
+        num_faces = mesh->lpVtbl->GetNumFaces(mesh);
+        num_vertices = mesh->lpVtbl->GetNumVertices(mesh);
+        face_remap = HeapAlloc(GetProcessHeap(), 0, num_faces * sizeof(*face_remap));
+        vertex_remap = HeapAlloc(GetProcessHeap(), 0, num_vertices * sizeof(*vertex_remap));
+        shuffled_indices = HeapAlloc(GetProcessHeap(), 0, num_faces * 3 * sizeof(*shuffled_indices));
+
+        hr = mesh->lpVtbl->LockIndexBuffer(mesh, D3DLOCK_READONLY, (void **)&indices);
+        ok(hr == D3D_OK, "Failed to lock index buffer, hr %#x.\n", hr);
+
+        hr = D3DXOptimizeFaces(indices, num_faces, num_vertices, FALSE, face_remap);
+        ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+        ok(is_permutation(face_remap, num_faces), "Face remap of %s is not a permutation.\n", mesh_names[i]);
+        acmr = get_acmr(indices, FALSE, NULL, num_faces);
+        optimized_acmr = get_acmr(indices, FALSE, face_remap, num_faces);
+        ok(optimized_acmr <= acmr, "Got ACMR %.3f for %s, original ACMR %.3f.\n",
+                optimized_acmr, mesh_names[i], acmr);
+        trace("%s: %u faces, ACMR %.3f, optimized %.3f.\n", mesh_names[i], num_faces, acmr, optimized_acmr);
+
+        /* Shuffle the faces to destroy the locality of the generated mesh. */
+        memcpy(shuffled_indices, indices, num_faces * 3 * sizeof(*shuffled_indices));
+        for (j = num_faces - 1, seed = 12345; j > 0; --j)
+        {
+            DWORD k = (seed = seed * 1103515245 + 12345) % (j + 1);
+            WORD tmp[3];
+
+            memcpy(tmp, &shuffled_indices[j * 3], sizeof(tmp));
+            memcpy(&shuffled_indices[j * 3], &shuffled_indices[k * 3], sizeof(tmp));
+            memcpy(&shuffled_indices[k * 3], tmp, sizeof(tmp));
+        }
+
+        mesh->lpVtbl->UnlockIndexBuffer(mesh);
+
+        hr = D3DXOptimizeFaces(shuffled_indices, num_faces, num_vertices, FALSE, face_remap);
+        ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+        ok(is_permutation(face_remap, num_faces), "Face remap of %s is not a permutation.\n", mesh_names[i]);
+        shuffled_acmr = get_acmr(shuffled_indices, FALSE, NULL, num_faces);
+        optimized_acmr = get_acmr(shuffled_indices, FALSE, face_remap, num_faces);
+        ok(optimized_acmr <= shuffled_acmr, "Got ACMR %.3f for shuffled %s, original ACMR %.3f.\n",
+                optimized_acmr, mesh_names[i], shuffled_acmr);
+        trace("shuffled %s: ACMR %.3f, optimized %.3f.\n", mesh_names[i], shuffled_acmr, optimized_acmr);
+
+        hr = D3DXOptimizeVertices(shuffled_indices, num_faces, num_vertices, FALSE, vertex_remap);
+        ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+        ok(is_permutation(vertex_remap, num_vertices), "Vertex remap of %s is not a permutation.\n", mesh_names[i]);
+
+        hr = mesh->lpVtbl->OptimizeInplace(mesh, D3DXMESHOPT_VERTEXCACHE,
+                ID3DXBuffer_GetBufferPointer(adjacency), NULL, face_remap, &vertex_remap_buffer);
+        ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+        ok(mesh->lpVtbl->GetNumFaces(mesh) == num_faces, "Got unexpected face count %u.\n",
+                mesh->lpVtbl->GetNumFaces(mesh));
+        ok(mesh->lpVtbl->GetNumVertices(mesh) == num_vertices, "Got unexpected vertex count %u.\n",
+                mesh->lpVtbl->GetNumVertices(mesh));
+        ok(is_permutation(face_remap, num_faces), "Face remap of %s is not a permutation.\n", mesh_names[i]);
+        ok(is_permutation(ID3DXBuffer_GetBufferPointer(vertex_remap_buffer), num_vertices),
+                "Vertex remap of %s is not a permutation.\n", mesh_names[i]);
+        ID3DXBuffer_Release(vertex_remap_buffer);
+
+        hr = mesh->lpVtbl->LockIndexBuffer(mesh, D3DLOCK_READONLY, (void **)&indices);
+        ok(hr == D3D_OK, "Failed to lock index buffer, hr %#x.\n", hr);
+        optimized_acmr = get_acmr(indices, FALSE, NULL, num_faces);
+        ok(optimized_acmr <= acmr, "Got ACMR %.3f for %s, original ACMR %.3f.\n",
+                optimized_acmr, mesh_names[i], acmr);
+        mesh->lpVtbl->UnlockIndexBuffer(mesh);
+
+        HeapFree(GetProcessHeap(), 0, shuffled_indices);
+        HeapFree(GetProcessHeap(), 0, vertex_remap);
+        HeapFree(GetProcessHeap(), 0, face_remap);
+        ID3DXBuffer_Release(adjacency);
+        mesh->lpVtbl->Release(mesh);
+    }
+
+    free_test_context(test_context);
+}
+
+static float intersect_test_rand(DWORD *seed)
+{
+    *seed = *seed * 1103515245 + 12345;
+    return (*seed >> 8) / (float)(1u << 24);
+}
+
+static void test_intersect(void)
+{
+    DWORD face_index, hit_count, exp_face_index, exp_hit_count, num_faces, seed, i, j;
+    float u, v, distance, exp_u, exp_v, exp_distance, hit_u, hit_v, hit_distance, radius_sq;
+    struct test_context *test_context;
+    D3DXINTERSECTINFO *intersect_info;
+    D3DXVECTOR3 ray_pos, ray_dir;
+    IDirect3DDevice9 *device;
+    D3DXVECTOR3 *vertices;
+    DWORD *attributes;
+    ID3DXBuffer *hits;
+    ID3DXMesh *mesh;
+    WORD *indices;
+    HRESULT hr;
+    BOOL hit;
+
+    if (!(test_context = new_test_context()))
+    {
+        skip("Couldn't create test context.\n");
+        return;
+    }
+    device = test_context->device;
+
+    /* The sphere vertices are a position followed by a normal. */
+    hr = D3DXCreateSphere(device, 1.0f, 32, 16, &mesh, NULL);
+    ok(hr == D3D_OK, "Failed to create sphere, hr %#x.\n", hr);
+    num_faces = mesh->lpVtbl->GetNumFaces(mesh);
+
+    /* Put the odd faces in subset 1. */
+    hr = mesh->lpVtbl->LockAttributeBuffer(mesh, 0, &attributes);
+    ok(hr == D3D_OK, "Failed to lock attribute buffer, hr %#x.\n", hr);
+    for (i = 0; i < num_faces; ++i)
+        attributes[i] = i & 1;
+    mesh->lpVtbl->UnlockAttributeBuffer(mesh);
+
+    hr = mesh->lpVtbl->LockVertexBuffer(mesh, D3DLOCK_READONLY, (void **)&vertices);
+    ok(hr == D3D_OK, "Failed to lock vertex buffer, hr %#x.\n", hr);
+    hr = mesh->lpVtbl->LockIndexBuffer(mesh, D3DLOCK_READONLY, (void **)&indices);
+    ok(hr == D3D_OK, "Failed to lock index buffer, hr %#x.\n", hr);
+
+    /* Compare against D3DXIntersectTri() on every face. */
+    for (i = 0, seed = 1; i < 64; ++i)
+    {
+        DWORD subset = i & 1;
+
+        ray_pos.x = intersect_test_rand(&seed) * 4.0f - 2.0f;
+        ray_pos.y = intersect_test_rand(&seed) * 4.0f - 2.0f;
+        ray_pos.z = intersect_test_rand(&seed) * 4.0f - 2.0f;
+        ray_dir.x = intersect_test_rand(&seed) - 0.5f - ray_pos.x;
+        ray_dir.y = intersect_test_rand(&seed) - 0.5f - ray_pos.y;
+        ray_dir.z = intersect_test_rand(&seed) - 0.5f - ray_pos.z;
+
+        exp_face_index = ~0u;
+        exp_hit_count = 0;
+        exp_distance = FLT_MAX;
+        exp_u = exp_v = 0.0f;
+        for (j = 0; j < num_faces; ++j)
+        {
+            if (!D3DXIntersectTri(&vertices[indices[j * 3] * 2], &vertices[indices[j * 3 + 1] * 2],
+                    &vertices[indices[j * 3 + 2] * 2], &ray_pos, &ray_dir, &hit_u, &hit_v, &hit_distance))
+                continue;
+            if (i & 2 && (j & 1) != subset)
+                continue;
+            ++exp_hit_count;
+            if (hit_distance < exp_distance)
+            {
+                exp_face_index = j;
+                exp_distance = hit_distance;
+                exp_u = hit_u;
+                exp_v = hit_v;
+            }
+        }
+
+        hits = NULL;
+        hit_count = 0xdeadbeef;
+        if (i & 2)
+            hr = D3DXIntersectSubset((ID3DXBaseMesh *)mesh, subset, &ray_pos, &ray_dir, &hit,
+                    &face_index, &u, &v, &distance, &hits, &hit_count);
+        else
+            hr = D3DXIntersect((ID3DXBaseMesh *)mesh, &ray_pos, &ray_dir, &hit,
+                    &face_index, &u, &v, &distance, &hits, &hit_count);
+        ok(hr == D3D_OK, "Ray %u: got unexpected hr %#x.\n", i, hr);
+        ok(hit == !!exp_hit_count, "Ray %u: got unexpected hit %#x.\n", i, hit);
+        ok(hit_count == exp_hit_count, "Ray %u: got %u hits, expected %u.\n", i, hit_count, exp_hit_count);
+        if (!hit)
+        {
+            if (hits)
+                ID3DXBuffer_Release(hits);
+            continue;
+        }
+
+        ok(face_index == exp_face_index, "Ray %u: got face %u, expected %u.\n", i, face_index, exp_face_index);
+        ok(compare(distance, exp_distance), "Ray %u: got distance %.8e, expected %.8e.\n",
+                i, distance, exp_distance);
+        ok(compare(u, exp_u), "Ray %u: got u %.8e, expected %.8e.\n", i, u, exp_u);
+        ok(compare(v, exp_v), "Ray %u: got v %.8e, expected %.8e.\n", i, v, exp_v);
+
+        ok(!!hits, "Ray %u: got NULL hits buffer.\n", i);
+        ok(ID3DXBuffer_GetBufferSize(hits) == hit_count * sizeof(*intersect_info),
+                "Ray %u: got unexpected buffer size %u.\n", i, ID3DXBuffer_GetBufferSize(hits));
+        intersect_info = ID3DXBuffer_GetBufferPointer(hits);
+        for (j = 0; j < hit_count; ++j)
+        {
+            if (intersect_info[j].FaceIndex == face_index)
+                break;
+        }
+        ok(j < hit_count, "Ray %u: closest face %u not found in the hits.\n", i, face_index);
+        ID3DXBuffer_Release(hits);
+    }
+
+    mesh->lpVtbl->UnlockIndexBuffer(mesh);
+    mesh->lpVtbl->UnlockVertexBuffer(mesh);
+
+    /* Writing to the vertex buffer updates the result. */
+    ray_pos.x = 0.01f;
+    ray_pos.y = 0.02f;
+    ray_pos.z = -4.0f;
+    ray_dir.x = 0.0f;
+    ray_dir.y = 0.0f;
+    ray_dir.z = 1.0f;
+    hr = D3DXIntersect((ID3DXBaseMesh *)mesh, &ray_pos, &ray_dir, &hit, NULL, NULL, NULL, &distance, NULL, NULL);
+    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+    ok(hit, "Got unexpected hit %#x.\n", hit);
+    ok(distance > 2.99f && distance < 3.1f, "Got unexpected distance %.8e.\n", distance);
+
+    hr = mesh->lpVtbl->LockVertexBuffer(mesh, 0, (void **)&vertices);
+    ok(hr == D3D_OK, "Failed to lock vertex buffer, hr %#x.\n", hr);
+    for (i = 0; i < mesh->lpVtbl->GetNumVertices(mesh); ++i)
+        D3DXVec3Scale(&vertices[i * 2], &vertices[i * 2], 2.0f);
+    mesh->lpVtbl->UnlockVertexBuffer(mesh);
+
+    hr = D3DXIntersect((ID3DXBaseMesh *)mesh, &ray_pos, &ray_dir, &hit, NULL, NULL, NULL, &distance, NULL, NULL);
+    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+    ok(hit, "Got unexpected hit %#x.\n", hit);
+    ok(distance > 1.99f && distance < 2.1f, "Got unexpected distance %.8e.\n", distance);
+
+    /* Intersecting while the vertex buffer is locked for writing doesn't
+     * keep results from the partially written data. */
+    hr = mesh->lpVtbl->LockVertexBuffer(mesh, 0, (void **)&vertices);
+    ok(hr == D3D_OK, "Failed to lock vertex buffer, hr %#x.\n", hr);
+    hr = D3DXIntersect((ID3DXBaseMesh *)mesh, &ray_pos, &ray_dir, &hit, NULL, NULL, NULL, &distance, NULL, NULL);
+    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+    ok(hit, "Got unexpected hit %#x.\n", hit);
+    ok(distance > 1.99f && distance < 2.1f, "Got unexpected distance %.8e.\n", distance);
+    for (i = 0; i < mesh->lpVtbl->GetNumVertices(mesh); ++i)
+        D3DXVec3Scale(&vertices[i * 2], &vertices[i * 2], 0.5f);
+    mesh->lpVtbl->UnlockVertexBuffer(mesh);
+
+    hr = D3DXIntersect((ID3DXBaseMesh *)mesh, &ray_pos, &ray_dir, &hit, NULL, NULL, NULL, &distance, NULL, NULL);
+    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+    ok(hit, "Got unexpected hit %#x.\n", hit);
+    ok(distance > 2.99f && distance < 3.1f, "Got unexpected distance %.8e.\n", distance);
+
+    ray_pos.x = 3.0f;
+    hr = D3DXIntersect((ID3DXBaseMesh *)mesh, &ray_pos, &ray_dir, &hit, NULL, NULL, NULL, NULL, NULL, &hit_count);
+    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+    ok(!hit, "Got unexpected hit %#x.\n", hit);
+    ok(!hit_count, "Got unexpected hit count %u.\n", hit_count);
+
+    mesh->lpVtbl->Release(mesh);
+
+    /* Picking on a high-poly mesh. */
+    hr = D3DXCreateSphere(device, 1.0f, 255, 255, &mesh, NULL);
+    ok(hr == D3D_OK, "Failed to create sphere, hr %#x.\n", hr);
+
+    for (i = 0, seed = 1; i < 64; ++i)
+    {
+        ray_pos.x = intersect_test_rand(&seed) * 4.0f - 2.0f;
+        ray_pos.y = intersect_test_rand(&seed) * 4.0f - 2.0f;
+        ray_pos.z = -4.0f;
+        ray_dir.x = 0.0f;
+        ray_dir.y = 0.0f;
+        ray_dir.z = 1.0f;
+        hr = D3DXIntersect((ID3DXBaseMesh *)mesh, &ray_pos, &ray_dir, &hit, &face_index, NULL, NULL, NULL,
+                NULL, NULL);
+        ok(hr == D3D_OK, "Ray %u: got unexpected hr %#x.\n", i, hr);
+        radius_sq = ray_pos.x * ray_pos.x + ray_pos.y * ray_pos.y;
+        if (radius_sq < 0.99f || radius_sq > 1.0f)
+            ok(hit == (radius_sq < 0.99f), "Ray %u: got unexpected hit %#x.\n", i, hit);
+    }
+
+    mesh->lpVtbl->Release(mesh);
+
+    free_test_context(test_context);
+}
+
 static HRESULT clear_normals(ID3DXMesh *mesh)
 {
     HRESULT hr;
@@ -11494,6 +11856,8 @@ START_TEST(mesh)
     test_clone_mesh();
     test_valid_mesh();
     test_optimize_faces();
+    test_optimize_vertex_cache();
+    test_intersect();
     test_compute_normals();
     test_D3DXFrameFind();
     test_load_skin_mesh_from_xof();
@@ -61,6 +61,7 @@ static void (WINAPI *pRtlInitAnsiString)(PANSI_STRING,PCSZ);
 static void (WINAPI *pRtlFreeUnicodeString)(PUNICODE_STRING);
 static BOOL (WINAPI *pSetFileCompletionNotificationModes)(HANDLE, UCHAR);
 static HANDLE (WINAPI *pFindFirstStreamW)(LPCWSTR filename, STREAM_INFO_LEVELS infolevel, void *data, DWORD flags);
+static BOOL (WINAPI *pCancelIoEx)(HANDLE, LPOVERLAPPED);
 
 static char filename[MAX_PATH];
 static const char sillytext[] =
@@ -112,6 +113,7 @@ static void InitFunctionPointers(void)
     pReOpenFile = (void *) GetProcAddress(hkernel32, "ReOpenFile");
     pSetFileCompletionNotificationModes = (void *)GetProcAddress(hkernel32, "SetFileCompletionNotificationModes");
     pFindFirstStreamW = (void *)GetProcAddress(hkernel32, "FindFirstStreamW");
+    pCancelIoEx = (void *)GetProcAddress(hkernel32, "CancelIoEx");
 }
 
 static void create_file( const char *path )
@@ -3518,6 +3520,129 @@ static void test_overlapped(void)
     ok( r == TRUE, "close handle failed\n");
 }
 
+static void test_overlapped_file_io(void)
+{
+    static const DWORD chunk_size = 0x10000;
+    char temp_path[MAX_PATH], filename[MAX_PATH];
+    HANDLE file, file2, port, events[16];
+    OVERLAPPED ov[16], *pov;
+    DWORD ret, size, i, j;
+    ULONG_PTR key;
+    char *data, *buffer;
+
+    ret = GetTempPathA(MAX_PATH, temp_path);
+    ok(ret != 0, "GetTempPathA error %d\n", GetLastError());
+    ret = GetTempFileNameA(temp_path, "ovl", 0, filename);
+    ok(ret != 0, "GetTempFileNameA error %d\n", GetLastError());
+
+    data = HeapAlloc(GetProcessHeap(), 0, chunk_size * ARRAY_SIZE(ov));
+    buffer = HeapAlloc(GetProcessHeap(), 0, chunk_size * ARRAY_SIZE(ov));
+    for (i = 0; i < chunk_size * ARRAY_SIZE(ov); i++) data[i] = i * 7 + i / 251;
+
+    file = CreateFileA(filename, GENERIC_READ | GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+                       FILE_FLAG_OVERLAPPED, NULL);
+    ok(file != INVALID_HANDLE_VALUE, "CreateFileA error %d\n", GetLastError());
+    for (i = 0; i < ARRAY_SIZE(ov); i++)
+        events[i] = CreateEventA(NULL, TRUE, FALSE, NULL);
+
+    for (j = 0; j < 8; j++)
+    {
+        /* keep all chunks in flight at once */
+        for (i = 0; i < ARRAY_SIZE(ov); i++)
+        {
+            memset(&ov[i], 0, sizeof(ov[i]));
+            ov[i].Offset = i * chunk_size;
+            ov[i].hEvent = events[i];
+            if (j & 1) ret = ReadFile(file, buffer + i * chunk_size, chunk_size, NULL, &ov[i]);
+            else ret = WriteFile(file, data + i * chunk_size, chunk_size, NULL, &ov[i]);
+            ok(ret || GetLastError() == ERROR_IO_PENDING, "%u: got error %u\n", i, GetLastError());
+        }
+        for (i = 0; i < ARRAY_SIZE(ov); i++)
+        {
+            ret = GetOverlappedResult(file, &ov[i], &size, TRUE);
+            ok(ret, "%u: GetOverlappedResult error %u\n", i, GetLastError());
+            ok(size == chunk_size, "%u: got size %u\n", i, size);
+        }
+        if (j & 1)
+            ok(!memcmp(data, buffer, chunk_size * ARRAY_SIZE(ov)), "data mismatch\n");
+    }
+
+    /* without an event, GetOverlappedResult() waits on the file handle */
+    memset(buffer, 0, chunk_size);
+    for (j = 0; j < 2; j++)
+    {
+        memset(&ov[0], 0, sizeof(ov[0]));
+        ov[0].Offset = chunk_size;
+        if (j) ret = ReadFile(file, buffer, chunk_size, NULL, &ov[0]);
+        else ret = WriteFile(file, data + chunk_size, chunk_size, NULL, &ov[0]);
+        ok(ret || GetLastError() == ERROR_IO_PENDING, "%u: got error %u\n", j, GetLastError());
+        size = 0xdeadbeef;
+        ret = GetOverlappedResult(file, &ov[0], &size, TRUE);
+        ok(ret, "%u: GetOverlappedResult error %u\n", j, GetLastError());
+        ok(size == chunk_size, "%u: got size %u\n", j, size);
+        ok(ov[0].Internal == STATUS_SUCCESS, "%u: got status %#lx\n", j, ov[0].Internal);
+    }
+    ok(!memcmp(data + chunk_size, buffer, chunk_size), "data mismatch\n");
+
+    /* cancelled requests either complete normally or fail with ERROR_OPERATION_ABORTED */
+    memset(&ov[0], 0, sizeof(ov[0]));
+    ov[0].hEvent = events[0];
+    ret = ReadFile(file, buffer, chunk_size, NULL, &ov[0]);
+    ok(ret || GetLastError() == ERROR_IO_PENDING, "got error %u\n", GetLastError());
+    if (pCancelIoEx)
+    {
+        SetLastError(0xdeadbeef);
+        ret = pCancelIoEx(file, &ov[0]);
+        ok(ret || GetLastError() == ERROR_NOT_FOUND, "CancelIoEx error %u\n", GetLastError());
+    }
+    else CancelIo(file);
+    SetLastError(0xdeadbeef);
+    ret = GetOverlappedResult(file, &ov[0], &size, TRUE);
+    if (ret) ok(size == chunk_size, "got size %u\n", size);
+    else ok(GetLastError() == ERROR_OPERATION_ABORTED, "got error %u\n", GetLastError());
+
+    /* the completion packet is posted after the file handle is closed */
+    file2 = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING,
+                        FILE_FLAG_OVERLAPPED, NULL);
+    ok(file2 != INVALID_HANDLE_VALUE, "CreateFileA error %d\n", GetLastError());
+    port = CreateIoCompletionPort(file2, NULL, 0xdead, 0);
+    ok(port != NULL, "CreateIoCompletionPort error %u\n", GetLastError());
+    memset(&ov[1], 0, sizeof(ov[1]));
+    ov[1].hEvent = events[1];
+    ret = ReadFile(file2, buffer, chunk_size, NULL, &ov[1]);
+    ok(ret || GetLastError() == ERROR_IO_PENDING, "got error %u\n", GetLastError());
+    CloseHandle(file2);
+    key = 0;
+    pov = NULL;
+    SetLastError(0xdeadbeef);
+    ret = GetQueuedCompletionStatus(port, &size, &key, &pov, 5000);
+    ok(ret || GetLastError() == ERROR_OPERATION_ABORTED, "GetQueuedCompletionStatus error %u\n", GetLastError());
+    ok(key == 0xdead, "got key %#lx\n", key);
+    ok(pov == &ov[1], "got overlapped %p\n", pov);
+    if (ret) ok(size == chunk_size, "got size %u\n", size);
+    CloseHandle(port);
+
+    /* reading past the end of the file */
+    memset(&ov[0], 0, sizeof(ov[0]));
+    ov[0].Offset = chunk_size * ARRAY_SIZE(ov);
+    ov[0].hEvent = events[0];
+    ret = ReadFile(file, buffer, chunk_size, NULL, &ov[0]);
+    ok(ret || GetLastError() == ERROR_IO_PENDING || GetLastError() == ERROR_HANDLE_EOF,
+       "got error %u\n", GetLastError());
+    SetLastError(0xdeadbeef);
+    ret = GetOverlappedResult(file, &ov[0], &size, TRUE);
+    ok(!ret, "expected failure\n");
+    ok(GetLastError() == ERROR_HANDLE_EOF, "got error %u\n", GetLastError());
+    ok(!size, "got size %u\n", size);
+
+    for (i = 0; i < ARRAY_SIZE(ov); i++)
+        CloseHandle(events[i]);
+    CloseHandle(file);
+    DeleteFileA(filename);
+    HeapFree(GetProcessHeap(), 0, data);
+    HeapFree(GetProcessHeap(), 0, buffer);
+}
+
 static void test_RemoveDirectory(void)
 {
     int rc;
@@ -3540,6 +3665,121 @@ static void test_RemoveDirectory(void)
     }
 }
 
+/* Move the last write time of a directory into the past. Recently modified
+ * directories may change again without their time changing, so Wine only
+ * caches their contents once they are older. */
+static void set_dir_write_time(const char *dir, unsigned int hours_ago)
+{
+    ULARGE_INTEGER time;
+    FILETIME ft;
+    HANDLE handle;
+    BOOL ret;
+
+    GetSystemTimeAsFileTime(&ft);
+    time.u.LowPart = ft.dwLowDateTime;
+    time.u.HighPart = ft.dwHighDateTime;
+    time.QuadPart -= hours_ago * (ULONGLONG)36000000000;
+    ft.dwLowDateTime = time.u.LowPart;
+    ft.dwHighDateTime = time.u.HighPart;
+
+    handle = CreateFileA(dir, FILE_WRITE_ATTRIBUTES, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+            NULL, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, NULL);
+    ok(handle != INVALID_HANDLE_VALUE, "CreateFileA error %d\n", GetLastError());
+    ret = SetFileTime(handle, NULL, NULL, &ft);
+    ok(ret, "SetFileTime error %d\n", GetLastError());
+    CloseHandle(handle);
+}
+
+static void test_case_insensitive_lookup(void)
+{
+    char temp_path[MAX_PATH], dir[MAX_PATH], path[MAX_PATH], path2[MAX_PATH];
+    DWORD ret;
+    HANDLE file;
+    unsigned int i, j;
+
+    ret = GetTempPathA(MAX_PATH, temp_path);
+    ok(ret != 0, "GetTempPathA error %d\n", GetLastError());
+    sprintf(dir, "%sCaseLookup", temp_path);
+    ret = CreateDirectoryA(dir, NULL);
+    ok(ret, "CreateDirectoryA error %d\n", GetLastError());
+
+    for (i = 0; i < 300; i++)
+    {
+        sprintf(path, "%s\\File%03u.Txt", dir, i);
+        file = CreateFileA(path, GENERIC_WRITE, 0, NULL, CREATE_NEW, 0, 0);
+        ok(file != INVALID_HANDLE_VALUE, "CreateFileA error %d\n", GetLastError());
+        CloseHandle(file);
+    }
+    set_dir_write_time(dir, 1);
+
+    /* the first pass fills the cache, the second one uses it */
+    for (j = 0; j < 2; j++)
+    {
+        for (i = 0; i < 300; i++)
+        {
+            sprintf(path, (i + j) & 1 ? "%s\\FILE%03u.TXT" : "%s\\file%03u.txt", dir, i);
+            ret = GetFileAttributesA(path);
+            ok(ret != INVALID_FILE_ATTRIBUTES, "GetFileAttributesA(%s) error %d\n", path, GetLastError());
+        }
+    }
+
+    sprintf(path, "%s\\FILE300.TXT", dir);
+    SetLastError(0xdeadbeef);
+    ret = GetFileAttributesA(path);
+    ok(ret == INVALID_FILE_ATTRIBUTES, "expected failure\n");
+    ok(GetLastError() == ERROR_FILE_NOT_FOUND, "got error %d\n", GetLastError());
+
+    /* renamed files are seen right away, and after the cache is filled again */
+    sprintf(path, "%s\\FILE000.TXT", dir);
+    sprintf(path2, "%s\\Moved.Txt", dir);
+    ret = MoveFileA(path, path2);
+    ok(ret, "MoveFileA error %d\n", GetLastError());
+    for (j = 0; j < 2; j++)
+    {
+        if (j) set_dir_write_time(dir, 2);
+        sprintf(path, "%s\\FILE000.TXT", dir);
+        ret = GetFileAttributesA(path);
+        ok(ret == INVALID_FILE_ATTRIBUTES, "%u: expected failure\n", j);
+        sprintf(path, "%s\\MOVED.TXT", dir);
+        ret = GetFileAttributesA(path);
+        ok(ret != INVALID_FILE_ATTRIBUTES, "%u: GetFileAttributesA(%s) error %d\n", j, path, GetLastError());
+        sprintf(path, "%s\\FILE001.TXT", dir);
+        ret = GetFileAttributesA(path);
+        ok(ret != INVALID_FILE_ATTRIBUTES, "%u: GetFileAttributesA(%s) error %d\n", j, path, GetLastError());
+    }
+    sprintf(path, "%s\\FILE000.TXT", dir);
+    ret = MoveFileA(path2, path);
+    ok(ret, "MoveFileA error %d\n", GetLastError());
+
+    /* so are created and deleted files */
+    sprintf(path, "%s\\NewFile.Txt", dir);
+    file = CreateFileA(path, GENERIC_WRITE, 0, NULL, CREATE_NEW, 0, 0);
+    ok(file != INVALID_HANDLE_VALUE, "CreateFileA error %d\n", GetLastError());
+    CloseHandle(file);
+    sprintf(path, "%s\\NEWFILE.TXT", dir);
+    ret = GetFileAttributesA(path);
+    ok(ret != INVALID_FILE_ATTRIBUTES, "GetFileAttributesA(%s) error %d\n", path, GetLastError());
+    set_dir_write_time(dir, 3);
+    ret = GetFileAttributesA(path);
+    ok(ret != INVALID_FILE_ATTRIBUTES, "GetFileAttributesA(%s) error %d\n", path, GetLastError());
+    ret = DeleteFileA(path);
+    ok(ret, "DeleteFileA error %d\n", GetLastError());
+    ret = GetFileAttributesA(path);
+    ok(ret == INVALID_FILE_ATTRIBUTES, "expected failure\n");
+    set_dir_write_time(dir, 4);
+    ret = GetFileAttributesA(path);
+    ok(ret == INVALID_FILE_ATTRIBUTES, "expected failure\n");
+
+    for (i = 0; i < 300; i++)
+    {
+        sprintf(path, "%s\\File%03u.Txt", dir, i);
+        ret = DeleteFileA(path);
+        ok(ret, "DeleteFileA error %d\n", GetLastError());
+    }
+    ret = RemoveDirectoryA(dir);
+    ok(ret, "RemoveDirectoryA error %d\n", GetLastError());
+}
+
 static BOOL check_file_time( const FILETIME *ft1, const FILETIME *ft2, UINT tolerance )
 {
     ULONGLONG t1 = ((ULONGLONG)ft1->dwHighDateTime << 32) | ft1->dwLowDateTime;
@@ -5786,7 +6026,9 @@ START_TEST(file)
     test_read_write();
     test_OpenFile();
     test_overlapped();
+    test_overlapped_file_io();
     test_RemoveDirectory();
+    test_case_insensitive_lookup();
     test_ReplaceFileA();
     test_ReplaceFileW();
     test_GetFileInformationByHandleEx();
@@ -889,6 +889,108 @@ static void test_HeapQueryInformation(void)
     ok(info == 0 || info == 1 || info == 2, "expected 0, 1 or 2, got %u\n", info);
 }
 
+static DWORD WINAPI lfh_thread( void *arg )
+{
+    HANDLE heap = arg;
+    void *ptrs[64];
+    unsigned int i, j;
+
+    for (i = 0; i < 1000; i++)
+    {
+        for (j = 0; j < ARRAY_SIZE(ptrs); j++)
+        {
+            ptrs[j] = HeapAlloc( heap, 0, 16 + (i + j) % 200 );
+            if (!ptrs[j]) return 1;
+            memset( ptrs[j], j, 16 );
+        }
+        for (j = 0; j < ARRAY_SIZE(ptrs); j++)
+        {
+            if (((BYTE *)ptrs[j])[15] != j) return 1;
+            if (!HeapFree( heap, 0, ptrs[j] )) return 1;
+        }
+    }
+    return 0;
+}
+
+static void test_lfh(void)
+{
+    HANDLE heap, threads[4];
+    ULONG info;
+    SIZE_T size;
+    BYTE *ptr, *ptr2;
+    DWORD code;
+    unsigned int i, j;
+    BOOL ret;
+
+    heap = HeapCreate( 0, 0, 0 );
+    ok( heap != NULL, "HeapCreate failed, error %u\n", GetLastError() );
+
+    info = 2;
+    ret = HeapSetInformation( heap, HeapCompatibilityInformation, &info, sizeof(info) );
+    ok( ret, "HeapSetInformation failed, error %u\n", GetLastError() );
+    info = 0xdeadbeef;
+    ret = HeapQueryInformation( heap, HeapCompatibilityInformation, &info, sizeof(info), NULL );
+    ok( ret, "HeapQueryInformation failed, error %u\n", GetLastError() );
+    ok( info == 2, "got %u\n", info );
+
+    info = 0;
+    ret = HeapSetInformation( heap, HeapCompatibilityInformation, &info, sizeof(info) );
+    ok( !ret, "HeapSetInformation succeeded\n" );
+
+    for (i = 0; i < 1100; i += 7)
+    {
+        ptr = HeapAlloc( heap, HEAP_ZERO_MEMORY, i );
+        ok( ptr != NULL, "%u: HeapAlloc failed, error %u\n", i, GetLastError() );
+        for (j = 0; j < i; j++) if (ptr[j]) break;
+        ok( j == i, "%u: block not zeroed at %u\n", i, j );
+        size = HeapSize( heap, 0, ptr );
+        ok( size == i, "%u: HeapSize returned %lu\n", i, size );
+        ok( HeapValidate( heap, 0, ptr ), "%u: HeapValidate failed\n", i );
+        memset( ptr, 0xcc, i );
+
+        ptr2 = HeapReAlloc( heap, 0, ptr, i + 1 );
+        ok( ptr2 != NULL, "%u: HeapReAlloc failed, error %u\n", i, GetLastError() );
+        size = HeapSize( heap, 0, ptr2 );
+        ok( size == i + 1, "%u: HeapSize returned %lu\n", i, size );
+        for (j = 0; j < i; j++) if (ptr2[j] != 0xcc) break;
+        ok( j == i, "%u: block content lost at %u\n", i, j );
+
+        ptr = HeapReAlloc( heap, 0, ptr2, 2 * i + 300 );
+        ok( ptr != NULL, "%u: HeapReAlloc failed, error %u\n", i, GetLastError() );
+        for (j = 0; j < i; j++) if (ptr[j] != 0xcc) break;
+        ok( j == i, "%u: block content lost at %u\n", i, j );
+
+        ret = HeapFree( heap, 0, ptr );
+        ok( ret, "%u: HeapFree failed, error %u\n", i, GetLastError() );
+    }
+    ok( HeapValidate( heap, 0, NULL ), "HeapValidate failed\n" );
+
+    for (i = 0; i < ARRAY_SIZE(threads); i++)
+        threads[i] = CreateThread( NULL, 0, lfh_thread, heap, 0, NULL );
+    for (i = 0; i < ARRAY_SIZE(threads); i++)
+    {
+        WaitForSingleObject( threads[i], INFINITE );
+        GetExitCodeThread( threads[i], &code );
+        ok( !code, "thread %u failed\n", i );
+        CloseHandle( threads[i] );
+    }
+    ok( HeapValidate( heap, 0, NULL ), "HeapValidate failed\n" );
+
+    HeapDestroy( heap );
+
+    heap = HeapCreate( HEAP_NO_SERIALIZE, 0, 0 );
+    ok( heap != NULL, "HeapCreate failed, error %u\n", GetLastError() );
+    info = 2;
+    SetLastError( 0xdeadbeef );
+    ret = HeapSetInformation( heap, HeapCompatibilityInformation, &info, sizeof(info) );
+    ok( !ret, "HeapSetInformation succeeded\n" );
+    info = 0xdeadbeef;
+    ret = HeapQueryInformation( heap, HeapCompatibilityInformation, &info, sizeof(info), NULL );
+    ok( ret, "HeapQueryInformation failed, error %u\n", GetLastError() );
+    ok( info == 0, "got %u\n", info );
+    HeapDestroy( heap );
+}
+
 static void test_heap_checks( DWORD flags )
 {
     BYTE old, *p, *p2;
@@ -1245,6 +1347,7 @@ START_TEST(heap)
     test_sized_HeapReAlloc((1 << 20), 1);
 
     test_HeapQueryInformation();
+    test_lfh();
     test_GetPhysicallyInstalledSystemMemory();
 
     if (pRtlGetNtGlobalFlags)
@@ -1569,6 +1569,110 @@ static void test_filenames(void)
     DeleteFileA( long_path );
 }
 
+static void test_many_modules(void)
+{
+    IMAGE_NT_HEADERS nt_header = nt_header_template;
+    char dll_name[MAX_PATH], path[100][MAX_PATH];
+    HMODULE mods[100];
+    char *name, *p;
+    BOOL ret;
+    int i;
+
+    nt_header.FileHeader.NumberOfSections = 1;
+    nt_header.FileHeader.SizeOfOptionalHeader = sizeof(IMAGE_OPTIONAL_HEADER);
+
+    nt_header.OptionalHeader.SectionAlignment = page_size;
+    nt_header.OptionalHeader.DllCharacteristics = IMAGE_DLLCHARACTERISTICS_NX_COMPAT;
+    nt_header.OptionalHeader.FileAlignment = page_size;
+    nt_header.OptionalHeader.SizeOfHeaders = sizeof(dos_header) + sizeof(nt_header) + sizeof(IMAGE_SECTION_HEADER);
+    nt_header.OptionalHeader.SizeOfImage = sizeof(dos_header) + sizeof(nt_header) + sizeof(IMAGE_SECTION_HEADER) + page_size;
+
+    create_test_dll( &dos_header, sizeof(dos_header), &nt_header, dll_name );
+    for (i = 0; i < ARRAY_SIZE(mods); i++)
+    {
+        strcpy( path[i], dll_name );
+        sprintf( strrchr( path[i], '\\' ), "\\ldrhash%03u.dll", i );
+        ret = CopyFileA( dll_name, path[i], FALSE );
+        ok( ret, "CopyFileA failed err %u\n", GetLastError() );
+    }
+    DeleteFileA( dll_name );
+
+    for (i = 0; i < ARRAY_SIZE(mods); i++)
+    {
+        mods[i] = LoadLibraryA( path[i] );
+        ok( mods[i] != NULL, "loading %s failed err %u\n", path[i], GetLastError() );
+    }
+
+    for (i = 0; i < ARRAY_SIZE(mods); i++)
+    {
+        name = strrchr( path[i], '\\' ) + 1;
+        ok( GetModuleHandleA( name ) == mods[i], "wrong module for %s\n", name );
+        for (p = name; *p; p++) *p = toupper( *p );
+        ok( GetModuleHandleA( name ) == mods[i], "wrong module for %s\n", name );
+        ok( GetModuleHandleA( path[i] ) == mods[i], "wrong module for %s\n", path[i] );
+        ok( LoadLibraryA( path[i] ) == mods[i], "library %s loaded twice\n", path[i] );
+        FreeLibrary( mods[i] );
+    }
+
+    for (i = 0; i < ARRAY_SIZE(mods); i++)
+    {
+        FreeLibrary( mods[i] );
+        name = strrchr( path[i], '\\' ) + 1;
+        ok( !GetModuleHandleA( name ), "%s still loaded\n", name );
+        ok( !GetModuleHandleA( path[i] ), "%s still loaded\n", path[i] );
+        DeleteFileA( path[i] );
+    }
+}
+
+/* check every export by name against a walk of the export directory, after
+ * enough lookups for the loader to index the names of a module */
+static void test_export_lookup(void)
+{
+    static const char *missing[] = { "NoSuchFunction", "CreateFil", "CreateFileAA", "createfilea" };
+    HMODULE module = GetModuleHandleA( "kernel32.dll" );
+    const IMAGE_EXPORT_DIRECTORY *exports;
+    const DWORD *functions, *names;
+    const WORD *ordinals;
+    const char *name;
+    FARPROC proc;
+    ULONG size;
+    DWORD rva, i;
+
+    if (!pRtlImageDirectoryEntryToData)
+    {
+        win_skip( "RtlImageDirectoryEntryToData not available\n" );
+        return;
+    }
+
+    exports = pRtlImageDirectoryEntryToData( module, TRUE, IMAGE_DIRECTORY_ENTRY_EXPORT, &size );
+    ok( exports != NULL, "no export directory\n" );
+    if (!exports) return;
+    ok( exports->NumberOfNames >= 256, "got only %u names\n", exports->NumberOfNames );
+
+    functions = (const DWORD *)((const char *)module + exports->AddressOfFunctions);
+    names = (const DWORD *)((const char *)module + exports->AddressOfNames);
+    ordinals = (const WORD *)((const char *)module + exports->AddressOfNameOrdinals);
+
+    for (i = 0; i < 64; i++)
+        ok( GetProcAddress( module, "CreateFileA" ) != NULL, "CreateFileA not found\n" );
+
+    for (i = 0; i < exports->NumberOfNames; i++)
+    {
+        name = (const char *)module + names[i];
+        rva = functions[ordinals[i]];
+        proc = GetProcAddress( module, name );
+        if (rva >= (const char *)exports - (const char *)module &&
+            rva < (const char *)exports - (const char *)module + size)
+            ok( proc != NULL, "forwarded export %s not found\n", name );
+        else
+            ok( proc == (FARPROC)((const char *)module + rva), "got %p for %s, expected %p\n",
+                proc, name, (const char *)module + rva );
+    }
+
+    for (i = 0; i < ARRAY_SIZE(missing); i++)
+        ok( !GetProcAddress( module, missing[i] ), "found non-existent export %s\n", missing[i] );
+}
+
 /* Verify linking style of import descriptors */
 static void test_ImportDescriptors(void)
 {
@@ -4021,6 +4125,8 @@ START_TEST(loader)
     }
 
     test_filenames();
+    test_many_modules();
+    test_export_lookup();
     test_ResolveDelayLoadedAPI();
     test_ImportDescriptors();
     test_section_access();
@@ -2256,6 +2256,71 @@ static void test_CompareStringEx(void)
 
 }
 
+static void test_CompareStringEx_prefix(void)
+{
+    static const WCHAR *suffixes[][2] =
+    {
+        { L"abc", L"abd" },
+        { L"abc", L"ABC" },
+        { L"abc", L"ab" },
+        { L"co-op", L"coop" },
+        { L"co'op", L"co-op" },
+        { L"a b", L"ab" },
+        { L"r\xe9sum\xe9", L"resume" },
+        { L"R\xc9SUM\xc9", L"r\xe9sum\xe9" },
+        { L"stra\xdf" L"e", L"strasse" },
+        { L"\xe6on", L"aeon" },
+        { L"a1", L"a\xb9" },
+        { L"x\x0100", L"x\x0101" },
+        { L"", L"a" },
+    };
+    static const DWORD flags[] =
+    {
+        0, NORM_IGNORECASE, NORM_IGNORENONSPACE, NORM_IGNORESYMBOLS, SORT_STRINGSORT,
+        NORM_IGNORECASE | NORM_IGNORENONSPACE, NORM_IGNORECASE | NORM_IGNORESYMBOLS,
+    };
+    static const WCHAR prefix[] = L"TheQuickBrownFox\xc0\xe9\xe7\xf1" L"0123456789";
+    WCHAR str1[128], str2[128];
+    INT ret, expect, i, j, k, len;
+
+    if (!pCompareStringEx)
+    {
+        win_skip("CompareStringEx not supported\n");
+        return;
+    }
+
+    for (i = 0; i < ARRAY_SIZE(flags); i++)
+    {
+        for (j = 0; j < ARRAY_SIZE(suffixes); j++)
+        {
+            expect = pCompareStringEx(L"en-US", flags[i], suffixes[j][0], -1, suffixes[j][1], -1, NULL, NULL, 0);
+            ok(expect, "%d/%d: CompareStringEx failed, error %u\n", i, j, GetLastError());
+
+            lstrcpyW(str1, prefix);
+            lstrcatW(str1, suffixes[j][0]);
+            lstrcpyW(str2, prefix);
+            lstrcatW(str2, suffixes[j][1]);
+            ret = pCompareStringEx(L"en-US", flags[i], str1, -1, str2, -1, NULL, NULL, 0);
+            ok(ret == expect, "%d/%d: got %d, expected %d\n", i, j, ret, expect);
+
+            /* prefixes only differing at an ignored level */
+            if (!(flags[i] & NORM_IGNORECASE)) continue;
+            for (k = 0; str1[k]; k++) if (str1[k] >= 'a' && str1[k] <= 'z') str1[k] -= 'a' - 'A';
+            len = lstrlenW(prefix);
+            lstrcpyW(str1 + len, suffixes[j][0]);
+            ret = pCompareStringEx(L"en-US", flags[i], str1, -1, str2, -1, NULL, NULL, 0);
+            ok(ret == expect, "%d/%d: got %d, expected %d\n", i, j, ret, expect);
+        }
+    }
+
+    for (i = 0; i < 100; i++) str1[i] = str2[i] = 'a' + i % 26;
+    str2[99] = 'z';
+    ret = pCompareStringEx(L"en-US", 0, str1, 100, str2, 100, NULL, NULL, 0);
+    ok(ret == CSTR_LESS_THAN, "got %d\n", ret);
+    ret = pCompareStringEx(L"en-US", 0, str1, 99, str2, 99, NULL, NULL, 0);
+    ok(ret == CSTR_EQUAL, "got %d\n", ret);
+}
+
 static const DWORD lcmap_invalid_flags[] = {
     0,
     LCMAP_HIRAGANA | LCMAP_KATAKANA,
@@ -6936,6 +7001,7 @@ START_TEST(locale)
   test_CompareStringA();
   test_CompareStringW();
   test_CompareStringEx();
+  test_CompareStringEx_prefix();
   test_LCMapStringA();
   test_LCMapStringW();
   test_LCMapStringEx();
@@ -1716,6 +1716,71 @@ static void test_WaitForMultipleObjects(void)
     todo_wine ok(status == STATUS_INVALID_HANDLE, "expected STATUS_INVALID_HANDLE, got %08x\n", status);
 }
 
+static DWORD close_remote_handle(DWORD pid, HANDLE handle)
+{
+    HANDLE process, dup;
+
+    if (!(process = OpenProcess(PROCESS_DUP_HANDLE, FALSE, pid)))
+        return 1;
+    if (!DuplicateHandle(process, handle, GetCurrentProcess(), &dup, 0, FALSE,
+            DUPLICATE_SAME_ACCESS | DUPLICATE_CLOSE_SOURCE))
+    {
+        CloseHandle(process);
+        return 2;
+    }
+    CloseHandle(dup);
+    CloseHandle(process);
+    return 0;
+}
+
+static void test_wait_reused_handle(void)
+{
+    PROCESS_INFORMATION pi;
+    STARTUPINFOA si = { sizeof(si) };
+    char cmdline[MAX_PATH];
+    HANDLE event, semaphore;
+    char **argv;
+    DWORD r;
+    BOOL ret;
+
+    /* make sure a cached wait object doesn't outlive its handle when the
+     * handle is closed by another process */
+    event = CreateEventW(NULL, TRUE, FALSE, NULL);
+    ok(event != NULL, "CreateEvent failed, error %u\n", GetLastError());
+    r = WaitForSingleObject(event, 0);
+    ok(r == WAIT_TIMEOUT, "got %u\n", r);
+
+    winetest_get_mainargs(&argv);
+    sprintf(cmdline, "\"%s\" sync close_remote %u %p", argv[0], GetCurrentProcessId(), event);
+    ret = CreateProcessA(argv[0], cmdline, NULL, NULL, FALSE, 0, NULL, NULL, &si, &pi);
+    ok(ret, "CreateProcess failed, error %u\n", GetLastError());
+    wait_child_process(pi.hProcess);
+    CloseHandle(pi.hProcess);
+    CloseHandle(pi.hThread);
+
+    SetLastError(0xdeadbeef);
+    r = WaitForSingleObject(event, 0);
+    ok(r == WAIT_FAILED, "got %u\n", r);
+    ok(GetLastError() == ERROR_INVALID_HANDLE, "got error %u\n", GetLastError());
+
+    semaphore = CreateSemaphoreW(NULL, 1, 1, NULL);
+    ok(semaphore != NULL, "CreateSemaphore failed, error %u\n", GetLastError());
+    if (semaphore != event)
+    {
+        skip("handle %p was not reused\n", event);
+        CloseHandle(semaphore);
+        return;
+    }
+
+    /* the wait takes the semaphore count, unlike a wait on a manual reset
+     * event */
+    r = WaitForSingleObject(semaphore, 0);
+    ok(r == WAIT_OBJECT_0, "got %u\n", r);
+    r = WaitForSingleObject(semaphore, 0);
+    ok(r == WAIT_TIMEOUT, "got %u\n", r);
+    CloseHandle(semaphore);
+}
+
 static BOOL g_initcallback_ret, g_initcallback_called;
 static void *g_initctxt;
 
@@ -3195,6 +3260,15 @@ START_TEST(sync)
         {
             for (;;) SleepEx(INFINITE, TRUE);
         }
+        if (!strcmp(argv[2], "close_remote") && argc >= 5)
+        {
+            DWORD pid;
+            HANDLE handle;
+
+            sscanf(argv[3], "%u", &pid);
+            sscanf(argv[4], "%p", &handle);
+            ExitProcess(close_remote_handle(pid, handle));
+        }
         return;
     }
 
@@ -3209,6 +3283,7 @@ START_TEST(sync)
     test_timer_queue();
     test_WaitForSingleObject();
     test_WaitForMultipleObjects();
+    test_wait_reused_handle();
     test_initonce();
     test_condvars_base(&aligned_cv);
     test_condvars_base(&unaligned_cv.cv);
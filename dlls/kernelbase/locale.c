@@ -606,6 +606,21 @@ static struct
     struct sortguid *guids;      /* table of sort GUIDs */
 } sort;
 
+/* collation elements of the Latin-1 range, looked up once from the multi-level table */
+static unsigned int latin1_collation[0x100];
+static BYTE latin1_flags[0x100];
+
+#define LATIN1_DECOMPOSED 0x01  /* char has a decomposition */
+#define LATIN1_SIMPLE     0x02  /* char always compares on its own, with non-zero weights */
+
+static void init_latin1_collation(void);
+
+static inline unsigned int get_collation_element( WCHAR ch )
+{
+    if (ch < 0x100) return latin1_collation[ch];
+    return collation_table[collation_table[collation_table[ch >> 8] + ((ch >> 4) & 0x0f)] + (ch & 0xf)];
+}
+
 static CRITICAL_SECTION locale_section;
 static CRITICAL_SECTION_DEBUG critsect_debug =
 {
@@ -723,6 +738,7 @@ void init_locale(void)
     NtGetNlsSectionPtr( 9, 0, NULL, &sort_ptr, &size );
     NtGetNlsSectionPtr( 12, NormalizationC, NULL, (void **)&norm_info, &size );
     init_sortkeys( sort_ptr );
+    init_latin1_collation();
 
     if (!ansi_cp || NtGetNlsSectionPtr( 11, ansi_cp, NULL, (void **)&ansi_ptr, &size ))
         NtGetNlsSectionPtr( 11, 1252, NULL, (void **)&ansi_ptr, &size );
@@ -887,6 +903,35 @@ static const WCHAR *get_decomposition( WCHAR ch, unsigned int *ret_len )
 }
 
 
+static void init_latin1_collation(void)
+{
+    unsigned int ce, len;
+    WCHAR ch;
+
+    for (ch = 0; ch < 0x100; ch++)
+    {
+        latin1_collation[ch] = ce = collation_table[collation_table[collation_table[0] + (ch >> 4)] + (ch & 0xf)];
+        if (get_decomposition( ch, &len ))
+            latin1_flags[ch] = LATIN1_DECOMPOSED;
+        else if (ce != ~0u && (ce >> 16) && ((ce >> 8) & 0xff) && ((ce >> 4) & 0x0f) &&
+                 ch != '-' && ch != '\'' && !(get_char_type( CT_CTYPE1, ch ) & (C1_PUNCT | C1_SPACE)))
+            latin1_flags[ch] = LATIN1_SIMPLE;
+    }
+}
+
+
+/* same as get_decomposition(), without the lookup for most of the Latin-1 range */
+static inline const WCHAR *get_char_decomposition( WCHAR ch, unsigned int *ret_len )
+{
+    if (ch < 0x100 && !(latin1_flags[ch] & LATIN1_DECOMPOSED))
+    {
+        *ret_len = 1;
+        return NULL;
+    }
+    return get_decomposition( ch, ret_len );
+}
+
+
 static WCHAR compose_chars( WCHAR ch1, WCHAR ch2 )
 {
     const USHORT *table = (const USHORT *)norm_info + norm_info->comp_hash;
@@ -2153,7 +2198,7 @@ static int get_sortkey( DWORD flags, const WCHAR *src, int srclen, char *dst, in
 
                 if (flags & NORM_IGNORECASE) wch = casemap( nls_info.LowerCaseTable, wch );
 
-                ce = collation_table[collation_table[collation_table[wch >> 8] + ((wch >> 4) & 0x0f)] + (wch & 0xf)];
+                ce = get_collation_element( wch );
                 if (ce != (unsigned int)-1)
                 {
                     if (ce >> 16) key_len[0] += 2;
@@ -2207,7 +2252,7 @@ static int get_sortkey( DWORD flags, const WCHAR *src, int srclen, char *dst, in
 
                 if (flags & NORM_IGNORECASE) wch = casemap( nls_info.LowerCaseTable, wch );
 
-                ce = collation_table[collation_table[collation_table[wch >> 8] + ((wch >> 4) & 0x0f)] + (wch & 0xf)];
+                ce = get_collation_element( wch );
                 if (ce != (unsigned int)-1)
                 {
                     WCHAR key;
@@ -2466,7 +2511,7 @@ static unsigned int get_weight( WCHAR ch, enum weight type )
 {
     unsigned int ret;
 
-    ret = collation_table[collation_table[collation_table[ch >> 8] + ((ch >> 4) & 0x0f)] + (ch & 0xf)];
+    ret = get_collation_element( ch );
     if (ret == ~0u) return ch;
 
     switch (type)
@@ -2499,8 +2544,8 @@ static int compare_weights(int flags, const WCHAR *str1, int len1,
 
     while (len1 > 0 && len2 > 0)
     {
-        if (!dlen1 && !(dstr1 = get_decomposition( *str1, &dlen1 ))) dstr1 = str1;
-        if (!dlen2 && !(dstr2 = get_decomposition( *str2, &dlen2 ))) dstr2 = str2;
+        if (!dlen1 && !(dstr1 = get_char_decomposition( *str1, &dlen1 ))) dstr1 = str1;
+        if (!dlen2 && !(dstr2 = get_char_decomposition( *str2, &dlen2 ))) dstr2 = str2;
 
         if (flags & NORM_IGNORESYMBOLS)
         {
@@ -2559,14 +2604,14 @@ static int compare_weights(int flags, const WCHAR *str1, int len1,
     }
     while (len1)
     {
-        if (!dlen1 && !(dstr1 = get_decomposition( *str1, &dlen1 ))) dstr1 = str1;
+        if (!dlen1 && !(dstr1 = get_char_decomposition( *str1, &dlen1 ))) dstr1 = str1;
         ce1 = get_weight( dstr1[dpos1], type );
         if (ce1) break;
         inc_str_pos( &str1, &len1, &dpos1, &dlen1 );
     }
     while (len2)
     {
-        if (!dlen2 && !(dstr2 = get_decomposition( *str2, &dlen2 ))) dstr2 = str2;
+        if (!dlen2 && !(dstr2 = get_char_decomposition( *str2, &dlen2 ))) dstr2 = str2;
         ce2 = get_weight( dstr2[dpos2], type );
         if (ce2) break;
         inc_str_pos( &str2, &len2, &dpos2, &dlen2 );
@@ -3021,6 +3066,7 @@ INT WINAPI CompareStringEx( const WCHAR *locale, DWORD flags, const WCHAR *str1,
                             NORM_IGNOREKANATYPE | NORM_IGNOREWIDTH | LOCALE_USE_CP_ACP;
     DWORD semistub_flags = NORM_LINGUISTIC_CASING | LINGUISTIC_IGNORECASE | 0x10000000;
     /* 0x10000000 is related to diacritics in Arabic, Japanese, and Hebrew */
+    unsigned int mask = 0xfffffff0;
     INT ret;
     static int once;
 
@@ -3048,6 +3094,20 @@ INT WINAPI CompareStringEx( const WCHAR *locale, DWORD flags, const WCHAR *str1,
     if (len1 < 0) len1 = lstrlenW(str1);
     if (len2 < 0) len2 = lstrlenW(str2);
 
+    /* skip the common prefix of chars that compare the same at all the used levels;
+     * they are neither decomposed nor skipped, so they can't affect the rest of the comparison */
+    if (flags & NORM_IGNORENONSPACE) mask &= ~0xff00;
+    if (flags & NORM_IGNORECASE) mask &= ~0xf0;
+    while (len1 && len2 && *str1 < 0x100 && *str2 < 0x100 &&
+           (latin1_flags[*str1] & latin1_flags[*str2] & LATIN1_SIMPLE) &&
+           !((latin1_collation[*str1] ^ latin1_collation[*str2]) & mask))
+    {
+        str1++;
+        str2++;
+        len1--;
+        len2--;
+    }
+
     ret = compare_weights( flags, str1, len1, str2, len2, UNICODE_WEIGHT );
     if (!ret)
     {
@@ -170,8 +170,8 @@ struct SchedulerVtbl {
     unsigned int (__thiscall *Release)(Scheduler*);
     void (__thiscall *RegisterShutdownEvent)(Scheduler*,HANDLE);
     void (__thiscall *Attach)(Scheduler*);
-    /* CreateScheduleGroup */
-    /* ScheduleTask */
+    void* (__thiscall *CreateScheduleGroup)(Scheduler*);
+    void (__thiscall *ScheduleTask)(Scheduler*,void (__cdecl*)(void*),void*);
 };
 
 static int* (__cdecl *p_errno)(void);
@@ -223,6 +223,7 @@ static int (__cdecl *p_event_wait_for_multiple)(event**, size_t, MSVCRT_bool, un
 
 static Context* (__cdecl *p_Context_CurrentContext)(void);
 static unsigned int (__cdecl *p_Context_Id)(void);
+static unsigned int (__cdecl *p_Context_VirtualProcessorId)(void);
 static SchedulerPolicy* (__thiscall *p_SchedulerPolicy_ctor)(SchedulerPolicy*);
 static void (__thiscall *p_SchedulerPolicy_SetConcurrencyLimits)(SchedulerPolicy*, unsigned int, unsigned int);
 static void (__thiscall *p_SchedulerPolicy_dtor)(SchedulerPolicy*);
@@ -274,6 +275,7 @@ static BOOL init(void)
     SET(p___strncnt, "__strncnt");
 
     SET(p_Context_Id, "?Id@Context@Concurrency@@SAIXZ");
+    SET(p_Context_VirtualProcessorId, "?VirtualProcessorId@Context@Concurrency@@SAIXZ");
     SET(p_CurrentScheduler_Detach, "?Detach@CurrentScheduler@Concurrency@@SAXXZ");
     SET(p_CurrentScheduler_Id, "?Id@CurrentScheduler@Concurrency@@SAIXZ");
 
@@ -956,11 +958,31 @@ static void test_ExternalContextBase(void)
     CloseHandle(thread);
 }
 
+static LONG chores_left;
+static HANDLE chores_done;
+static DWORD main_thread_id;
+
+static void __cdecl test_chore(void *arg)
+{
+    unsigned int vproc = p_Context_VirtualProcessorId();
+
+    ok(GetCurrentThreadId() != main_thread_id, "chore executed on the main thread\n");
+    ok(vproc < (unsigned int)(ULONG_PTR)arg, "Context::VirtualProcessorId() = %u\n", vproc);
+    if (!InterlockedDecrement(&chores_left))
+        SetEvent(chores_done);
+}
+
+static void __cdecl release_scheduler_chore(void *arg)
+{
+    Scheduler *scheduler = arg;
+    call_func1(scheduler->vtable->Release, scheduler);
+}
+
 static void test_Scheduler(void)
 {
     Scheduler *scheduler, *current_scheduler;
     SchedulerPolicy policy;
-    unsigned int i;
+    unsigned int i, vproc_no;
 
     call_func1(p_SchedulerPolicy_ctor, &policy);
     scheduler = p_Scheduler_Create(&policy);
@@ -986,6 +1008,35 @@ static void test_Scheduler(void)
     i = call_func1(scheduler->vtable->GetNumberOfVirtualProcessors, scheduler);
     ok(i == 1, "Scheduler::GetNumberOfVirtualProcessors() = %u\n", i);
     call_func1(scheduler->vtable->Release, scheduler);
+
+    call_func3(p_SchedulerPolicy_SetConcurrencyLimits, &policy, 1, 4);
+    scheduler = p_Scheduler_Create(&policy);
+    ok(scheduler != NULL, "Scheduler::Create() = NULL\n");
+    vproc_no = call_func1(scheduler->vtable->GetNumberOfVirtualProcessors, scheduler);
+    ok(vproc_no >= 1 && vproc_no <= 4, "Scheduler::GetNumberOfVirtualProcessors() = %u\n", vproc_no);
+
+    main_thread_id = GetCurrentThreadId();
+    chores_done = CreateEventW(NULL, FALSE, FALSE, NULL);
+    chores_left = 100;
+    for (i = 0; i < 100; i++)
+        call_func3(scheduler->vtable->ScheduleTask, scheduler, test_chore, (void*)(ULONG_PTR)vproc_no);
+    i = WaitForSingleObject(chores_done, 5000);
+    ok(i == WAIT_OBJECT_0, "WaitForSingleObject returned %u\n", i);
+    ok(!chores_left, "%d chores left\n", chores_left);
+
+    call_func1(scheduler->vtable->Release, scheduler);
+    CloseHandle(chores_done);
+
+    /* drop the last reference from one of the scheduler workers */
+    scheduler = p_Scheduler_Create(&policy);
+    ok(scheduler != NULL, "Scheduler::Create() = NULL\n");
+    chores_done = CreateEventW(NULL, TRUE, FALSE, NULL);
+    call_func2(scheduler->vtable->RegisterShutdownEvent, scheduler, chores_done);
+    call_func3(scheduler->vtable->ScheduleTask, scheduler, release_scheduler_chore, scheduler);
+    i = WaitForSingleObject(chores_done, 5000);
+    ok(i == WAIT_OBJECT_0, "WaitForSingleObject returned %u\n", i);
+    CloseHandle(chores_done);
+
     call_func1(p_SchedulerPolicy_dtor, &policy);
 }
 
@@ -35,6 +35,7 @@ WINE_DEFAULT_DEBUG_CHANNEL(msvcrt);
 
 static int context_id = -1;
 static int scheduler_id = -1;
+static int schedule_group_id = -1;
 
 typedef enum {
     SchedulerKind,
@@ -89,6 +90,11 @@ typedef struct {
     struct scheduler_list scheduler;
     unsigned int id;
     union allocator_cache_entry *allocator_cache[8];
+    struct Scheduler *worker_scheduler; /* scheduler the thread is a worker of */
+    int vproc;
+    unsigned int group_id;
+    unsigned int oversubscribe;
+    struct Scheduler *oversubscribe_scheduler;
 } ExternalContextBase;
 extern const vtable_ptr MSVCRT_ExternalContextBase_vtable;
 static void ExternalContextBase_ctor(ExternalContextBase*);
@@ -120,6 +126,23 @@ typedef struct Scheduler {
         void, (Scheduler*,void (__cdecl*)(void*),void*), (this,proc,data))
 #endif
 
+struct chore {
+    void (__cdecl *proc)(void*);
+    void *data;
+    struct ScheduleGroupBase *group;
+};
+
+/* Chores queued on a virtual processor. Its worker thread takes the most
+ * recently queued chore from the tail, other workers steal the oldest one
+ * from the head. */
+struct scheduler_vproc {
+    CRITICAL_SECTION cs;
+    struct chore **chores;
+    unsigned int head;
+    unsigned int count;
+    unsigned int size;
+};
+
 typedef struct {
     Scheduler scheduler;
     LONG ref;
@@ -130,9 +153,33 @@ typedef struct {
     int shutdown_size;
     HANDLE *shutdown_events;
     CRITICAL_SECTION cs;
+    struct scheduler_vproc *vprocs;
+    LONG next_vproc;
+    unsigned int running_workers;
+    CONDITION_VARIABLE workers_cv;
+    unsigned int vproc_workers;
+    unsigned int extra_workers; /* workers started because of oversubscription */
+    unsigned int oversubscribed;
+    LONG idle;
+    HANDLE idle_sem;
+    BOOL shutdown;
+    BOOL destroy_on_exit; /* released from a worker, the last worker to exit destroys it */
 } ThreadScheduler;
 extern const vtable_ptr MSVCRT_ThreadScheduler_vtable;
 
+struct scheduler_worker {
+    ThreadScheduler *scheduler;
+    int vproc;
+};
+
+typedef struct ScheduleGroupBase {
+    const vtable_ptr *vtable;
+    LONG ref;
+    unsigned int id;
+    ThreadScheduler *scheduler;
+} ScheduleGroupBase;
+extern const vtable_ptr MSVCRT_ScheduleGroupBase_vtable;
+
 typedef struct {
     Scheduler *scheduler;
 } _Scheduler;
@@ -240,13 +287,15 @@ void __cdecl Context_Block(void)
 /* ?_Yield@_Context@details@Concurrency@@SAXXZ */
 void __cdecl Context_Yield(void)
 {
-    FIXME("()\n");
+    TRACE("()\n");
+    SwitchToThread();
 }
 
 /* ?_SpinYield@Context@Concurrency@@SAXXZ */
 void __cdecl Context__SpinYield(void)
 {
-    FIXME("()\n");
+    TRACE("()\n");
+    Sleep(0);
 }
 
 /* ?IsCurrentTaskCollectionCanceling@Context@Concurrency@@SA_NXZ */
@@ -256,10 +305,44 @@ MSVCRT_bool __cdecl Context_IsCurrentTaskCollectionCanceling(void)
     return FALSE;
 }
 
+static void ThreadScheduler_oversubscribe(ThreadScheduler*, BOOL);
+
 /* ?Oversubscribe@Context@Concurrency@@SAX_N@Z */
 void __cdecl Context_Oversubscribe(MSVCRT_bool begin)
 {
-    FIXME("(%x)\n", begin);
+    ExternalContextBase *context = (ExternalContextBase*)get_current_context();
+    Scheduler *scheduler;
+
+    TRACE("(%x)\n", begin);
+
+    if (context->context.vtable != &MSVCRT_ExternalContextBase_vtable) {
+        ERR("unknown context set\n");
+        return;
+    }
+
+    if (begin) {
+        if (context->oversubscribe++)
+            return;
+
+        scheduler = context->scheduler.scheduler;
+        if (!scheduler || scheduler->vtable != &MSVCRT_ThreadScheduler_vtable)
+            return;
+        context->oversubscribe_scheduler = scheduler;
+        ThreadScheduler_oversubscribe((ThreadScheduler*)scheduler, TRUE);
+    } else {
+        if (!context->oversubscribe) {
+            WARN("oversubscription was not started\n");
+            return;
+        }
+        if (--context->oversubscribe)
+            return;
+
+        scheduler = context->oversubscribe_scheduler;
+        if (!scheduler)
+            return;
+        context->oversubscribe_scheduler = NULL;
+        ThreadScheduler_oversubscribe((ThreadScheduler*)scheduler, FALSE);
+    }
 }
 
 /* ?ScheduleGroupId@Context@Concurrency@@SAIXZ */
@@ -288,15 +371,15 @@ unsigned int __thiscall ExternalContextBase_GetId(const ExternalContextBase *thi
 DEFINE_THISCALL_WRAPPER(ExternalContextBase_GetVirtualProcessorId, 4)
 unsigned int __thiscall ExternalContextBase_GetVirtualProcessorId(const ExternalContextBase *this)
 {
-    FIXME("(%p)->() stub\n", this);
-    return -1;
+    TRACE("(%p)->()\n", this);
+    return this->vproc;
 }
 
 DEFINE_THISCALL_WRAPPER(ExternalContextBase_GetScheduleGroupId, 4)
 unsigned int __thiscall ExternalContextBase_GetScheduleGroupId(const ExternalContextBase *this)
 {
-    FIXME("(%p)->() stub\n", this);
-    return -1;
+    TRACE("(%p)->()\n", this);
+    return this->group_id;
 }
 
 DEFINE_THISCALL_WRAPPER(ExternalContextBase_Unblock, 4)
@@ -364,6 +447,8 @@ static void ExternalContextBase_ctor(ExternalContextBase *this)
     memset(this, 0, sizeof(*this));
     this->context.vtable = &MSVCRT_ExternalContextBase_vtable;
     this->id = InterlockedIncrement(&context_id);
+    this->vproc = -1;
+    this->group_id = -1;
 
     create_default_scheduler();
     this->scheduler.scheduler = &default_scheduler->scheduler;
@@ -598,17 +683,307 @@ void __thiscall SchedulerPolicy_dtor(SchedulerPolicy *this)
     MSVCRT_operator_delete(this->policy_container);
 }
 
+static void vproc_push(struct scheduler_vproc *vproc, struct chore *chore)
+{
+    EnterCriticalSection(&vproc->cs);
+    if (vproc->count == vproc->size) {
+        unsigned int i, size = vproc->size ? vproc->size * 2 : 16;
+        struct chore **chores = MSVCRT_operator_new(size * sizeof(*chores));
+
+        for (i = 0; i < vproc->count; i++)
+            chores[i] = vproc->chores[(vproc->head + i) % vproc->size];
+        MSVCRT_operator_delete(vproc->chores);
+        vproc->chores = chores;
+        vproc->size = size;
+        vproc->head = 0;
+    }
+    vproc->chores[(vproc->head + vproc->count++) % vproc->size] = chore;
+    LeaveCriticalSection(&vproc->cs);
+}
+
+static struct chore* vproc_pop(struct scheduler_vproc *vproc, BOOL steal)
+{
+    struct chore *chore = NULL;
+
+    if (!vproc->count)
+        return NULL;
+
+    EnterCriticalSection(&vproc->cs);
+    if (vproc->count) {
+        if (steal) {
+            chore = vproc->chores[vproc->head];
+            vproc->head = (vproc->head + 1) % vproc->size;
+        } else {
+            chore = vproc->chores[(vproc->head + vproc->count - 1) % vproc->size];
+        }
+        vproc->count--;
+    }
+    LeaveCriticalSection(&vproc->cs);
+    return chore;
+}
+
+static struct chore* ThreadScheduler_get_chore(ThreadScheduler *this, int vproc)
+{
+    struct chore *chore;
+    unsigned int i;
+
+    if (vproc >= 0 && (chore = vproc_pop(&this->vprocs[vproc], FALSE)))
+        return chore;
+
+    for (i = 1; i <= this->virt_proc_no; i++) {
+        if ((chore = vproc_pop(&this->vprocs[(vproc + i) % this->virt_proc_no], TRUE)))
+            return chore;
+    }
+    return NULL;
+}
+
+static BOOL ThreadScheduler_wake_worker(ThreadScheduler *this)
+{
+    LONG idle;
+
+    do {
+        idle = this->idle;
+        if (!idle) return FALSE;
+    } while (InterlockedCompareExchange(&this->idle, idle - 1, idle) != idle);
+
+    ReleaseSemaphore(this->idle_sem, 1, NULL);
+    return TRUE;
+}
+
+unsigned int __thiscall ThreadScheduler_Release(ThreadScheduler*);
+unsigned int __thiscall ScheduleGroupBase_Release(ScheduleGroupBase*);
+
+static void run_chore(ExternalContextBase *context, struct chore *chore)
+{
+    context->group_id = chore->group ? chore->group->id : -1;
+    chore->proc(chore->data);
+    context->group_id = -1;
+
+    if (chore->group)
+        ScheduleGroupBase_Release(chore->group);
+    MSVCRT_operator_delete(chore);
+}
+
+static void ThreadScheduler_dtor(ThreadScheduler*);
+
+static BOOL ThreadScheduler_retire_worker(ThreadScheduler *this)
+{
+    BOOL ret = FALSE;
+
+    EnterCriticalSection(&this->cs);
+    if (this->extra_workers > this->oversubscribed) {
+        this->extra_workers--;
+        ret = TRUE;
+    }
+    LeaveCriticalSection(&this->cs);
+    return ret;
+}
+
+static DWORD WINAPI scheduler_worker_proc(void *arg)
+{
+    struct scheduler_worker worker = *(struct scheduler_worker*)arg;
+    ThreadScheduler *this = worker.scheduler;
+    ExternalContextBase *context;
+    struct chore *chore;
+    BOOL destroy;
+    int priority;
+
+    MSVCRT_operator_delete(arg);
+
+    priority = SchedulerPolicy_GetPolicyValue(&this->policy, ContextPriority);
+    if (priority != INHERIT_THREAD_PRIORITY)
+        SetThreadPriority(GetCurrentThread(), priority);
+
+    /* the worker doesn't hold a reference, the scheduler waits for it on destruction */
+    context = (ExternalContextBase*)get_current_context();
+    if (context->scheduler.scheduler)
+        call_Scheduler_Release(context->scheduler.scheduler);
+    context->scheduler.scheduler = &this->scheduler;
+    context->worker_scheduler = &this->scheduler;
+    context->vproc = worker.vproc;
+
+    for (;;) {
+        if ((chore = ThreadScheduler_get_chore(this, worker.vproc))) {
+            run_chore(context, chore);
+            continue;
+        }
+
+        if (this->shutdown)
+            break;
+        if (worker.vproc == -1 && ThreadScheduler_retire_worker(this))
+            break;
+
+        InterlockedIncrement(&this->idle);
+        if ((chore = ThreadScheduler_get_chore(this, worker.vproc))) {
+            /* take back our idle count, or the wake up a waker already turned it into */
+            LONG idle;
+
+            do {
+                idle = this->idle;
+                if (!idle) {
+                    WaitForSingleObject(this->idle_sem, INFINITE);
+                    break;
+                }
+            } while (InterlockedCompareExchange(&this->idle, idle - 1, idle) != idle);
+            run_chore(context, chore);
+            continue;
+        }
+        WaitForSingleObject(this->idle_sem, INFINITE);
+    }
+
+    TRACE("(%p) worker %d exiting\n", this, worker.vproc);
+    if (context->scheduler.scheduler == &this->scheduler)
+        context->scheduler.scheduler = NULL;
+    context->worker_scheduler = NULL;
+    context->vproc = -1;
+
+    /* the scheduler may be destroyed as soon as we leave the lock */
+    EnterCriticalSection(&this->cs);
+    if (!--this->running_workers)
+        WakeAllConditionVariable(&this->workers_cv);
+    destroy = !this->running_workers && this->destroy_on_exit;
+    LeaveCriticalSection(&this->cs);
+
+    if (destroy) {
+        ThreadScheduler_dtor(this);
+        MSVCRT_operator_delete(this);
+    }
+    return 0;
+}
+
+/* must be called with scheduler lock held */
+static BOOL ThreadScheduler_add_worker(ThreadScheduler *this, int vproc)
+{
+    static BOOL pinned;
+    struct scheduler_worker *worker;
+    HMODULE module;
+    HANDLE thread;
+
+    if (this->shutdown)
+        return FALSE;
+
+    /* the workers run our code until the scheduler is destroyed, don't let us be unloaded under them */
+    if (!pinned)
+        pinned = GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_PIN,
+                (const WCHAR*)scheduler_worker_proc, &module);
+
+    worker = MSVCRT_operator_new(sizeof(*worker));
+    worker->scheduler = this;
+    worker->vproc = vproc;
+    thread = CreateThread(NULL, SchedulerPolicy_GetPolicyValue(&this->policy, ContextStackSize) * 1024,
+            scheduler_worker_proc, worker, 0, NULL);
+    if (!thread) {
+        WARN("failed to create worker thread: %u\n", GetLastError());
+        MSVCRT_operator_delete(worker);
+        return FALSE;
+    }
+
+    TRACE("(%p) started worker %d\n", this, vproc);
+    CloseHandle(thread);
+    this->running_workers++;
+    return TRUE;
+}
+
+static void ThreadScheduler_schedule(ThreadScheduler *this,
+        void (__cdecl *proc)(void*), void *data, ScheduleGroupBase *group)
+{
+    ExternalContextBase *context = (ExternalContextBase*)try_get_current_context();
+    struct chore *chore = MSVCRT_operator_new(sizeof(*chore));
+    unsigned int vproc, count;
+    BOOL failed;
+
+    chore->proc = proc;
+    chore->data = data;
+    chore->group = group;
+    if (group)
+        InterlockedIncrement(&group->ref);
+
+    /* keep chores scheduled by a worker on its own virtual processor */
+    if (context && context->context.vtable == &MSVCRT_ExternalContextBase_vtable
+            && context->worker_scheduler == &this->scheduler && context->vproc >= 0)
+        vproc = context->vproc;
+    else
+        vproc = (unsigned int)InterlockedIncrement(&this->next_vproc) % this->virt_proc_no;
+    vproc_push(&this->vprocs[vproc], chore);
+
+    if (ThreadScheduler_wake_worker(this))
+        return;
+
+    EnterCriticalSection(&this->cs);
+    count = max(this->vproc_workers + 1,
+            SchedulerPolicy_GetPolicyValue(&this->policy, MinConcurrency));
+    count = min(count, this->virt_proc_no);
+    while (this->vproc_workers < count && ThreadScheduler_add_worker(this, this->vproc_workers))
+        this->vproc_workers++;
+    failed = !this->running_workers;
+    LeaveCriticalSection(&this->cs);
+
+    if (failed)
+        throw_exception(EXCEPTION_SCHEDULER_RESOURCE_ALLOCATION_ERROR,
+                HRESULT_FROM_WIN32(GetLastError()), NULL);
+}
+
+/* the scheduler is kept alive while oversubscribed */
+static void ThreadScheduler_oversubscribe(ThreadScheduler *this, BOOL begin)
+{
+    if (begin)
+        InterlockedIncrement(&this->ref);
+
+    EnterCriticalSection(&this->cs);
+    if (begin) {
+        this->oversubscribed++;
+        if (this->extra_workers < this->oversubscribed && ThreadScheduler_add_worker(this, -1))
+            this->extra_workers++;
+    } else {
+        this->oversubscribed--;
+    }
+    LeaveCriticalSection(&this->cs);
+
+    /* let an idle extra worker notice it's no longer needed */
+    if (!begin) {
+        ThreadScheduler_wake_worker(this);
+        ThreadScheduler_Release(this);
+    }
+}
+
+/* workers run the remaining chores before exiting */
+static void ThreadScheduler_shutdown(ThreadScheduler *this)
+{
+    EnterCriticalSection(&this->cs);
+    this->shutdown = TRUE;
+    if (this->running_workers)
+        ReleaseSemaphore(this->idle_sem, this->running_workers, NULL);
+    while (this->running_workers)
+        SleepConditionVariableCS(&this->workers_cv, &this->cs, INFINITE);
+    LeaveCriticalSection(&this->cs);
+}
+
 static void ThreadScheduler_dtor(ThreadScheduler *this)
 {
+    unsigned int j;
     int i;
 
     if(this->ref != 0) WARN("ref = %d\n", this->ref);
+    ThreadScheduler_shutdown(this);
     SchedulerPolicy_dtor(&this->policy);
 
     for(i=0; i<this->shutdown_count; i++)
         SetEvent(this->shutdown_events[i]);
     MSVCRT_operator_delete(this->shutdown_events);
 
+    for(j=0; j<this->virt_proc_no; j++) {
+        struct scheduler_vproc *vproc = &this->vprocs[j];
+
+        if(vproc->count) WARN("dropping %u chores\n", vproc->count);
+        while(vproc->count)
+            MSVCRT_operator_delete(vproc_pop(vproc, TRUE));
+        MSVCRT_operator_delete(vproc->chores);
+        vproc->cs.DebugInfo->Spare[0] = 0;
+        DeleteCriticalSection(&vproc->cs);
+    }
+    MSVCRT_operator_delete(this->vprocs);
+    CloseHandle(this->idle_sem);
+
     this->cs.DebugInfo->Spare[0] = 0;
     DeleteCriticalSection(&this->cs);
 }
@@ -650,6 +1025,20 @@ unsigned int __thiscall ThreadScheduler_Release(ThreadScheduler *this)
     TRACE("(%p)\n", this);
 
     if(!ret) {
+        ExternalContextBase *context = (ExternalContextBase*)try_get_current_context();
+
+        /* a worker can't wait for itself to exit */
+        if(context && context->context.vtable == &MSVCRT_ExternalContextBase_vtable
+                && context->worker_scheduler == &this->scheduler) {
+            TRACE("(%p) released from its own worker thread, destroying after the workers exit\n", this);
+            EnterCriticalSection(&this->cs);
+            this->shutdown = TRUE;
+            this->destroy_on_exit = TRUE;
+            ReleaseSemaphore(this->idle_sem, this->running_workers, NULL);
+            LeaveCriticalSection(&this->cs);
+            return ret;
+        }
+
         ThreadScheduler_dtor(this);
         MSVCRT_operator_delete(this);
     }
@@ -702,33 +1091,118 @@ void __thiscall ThreadScheduler_Attach(ThreadScheduler *this)
     ThreadScheduler_Reference(this);
 }
 
+DEFINE_THISCALL_WRAPPER(ScheduleGroupBase_ScheduleTask, 12)
+void __thiscall ScheduleGroupBase_ScheduleTask(ScheduleGroupBase *this,
+        void (__cdecl *proc)(void*), void* data)
+{
+    TRACE("(%p %p %p)\n", this, proc, data);
+    ThreadScheduler_schedule(this->scheduler, proc, data, this);
+}
+
+DEFINE_THISCALL_WRAPPER(ScheduleGroupBase_Id, 4)
+unsigned int __thiscall ScheduleGroupBase_Id(const ScheduleGroupBase *this)
+{
+    TRACE("(%p)\n", this);
+    return this->id;
+}
+
+DEFINE_THISCALL_WRAPPER(ScheduleGroupBase_Reference, 4)
+unsigned int __thiscall ScheduleGroupBase_Reference(ScheduleGroupBase *this)
+{
+    TRACE("(%p)\n", this);
+    return InterlockedIncrement(&this->ref);
+}
+
+static void ScheduleGroupBase_dtor(ScheduleGroupBase *this)
+{
+    if(this->ref != 0) WARN("ref = %d\n", this->ref);
+    ThreadScheduler_Release(this->scheduler);
+}
+
+DEFINE_THISCALL_WRAPPER(ScheduleGroupBase_Release, 4)
+unsigned int __thiscall ScheduleGroupBase_Release(ScheduleGroupBase *this)
+{
+    unsigned int ret = InterlockedDecrement(&this->ref);
+
+    TRACE("(%p)\n", this);
+
+    if(!ret) {
+        ScheduleGroupBase_dtor(this);
+        MSVCRT_operator_delete(this);
+    }
+    return ret;
+}
+
+DEFINE_THISCALL_WRAPPER(ScheduleGroupBase_vector_dtor, 8)
+ScheduleGroupBase* __thiscall ScheduleGroupBase_vector_dtor(ScheduleGroupBase *this, unsigned int flags)
+{
+    TRACE("(%p %x)\n", this, flags);
+    if(flags & 2) {
+        /* we have an array, with the number of elements stored before the first object */
+        INT_PTR i, *ptr = (INT_PTR *)this-1;
+
+        for(i=*ptr-1; i>=0; i--)
+            ScheduleGroupBase_dtor(this+i);
+        MSVCRT_operator_delete(ptr);
+    } else {
+        ScheduleGroupBase_dtor(this);
+        if(flags & 1)
+            MSVCRT_operator_delete(this);
+    }
+
+    return this;
+}
+
+static ScheduleGroupBase* ScheduleGroupBase_ctor(ScheduleGroupBase *this, ThreadScheduler *scheduler)
+{
+    TRACE("(%p)->(%p)\n", this, scheduler);
+
+    this->vtable = &MSVCRT_ScheduleGroupBase_vtable;
+    this->ref = 1;
+    this->id = InterlockedIncrement(&schedule_group_id);
+    this->scheduler = scheduler;
+    ThreadScheduler_Reference(scheduler);
+    return this;
+}
+
 DEFINE_THISCALL_WRAPPER(ThreadScheduler_CreateScheduleGroup_loc, 8)
 /*ScheduleGroup*/void* __thiscall ThreadScheduler_CreateScheduleGroup_loc(
         ThreadScheduler *this, /*location*/void *placement)
 {
-    FIXME("(%p %p) stub\n", this, placement);
-    return NULL;
+    ScheduleGroupBase *ret;
+
+    TRACE("(%p %p)\n", this, placement);
+
+    /* placement is ignored, any worker can run the group chores */
+    ret = MSVCRT_operator_new(sizeof(*ret));
+    return ScheduleGroupBase_ctor(ret, this);
 }
 
 DEFINE_THISCALL_WRAPPER(ThreadScheduler_CreateScheduleGroup, 4)
 /*ScheduleGroup*/void* __thiscall ThreadScheduler_CreateScheduleGroup(ThreadScheduler *this)
 {
-    FIXME("(%p) stub\n", this);
-    return NULL;
+    ScheduleGroupBase *ret;
+
+    TRACE("(%p)\n", this);
+
+    ret = MSVCRT_operator_new(sizeof(*ret));
+    return ScheduleGroupBase_ctor(ret, this);
 }
 
 DEFINE_THISCALL_WRAPPER(ThreadScheduler_ScheduleTask_loc, 16)
 void __thiscall ThreadScheduler_ScheduleTask_loc(ThreadScheduler *this,
         void (__cdecl *proc)(void*), void* data, /*location*/void *placement)
 {
-    FIXME("(%p %p %p %p) stub\n", this, proc, data, placement);
+    TRACE("(%p %p %p %p)\n", this, proc, data, placement);
+    ThreadScheduler_schedule(this, proc, data, NULL);
 }
 
 DEFINE_THISCALL_WRAPPER(ThreadScheduler_ScheduleTask, 12)
 void __thiscall ThreadScheduler_ScheduleTask(ThreadScheduler *this,
         void (__cdecl *proc)(void*), void* data)
 {
-    FIXME("(%p %p %p) stub\n", this, proc, data);
+    TRACE("(%p %p %p)\n", this, proc, data);
+    ThreadScheduler_schedule(this, proc, data, NULL);
 }
 
 DEFINE_THISCALL_WRAPPER(ThreadScheduler_IsAvailableLocation, 8)
@@ -762,10 +1236,12 @@ Scheduler* __thiscall ThreadScheduler_vector_dtor(ThreadScheduler *this, unsigne
 static ThreadScheduler* ThreadScheduler_ctor(ThreadScheduler *this,
         const SchedulerPolicy *policy)
 {
+    unsigned int i, min_concurrency;
     SYSTEM_INFO si;
 
     TRACE("(%p)->()\n", this);
 
+    memset(this, 0, sizeof(*this));
     this->scheduler.vtable = &MSVCRT_ThreadScheduler_vtable;
     this->ref = 1;
     this->id = InterlockedIncrement(&scheduler_id);
@@ -775,9 +1251,20 @@ static ThreadScheduler* ThreadScheduler_ctor(ThreadScheduler *this,
     this->virt_proc_no = SchedulerPolicy_GetPolicyValue(&this->policy, MaxConcurrency);
     if(this->virt_proc_no > si.dwNumberOfProcessors)
         this->virt_proc_no = si.dwNumberOfProcessors;
-
-    this->shutdown_count = this->shutdown_size = 0;
-    this->shutdown_events = NULL;
+    min_concurrency = SchedulerPolicy_GetPolicyValue(&this->policy, MinConcurrency);
+    if(this->virt_proc_no < min_concurrency)
+        this->virt_proc_no = min_concurrency;
+    if(!this->virt_proc_no)
+        this->virt_proc_no = 1;
+
+    this->vprocs = MSVCRT_operator_new(this->virt_proc_no * sizeof(*this->vprocs));
+    memset(this->vprocs, 0, this->virt_proc_no * sizeof(*this->vprocs));
+    for(i=0; i<this->virt_proc_no; i++) {
+        InitializeCriticalSection(&this->vprocs[i].cs);
+        this->vprocs[i].cs.DebugInfo->Spare[0] = (DWORD_PTR)(__FILE__ ": ThreadScheduler.vproc");
+    }
+    this->idle_sem = CreateSemaphoreW(NULL, 0, MAXLONG, NULL);
+    InitializeConditionVariable(&this->workers_cv);
 
     InitializeCriticalSection(&this->cs);
     this->cs.DebugInfo->Spare[0] = (DWORD_PTR)(__FILE__ ": ThreadScheduler");
@@ -1093,6 +1580,9 @@ DEFINE_RTTI_DATA0(Scheduler, 0, ".?AVScheduler@Concurrency@@")
 DEFINE_RTTI_DATA1(SchedulerBase, 0, &Scheduler_rtti_base_descriptor, ".?AVSchedulerBase@details@Concurrency@@")
 DEFINE_RTTI_DATA2(ThreadScheduler, 0, &SchedulerBase_rtti_base_descriptor,
         &Scheduler_rtti_base_descriptor, ".?AVThreadScheduler@details@Concurrency@@")
+DEFINE_RTTI_DATA0(ScheduleGroup, 0, ".?AVScheduleGroup@Concurrency@@")
+DEFINE_RTTI_DATA1(ScheduleGroupBase, 0, &ScheduleGroup_rtti_base_descriptor,
+        ".?AVScheduleGroupBase@details@Concurrency@@")
 
 __ASM_BLOCK_BEGIN(scheduler_vtables)
     __ASM_VTABLE(ExternalContextBase,
@@ -1123,6 +1613,12 @@ __ASM_BLOCK_BEGIN(scheduler_vtables)
             VTABLE_ADD_FUNC(ThreadScheduler_IsAvailableLocation)
 #endif
             );
+    __ASM_VTABLE(ScheduleGroupBase,
+            VTABLE_ADD_FUNC(ScheduleGroupBase_ScheduleTask)
+            VTABLE_ADD_FUNC(ScheduleGroupBase_Id)
+            VTABLE_ADD_FUNC(ScheduleGroupBase_Reference)
+            VTABLE_ADD_FUNC(ScheduleGroupBase_Release)
+            VTABLE_ADD_FUNC(ScheduleGroupBase_vector_dtor));
 __ASM_BLOCK_END
 
 void msvcrt_init_scheduler(void *base)
@@ -1134,6 +1630,8 @@ void msvcrt_init_scheduler(void *base)
     init_Scheduler_rtti(base);
     init_SchedulerBase_rtti(base);
     init_ThreadScheduler_rtti(base);
+    init_ScheduleGroup_rtti(base);
+    init_ScheduleGroupBase_rtti(base);
 #endif
 }
 
@@ -1143,7 +1641,8 @@ void msvcrt_free_scheduler(void)
         TlsFree(context_tls_index);
     if(default_scheduler_policy.policy_container)
         SchedulerPolicy_dtor(&default_scheduler_policy);
-    if(default_scheduler) {
+    /* the module is pinned once workers are started, so there are none left here */
+    if(default_scheduler && !default_scheduler->running_workers) {
         ThreadScheduler_dtor(default_scheduler);
         MSVCRT_operator_delete(default_scheduler);
     }
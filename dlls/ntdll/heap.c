@@ -87,6 +87,7 @@ typedef struct
 #define ARENA_PENDING_MAGIC    0xbedead
 #define ARENA_FREE_MAGIC       0x45455246
 #define ARENA_LARGE_MAGIC      0x6752614c
+#define ARENA_LFH_MAGIC        0x484c46
 
 #define ARENA_INUSE_FILLER     0x55
 #define ARENA_TAIL_FILLER      0xab
@@ -125,6 +126,7 @@ C_ASSERT( sizeof(ARENA_LARGE) % LARGE_ALIGNMENT == 0 );
 #define HEAP_NB_FREE_LISTS  128
 
 struct tagHEAP;
+struct lfh_heap;
 
 typedef struct tagSUBHEAP
 {
@@ -164,6 +166,7 @@ typedef struct tagHEAP
     struct list     *freeList;      /* Free lists */
     struct wine_rb_tree freeTree;   /* Free tree */
     DWORD            freeMask[HEAP_NB_FREE_LISTS / (8 * sizeof(DWORD))];
+    struct lfh_heap *lfh;           /* Low fragmentation heap front-end, if enabled */
 } HEAP;
 
 #define HEAP_FREEMASK_BLOCK    (8 * sizeof(DWORD))
@@ -178,6 +181,60 @@ C_ASSERT( HEAP_NB_FREE_LISTS % HEAP_FREEMASK_BLOCK == 0 );
 #define COMMIT_MASK          0xffff  /* bitmask for commit/decommit granularity */
 #define MAX_FREE_PENDING     1024    /* max number of free requests to delay */
 
+/* The low fragmentation heap serves small blocks from groups of same-sized
+ * blocks carved out of the normal heap. Each thread allocates from the group
+ * in its affinity slot, claiming blocks with atomic operations on the group
+ * bitmap, so the heap lock is only taken to find or create a group once the
+ * current one is exhausted. Blocks are freed under the heap lock, and groups
+ * that are not in an affinity slot are given back to the heap once all their
+ * blocks are free. */
+
+#define LFH_MAX_SIZE         1024  /* largest block data size served by the LFH */
+#define LFH_SMALL_SIZE       256   /* size classes are ALIGNMENT apart below this size */
+#define LFH_STEP             64    /* and LFH_STEP apart above it */
+#define LFH_CLASS_COUNT      (LFH_SMALL_SIZE / ALIGNMENT + (LFH_MAX_SIZE - LFH_SMALL_SIZE) / LFH_STEP)
+#define LFH_GROUP_BLOCKS     64    /* number of blocks in a group */
+#define LFH_AFFINITY_SLOTS   8     /* number of groups threads allocate from for each class */
+
+#define LFH_GROUP_MAGIC      ((DWORD)('L' | ('F'<<8) | ('H'<<16) | ('G'<<24)))
+
+struct lfh_group;
+
+struct lfh_block
+{
+    struct lfh_group *group;        /* group containing this block */
+#ifndef _WIN64
+    DWORD             pad;          /* padding to keep the data aligned */
+#endif
+    ARENA_INUSE       arena;        /* for compatibility with normal arenas, must be last */
+};
+
+C_ASSERT( sizeof(struct lfh_block) % ALIGNMENT == 0 );
+
+struct lfh_group
+{
+    DWORD             magic;        /* Magic number */
+    unsigned int      cls;          /* size class of the blocks */
+    struct tagHEAP   *heap;         /* heap the group belongs to */
+    struct list       entry;        /* entry in the size class group list */
+    SIZE_T            block_size;   /* size of each block, including its header */
+    BOOL              owned;        /* whether the group is in, or taken from, an affinity slot */
+    LONG volatile     free_bits[LFH_GROUP_BLOCKS / 32];  /* bitmap of the free blocks */
+};
+
+#define LFH_GROUP_HEADER_SIZE  ((sizeof(struct lfh_group) + ALIGNMENT - 1) & ~(ALIGNMENT - 1))
+
+struct lfh_class
+{
+    struct lfh_group *affinity[LFH_AFFINITY_SLOTS];  /* groups to allocate from, indexed by thread */
+    struct list       groups;       /* all groups of this class, protected by the heap lock */
+};
+
+struct lfh_heap
+{
+    struct lfh_class  classes[LFH_CLASS_COUNT];
+};
+
 /* some undocumented flags (names are made up) */
 #define HEAP_PAGE_ALLOCS      0x01000000
 #define HEAP_VALIDATE         0x10000000
@@ -1441,6 +1498,320 @@ static BOOL HEAP_ValidateInUseArena( const SUBHEAP *subheap, const ARENA_INUSE *
 }
 
 
+/***********************************************************************
+ *           lfh_get_class
+ *
+ * Get the LFH size class for a block data size.
+ */
+static inline unsigned int lfh_get_class( SIZE_T size )
+{
+    if (size <= LFH_SMALL_SIZE) return size ? (size - 1) / ALIGNMENT : 0;
+    return LFH_SMALL_SIZE / ALIGNMENT + (size - LFH_SMALL_SIZE - 1) / LFH_STEP;
+}
+
+
+/***********************************************************************
+ *           lfh_get_class_size
+ */
+static inline SIZE_T lfh_get_class_size( unsigned int cls )
+{
+    if (cls < LFH_SMALL_SIZE / ALIGNMENT) return (cls + 1) * ALIGNMENT;
+    return LFH_SMALL_SIZE + (cls - LFH_SMALL_SIZE / ALIGNMENT + 1) * LFH_STEP;
+}
+
+
+static inline struct lfh_block *lfh_group_get_block( struct lfh_group *group, unsigned int index )
+{
+    return (struct lfh_block *)((char *)group + LFH_GROUP_HEADER_SIZE + index * group->block_size);
+}
+
+static inline unsigned int lfh_block_index( const struct lfh_block *block )
+{
+    return ((char *)block - (char *)lfh_group_get_block( block->group, 0 )) / block->group->block_size;
+}
+
+
+/***********************************************************************
+ *           lfh_create_group
+ *
+ * Allocate a new group of blocks for a size class. Heap must be locked.
+ */
+static struct lfh_group *lfh_create_group( HEAP *heap, unsigned int cls )
+{
+    SIZE_T class_size = lfh_get_class_size( cls );
+    SIZE_T block_size = sizeof(struct lfh_block) + class_size;
+    struct lfh_group *group;
+    struct lfh_block *block;
+    unsigned int i;
+
+    if (!(group = RtlAllocateHeap( heap, 0, LFH_GROUP_HEADER_SIZE + LFH_GROUP_BLOCKS * block_size )))
+        return NULL;
+
+    group->magic = LFH_GROUP_MAGIC;
+    group->cls = cls;
+    group->heap = heap;
+    group->block_size = block_size;
+    group->owned = FALSE;
+    for (i = 0; i < LFH_GROUP_BLOCKS; i++)
+    {
+        block = lfh_group_get_block( group, i );
+        block->group = group;
+        block->arena.size = class_size;
+        block->arena.magic = ARENA_LFH_MAGIC;
+        block->arena.unused_bytes = 0;
+    }
+    for (i = 0; i < ARRAY_SIZE(group->free_bits); i++) group->free_bits[i] = ~0;
+
+    list_add_head( &heap->lfh->classes[cls].groups, &group->entry );
+    TRACE( "heap %p: new group %p for size class %u\n", heap, group, cls );
+    return group;
+}
+
+
+/***********************************************************************
+ *           lfh_release_group
+ *
+ * Give a group back to the heap if it isn't owned and all its blocks are
+ * free. Heap must be locked.
+ */
+static void lfh_release_group( HEAP *heap, struct lfh_group *group )
+{
+    unsigned int i;
+
+    if (group->owned) return;
+    for (i = 0; i < ARRAY_SIZE(group->free_bits); i++)
+        if (group->free_bits[i] != ~0) return;
+
+    TRACE( "heap %p: releasing group %p for size class %u\n", heap, group, group->cls );
+    list_remove( &group->entry );
+    group->magic = 0;
+    RtlFreeHeap( heap, 0, group );
+}
+
+
+/***********************************************************************
+ *           lfh_find_group
+ *
+ * Find a group with free blocks for a size class, or create one, and take
+ * ownership of it. The ownership of the previous group of the caller, if
+ * any, is given up.
+ */
+static struct lfh_group *lfh_find_group( HEAP *heap, unsigned int cls, struct lfh_group *prev )
+{
+    struct lfh_class *class = &heap->lfh->classes[cls];
+    struct lfh_group *group;
+    unsigned int i;
+
+    RtlEnterCriticalSection( &heap->critSection );
+
+    /* move exhausted groups to the end, the ones at the head are then likely to have free blocks */
+    if (prev)
+    {
+        prev->owned = FALSE;
+        list_remove( &prev->entry );
+        list_add_tail( &class->groups, &prev->entry );
+    }
+
+    LIST_FOR_EACH_ENTRY( group, &class->groups, struct lfh_group, entry )
+    {
+        if (group == prev) break;
+        if (group->owned) continue;
+        for (i = 0; i < ARRAY_SIZE(group->free_bits); i++)
+            if (group->free_bits[i]) goto done;
+    }
+    group = lfh_create_group( heap, cls );
+
+done:
+    if (group) group->owned = TRUE;
+    RtlLeaveCriticalSection( &heap->critSection );
+    return group;
+}
+
+
+/***********************************************************************
+ *           lfh_disown_group
+ *
+ * Give up the ownership of a group that couldn't be put back in its slot.
+ */
+static void lfh_disown_group( HEAP *heap, struct lfh_group *group )
+{
+    RtlEnterCriticalSection( &heap->critSection );
+    group->owned = FALSE;
+    lfh_release_group( heap, group );
+    RtlLeaveCriticalSection( &heap->critSection );
+}
+
+
+/***********************************************************************
+ *           lfh_group_alloc_block
+ *
+ * Claim a free block in a group, without locking.
+ */
+static struct lfh_block *lfh_group_alloc_block( struct lfh_group *group )
+{
+    unsigned int i;
+    DWORD index;
+    LONG bits;
+
+    for (i = 0; i < ARRAY_SIZE(group->free_bits); i++)
+    {
+        while ((bits = group->free_bits[i]))
+        {
+            BitScanForward( &index, bits );
+            if (InterlockedCompareExchange( &group->free_bits[i], bits & ~(1u << index), bits ) == bits)
+                return lfh_group_get_block( group, i * 32 + index );
+        }
+    }
+    return NULL;
+}
+
+
+/***********************************************************************
+ *           lfh_allocate
+ */
+static void *lfh_allocate( HEAP *heap, DWORD flags, SIZE_T size )
+{
+    unsigned int cls = lfh_get_class( size + HEAP_TAIL_EXTRA_SIZE );
+    ULONG tid = HandleToULong( NtCurrentTeb()->ClientId.UniqueThread );
+    struct lfh_group **slot = &heap->lfh->classes[cls].affinity[(tid >> 2) % LFH_AFFINITY_SLOTS];
+    struct lfh_group *group, *prev;
+    struct lfh_block *block;
+
+    /* take the group out of its slot while allocating from it, so that it can't be released */
+    group = InterlockedExchangePointer( (void **)slot, NULL );
+    for (;;)
+    {
+        if (group && (block = lfh_group_alloc_block( group ))) break;
+        prev = group;
+        if (!(group = lfh_find_group( heap, cls, prev ))) return NULL;
+    }
+    if (InterlockedCompareExchangePointer( (void **)slot, group, NULL )) lfh_disown_group( heap, group );
+
+    block->arena.unused_bytes = block->arena.size - size;
+    notify_alloc( &block->arena + 1, size, flags & HEAP_ZERO_MEMORY );
+    initialize_block( &block->arena + 1, size, block->arena.unused_bytes, flags );
+    return &block->arena + 1;
+}
+
+
+/***********************************************************************
+ *           lfh_find_block
+ *
+ * Check if a pointer is an LFH block of the heap. The block and its group
+ * header are checked to be inside the heap before being accessed. Heap
+ * must be locked.
+ */
+static struct lfh_block *lfh_find_block( HEAP *heap, const void *ptr )
+{
+    const ARENA_INUSE *arena = (const ARENA_INUSE *)ptr - 1;
+    struct lfh_block *block;
+    struct lfh_group *group;
+    SUBHEAP *subheap;
+    SIZE_T offset;
+
+    if (!heap->lfh || (ULONG_PTR)ptr % ALIGNMENT) return NULL;
+    if (!(subheap = HEAP_FindSubHeap( heap, arena ))) return NULL;
+
+    block = CONTAINING_RECORD( arena, struct lfh_block, arena );
+    if ((char *)block < (char *)subheap->base + subheap->headerSize) return NULL;
+    if ((const char *)ptr > (char *)subheap->base + subheap->commitSize) return NULL;
+    if (arena->magic != ARENA_LFH_MAGIC) return NULL;
+
+    /* the group is in the same subheap as its blocks */
+    group = block->group;
+    if ((char *)group < (char *)subheap->base + subheap->headerSize ||
+        (char *)group + LFH_GROUP_HEADER_SIZE > (char *)block) return NULL;
+    if (group->magic != LFH_GROUP_MAGIC || group->heap != heap) return NULL;
+
+    offset = (char *)block - (char *)lfh_group_get_block( group, 0 );
+    if (offset % group->block_size || offset / group->block_size >= LFH_GROUP_BLOCKS) return NULL;
+    return block;
+}
+
+
+/***********************************************************************
+ *           lfh_free_block
+ *
+ * Release a block to its group. Fails if it was already free. Heap must be
+ * locked.
+ */
+static BOOL lfh_free_block( HEAP *heap, struct lfh_block *block )
+{
+    struct lfh_group *group = block->group;
+    unsigned int index = lfh_block_index( block );
+    LONG volatile *bits = &group->free_bits[index / 32];
+    LONG mask = 1u << (index % 32), old;
+
+    /* the owner of the group may be claiming other blocks concurrently */
+    do
+    {
+        old = *bits;
+        if (old & mask) return FALSE;
+    } while (InterlockedCompareExchange( bits, old | mask, old ) != old);
+
+    lfh_release_group( heap, group );
+    return TRUE;
+}
+
+
+/***********************************************************************
+ *           lfh_reallocate
+ *
+ * Resize an LFH block, moving it to another size class if needed. Heap
+ * must be locked.
+ */
+static void *lfh_reallocate( HEAP *heap, DWORD flags, struct lfh_block *block, SIZE_T size )
+{
+    SIZE_T old_size = block->arena.size - block->arena.unused_bytes;
+    void *ptr = &block->arena + 1, *ret;
+
+    if (size <= LFH_MAX_SIZE - HEAP_TAIL_EXTRA_SIZE &&
+        lfh_get_class( size + HEAP_TAIL_EXTRA_SIZE ) == block->group->cls)
+    {
+        block->arena.unused_bytes = block->arena.size - size;
+        notify_realloc( ptr, old_size, size );
+        if (size > old_size)
+            initialize_block( (char *)ptr + old_size, size - old_size, block->arena.unused_bytes, flags );
+        else
+            mark_block_tail( (char *)ptr + size, block->arena.unused_bytes, flags );
+        return ptr;
+    }
+
+    if (flags & HEAP_REALLOC_IN_PLACE_ONLY) return NULL;
+    if (!(ret = RtlAllocateHeap( heap, flags & ~HEAP_GENERATE_EXCEPTIONS, size ))) return NULL;
+    memcpy( ret, ptr, min( old_size, size ) );
+    notify_free( ptr );
+    lfh_free_block( heap, block );
+    return ret;
+}
+
+
+/***********************************************************************
+ *           enable_lfh
+ */
+static NTSTATUS enable_lfh( HEAP *heap )
+{
+    struct lfh_heap *lfh;
+    unsigned int i;
+
+    if (heap->flags & (HEAP_NO_SERIALIZE | HEAP_VALIDATE | HEAP_PAGE_ALLOCS |
+                       HEAP_TAIL_CHECKING_ENABLED | HEAP_FREE_CHECKING_ENABLED))
+        return STATUS_UNSUCCESSFUL;
+    if (heap->lfh) return STATUS_SUCCESS;
+
+    RtlEnterCriticalSection( &heap->critSection );
+    if (!heap->lfh && (lfh = RtlAllocateHeap( heap, HEAP_ZERO_MEMORY, sizeof(*lfh) )))
+    {
+        for (i = 0; i < LFH_CLASS_COUNT; i++) list_init( &lfh->classes[i].groups );
+        InterlockedExchangePointer( (void **)&heap->lfh, lfh );
+    }
+    RtlLeaveCriticalSection( &heap->critSection );
+
+    TRACE( "heap %p: low fragmentation heap %p\n", heap, heap->lfh );
+    return heap->lfh ? STATUS_SUCCESS : STATUS_NO_MEMORY;
+}
+
+
 /***********************************************************************
  *           HEAP_IsRealArena  [Internal]
  * Validates a block is a valid arena.
@@ -1468,8 +1839,14 @@ static BOOL HEAP_IsRealArena( HEAP *heapPtr,   /* [in] ptr to the heap */
     if (block)  /* only check this single memory block */
     {
         const ARENA_INUSE *arena = (const ARENA_INUSE *)block - 1;
+        struct lfh_block *lfh_block;
 
-        if (!(subheap = HEAP_FindSubHeap( heapPtr, arena )) ||
+        if ((lfh_block = lfh_find_block( heapPtr, block )))
+        {
+            unsigned int index = lfh_block_index( lfh_block );
+            ret = !(lfh_block->group->free_bits[index / 32] & (1u << (index % 32)));
+        }
+        else if (!(subheap = HEAP_FindSubHeap( heapPtr, arena )) ||
             ((const char *)arena < (char *)subheap->base + subheap->headerSize))
         {
             if (!(large_arena = find_large_block( heapPtr, block )))
@@ -1788,6 +2165,14 @@ void * WINAPI DECLSPEC_HOTPATCH RtlAllocateHeap( HANDLE heap, ULONG flags, SIZE_
     }
     if (rounded_size < HEAP_MIN_DATA_SIZE) rounded_size = HEAP_MIN_DATA_SIZE;
 
+    if (heapPtr->lfh && size <= LFH_MAX_SIZE - HEAP_TAIL_EXTRA_SIZE)
+    {
+        void *ret = lfh_allocate( heapPtr, flags, size );
+        if (!ret && (flags & HEAP_GENERATE_EXCEPTIONS)) RtlRaiseStatus( STATUS_NO_MEMORY );
+        TRACE("(%p,%08x,%08lx): returning %p\n", heap, flags, size, ret );
+        return ret;
+    }
+
     if (!(flags & HEAP_NO_SERIALIZE)) RtlEnterCriticalSection( &heapPtr->critSection );
 
     if (rounded_size >= HEAP_MIN_LARGE_BLOCK_SIZE && (flags & HEAP_GROWABLE))
@@ -1854,6 +2239,7 @@ void * WINAPI DECLSPEC_HOTPATCH RtlAllocateHeap( HANDLE heap, ULONG flags, SIZE_
  */
 BOOLEAN WINAPI DECLSPEC_HOTPATCH RtlFreeHeap( HANDLE heap, ULONG flags, void *ptr )
 {
+    struct lfh_block *block;
     ARENA_INUSE *pInUse;
     SUBHEAP *subheap;
     HEAP *heapPtr;
@@ -1876,6 +2262,14 @@ BOOLEAN WINAPI DECLSPEC_HOTPATCH RtlFreeHeap( HANDLE heap, ULONG flags, void *pt
     /* Inform valgrind we are trying to free memory, so it can throw up an error message */
     notify_free( ptr );
 
+    if ((block = lfh_find_block( heapPtr, ptr )))
+    {
+        if (!lfh_free_block( heapPtr, block )) goto error;
+        if (!(flags & HEAP_NO_SERIALIZE)) RtlLeaveCriticalSection( &heapPtr->critSection );
+        TRACE("(%p,%08x,%p): returning TRUE\n", heap, flags, ptr );
+        return TRUE;
+    }
+
     /* Some sanity checks */
     pInUse  = (ARENA_INUSE *)ptr - 1;
     if (!validate_block_pointer( heapPtr, &subheap, pInUse )) goto error;
@@ -1914,6 +2308,7 @@ error:
  */
 PVOID WINAPI RtlReAllocateHeap( HANDLE heap, ULONG flags, PVOID ptr, SIZE_T size )
 {
+    struct lfh_block *block;
     ARENA_INUSE *pArena;
     HEAP *heapPtr;
     SUBHEAP *subheap;
@@ -1938,6 +2333,12 @@ PVOID WINAPI RtlReAllocateHeap( HANDLE heap, ULONG flags, PVOID ptr, SIZE_T size
     if (rounded_size < size) goto oom;  /* overflow */
     if (rounded_size < HEAP_MIN_DATA_SIZE) rounded_size = HEAP_MIN_DATA_SIZE;
 
+    if ((block = lfh_find_block( heapPtr, ptr )))
+    {
+        if (!(ret = lfh_reallocate( heapPtr, flags, block, size ))) goto oom;
+        goto done;
+    }
+
     pArena = (ARENA_INUSE *)ptr - 1;
     if (!validate_block_pointer( heapPtr, &subheap, pArena )) goto error;
     if (!subheap)
@@ -2130,6 +2531,7 @@ BOOLEAN WINAPI RtlUnlockHeap( HANDLE heap )
 SIZE_T WINAPI RtlSizeHeap( HANDLE heap, ULONG flags, const void *ptr )
 {
     SIZE_T ret;
+    const struct lfh_block *block;
     const ARENA_INUSE *pArena;
     SUBHEAP *subheap;
     HEAP *heapPtr = HEAP_GetPtr( heap );
@@ -2144,7 +2546,11 @@ SIZE_T WINAPI RtlSizeHeap( HANDLE heap, ULONG flags, const void *ptr )
     if (!(flags & HEAP_NO_SERIALIZE)) RtlEnterCriticalSection( &heapPtr->critSection );
 
     pArena = (const ARENA_INUSE *)ptr - 1;
-    if (!validate_block_pointer( heapPtr, &subheap, pArena ))
+    if ((block = lfh_find_block( heapPtr, ptr )))
+    {
+        ret = block->arena.size - block->arena.unused_bytes;
+    }
+    else if (!validate_block_pointer( heapPtr, &subheap, pArena ))
     {
         RtlSetLastWin32ErrorAndNtStatusFromNtStatus( STATUS_INVALID_PARAMETER );
         ret = ~(SIZE_T)0;
@@ -2351,6 +2757,8 @@ ULONG WINAPI RtlGetProcessHeaps( ULONG count, HANDLE *heaps )
 NTSTATUS WINAPI RtlQueryHeapInformation( HANDLE heap, HEAP_INFORMATION_CLASS info_class,
                                          PVOID info, SIZE_T size_in, PSIZE_T size_out)
 {
+    HEAP *heapPtr;
+
     switch (info_class)
     {
     case HeapCompatibilityInformation:
@@ -2359,7 +2767,8 @@ NTSTATUS WINAPI RtlQueryHeapInformation( HANDLE heap, HEAP_INFORMATION_CLASS inf
         if (size_in < sizeof(ULONG))
             return STATUS_BUFFER_TOO_SMALL;
 
-        *(ULONG *)info = 0; /* standard heap */
+        if (!(heapPtr = HEAP_GetPtr( heap ))) return STATUS_INVALID_HANDLE;
+        *(ULONG *)info = heapPtr->lfh ? 2 : 0; /* low fragmentation heap or standard heap */
         return STATUS_SUCCESS;
 
     default:
@@ -2373,6 +2782,23 @@ NTSTATUS WINAPI RtlQueryHeapInformation( HANDLE heap, HEAP_INFORMATION_CLASS inf
  */
 NTSTATUS WINAPI RtlSetHeapInformation( HANDLE heap, HEAP_INFORMATION_CLASS info_class, PVOID info, SIZE_T size)
 {
-    FIXME("%p %d %p %ld stub\n", heap, info_class, info, size);
-    return STATUS_SUCCESS;
+    HEAP *heapPtr;
+
+    switch (info_class)
+    {
+    case HeapCompatibilityInformation:
+        if (size < sizeof(ULONG)) return STATUS_BUFFER_TOO_SMALL;
+        if (!(heapPtr = HEAP_GetPtr( heap ))) return STATUS_INVALID_HANDLE;
+
+        switch (*(ULONG *)info)
+        {
+        case 0: return heapPtr->lfh ? STATUS_UNSUCCESSFUL : STATUS_SUCCESS;
+        case 2: return enable_lfh( heapPtr );
+        default: return STATUS_UNSUCCESSFUL;
+        }
+
+    default:
+        FIXME("%p %d %p %ld stub\n", heap, info_class, info, size);
+        return STATUS_SUCCESS;
+    }
 }
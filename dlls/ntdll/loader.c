@@ -124,6 +124,13 @@ typedef struct _wine_modref
 {
     LDR_DATA_TABLE_ENTRY  ldr;
     struct file_id        id;
+    LIST_ENTRY            base_hash_links;  /* entries in the module hash tables */
+    LIST_ENTRY            name_hash_links;
+    LIST_ENTRY            path_hash_links;
+    LIST_ENTRY            id_hash_links;
+    DWORD                *export_hash;      /* hash table of the export names, built on demand */
+    DWORD                 export_hash_size;
+    ULONG                 export_lookups;   /* number of lookups by export name */
     int                   alloc_deps;
     int                   nDeps;
     struct _wine_modref **deps;
@@ -178,6 +185,17 @@ static WINE_MODREF *cached_modref;
 static WINE_MODREF *current_modref;
 static WINE_MODREF *last_failed_modref;
 
+/* hash tables of the loaded modules, by base address, base name, full name and file id */
+#define MODULE_HASH_SIZE 64
+static LIST_ENTRY module_base_hash[MODULE_HASH_SIZE];
+static LIST_ENTRY module_name_hash[MODULE_HASH_SIZE];
+static LIST_ENTRY module_path_hash[MODULE_HASH_SIZE];
+static LIST_ENTRY module_id_hash[MODULE_HASH_SIZE];
+
+/* number of lookups by name after which the export names of a module get hashed */
+#define EXPORT_HASH_MIN_LOOKUPS 16
+#define EXPORT_HASH_MIN_NAMES   64
+
 static NTSTATUS load_dll( const WCHAR *load_path, const WCHAR *libname, const WCHAR *default_ext,
                           DWORD flags, WINE_MODREF** pwm );
 static NTSTATUS process_attach( WINE_MODREF *wm, LPVOID lpReserved );
@@ -477,6 +495,90 @@ static void call_ldr_notifications( ULONG reason, LDR_DATA_TABLE_ENTRY *module )
     }
 }
 
+/**********************************************************************
+ *	    get_module_hash_bucket
+ *
+ * Return the list of modules for a given hash value, initializing it if needed.
+ */
+static LIST_ENTRY *get_module_hash_bucket( LIST_ENTRY *table, ULONG hash )
+{
+    LIST_ENTRY *bucket = &table[hash % MODULE_HASH_SIZE];
+
+    if (!bucket->Flink) InitializeListHead( bucket );
+    return bucket;
+}
+
+
+/* only ASCII case is folded, so that the hash doesn't depend on the locale being initialized */
+static ULONG hash_module_name( const UNICODE_STRING *name )
+{
+    ULONG i, hash = 0;
+
+    for (i = 0; i < name->Length / sizeof(WCHAR); i++)
+    {
+        WCHAR ch = name->Buffer[i];
+        if (ch >= 'a' && ch <= 'z') ch -= 'a' - 'A';
+        else if (ch >= 0x80) ch = 0x80;
+        hash = hash * 65599 + ch;
+    }
+    return hash;
+}
+
+static ULONG hash_module_base( const void *base )
+{
+    return (ULONG_PTR)base >> 16;
+}
+
+static ULONG hash_file_id( const struct file_id *id )
+{
+    ULONG i, hash = 0;
+
+    for (i = 0; i < sizeof(id->ObjectId); i++) hash = hash * 65599 + id->ObjectId[i];
+    return hash;
+}
+
+
+static void insert_module_hash( LIST_ENTRY *bucket, LIST_ENTRY *entry, BOOL first )
+{
+    if (first) InsertHeadList( bucket, entry );
+    else InsertTailList( bucket, entry );
+}
+
+
+/**********************************************************************
+ *	    insert_module_hashes
+ *
+ * Add a module to the module hash tables.
+ * The loader_section must be locked while calling this function
+ */
+static void insert_module_hashes( WINE_MODREF *wm, BOOL first )
+{
+    insert_module_hash( get_module_hash_bucket( module_base_hash, hash_module_base( wm->ldr.DllBase )),
+                        &wm->base_hash_links, first );
+    insert_module_hash( get_module_hash_bucket( module_name_hash, hash_module_name( &wm->ldr.BaseDllName )),
+                        &wm->name_hash_links, first );
+    insert_module_hash( get_module_hash_bucket( module_path_hash, hash_module_name( &wm->ldr.FullDllName )),
+                        &wm->path_hash_links, first );
+    insert_module_hash( get_module_hash_bucket( module_id_hash, hash_file_id( &wm->id )),
+                        &wm->id_hash_links, first );
+}
+
+
+/**********************************************************************
+ *	    remove_module_hashes
+ *
+ * Remove a module from the module hash tables.
+ * The loader_section must be locked while calling this function
+ */
+static void remove_module_hashes( WINE_MODREF *wm )
+{
+    RemoveEntryList( &wm->base_hash_links );
+    RemoveEntryList( &wm->name_hash_links );
+    RemoveEntryList( &wm->path_hash_links );
+    RemoveEntryList( &wm->id_hash_links );
+}
+
+
 /*************************************************************************
  *		get_modref
  *
@@ -486,16 +588,15 @@ static void call_ldr_notifications( ULONG reason, LDR_DATA_TABLE_ENTRY *module )
 static WINE_MODREF *get_modref( HMODULE hmod )
 {
     PLIST_ENTRY mark, entry;
-    PLDR_DATA_TABLE_ENTRY mod;
+    WINE_MODREF *wm;
 
     if (cached_modref && cached_modref->ldr.DllBase == hmod) return cached_modref;
 
-    mark = &NtCurrentTeb()->Peb->LdrData->InMemoryOrderModuleList;
+    mark = get_module_hash_bucket( module_base_hash, hash_module_base( hmod ));
     for (entry = mark->Flink; entry != mark; entry = entry->Flink)
     {
-        mod = CONTAINING_RECORD(entry, LDR_DATA_TABLE_ENTRY, InMemoryOrderLinks);
-        if (mod->DllBase == hmod)
-            return cached_modref = CONTAINING_RECORD(mod, WINE_MODREF, ldr);
+        wm = CONTAINING_RECORD(entry, WINE_MODREF, base_hash_links);
+        if (wm->ldr.DllBase == hmod) return cached_modref = wm;
     }
     return NULL;
 }
@@ -517,13 +618,13 @@ static WINE_MODREF *find_basename_module( LPCWSTR name )
     if (cached_modref && RtlEqualUnicodeString( &name_str, &cached_modref->ldr.BaseDllName, TRUE ))
         return cached_modref;
 
-    mark = &NtCurrentTeb()->Peb->LdrData->InLoadOrderModuleList;
+    mark = get_module_hash_bucket( module_name_hash, hash_module_name( &name_str ));
     for (entry = mark->Flink; entry != mark; entry = entry->Flink)
     {
-        LDR_DATA_TABLE_ENTRY *mod = CONTAINING_RECORD(entry, LDR_DATA_TABLE_ENTRY, InLoadOrderLinks);
-        if (RtlEqualUnicodeString( &name_str, &mod->BaseDllName, TRUE ))
+        WINE_MODREF *wm = CONTAINING_RECORD(entry, WINE_MODREF, name_hash_links);
+        if (RtlEqualUnicodeString( &name_str, &wm->ldr.BaseDllName, TRUE ))
         {
-            cached_modref = CONTAINING_RECORD(mod, WINE_MODREF, ldr);
+            cached_modref = wm;
             return cached_modref;
         }
     }
@@ -549,13 +650,13 @@ static WINE_MODREF *find_fullname_module( const UNICODE_STRING *nt_name )
     if (cached_modref && RtlEqualUnicodeString( &name, &cached_modref->ldr.FullDllName, TRUE ))
         return cached_modref;
 
-    mark = &NtCurrentTeb()->Peb->LdrData->InLoadOrderModuleList;
+    mark = get_module_hash_bucket( module_path_hash, hash_module_name( &name ));
     for (entry = mark->Flink; entry != mark; entry = entry->Flink)
     {
-        LDR_DATA_TABLE_ENTRY *mod = CONTAINING_RECORD(entry, LDR_DATA_TABLE_ENTRY, InLoadOrderLinks);
-        if (RtlEqualUnicodeString( &name, &mod->FullDllName, TRUE ))
+        WINE_MODREF *wm = CONTAINING_RECORD(entry, WINE_MODREF, path_hash_links);
+        if (RtlEqualUnicodeString( &name, &wm->ldr.FullDllName, TRUE ))
         {
-            cached_modref = CONTAINING_RECORD(mod, WINE_MODREF, ldr);
+            cached_modref = wm;
             return cached_modref;
         }
     }
@@ -575,11 +676,10 @@ static WINE_MODREF *find_fileid_module( const struct file_id *id )
 
     if (cached_modref && !memcmp( &cached_modref->id, id, sizeof(*id) )) return cached_modref;
 
-    mark = &NtCurrentTeb()->Peb->LdrData->InLoadOrderModuleList;
+    mark = get_module_hash_bucket( module_id_hash, hash_file_id( id ));
     for (entry = mark->Flink; entry != mark; entry = entry->Flink)
     {
-        LDR_DATA_TABLE_ENTRY *mod = CONTAINING_RECORD( entry, LDR_DATA_TABLE_ENTRY, InLoadOrderLinks );
-        WINE_MODREF *wm = CONTAINING_RECORD( mod, WINE_MODREF, ldr );
+        WINE_MODREF *wm = CONTAINING_RECORD( entry, WINE_MODREF, id_hash_links );
 
         if (!memcmp( &wm->id, id, sizeof(*id) ))
         {
@@ -724,6 +824,40 @@ static FARPROC find_ordinal_export( HMODULE module, const IMAGE_EXPORT_DIRECTORY
 }
 
 
+static ULONG hash_export_name( const char *name )
+{
+    ULONG hash = 0;
+
+    while (*name) hash = hash * 65599 + (unsigned char)*name++;
+    return hash;
+}
+
+
+/*************************************************************************
+ *		build_export_hash
+ *
+ * Build an open addressing hash table of the indices in the export names array.
+ * The loader_section must be locked while calling this function.
+ */
+static void build_export_hash( WINE_MODREF *wm, const IMAGE_EXPORT_DIRECTORY *exports )
+{
+    const DWORD *names = get_rva( wm->ldr.DllBase, exports->AddressOfNames );
+    DWORD i, pos, size = 16;
+
+    while (size < 2 * exports->NumberOfNames) size *= 2;
+    if (!(wm->export_hash = RtlAllocateHeap( GetProcessHeap(), 0, size * sizeof(*wm->export_hash) ))) return;
+    memset( wm->export_hash, 0xff, size * sizeof(*wm->export_hash) );
+    wm->export_hash_size = size;
+
+    for (i = 0; i < exports->NumberOfNames; i++)
+    {
+        pos = hash_export_name( get_rva( wm->ldr.DllBase, names[i] )) & (size - 1);
+        while (wm->export_hash[pos] != ~0u) pos = (pos + 1) & (size - 1);
+        wm->export_hash[pos] = i;
+    }
+}
+
+
 /*************************************************************************
  *		find_named_export
  *
@@ -736,6 +870,7 @@ static FARPROC find_named_export( HMODULE module, const IMAGE_EXPORT_DIRECTORY *
     const WORD *ordinals = get_rva( module, exports->AddressOfNameOrdinals );
     const DWORD *names = get_rva( module, exports->AddressOfNames );
     int min = 0, max = exports->NumberOfNames - 1;
+    WINE_MODREF *wm;
 
     /* first check the hint */
     if (hint >= 0 && hint <= max)
@@ -745,6 +880,25 @@ static FARPROC find_named_export( HMODULE module, const IMAGE_EXPORT_DIRECTORY *
             return find_ordinal_export( module, exports, exp_size, ordinals[hint], load_path );
     }
 
+    /* then use the hash table, once the module is used often enough to be worth building it */
+    if (exports->NumberOfNames >= EXPORT_HASH_MIN_NAMES && (wm = get_modref( module )))
+    {
+        if (!wm->export_hash && ++wm->export_lookups >= EXPORT_HASH_MIN_LOOKUPS)
+            build_export_hash( wm, exports );
+        if (wm->export_hash)
+        {
+            DWORD mask = wm->export_hash_size - 1, pos = hash_export_name( name ) & mask;
+
+            for ( ; wm->export_hash[pos] != ~0u; pos = (pos + 1) & mask)
+            {
+                DWORD index = wm->export_hash[pos];
+                if (!strcmp( get_rva( module, names[index] ), name ))
+                    return find_ordinal_export( module, exports, exp_size, ordinals[index], load_path );
+            }
+            return NULL;
+        }
+    }
+
     /* then do a binary search */
     while (min <= max)
     {
@@ -1179,7 +1333,8 @@ static NTSTATUS fixup_imports( WINE_MODREF *wm, LPCWSTR load_path )
  * Allocate a WINE_MODREF structure and add it to the process list
  * The loader_section must be locked while calling this function.
  */
-static WINE_MODREF *alloc_module( HMODULE hModule, const UNICODE_STRING *nt_name, BOOL builtin )
+static WINE_MODREF *alloc_module( HMODULE hModule, const UNICODE_STRING *nt_name,
+                                  const struct file_id *id, BOOL builtin )
 {
     WCHAR *buffer;
     WINE_MODREF *wm;
@@ -1193,6 +1348,7 @@ static WINE_MODREF *alloc_module( HMODULE hModule, const UNICODE_STRING *nt_name
     wm->ldr.Flags         = LDR_DONT_RESOLVE_REFS | (builtin ? LDR_WINE_INTERNAL : 0);
     wm->ldr.TlsIndex      = -1;
     wm->ldr.LoadCount     = 1;
+    if (id) wm->id = *id;
 
     if (!(buffer = RtlAllocateHeap( GetProcessHeap(), 0, nt_name->Length - 3 * sizeof(WCHAR) )))
     {
@@ -1218,6 +1374,7 @@ static WINE_MODREF *alloc_module( HMODULE hModule, const UNICODE_STRING *nt_name
                    &wm->ldr.InLoadOrderLinks);
     InsertTailList(&NtCurrentTeb()->Peb->LdrData->InMemoryOrderModuleList,
                    &wm->ldr.InMemoryOrderLinks);
+    insert_module_hashes( wm, FALSE );
     /* wait until init is called for inserting into InInitializationOrderModuleList */
 
     if (!(nt->OptionalHeader.DllCharacteristics & IMAGE_DLLCHARACTERISTICS_NX_COMPAT))
@@ -1927,10 +2084,9 @@ static NTSTATUS build_module( LPCWSTR load_path, const UNICODE_STRING *nt_name,
 
     /* create the MODREF */
 
-    if (!(wm = alloc_module( *module, nt_name, (image_info->image_flags & IMAGE_FLAGS_WineBuiltin) )))
+    if (!(wm = alloc_module( *module, nt_name, id, (image_info->image_flags & IMAGE_FLAGS_WineBuiltin) )))
         return STATUS_NO_MEMORY;
 
-    if (id) wm->id = *id;
     if (image_info->loader_flags) wm->ldr.Flags |= LDR_COR_IMAGE;
     if (image_info->image_flags & IMAGE_FLAGS_ComPlusILOnly) wm->ldr.Flags |= LDR_COR_ILONLY;
 
@@ -1969,6 +2125,7 @@ static NTSTATUS build_module( LPCWSTR load_path, const UNICODE_STRING *nt_name,
             /* the module has only be inserted in the load & memory order lists */
             RemoveEntryList(&wm->ldr.InLoadOrderLinks);
             RemoveEntryList(&wm->ldr.InMemoryOrderLinks);
+            remove_module_hashes( wm );
 
             /* FIXME: there are several more dangling references
              * left. Including dlls loaded by this dll before the
@@ -3502,6 +3659,7 @@ static void free_modref( WINE_MODREF *wm )
     RemoveEntryList(&wm->ldr.InMemoryOrderLinks);
     if (wm->ldr.InInitializationOrderLinks.Flink)
         RemoveEntryList(&wm->ldr.InInitializationOrderLinks);
+    remove_module_hashes( wm );
 
     TRACE(" unloading %s\n", debugstr_w(wm->ldr.FullDllName.Buffer));
     if (!TRACE_ON(module))
@@ -3522,6 +3680,7 @@ static void free_modref( WINE_MODREF *wm )
     NtUnmapViewOfSection( NtCurrentProcess(), wm->ldr.DllBase );
     if (cached_modref == wm) cached_modref = NULL;
     RtlFreeUnicodeString( &wm->ldr.FullDllName );
+    RtlFreeHeap( GetProcessHeap(), 0, wm->export_hash );
     RtlFreeHeap( GetProcessHeap(), 0, wm->deps );
     RtlFreeHeap( GetProcessHeap(), 0, wm );
 }
@@ -4318,6 +4477,8 @@ void __wine_process_init(void)
     InsertHeadList( &peb->LdrData->InLoadOrderModuleList, &wm->ldr.InLoadOrderLinks );
     RemoveEntryList( &wm->ldr.InMemoryOrderLinks );
     InsertHeadList( &peb->LdrData->InMemoryOrderModuleList, &wm->ldr.InMemoryOrderLinks );
+    remove_module_hashes( wm );
+    insert_module_hashes( wm, TRUE );
 
     unix_funcs->virtual_alloc_thread_stack( &stack, 0, 0, NULL );
     teb->Tib.StackBase = stack.StackBase;
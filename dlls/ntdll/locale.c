@@ -201,6 +201,35 @@ static void put_utf16( WCHAR *dst, unsigned int ch )
     else dst[0] = ch;
 }
 
+/* length of the leading run of 7-bit ASCII chars, checked a 64-bit word at a time;
+ * the chars past the last full ASCII word are left to the caller */
+static inline unsigned int get_ascii_run( const char *src, unsigned int len )
+{
+    unsigned int pos;
+    UINT64 val;
+
+    for (pos = 0; pos + sizeof(val) <= len; pos += sizeof(val))
+    {
+        memcpy( &val, src + pos, sizeof(val) );
+        if (val & 0x8080808080808080) break;
+    }
+    return pos;
+}
+
+/* same as get_ascii_run() for a WCHAR string */
+static inline unsigned int get_wide_ascii_run( const WCHAR *src, unsigned int len )
+{
+    unsigned int pos;
+    UINT64 val;
+
+    for (pos = 0; pos + sizeof(val) / sizeof(WCHAR) <= len; pos += sizeof(val) / sizeof(WCHAR))
+    {
+        memcpy( &val, src + pos, sizeof(val) );
+        if (val & 0xff80ff80ff80ff80) break;
+    }
+    return pos;
+}
+
 
 static NTSTATUS load_norm_table( ULONG form, const struct norm_table **info )
 {
@@ -1656,7 +1685,7 @@ static unsigned int decode_utf8_char( unsigned char ch, const char **str, const
  */
 NTSTATUS WINAPI RtlUTF8ToUnicodeN( WCHAR *dst, DWORD dstlen, DWORD *reslen, const char *src, DWORD srclen )
 {
-    unsigned int res, len;
+    unsigned int res, len, run, i;
     NTSTATUS status = STATUS_SUCCESS;
     const char *srcend = src + srclen;
     WCHAR *dstend;
@@ -1671,7 +1700,13 @@ NTSTATUS WINAPI RtlUTF8ToUnicodeN( WCHAR *dst, DWORD dstlen, DWORD *reslen, cons
         for (len = 0; src < srcend; len++)
         {
             unsigned char ch = *src++;
-            if (ch < 0x80) continue;
+            if (ch < 0x80)
+            {
+                run = get_ascii_run( src, srcend - src );
+                src += run;
+                len += run;
+                continue;
+            }
             if ((res = decode_utf8_char( ch, &src, srcend )) > 0x10ffff)
                 status = STATUS_SOME_NOT_MAPPED;
             else
@@ -1687,6 +1722,10 @@ NTSTATUS WINAPI RtlUTF8ToUnicodeN( WCHAR *dst, DWORD dstlen, DWORD *reslen, cons
         if (ch < 0x80)  /* special fast case for 7-bit ASCII */
         {
             *dst++ = ch;
+            run = get_ascii_run( src, min( srcend - src, dstend - dst ));
+            for (i = 0; i < run; i++) dst[i] = (unsigned char)src[i];
+            src += run;
+            dst += run;
             continue;
         }
         if ((res = decode_utf8_char( ch, &src, srcend )) <= 0xffff)
@@ -1718,7 +1757,7 @@ NTSTATUS WINAPI RtlUTF8ToUnicodeN( WCHAR *dst, DWORD dstlen, DWORD *reslen, cons
 NTSTATUS WINAPI RtlUnicodeToUTF8N( char *dst, DWORD dstlen, DWORD *reslen, const WCHAR *src, DWORD srclen )
 {
     char *end;
-    unsigned int val, len;
+    unsigned int val, len, run, i;
     NTSTATUS status = STATUS_SUCCESS;
 
     if (!src) return STATUS_INVALID_PARAMETER_4;
@@ -1731,7 +1770,13 @@ NTSTATUS WINAPI RtlUnicodeToUTF8N( char *dst, DWORD dstlen, DWORD *reslen, const
     {
         for (len = 0; srclen; srclen--, src++)
         {
-            if (*src < 0x80) len++;  /* 0x00-0x7f: 1 byte */
+            if (*src < 0x80)  /* 0x00-0x7f: 1 byte */
+            {
+                run = get_wide_ascii_run( src + 1, srclen - 1 );
+                len += run + 1;
+                src += run;
+                srclen -= run;
+            }
             else if (*src < 0x800) len += 2;  /* 0x80-0x7ff: 2 bytes */
             else
             {
@@ -1761,6 +1806,11 @@ NTSTATUS WINAPI RtlUnicodeToUTF8N( char *dst, DWORD dstlen, DWORD *reslen, const
         {
             if (dst > end - 1) break;
             *dst++ = ch;
+            run = get_wide_ascii_run( src + 1, min( srclen - 1, end - dst ));
+            for (i = 0; i < run; i++) dst[i] = src[i + 1];
+            dst += run;
+            src += run;
+            srclen -= run;
             continue;
         }
         if (ch < 0x800)  /* 0x80-0x7ff: 2 bytes */
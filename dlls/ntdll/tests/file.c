@@ -939,9 +939,9 @@ static void WINAPI user_apc_proc(ULONG_PTR arg)
 
 static void test_set_io_completion(void)
 {
-    FILE_IO_COMPLETION_INFORMATION info[2] = {{0}};
+    FILE_IO_COMPLETION_INFORMATION info[2] = {{0}}, batch_info[80];
     LARGE_INTEGER timeout = {{0}};
-    unsigned int apc_count;
+    unsigned int apc_count, i;
     IO_STATUS_BLOCK iosb;
     ULONG_PTR key, value;
     NTSTATUS res;
@@ -1020,6 +1020,32 @@ static void test_set_io_completion(void)
         info[1].IoStatusBlock.Information );
     ok( U(info[1].IoStatusBlock).Status == 56, "wrong status %#x\n", U(info[1].IoStatusBlock).Status);
 
+    for (i = 0; i < 100; i++)
+    {
+        res = pNtSetIoCompletion( h, i, 1000 + i, 789, size );
+        ok( res == STATUS_SUCCESS, "NtSetIoCompletion failed: %#x\n", res );
+    }
+
+    count = 0xdeadbeef;
+    res = pNtRemoveIoCompletionEx( h, batch_info, ARRAY_SIZE(batch_info), &count, &timeout, FALSE );
+    ok( res == STATUS_SUCCESS, "NtRemoveIoCompletionEx failed: %#x\n", res );
+    ok( count == 80, "wrong count %u\n", count );
+    for (i = 0; i < count; i++)
+    {
+        ok( batch_info[i].CompletionKey == i, "%u: wrong key %#lx\n", i, batch_info[i].CompletionKey );
+        ok( batch_info[i].CompletionValue == 1000 + i, "%u: wrong value %#lx\n", i, batch_info[i].CompletionValue );
+    }
+
+    count = 0xdeadbeef;
+    res = pNtRemoveIoCompletionEx( h, batch_info, ARRAY_SIZE(batch_info), &count, &timeout, FALSE );
+    ok( res == STATUS_SUCCESS, "NtRemoveIoCompletionEx failed: %#x\n", res );
+    ok( count == 20, "wrong count %u\n", count );
+    for (i = 0; i < count; i++)
+        ok( batch_info[i].CompletionKey == 80 + i, "%u: wrong key %#lx\n", i, batch_info[i].CompletionKey );
+
+    count = get_pending_msgs(h);
+    ok( !count, "Unexpected msg count: %d\n", count );
+
     res = pNtSetIoCompletion( h, 123, 456, 789, size );
     ok( res == STATUS_SUCCESS, "NtSetIoCompletion failed: %#x\n", res );
 
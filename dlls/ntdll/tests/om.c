@@ -2007,6 +2007,53 @@ static void test_wait_on_address(void)
     ok(address == 0, "got %s\n", wine_dbgstr_longlong(address));
 }
 
+static void test_handle_table(void)
+{
+    static const unsigned int count = 3000;
+    EVENT_BASIC_INFORMATION info;
+    HANDLE *handles;
+    NTSTATUS status;
+    unsigned int i, j;
+
+    handles = HeapAlloc( GetProcessHeap(), 0, count * sizeof(*handles) );
+
+    for (i = 0; i < count; i++)
+    {
+        status = pNtCreateEvent( &handles[i], GENERIC_ALL, NULL, 1, 0 );
+        ok( !status, "%u: NtCreateEvent failed %08x\n", i, status );
+    }
+
+    /* punch holes in the table and close the tail */
+    for (i = 0; i < count; i += 2) pNtClose( handles[i] );
+    for (i = count / 2 + 1; i < count; i += 2) pNtClose( handles[i] );
+
+    for (i = 0; i < count; i += 2)
+    {
+        status = pNtQueryEvent( handles[i], EventBasicInformation, &info, sizeof(info), NULL );
+        ok( status == STATUS_INVALID_HANDLE, "%u: NtQueryEvent returned %08x\n", i, status );
+    }
+
+    /* refill the holes, the remaining handles must stay valid */
+    for (i = 0; i < count; i += 2)
+    {
+        status = pNtCreateEvent( &handles[i], GENERIC_ALL, NULL, 1, 0 );
+        ok( !status, "%u: NtCreateEvent failed %08x\n", i, status );
+    }
+    for (i = 1; i < count / 2; i += 2)
+    {
+        status = pNtQueryEvent( handles[i], EventBasicInformation, &info, sizeof(info), NULL );
+        ok( !status, "%u: NtQueryEvent failed %08x\n", i, status );
+    }
+
+    for (i = 0; i < count; i += 2)
+        for (j = 1; j < count / 2; j += 2)
+            if (handles[i] == handles[j]) ok( 0, "handle %p allocated twice\n", handles[i] );
+
+    for (i = 0; i < count; i += 2) pNtClose( handles[i] );
+    for (i = 1; i < count / 2; i += 2) pNtClose( handles[i] );
+    HeapFree( GetProcessHeap(), 0, handles );
+}
+
 START_TEST(om)
 {
     HMODULE hntdll = GetModuleHandleA("ntdll.dll");
@@ -2069,4 +2116,5 @@ START_TEST(om)
     test_keyed_events();
     test_null_device();
     test_wait_on_address();
+    test_handle_table();
 }
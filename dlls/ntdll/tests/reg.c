@@ -133,6 +133,7 @@ static NTSTATUS (WINAPI * pNtCreateKey)( PHANDLE retkey, ACCESS_MASK access, con
 static NTSTATUS (WINAPI * pNtQueryKey)(HANDLE,KEY_INFORMATION_CLASS,PVOID,ULONG,PULONG);
 static NTSTATUS (WINAPI * pNtQueryLicenseValue)(const UNICODE_STRING *,ULONG *,PVOID,ULONG,ULONG *);
 static NTSTATUS (WINAPI * pNtQueryValueKey)(HANDLE,const UNICODE_STRING *,KEY_VALUE_INFORMATION_CLASS,void *,DWORD,DWORD *);
+static NTSTATUS (WINAPI * pNtQueryMultipleValueKey)(HANDLE,KEY_MULTIPLE_VALUE_INFORMATION *,ULONG,void *,ULONG,ULONG *);
 static NTSTATUS (WINAPI * pNtSetValueKey)(HANDLE, const PUNICODE_STRING, ULONG,
                                ULONG, const void*, ULONG  );
 static NTSTATUS (WINAPI * pNtQueryInformationProcess)(HANDLE,PROCESSINFOCLASS,PVOID,ULONG,PULONG);
@@ -206,6 +207,7 @@ static BOOL InitFunctionPtrs(void)
     pNtQueryLicenseValue = (void *)GetProcAddress(hntdll, "NtQueryLicenseValue");
     pNtOpenKeyEx = (void *)GetProcAddress(hntdll, "NtOpenKeyEx");
     pNtNotifyChangeMultipleKeys = (void *)GetProcAddress(hntdll, "NtNotifyChangeMultipleKeys");
+    pNtQueryMultipleValueKey = (void *)GetProcAddress(hntdll, "NtQueryMultipleValueKey");
 
     return TRUE;
 }
@@ -841,6 +843,109 @@ static void test_NtQueryValueKey(void)
     pNtClose(key);
 }
 
+static void test_NtQueryMultipleValueKey(void)
+{
+    static const WCHAR stringW[] = {'w','i','n','e',0};
+    static const WCHAR name_dwordW[] = {'m','u','l','t','i','_','d','w','o','r','d',0};
+    static const WCHAR name_stringW[] = {'m','u','l','t','i','_','s','t','r','i','n','g',0};
+    static const WCHAR name_missingW[] = {'m','u','l','t','i','_','m','i','s','s','i','n','g',0};
+    static const WCHAR name_bigW[] = {'m','u','l','t','i','_','b','i','g','_','%','u',0};
+    KEY_MULTIPLE_VALUE_INFORMATION info[40];
+    UNICODE_STRING names[40], missing;
+    WCHAR big_names[40][16];
+    DWORD dword = 0x12345678, len, i, j;
+    OBJECT_ATTRIBUTES attr;
+    NTSTATUS status;
+    BYTE *buffer, *data;
+    HANDLE key;
+
+    if (!pNtQueryMultipleValueKey)
+    {
+        win_skip("NtQueryMultipleValueKey is not available.\n");
+        return;
+    }
+
+    InitializeObjectAttributes(&attr, &winetestpath, 0, 0, 0);
+    status = pNtOpenKey(&key, KEY_READ|KEY_SET_VALUE, &attr);
+    ok(status == STATUS_SUCCESS, "NtOpenKey failed: 0x%08x\n", status);
+
+    pRtlInitUnicodeString(&names[0], name_dwordW);
+    status = pNtSetValueKey(key, &names[0], 0, REG_DWORD, &dword, sizeof(dword));
+    ok(status == STATUS_SUCCESS, "NtSetValueKey failed: 0x%08x\n", status);
+    pRtlInitUnicodeString(&names[1], name_stringW);
+    status = pNtSetValueKey(key, &names[1], 0, REG_SZ, stringW, sizeof(stringW));
+    ok(status == STATUS_SUCCESS, "NtSetValueKey failed: 0x%08x\n", status);
+    pRtlInitUnicodeString(&missing, name_missingW);
+
+    buffer = HeapAlloc(GetProcessHeap(), 0, 0x40000);
+
+    memset(info, 0xcc, sizeof(info));
+    info[0].ValueName = &names[0];
+    info[1].ValueName = &names[1];
+    len = 0xdeadbeef;
+    status = pNtQueryMultipleValueKey(key, info, 2, buffer, 0x40000, &len);
+    ok(status == STATUS_SUCCESS, "Got unexpected status 0x%08x.\n", status);
+    ok(len >= sizeof(dword) + sizeof(stringW), "Got unexpected length %u.\n", len);
+    ok(info[0].Type == REG_DWORD, "Got unexpected type %u.\n", info[0].Type);
+    ok(info[0].DataLength == sizeof(dword), "Got unexpected length %u.\n", info[0].DataLength);
+    ok(info[0].DataOffset + info[0].DataLength <= len, "Got unexpected offset %u.\n", info[0].DataOffset);
+    ok(*(DWORD *)(buffer + info[0].DataOffset) == dword, "Got unexpected data %#x.\n",
+            *(DWORD *)(buffer + info[0].DataOffset));
+    ok(info[1].Type == REG_SZ, "Got unexpected type %u.\n", info[1].Type);
+    ok(info[1].DataLength == sizeof(stringW), "Got unexpected length %u.\n", info[1].DataLength);
+    ok(info[1].DataOffset + info[1].DataLength <= len, "Got unexpected offset %u.\n", info[1].DataOffset);
+    ok(!memcmp(buffer + info[1].DataOffset, stringW, sizeof(stringW)), "Got unexpected data.\n");
+
+    /* Buffer too small. */
+    len = 0xdeadbeef;
+    status = pNtQueryMultipleValueKey(key, info, 2, buffer, sizeof(dword), &len);
+    ok(status == STATUS_BUFFER_OVERFLOW, "Got unexpected status 0x%08x.\n", status);
+    ok(len >= sizeof(dword) + sizeof(stringW), "Got unexpected length %u.\n", len);
+
+    /* A missing value fails the whole query. */
+    info[0].ValueName = &names[0];
+    info[1].ValueName = &missing;
+    info[2].ValueName = &names[1];
+    status = pNtQueryMultipleValueKey(key, info, 3, buffer, 0x40000, &len);
+    ok(status == STATUS_OBJECT_NAME_NOT_FOUND, "Got unexpected status 0x%08x.\n", status);
+
+    /* More data than fits in a single server reply. */
+    data = HeapAlloc(GetProcessHeap(), 0, 4000);
+    for (i = 0; i < ARRAY_SIZE(info); ++i)
+    {
+        swprintf(big_names[i], ARRAY_SIZE(big_names[i]), name_bigW, i);
+        pRtlInitUnicodeString(&names[i], big_names[i]);
+        memset(data, i, 4000);
+        status = pNtSetValueKey(key, &names[i], 0, REG_BINARY, data, 4000);
+        ok(status == STATUS_SUCCESS, "NtSetValueKey failed: 0x%08x\n", status);
+        info[i].ValueName = &names[i];
+    }
+    len = 0xdeadbeef;
+    status = pNtQueryMultipleValueKey(key, info, ARRAY_SIZE(info), buffer, 0x40000, &len);
+    ok(status == STATUS_SUCCESS, "Got unexpected status 0x%08x.\n", status);
+    ok(len >= ARRAY_SIZE(info) * 4000, "Got unexpected length %u.\n", len);
+    for (i = 0; i < ARRAY_SIZE(info); ++i)
+    {
+        ok(info[i].Type == REG_BINARY, "Value %u: got unexpected type %u.\n", i, info[i].Type);
+        ok(info[i].DataLength == 4000, "Value %u: got unexpected length %u.\n", i, info[i].DataLength);
+        for (j = 0; j < 4000; ++j)
+        {
+            if (buffer[info[i].DataOffset + j] != i)
+                break;
+        }
+        ok(j == 4000, "Value %u: got unexpected data at %u.\n", i, j);
+        pNtDeleteValueKey(key, &names[i]);
+    }
+    HeapFree(GetProcessHeap(), 0, data);
+    HeapFree(GetProcessHeap(), 0, buffer);
+
+    pRtlInitUnicodeString(&names[0], name_dwordW);
+    pNtDeleteValueKey(key, &names[0]);
+    pRtlInitUnicodeString(&names[1], name_stringW);
+    pNtDeleteValueKey(key, &names[1]);
+    pNtClose(key);
+}
+
 static void test_NtDeleteKey(void)
 {
     NTSTATUS status;
@@ -2040,6 +2145,7 @@ START_TEST(reg)
     test_NtQueryKey();
     test_NtQueryLicenseKey();
     test_NtQueryValueKey();
+    test_NtQueryMultipleValueKey();
     test_long_value_name();
     test_notify();
     test_RtlCreateRegistryKey();
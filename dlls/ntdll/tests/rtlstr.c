@@ -2428,6 +2428,89 @@ static void unicode_expect_(const WCHAR *out_string, ULONG buflen, ULONG out_cha
 #define unicode_expect(out_string, buflen, out_chars, in_string, in_chars, expect_status) \
         unicode_expect_(out_string, buflen, out_chars, in_string, in_chars, expect_status, __LINE__)
 
+static void test_utf8_ascii_runs(void)
+{
+    static const struct
+    {
+        const char *utf8;
+        WCHAR wide[3];
+    }
+    pieces[] =
+    {
+        { "\xc3\xa9", { 0x00e9 } },
+        { "\xe2\x82\xac", { 0x20ac } },
+        { "\xf0\x9d\x84\x9e", { 0xd834, 0xdd1e } },
+        { "\xff", { 0xfffd } },
+        { "\xc3", { 0xfffd } },
+    };
+    static char src[65536], back[65536 * 3];
+    static WCHAR expect[65536], dst[65536];
+    unsigned int i, j, k, srclen = 0, len = 0, invalid = 0, run;
+    NTSTATUS status;
+    ULONG reslen;
+
+    if (!pRtlUTF8ToUnicodeN || !pRtlUnicodeToUTF8N)
+    {
+        win_skip( "RtlUTF8ToUnicodeN is not available\n" );
+        return;
+    }
+
+    /* ASCII runs of all lengths around the word size, at all alignments */
+    for (i = 0; srclen < sizeof(src) - 64; i++)
+    {
+        run = i % 37;
+        for (j = 0; j < run; j++)
+        {
+            src[srclen++] = 'a' + (i + j) % 26;
+            expect[len++] = 'a' + (i + j) % 26;
+        }
+        k = i % ARRAY_SIZE(pieces);
+        /* a truncated sequence must not be followed by a continuation byte */
+        if (k == 4 && i % 7) continue;
+        if (k >= 3) invalid++;
+        for (j = 0; pieces[k].utf8[j]; j++) src[srclen++] = pieces[k].utf8[j];
+        for (j = 0; j < ARRAY_SIZE(pieces[k].wide) && pieces[k].wide[j]; j++) expect[len++] = pieces[k].wide[j];
+    }
+    ok( invalid, "no invalid sequences\n" );
+
+    status = pRtlUTF8ToUnicodeN( NULL, 0, &reslen, src, srclen );
+    ok( status == STATUS_SOME_NOT_MAPPED, "got status %#x\n", status );
+    ok( reslen == len * sizeof(WCHAR), "got len %u, expected %u\n", reslen, len );
+
+    status = pRtlUTF8ToUnicodeN( dst, sizeof(dst), &reslen, src, srclen );
+    ok( status == STATUS_SOME_NOT_MAPPED, "got status %#x\n", status );
+    ok( reslen == len * sizeof(WCHAR), "got len %u, expected %u\n", reslen, len );
+    ok( !memcmp( dst, expect, len * sizeof(WCHAR) ), "wrong conversion\n" );
+
+    /* truncated output stops at the same char as the byte at a time conversion */
+    for (i = 0; i < 300; i++)
+    {
+        status = pRtlUTF8ToUnicodeN( dst, i * sizeof(WCHAR), &reslen, src, srclen );
+        ok( status == STATUS_BUFFER_TOO_SMALL, "%u: got status %#x\n", i, status );
+        ok( reslen == i * sizeof(WCHAR), "%u: got len %u\n", i, reslen );
+        ok( !memcmp( dst, expect, reslen ), "%u: wrong conversion\n", i );
+    }
+
+    /* and back, without the replacement chars */
+    for (i = j = 0; i < len; i++) if (expect[i] != 0xfffd) expect[j++] = expect[i];
+    len = j;
+    status = pRtlUnicodeToUTF8N( NULL, 0, &reslen, expect, len * sizeof(WCHAR) );
+    ok( status == STATUS_SUCCESS, "got status %#x\n", status );
+    status = pRtlUnicodeToUTF8N( back, sizeof(back), &reslen, expect, len * sizeof(WCHAR) );
+    ok( status == STATUS_SUCCESS, "got status %#x\n", status );
+    status = pRtlUTF8ToUnicodeN( dst, sizeof(dst), &reslen, back, reslen );
+    ok( status == STATUS_SUCCESS, "got status %#x\n", status );
+    ok( reslen == len * sizeof(WCHAR), "got len %u, expected %u\n", reslen, len );
+    ok( !memcmp( dst, expect, len * sizeof(WCHAR) ), "wrong round trip conversion\n" );
+
+    for (i = 0; i < 300; i++)
+    {
+        status = pRtlUnicodeToUTF8N( back, i, &reslen, expect, len * sizeof(WCHAR) );
+        ok( status == STATUS_BUFFER_TOO_SMALL, "%u: got status %#x\n", i, status );
+        ok( reslen <= i && reslen + 4 > i, "%u: got len %u\n", i, reslen );
+    }
+}
+
 static void test_RtlUTF8ToUnicodeN(void)
 {
     NTSTATUS status;
@@ -2923,5 +3006,6 @@ START_TEST(rtlstr)
     test_RtlHashUnicodeString();
     test_RtlUnicodeToUTF8N();
     test_RtlUTF8ToUnicodeN();
+    test_utf8_ascii_runs();
     test_RtlFormatMessage();
 }
@@ -732,6 +732,79 @@ static void test_tp_work_scheduler(void)
     pTpReleasePool(pool);
 }
 
+static void CALLBACK work_count_cb(TP_CALLBACK_INSTANCE *instance, void *userdata, TP_WORK *work)
+{
+    InterlockedIncrement((LONG *)userdata);
+}
+
+struct post_work_info
+{
+    TP_WORK *work[2];
+    HANDLE start_event;
+};
+
+static DWORD WINAPI post_work_thread(void *param)
+{
+    struct post_work_info *info = param;
+    int i;
+
+    WaitForSingleObject(info->start_event, INFINITE);
+    for (i = 0; i < 1000; i++)
+        pTpPostWork(info->work[i & 1]);
+    return 0;
+}
+
+static void test_tp_work_concurrent_post(void)
+{
+    TP_CALLBACK_ENVIRON environment;
+    struct post_work_info info;
+    HANDLE threads[4];
+    TP_POOL *pool;
+    NTSTATUS status;
+    LONG userdata[2];
+    int i;
+
+    pool = NULL;
+    status = pTpAllocPool(&pool, NULL);
+    ok(!status, "TpAllocPool failed with status %x\n", status);
+    ok(pool != NULL, "expected pool != NULL\n");
+
+    memset(&environment, 0, sizeof(environment));
+    environment.Version = 1;
+    environment.Pool = pool;
+    for (i = 0; i < 2; i++)
+    {
+        info.work[i] = NULL;
+        status = pTpAllocWork(&info.work[i], work_count_cb, &userdata[i], &environment);
+        ok(!status, "TpAllocWork failed with status %x\n", status);
+        ok(info.work[i] != NULL, "expected work != NULL\n");
+        userdata[i] = 0;
+    }
+
+    /* post work items from several threads at once, no callback may get lost */
+    info.start_event = CreateEventW(NULL, TRUE, FALSE, NULL);
+    for (i = 0; i < ARRAY_SIZE(threads); i++)
+    {
+        threads[i] = CreateThread(NULL, 0, post_work_thread, &info, 0, NULL);
+        ok(threads[i] != NULL, "CreateThread failed with error %u\n", GetLastError());
+    }
+    SetEvent(info.start_event);
+    for (i = 0; i < ARRAY_SIZE(threads); i++)
+    {
+        WaitForSingleObject(threads[i], INFINITE);
+        CloseHandle(threads[i]);
+    }
+    for (i = 0; i < 2; i++)
+        pTpWaitForWork(info.work[i], FALSE);
+    ok(userdata[0] == 2000, "expected userdata[0] = 2000, got %u\n", userdata[0]);
+    ok(userdata[1] == 2000, "expected userdata[1] = 2000, got %u\n", userdata[1]);
+
+    for (i = 0; i < 2; i++)
+        pTpReleaseWork(info.work[i]);
+    CloseHandle(info.start_event);
+    pTpReleasePool(pool);
+}
+
 static void CALLBACK simple_release_cb(TP_CALLBACK_INSTANCE *instance, void *userdata)
 {
     HANDLE *semaphores = userdata;
@@ -2244,6 +2317,7 @@ START_TEST(threadpool)
     test_tp_simple();
     test_tp_work();
     test_tp_work_scheduler();
+    test_tp_work_concurrent_post();
     test_tp_group_wait();
     test_tp_group_cancel();
     test_tp_instance();
@@ -34,6 +34,7 @@
 #include "ntdll_misc.h"
 
 WINE_DEFAULT_DEBUG_CHANNEL(threadpool);
+WINE_DECLARE_DEBUG_CHANNEL(tpstats);
 
 /*
  * Old thread pooling API
@@ -122,6 +123,7 @@ struct timer_queue
  */
 
 #define THREADPOOL_WORKER_TIMEOUT 5000
+#define THREADPOOL_INJECTION_LATENCY 50
 #define MAXIMUM_WAITQUEUE_OBJECTS (MAXIMUM_WAIT_OBJECTS - 1)
 
 /* internal threadpool representation */
@@ -139,8 +141,20 @@ struct threadpool
     int                     min_workers;
     int                     num_workers;
     int                     num_busy_workers;
+    DWORD                   last_injection;
     HANDLE                  compl_port;
     TP_POOL_STACK_INFORMATION stack_info;
+    /* work items posted without holding .cs, see tp_object_post */
+    struct threadpool_object * volatile posted;
+    /* statistics, dumped on the tpstats debug channel */
+    struct
+    {
+        LONG                queued;
+        LONG                posted_lockfree;
+        LONG                started;
+        LONG                injected;
+        DWORD               max_latency;
+    } stats;
 };
 
 enum threadpool_objtype
@@ -179,6 +193,7 @@ struct threadpool_object
     BOOL                    is_group_member;
     /* information about the pool, locked via .pool->cs */
     struct list             pool_entry;
+    DWORD                   queued_time;
     RTL_CONDITION_VARIABLE  finished_event;
     RTL_CONDITION_VARIABLE  group_finished_event;
     LONG                    num_pending_callbacks;
@@ -194,6 +209,9 @@ struct threadpool_object
         struct
         {
             PTP_WORK_CALLBACK callback;
+            /* number of lock-free posts not yet moved to the pool */
+            LONG            posted;
+            struct threadpool_object *next_posted;
         } work;
         struct
         {
@@ -1396,11 +1414,24 @@ static NTSTATUS tp_new_worker_thread( struct threadpool *pool )
     {
         InterlockedIncrement( &pool->refcount );
         pool->num_workers++;
+        pool->stats.started++;
         NtClose( thread );
     }
     return status;
 }
 
+/***********************************************************************
+ *           tp_threadpool_dump_stats    (internal)
+ */
+static void tp_threadpool_dump_stats( struct threadpool *pool )
+{
+    TRACE_(tpstats)( "pool %p: %d workers (%d busy), %d callbacks queued (%d lock-free), "
+                     "%d threads started (%d for latency), max queue latency %u ms\n",
+                     pool, pool->num_workers, pool->num_busy_workers, pool->stats.queued,
+                     pool->stats.posted_lockfree, pool->stats.started, pool->stats.injected,
+                     pool->stats.max_latency );
+}
+
 /***********************************************************************
  *           tp_timerqueue_lock    (internal)
  *
@@ -1875,6 +1906,9 @@ static NTSTATUS tp_threadpool_alloc( struct threadpool **out )
     pool->min_workers             = 0;
     pool->num_workers             = 0;
     pool->num_busy_workers        = 0;
+    pool->last_injection          = 0;
+    pool->posted                  = NULL;
+    memset( &pool->stats, 0, sizeof(pool->stats) );
     pool->stack_info.StackReserve = nt->OptionalHeader.SizeOfStackReserve;
     pool->stack_info.StackCommit  = nt->OptionalHeader.SizeOfStackCommit;
 
@@ -1912,9 +1946,11 @@ static BOOL tp_threadpool_release( struct threadpool *pool )
         return FALSE;
 
     TRACE( "destroying threadpool %p\n", pool );
+    tp_threadpool_dump_stats( pool );
 
     assert( pool->shutdown );
     assert( !pool->objcount );
+    assert( !pool->posted );
     for (i = 0; i < ARRAY_SIZE(pool->pools); ++i)
         assert( list_empty( &pool->pools[i] ) );
 
@@ -2157,10 +2193,77 @@ static void tp_object_initialize( struct threadpool_object *object, struct threa
 
 static void tp_object_prio_queue( struct threadpool_object *object )
 {
-    ++object->pool->num_busy_workers;
+    object->queued_time = NtGetTickCount();
     list_add_tail( &object->pool->pools[object->priority], &object->pool_entry );
 }
 
+/***********************************************************************
+ *           tp_threadpool_wake_worker    (internal)
+ *
+ * Makes sure that a worker thread picks up a newly queued callback. An
+ * idle worker is woken up; a new one is only started when all workers
+ * are busy running callbacks. Has to be called with pool->cs held.
+ */
+static void tp_threadpool_wake_worker( struct threadpool *pool )
+{
+    if (pool->num_busy_workers >= pool->num_workers &&
+        pool->num_workers < pool->max_workers &&
+        tp_new_worker_thread( pool ) == STATUS_SUCCESS)
+        return;
+
+    assert( pool->num_workers > 0 );
+    RtlWakeConditionVariable( &pool->update_event );
+}
+
+/***********************************************************************
+ *           tp_object_queue    (internal)
+ *
+ * Queues callbacks of an object which already hold a reference each.
+ * Has to be called with pool->cs held.
+ */
+static void tp_object_queue( struct threadpool_object *object, LONG count )
+{
+    struct threadpool *pool = object->pool;
+
+    if (!object->num_pending_callbacks)
+        tp_object_prio_queue( object );
+    object->num_pending_callbacks += count;
+    pool->stats.queued += count;
+
+    while (count--)
+        tp_threadpool_wake_worker( pool );
+}
+
+/***********************************************************************
+ *           tp_threadpool_flush_posted    (internal)
+ *
+ * Moves work items posted by tp_object_post to the pool lists. Has to
+ * be called with pool->cs held.
+ */
+static void tp_threadpool_flush_posted( struct threadpool *pool )
+{
+    struct threadpool_object *object, *next, *list = NULL;
+
+    if (!pool->posted) return;
+
+    /* Reverse the list to preserve the submission order. */
+    object = InterlockedExchangePointer( (void **)&pool->posted, NULL );
+    while (object)
+    {
+        next = object->u.work.next_posted;
+        object->u.work.next_posted = list;
+        list = object;
+        object = next;
+    }
+
+    for (object = list; object; object = next)
+    {
+        /* The object may be posted again as soon as its counter is reset. */
+        next = object->u.work.next_posted;
+        tp_object_queue( object, InterlockedExchange( &object->u.work.posted, 0 ) );
+    }
+}
+
 /***********************************************************************
  *           tp_object_submit    (internal)
  *
@@ -2170,34 +2273,63 @@ static void tp_object_prio_queue( struct threadpool_object *object )
 static void tp_object_submit( struct threadpool_object *object, BOOL signaled )
 {
     struct threadpool *pool = object->pool;
-    NTSTATUS status = STATUS_UNSUCCESSFUL;
 
     assert( !object->shutdown );
     assert( !pool->shutdown );
 
     RtlEnterCriticalSection( &pool->cs );
 
-    /* Start new worker threads if required. */
-    if (pool->num_busy_workers >= pool->num_workers &&
-        pool->num_workers < pool->max_workers)
-        status = tp_new_worker_thread( pool );
+    /* Count how often the object was signaled. */
+    if (object->type == TP_OBJECT_TYPE_WAIT && signaled)
+        object->u.wait.signaled++;
 
     /* Queue work item and increment refcount. */
     InterlockedIncrement( &object->refcount );
-    if (!object->num_pending_callbacks++)
-        tp_object_prio_queue( object );
+    tp_object_queue( object, 1 );
 
-    /* Count how often the object was signaled. */
-    if (object->type == TP_OBJECT_TYPE_WAIT && signaled)
-        object->u.wait.signaled++;
+    RtlLeaveCriticalSection( &pool->cs );
+}
 
-    /* No new thread started - wake up one existing thread. */
-    if (status != STATUS_SUCCESS)
+/***********************************************************************
+ *           tp_object_post    (internal)
+ *
+ * Submits a work object without taking the pool lock in the common case.
+ * Posts are collected in a lock-free list; only the thread which finds
+ * the list empty enters pool->cs to move the whole batch to the pool.
+ */
+static void tp_object_post( struct threadpool_object *object )
+{
+    struct threadpool *pool = object->pool;
+    struct threadpool_object *head;
+
+    assert( object->type == TP_OBJECT_TYPE_WORK );
+    assert( !object->shutdown );
+    assert( !pool->shutdown );
+
+    InterlockedIncrement( &object->refcount );
+
+    /* Already in the list, the pending flush picks up the new count. */
+    if (InterlockedIncrement( &object->u.work.posted ) > 1)
     {
-        assert( pool->num_workers > 0 );
-        RtlWakeConditionVariable( &pool->update_event );
+        InterlockedIncrement( &pool->stats.posted_lockfree );
+        return;
     }
 
+    do
+    {
+        head = pool->posted;
+        object->u.work.next_posted = head;
+    }
+    while (InterlockedCompareExchangePointer( (void **)&pool->posted, object, head ) != head);
+
+    if (head)
+    {
+        InterlockedIncrement( &pool->stats.posted_lockfree );
+        return;
+    }
+
+    RtlEnterCriticalSection( &pool->cs );
+    tp_threadpool_flush_posted( pool );
     RtlLeaveCriticalSection( &pool->cs );
 }
 
@@ -2212,6 +2344,7 @@ static void tp_object_cancel( struct threadpool_object *object )
     LONG pending_callbacks = 0;
 
     RtlEnterCriticalSection( &pool->cs );
+    tp_threadpool_flush_posted( pool );
     if (object->num_pending_callbacks)
     {
         pending_callbacks = object->num_pending_callbacks;
@@ -2253,6 +2386,7 @@ static void tp_object_wait( struct threadpool_object *object, BOOL group_wait )
     struct threadpool *pool = object->pool;
 
     RtlEnterCriticalSection( &pool->cs );
+    tp_threadpool_flush_posted( pool );
     while (!object_is_finished( object, group_wait ))
     {
         if (group_wait)
@@ -2347,6 +2481,7 @@ static void CALLBACK threadpool_worker_proc( void *param )
     LARGE_INTEGER timeout;
     struct list *ptr;
     NTSTATUS status;
+    DWORD latency;
 
     TRACE( "starting worker thread for pool %p\n", pool );
 
@@ -2361,8 +2496,27 @@ static void CALLBACK threadpool_worker_proc( void *param )
             /* If further pending callbacks are queued, move the work item to
              * the end of the pool list. Otherwise remove it from the pool. */
             list_remove( &object->pool_entry );
+            latency = NtGetTickCount() - object->queued_time;
             if (--object->num_pending_callbacks)
                 tp_object_prio_queue( object );
+            pool->num_busy_workers++;
+            pool->stats.max_latency = max( pool->stats.max_latency, latency );
+
+            /* Make sure the remaining callbacks are not starved: start a new
+             * worker if nobody else is free to run them, or if callbacks have
+             * been waiting too long, at most once per latency period. */
+            if (threadpool_get_next_item( pool ) && pool->num_workers < pool->max_workers)
+            {
+                if (pool->num_busy_workers >= pool->num_workers)
+                    tp_new_worker_thread( pool );
+                else if (latency >= THREADPOOL_INJECTION_LATENCY &&
+                         NtGetTickCount() - pool->last_injection >= THREADPOOL_INJECTION_LATENCY &&
+                         tp_new_worker_thread( pool ) == STATUS_SUCCESS)
+                {
+                    pool->last_injection = NtGetTickCount();
+                    pool->stats.injected++;
+                }
+            }
 
             /* For wait objects check if they were signaled or have timed out. */
             if (object->type == TP_OBJECT_TYPE_WAIT)
@@ -2527,6 +2681,7 @@ static void CALLBACK threadpool_worker_proc( void *param )
         }
     }
     pool->num_workers--;
+    tp_threadpool_dump_stats( pool );
     RtlLeaveCriticalSection( &pool->cs );
 
     TRACE( "terminating worker thread for pool %p\n", pool );
@@ -2706,6 +2861,8 @@ NTSTATUS WINAPI TpAllocWork( TP_WORK **out, PTP_WORK_CALLBACK callback, PVOID us
 
     object->type = TP_OBJECT_TYPE_WORK;
     object->u.work.callback = callback;
+    object->u.work.posted = 0;
+    object->u.work.next_posted = NULL;
     tp_object_initialize( object, pool, userdata, environment );
 
     *out = (TP_WORK *)object;
@@ -2894,7 +3051,7 @@ VOID WINAPI TpPostWork( TP_WORK *work )
 
     TRACE( "%p\n", work );
 
-    tp_object_submit( this, FALSE );
+    tp_object_post( this );
 }
 
 /***********************************************************************
@@ -494,6 +494,36 @@ static unsigned int decode_utf8_char( unsigned char ch, const char **str, const
 }
 
 
+/* length of the leading run of 7-bit ASCII chars, checked a 64-bit word at a time;
+ * the chars past the last full ASCII word are left to the caller */
+static inline unsigned int get_ascii_run( const char *src, unsigned int len )
+{
+    unsigned int pos;
+    UINT64 val;
+
+    for (pos = 0; pos + sizeof(val) <= len; pos += sizeof(val))
+    {
+        memcpy( &val, src + pos, sizeof(val) );
+        if (val & 0x8080808080808080) break;
+    }
+    return pos;
+}
+
+/* same as get_ascii_run() for a WCHAR string */
+static inline unsigned int get_wide_ascii_run( const WCHAR *src, unsigned int len )
+{
+    unsigned int pos;
+    UINT64 val;
+
+    for (pos = 0; pos + sizeof(val) / sizeof(WCHAR) <= len; pos += sizeof(val) / sizeof(WCHAR))
+    {
+        memcpy( &val, src + pos, sizeof(val) );
+        if (val & 0xff80ff80ff80ff80) break;
+    }
+    return pos;
+}
+
+
 /******************************************************************
  *      ntdll_umbstowcs
  */
@@ -528,7 +558,7 @@ DWORD ntdll_umbstowcs( const char *src, DWORD srclen, WCHAR *dst, DWORD dstlen )
     }
     else  /* utf-8 */
     {
-        unsigned int res;
+        unsigned int res, run, i;
         const char *srcend = src + srclen;
         WCHAR *dstend = dst + dstlen;
 
@@ -538,6 +568,10 @@ DWORD ntdll_umbstowcs( const char *src, DWORD srclen, WCHAR *dst, DWORD dstlen )
             if (ch < 0x80)  /* special fast case for 7-bit ASCII */
             {
                 *dst++ = ch;
+                run = get_ascii_run( src, min( srcend - src, dstend - dst ));
+                for (i = 0; i < run; i++) dst[i] = (unsigned char)src[i];
+                src += run;
+                dst += run;
                 continue;
             }
             if ((res = decode_utf8_char( ch, &src, srcend )) <= 0xffff)
@@ -610,7 +644,7 @@ int ntdll_wcstoumbs( const WCHAR *src, DWORD srclen, char *dst, DWORD dstlen, BO
     else  /* utf-8 */
     {
         char *end;
-        unsigned int val;
+        unsigned int val, run;
 
         for (end = dst + dstlen; srclen; srclen--, src++)
         {
@@ -620,6 +654,11 @@ int ntdll_wcstoumbs( const WCHAR *src, DWORD srclen, char *dst, DWORD dstlen, BO
             {
                 if (dst > end - 1) break;
                 *dst++ = ch;
+                run = get_wide_ascii_run( src + 1, min( srclen - 1, end - dst ));
+                for (i = 0; i < run; i++) dst[i] = src[i + 1];
+                dst += run;
+                src += run;
+                srclen -= run;
                 continue;
             }
             if (ch < 0x800)  /* 0x80-0x7ff: 2 bytes */
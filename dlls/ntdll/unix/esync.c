@@ -62,13 +62,19 @@
 
 WINE_DEFAULT_DEBUG_CHANNEL(esync);
 
+/* don't fetch the fd of objects we create or open until they are used */
+static int defer_fds;
+
 int do_esync(void)
 {
 #ifdef HAVE_SYS_EVENTFD_H
     static int do_esync_cached = -1;
 
     if (do_esync_cached == -1)
+    {
         do_esync_cached = getenv("WINEESYNC") && atoi(getenv("WINEESYNC")) && !do_fsync();
+        defer_fds = getenv("WINEESYNC_DEFER_FDS") && atoi(getenv("WINEESYNC_DEFER_FDS"));
+    }
 
     return do_esync_cached;
 #else
@@ -301,7 +307,7 @@ static NTSTATUS create_esync( enum esync_type type, HANDLE *handle, ACCESS_MASK
     obj_handle_t fd_handle;
     unsigned int shm_idx;
     sigset_t sigset;
-    int fd;
+    int fd = -1;
 
     if ((ret = alloc_object_attributes( attr, &objattr, &len ))) return ret;
 
@@ -314,6 +320,7 @@ static NTSTATUS create_esync( enum esync_type type, HANDLE *handle, ACCESS_MASK
         req->initval = initval;
         req->type    = type;
         req->max     = max;
+        req->defer_fd = defer_fds;
         wine_server_add_data( req, objattr, len );
         ret = wine_server_call( req );
         if (!ret || ret == STATUS_OBJECT_NAME_EXISTS)
@@ -321,14 +328,17 @@ static NTSTATUS create_esync( enum esync_type type, HANDLE *handle, ACCESS_MASK
             *handle = wine_server_ptr_handle( reply->handle );
             type = reply->type;
             shm_idx = reply->shm_idx;
-            fd = receive_fd( &fd_handle );
-            assert( wine_server_ptr_handle(fd_handle) == *handle );
+            if (!defer_fds)
+            {
+                fd = receive_fd( &fd_handle );
+                assert( wine_server_ptr_handle(fd_handle) == *handle );
+            }
         }
     }
     SERVER_END_REQ;
     server_leave_uninterrupted_section( &fd_cache_mutex, &sigset );
 
-    if (!ret || ret == STATUS_OBJECT_NAME_EXISTS)
+    if ((!ret || ret == STATUS_OBJECT_NAME_EXISTS) && !defer_fds)
     {
         add_to_list( *handle, type, fd, shm_idx ? get_shm( shm_idx ) : 0 );
         TRACE("-> handle %p, fd %d.\n", *handle, fd);
@@ -345,7 +355,7 @@ static NTSTATUS open_esync( enum esync_type type, HANDLE *handle,
     obj_handle_t fd_handle;
     unsigned int shm_idx;
     sigset_t sigset;
-    int fd;
+    int fd = -1;
 
     server_enter_uninterrupted_section( &fd_cache_mutex, &sigset );
     SERVER_START_REQ( open_esync )
@@ -354,6 +364,7 @@ static NTSTATUS open_esync( enum esync_type type, HANDLE *handle,
         req->attributes = attr->Attributes;
         req->rootdir    = wine_server_obj_handle( attr->RootDirectory );
         req->type       = type;
+        req->defer_fd   = defer_fds;
         if (attr->ObjectName)
             wine_server_add_data( req, attr->ObjectName->Buffer, attr->ObjectName->Length );
         if (!(ret = wine_server_call( req )))
@@ -361,14 +372,17 @@ static NTSTATUS open_esync( enum esync_type type, HANDLE *handle,
             *handle = wine_server_ptr_handle( reply->handle );
             type = reply->type;
             shm_idx = reply->shm_idx;
-            fd = receive_fd( &fd_handle );
-            assert( wine_server_ptr_handle(fd_handle) == *handle );
+            if (!defer_fds)
+            {
+                fd = receive_fd( &fd_handle );
+                assert( wine_server_ptr_handle(fd_handle) == *handle );
+            }
         }
     }
     SERVER_END_REQ;
     server_leave_uninterrupted_section( &fd_cache_mutex, &sigset );
 
-    if (!ret)
+    if (!ret && !defer_fds)
     {
         add_to_list( *handle, type, fd, shm_idx ? get_shm( shm_idx ) : 0 );
 
@@ -2477,6 +2477,245 @@ NTSTATUS WINAPI NtQueryDirectoryFile( HANDLE handle, HANDLE event, PIO_APC_ROUTI
 }
 
 
+/* cache of case-insensitive directory lookups, see find_file_in_dir */
+
+#define DIR_LOOKUP_CACHE_SIZE   16
+#define DIR_LOOKUP_MAX_KEYS     65536
+
+struct dir_lookup_key
+{
+    unsigned int hash;       /* hash of the upcased name */
+    unsigned int len;        /* length of the name in WCHARs */
+    BOOL         is_short;   /* hashed short name */
+    unsigned int name;       /* offset of the name in the names buffer */
+    unsigned int unix_name;  /* offset of the Unix name in the unix_names buffer */
+};
+
+struct dir_lookup_cache
+{
+    dev_t                  dev;
+    ino_t                  ino;
+    time_t                 mtime;
+    long                   mtime_nsec;
+    BOOL                   uncacheable; /* directory has too many entries to be cached */
+    unsigned int           count;       /* number of keys */
+    unsigned int           mask;        /* size of the hash table - 1 */
+    unsigned int          *table;       /* index of the key + 1, or 0 */
+    struct dir_lookup_key *keys;
+    WCHAR                 *names;
+    char                  *unix_names;
+};
+
+static struct dir_lookup_cache dir_lookup_cache[DIR_LOOKUP_CACHE_SIZE];
+static unsigned int dir_lookup_cache_next;
+static pthread_mutex_t dir_lookup_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static unsigned int dir_lookup_hash( const WCHAR *name, int length )
+{
+    unsigned int hash = 0;
+    while (length--) hash = hash * 31 + towupper( *name++ );
+    return hash;
+}
+
+static long get_mtime_nsec( const struct stat *st )
+{
+#ifdef HAVE_STRUCT_STAT_ST_MTIM
+    return st->st_mtim.tv_nsec;
+#elif defined(HAVE_STRUCT_STAT_ST_MTIMESPEC)
+    return st->st_mtimespec.tv_nsec;
+#else
+    return 0;
+#endif
+}
+
+static void dir_lookup_cache_free( struct dir_lookup_cache *cache )
+{
+    free( cache->table );
+    free( cache->keys );
+    free( cache->names );
+    free( cache->unix_names );
+    memset( cache, 0, sizeof(*cache) );
+}
+
+/* add a key to the cache while it is being filled, the hash table is built afterwards */
+static BOOL dir_lookup_cache_add( struct dir_lookup_cache *cache, const WCHAR *name, int length, BOOL is_short,
+                                  unsigned int unix_name, unsigned int *names_size, unsigned int *names_max,
+                                  unsigned int *keys_max )
+{
+    struct dir_lookup_key *key;
+
+    if (cache->count >= DIR_LOOKUP_MAX_KEYS) return FALSE;
+    if (cache->count == *keys_max)
+    {
+        unsigned int new_max = max( 256, *keys_max * 2 );
+        if (!(key = realloc( cache->keys, new_max * sizeof(*key) ))) return FALSE;
+        cache->keys = key;
+        *keys_max = new_max;
+    }
+    if (*names_size + length > *names_max)
+    {
+        unsigned int new_max = max( 4096, max( *names_max * 2, *names_size + length ) );
+        WCHAR *names;
+        if (!(names = realloc( cache->names, new_max * sizeof(WCHAR) ))) return FALSE;
+        cache->names = names;
+        *names_max = new_max;
+    }
+    key = &cache->keys[cache->count++];
+    key->hash      = dir_lookup_hash( name, length );
+    key->len       = length;
+    key->is_short  = is_short;
+    key->name      = *names_size;
+    key->unix_name = unix_name;
+    memcpy( cache->names + *names_size, name, length * sizeof(WCHAR) );
+    *names_size += length;
+    return TRUE;
+}
+
+/* read a directory into a cache entry; the long name and the hashed short name of every entry become keys */
+static BOOL dir_lookup_cache_fill( struct dir_lookup_cache *cache, const char *dir )
+{
+    unsigned int names_size = 0, names_max = 0, keys_max = 0, unix_size = 0, unix_max = 0;
+    unsigned int i, size, pos;
+    WCHAR buffer[MAX_DIR_ENTRY_LEN];
+    WCHAR short_nameW[12];
+    struct dirent *de;
+    BOOL too_big;
+    DIR *dirp;
+    int ret, len;
+
+    if (!(dirp = opendir( dir ))) return FALSE;
+    while ((de = readdir( dirp )))
+    {
+        len = strlen( de->d_name ) + 1;
+        if (unix_size + len > unix_max)
+        {
+            unsigned int new_max = max( 4096, max( unix_max * 2, unix_size + len ) );
+            char *unix_names;
+            if (!(unix_names = realloc( cache->unix_names, new_max ))) goto failed;
+            cache->unix_names = unix_names;
+            unix_max = new_max;
+        }
+        memcpy( cache->unix_names + unix_size, de->d_name, len );
+
+        ret = ntdll_umbstowcs( de->d_name, len - 1, buffer, MAX_DIR_ENTRY_LEN );
+        if (!dir_lookup_cache_add( cache, buffer, ret, FALSE, unix_size, &names_size, &names_max, &keys_max ))
+            goto failed;
+        if (!is_legal_8dot3_name( buffer, ret ))
+        {
+            ret = hash_short_file_name( buffer, ret, short_nameW );
+            if (!dir_lookup_cache_add( cache, short_nameW, ret, TRUE, unix_size,
+                                       &names_size, &names_max, &keys_max ))
+                goto failed;
+        }
+        unix_size += len;
+    }
+    closedir( dirp );
+
+    /* keys are inserted in directory order, so that lookups return the same entry as a readdir scan */
+    for (size = 64; size < cache->count * 2; size *= 2) ;
+    if (!(cache->table = calloc( size, sizeof(*cache->table) ))) goto failed_closed;
+    cache->mask = size - 1;
+    for (i = 0; i < cache->count; i++)
+    {
+        for (pos = cache->keys[i].hash & cache->mask; cache->table[pos]; pos = (pos + 1) & cache->mask) ;
+        cache->table[pos] = i + 1;
+    }
+    return TRUE;
+
+failed:
+    closedir( dirp );
+failed_closed:
+    too_big = cache->count >= DIR_LOOKUP_MAX_KEYS;
+    dir_lookup_cache_free( cache );
+    cache->uncacheable = too_big;
+    return FALSE;
+}
+
+/***********************************************************************
+ *           lookup_dir_cache
+ *
+ * Look up a file name case-insensitively in the cached contents of a directory.
+ * Returns 1 and stores the Unix name in 'result' if found, 0 if the directory
+ * doesn't contain the name, and -1 if the directory can't be cached.
+ */
+static struct dir_lookup_cache *find_dir_lookup_cache( const struct stat *st )
+{
+    unsigned int i;
+
+    for (i = 0; i < DIR_LOOKUP_CACHE_SIZE; i++)
+    {
+        struct dir_lookup_cache *entry = &dir_lookup_cache[i];
+
+        if (!entry->table && !entry->uncacheable) continue;
+        if (entry->dev == st->st_dev && entry->ino == st->st_ino) return entry;
+    }
+    return NULL;
+}
+
+static int lookup_dir_cache( const char *dir, const WCHAR *name, int length, BOOLEAN match_short, char *result )
+{
+    struct dir_lookup_cache *cache, new_cache;
+    const struct dir_lookup_key *key;
+    unsigned int pos, hash;
+    struct stat st;
+    int ret = 0;
+
+    if (stat( dir, &st ) == -1) return -1;
+
+    pthread_mutex_lock( &dir_lookup_mutex );
+    if ((cache = find_dir_lookup_cache( &st )) &&
+        (cache->mtime != st.st_mtime || cache->mtime_nsec != get_mtime_nsec( &st )))
+    {
+        dir_lookup_cache_free( cache );
+        cache = NULL;
+    }
+
+    if (!cache)
+    {
+        pthread_mutex_unlock( &dir_lookup_mutex );
+
+        /* A directory modified very recently may change again without its timestamp
+         * moving on filesystems with coarse timestamps, don't cache it yet. */
+        if (time( NULL ) - st.st_mtime <= 1) return -1;
+
+        /* read the directory without holding the lock */
+        memset( &new_cache, 0, sizeof(new_cache) );
+        if (!dir_lookup_cache_fill( &new_cache, dir ) && !new_cache.uncacheable) return -1;
+        new_cache.dev        = st.st_dev;
+        new_cache.ino        = st.st_ino;
+        new_cache.mtime      = st.st_mtime;
+        new_cache.mtime_nsec = get_mtime_nsec( &st );
+        if (new_cache.uncacheable) TRACE( "too many names in %s, not caching\n", debugstr_a(dir) );
+        else TRACE( "cached %u names for %s\n", new_cache.count, debugstr_a(dir) );
+
+        /* replace the entry another thread may have added meanwhile */
+        pthread_mutex_lock( &dir_lookup_mutex );
+        if (!(cache = find_dir_lookup_cache( &st )))
+            cache = &dir_lookup_cache[dir_lookup_cache_next++ % DIR_LOOKUP_CACHE_SIZE];
+        dir_lookup_cache_free( cache );
+        *cache = new_cache;
+    }
+
+    /* directories with too many entries are only remembered, so that they are not read again */
+    if (cache->uncacheable) ret = -1;
+    else
+    {
+        hash = dir_lookup_hash( name, length );
+        for (pos = hash & cache->mask; cache->table[pos]; pos = (pos + 1) & cache->mask)
+        {
+            key = &cache->keys[cache->table[pos] - 1];
+            if (key->hash != hash || key->len != length || (key->is_short && !match_short)) continue;
+            if (wcsnicmp( cache->names + key->name, name, length )) continue;
+            strcpy( result, cache->unix_names + key->unix_name );
+            ret = 1;
+            break;
+        }
+    }
+    pthread_mutex_unlock( &dir_lookup_mutex );
+    return ret;
+}
+
+
 /***********************************************************************
  *           find_file_in_dir
  *
@@ -2488,6 +2727,7 @@ static NTSTATUS find_file_in_dir( char *unix_name, int pos, const WCHAR *name, i
                                   BOOLEAN check_case, BOOLEAN *is_win_dir )
 {
     WCHAR buffer[MAX_DIR_ENTRY_LEN];
+    char buffer_unix[MAX_DIR_ENTRY_LEN * 3 + 1];
     BOOLEAN is_name_8_dot_3;
     DIR *dir;
     struct dirent *de;
@@ -2569,6 +2809,16 @@ static NTSTATUS find_file_in_dir( char *unix_name, int pos, const WCHAR *name, i
     }
 #endif /* VFAT_IOCTL_READDIR_BOTH */
 
+    switch (lookup_dir_cache( unix_name, name, length, is_name_8_dot_3, buffer_unix ))
+    {
+    case 1:
+        unix_name[pos - 1] = '/';
+        strcpy( unix_name + pos, buffer_unix );
+        goto success;
+    case 0:
+        goto not_found;
+    }
+
     if (!(dir = opendir( unix_name )))
     {
         if (errno == ENOENT) return STATUS_OBJECT_PATH_NOT_FOUND;
@@ -4972,7 +5222,7 @@ static NTSTATUS register_async_file_read( HANDLE handle, HANDLE event,
     return status;
 }
 
-static void add_completion( HANDLE handle, ULONG_PTR value, NTSTATUS status, ULONG info, BOOL async )
+void add_completion( HANDLE handle, ULONG_PTR value, NTSTATUS status, ULONG info, BOOL async )
 {
     SERVER_START_REQ( add_fd_completion )
     {
@@ -5042,6 +5292,12 @@ NTSTATUS WINAPI NtReadFile( HANDLE handle, HANDLE event, PIO_APC_ROUTINE apc, vo
 
         if (offset && offset->QuadPart != FILE_USE_FILE_POINTER_POSITION)
         {
+            /* without an event, waiters use the file handle, which only the server signals */
+            if (async_read && !apc && event && length &&
+                (status = uring_submit_rw( handle, unix_handle, event, cvalue, io, buffer, length,
+                                           offset->QuadPart, FALSE )) != STATUS_NOT_SUPPORTED)
+                goto err;
+
             /* async I/O doesn't make sense on regular files */
             while ((result = virtual_locked_pread( unix_handle, buffer, length, offset->QuadPart )) == -1)
             {
@@ -5353,6 +5609,11 @@ NTSTATUS WINAPI NtWriteFile( HANDLE handle, HANDLE event, PIO_APC_ROUTINE apc, v
                 goto done;
             }
 
+            if (async_write && !apc && event && length &&
+                (status = uring_submit_rw( handle, unix_handle, event, cvalue, io, (void *)buffer, length,
+                                           off, TRUE )) != STATUS_NOT_SUPPORTED)
+                goto err;
+
             /* async I/O doesn't make sense on regular files */
             while ((result = pwrite( unix_handle, buffer, length, off )) == -1)
             {
@@ -6391,8 +6652,12 @@ NTSTATUS WINAPI NtFlushBuffersFile( HANDLE handle, IO_STATUS_BLOCK *io )
  */
 NTSTATUS WINAPI NtCancelIoFile( HANDLE handle, IO_STATUS_BLOCK *io_status )
 {
+    NTSTATUS uring_status;
+
     TRACE( "%p %p\n", handle, io_status );
 
+    uring_status = uring_cancel( handle, NULL, TRUE );
+
     SERVER_START_REQ( cancel_async )
     {
         req->handle      = wine_server_obj_handle( handle );
@@ -6400,6 +6665,7 @@ NTSTATUS WINAPI NtCancelIoFile( HANDLE handle, IO_STATUS_BLOCK *io_status )
         io_status->u.Status = wine_server_call( req );
     }
     SERVER_END_REQ;
+    if (io_status->u.Status == STATUS_NOT_FOUND && !uring_status) io_status->u.Status = STATUS_SUCCESS;
     return io_status->u.Status;
 }
 
@@ -6409,8 +6675,12 @@ NTSTATUS WINAPI NtCancelIoFile( HANDLE handle, IO_STATUS_BLOCK *io_status )
  */
 NTSTATUS WINAPI NtCancelIoFileEx( HANDLE handle, IO_STATUS_BLOCK *io, IO_STATUS_BLOCK *io_status )
 {
+    NTSTATUS uring_status;
+
     TRACE( "%p %p %p\n", handle, io, io_status );
 
+    uring_status = uring_cancel( handle, io, FALSE );
+
     SERVER_START_REQ( cancel_async )
     {
         req->handle = wine_server_obj_handle( handle );
@@ -6418,6 +6688,7 @@ NTSTATUS WINAPI NtCancelIoFileEx( HANDLE handle, IO_STATUS_BLOCK *io, IO_STATUS_
         io_status->u.Status = wine_server_call( req );
     }
     SERVER_END_REQ;
+    if (io_status->u.Status == STATUS_NOT_FOUND && !uring_status) io_status->u.Status = STATUS_SUCCESS;
     return io_status->u.Status;
 }
 
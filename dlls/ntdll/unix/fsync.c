@@ -122,6 +122,7 @@ struct fsync
 {
     enum fsync_type type;
     void *shm;              /* pointer to shm section */
+    int gen;                /* generation of the shm slot when it was cached */
 };
 
 struct semaphore
@@ -155,8 +156,8 @@ static pthread_mutex_t shm_addrs_mutex = PTHREAD_MUTEX_INITIALIZER;
 
 static void *get_shm( unsigned int idx )
 {
-    int entry  = (idx * 8) / pagesize;
-    int offset = (idx * 8) % pagesize;
+    int entry  = (idx * FSYNC_SHM_SLOT_SIZE) / pagesize;
+    int offset = (idx * FSYNC_SHM_SLOT_SIZE) % pagesize;
     void *ret;
 
     pthread_mutex_lock( &shm_addrs_mutex );
@@ -190,6 +191,11 @@ static void *get_shm( unsigned int idx )
     return ret;
 }
 
+static inline int get_shm_gen( void *shm )
+{
+    return __atomic_load_n( (int *)((char *)shm + FSYNC_SHM_GEN_OFFSET), __ATOMIC_SEQ_CST );
+}
+
 /* We'd like lookup to be fast. To that end, we use a static list indexed by handle.
  * This is copied and adapted from the fd cache code. */
 
@@ -228,8 +234,12 @@ static struct fsync *add_to_list( HANDLE handle, enum fsync_type type, void *shm
         }
     }
 
-    if (!__sync_val_compare_and_swap((int *)&fsync_list[entry][idx].type, 0, type ))
-        fsync_list[entry][idx].shm = shm;
+    /* Concurrent callers for the same handle store the same values. The type
+     * is published last, so that get_cached_object() never pairs it with the
+     * shm and generation of a previous object. */
+    fsync_list[entry][idx].gen = get_shm_gen( shm );
+    fsync_list[entry][idx].shm = shm;
+    __atomic_store_n( &fsync_list[entry][idx].type, type, __ATOMIC_RELEASE );
 
     return &fsync_list[entry][idx];
 }
@@ -239,7 +249,17 @@ static struct fsync *get_cached_object( HANDLE handle )
     UINT_PTR entry, idx = handle_to_index( handle, &entry );
 
     if (entry >= FSYNC_LIST_ENTRIES || !fsync_list[entry]) return NULL;
-    if (!fsync_list[entry][idx].type) return NULL;
+    if (!__atomic_load_n( &fsync_list[entry][idx].type, __ATOMIC_ACQUIRE )) return NULL;
+
+    /* The server recycles the slots of destroyed objects; if the handle was
+     * closed behind our back, drop the stale entry and ask the server again. */
+    if (fsync_list[entry][idx].shm &&
+        fsync_list[entry][idx].gen != get_shm_gen( fsync_list[entry][idx].shm ))
+    {
+        TRACE("Discarding stale cache entry for handle %p.\n", handle);
+        fsync_close( handle );
+        return NULL;
+    }
 
     return &fsync_list[entry][idx];
 }
@@ -786,6 +786,8 @@ NTSTATUS WINAPI NtCreateUserProcess( HANDLE *process_handle_ptr, HANDLE *thread_
     NTSTATUS status;
     BOOL success = FALSE;
     HANDLE file_handle, process_info = 0, process_handle = 0, thread_handle = 0;
+    HANDLE handles[4];
+    unsigned int count = 0;
     struct object_attributes *objattr;
     data_size_t attr_len;
     char *winedebug = NULL;
@@ -985,10 +987,11 @@ NTSTATUS WINAPI NtCreateUserProcess( HANDLE *process_handle_ptr, HANDLE *thread_
     status = STATUS_SUCCESS;
 
 done:
-    if (file_handle) NtClose( file_handle );
-    if (process_info) NtClose( process_info );
-    if (process_handle) NtClose( process_handle );
-    if (thread_handle) NtClose( thread_handle );
+    if (file_handle) handles[count++] = file_handle;
+    if (process_info) handles[count++] = process_info;
+    if (process_handle) handles[count++] = process_handle;
+    if (thread_handle) handles[count++] = thread_handle;
+    if (count) close_handles( handles, count );
     if (socketfd[0] != -1) close( socketfd[0] );
     if (unixdir != -1) close( unixdir );
     free( startup_info );
@@ -497,8 +497,63 @@ NTSTATUS WINAPI NtQueryValueKey( HANDLE handle, const UNICODE_STRING *name,
 NTSTATUS WINAPI NtQueryMultipleValueKey( HANDLE key, KEY_MULTIPLE_VALUE_INFORMATION *info,
                                          ULONG count, void *buffer, ULONG length, ULONG *retlen )
 {
-    FIXME( "(%p,%p,0x%08x,%p,0x%08x,%p) stub!\n", key, info, count, buffer, length, retlen );
-    return STATUS_SUCCESS;
+    struct __server_request_info *infos, **reqs;
+    NTSTATUS ret;
+    ULONG i, total = 0;
+
+    TRACE( "(%p,%p,0x%08x,%p,0x%08x,%p)\n", key, info, count, buffer, length, retlen );
+
+    for (i = 0; i < count; i++)
+        if (info[i].ValueName->Length > MAX_VALUE_LENGTH) return STATUS_OBJECT_NAME_NOT_FOUND;
+
+    if (!(infos = malloc( count * (sizeof(*infos) + sizeof(*reqs) )))) return STATUS_NO_MEMORY;
+    reqs = (struct __server_request_info **)(infos + count);
+
+    /* first retrieve the type and size of all the values in a single batch */
+    for (i = 0; i < count; i++)
+    {
+        memset( &infos[i].u.req, 0, sizeof(infos[i].u.req) );
+        infos[i].u.req.request_header.req = REQ_get_key_value;
+        infos[i].u.req.get_key_value_request.hkey = wine_server_obj_handle( key );
+        infos[i].data_count = 0;
+        wine_server_add_data( &infos[i], info[i].ValueName->Buffer, info[i].ValueName->Length );
+        reqs[i] = &infos[i];
+    }
+    if ((ret = server_call_batch( reqs, count ))) goto done;
+
+    for (i = 0; i < count; i++)
+    {
+        const struct get_key_value_reply *reply = &infos[i].u.reply.get_key_value_reply;
+
+        if ((ret = reply->__header.error)) goto done;
+        info[i].Type       = reply->type;
+        info[i].DataLength = reply->total;
+        info[i].DataOffset = total;
+        total += reply->total;
+    }
+    if (retlen) *retlen = total;
+    if (total > length)
+    {
+        ret = STATUS_BUFFER_OVERFLOW;
+        goto done;
+    }
+
+    /* then fetch the data straight into the caller buffer */
+    for (i = 0; i < count; i++)
+    {
+        memset( &infos[i].u.req, 0, sizeof(infos[i].u.req) );
+        infos[i].u.req.request_header.req = REQ_get_key_value;
+        infos[i].u.req.get_key_value_request.hkey = wine_server_obj_handle( key );
+        infos[i].data_count = 0;
+        wine_server_add_data( &infos[i], info[i].ValueName->Buffer, info[i].ValueName->Length );
+        wine_server_set_reply( &infos[i], (char *)buffer + info[i].DataOffset, info[i].DataLength );
+    }
+    if ((ret = server_call_batch( reqs, count ))) goto done;
+    for (i = 0; i < count && !ret; i++) ret = infos[i].u.reply.reply_header.error;
+
+done:
+    free( infos );
+    return ret;
 }
 
 
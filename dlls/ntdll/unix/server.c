@@ -294,6 +294,80 @@ unsigned int CDECL wine_server_call( void *req_ptr )
 }
 
 
+/* maximum size of the request or reply data of a single batch */
+#define MAX_BATCH_SIZE 0x10000
+
+static inline data_size_t batch_data_size( data_size_t size )
+{
+    return (size + 7) & ~7;
+}
+
+/***********************************************************************
+ *           server_call_batch
+ *
+ * Perform several independent server calls in as few round trips as possible.
+ * The status of each request is returned in its reply header.
+ */
+unsigned int server_call_batch( struct __server_request_info **reqs, unsigned int count )
+{
+    unsigned int i, j, n, done, ret;
+    data_size_t req_size, reply_size, size, reply_max;
+    char *buffer, *ptr;
+
+    while (count)
+    {
+        req_size = reply_size = 0;
+        for (n = 0; n < count; n++)
+        {
+            size = sizeof(union generic_request) + batch_data_size( reqs[n]->u.req.request_header.request_size );
+            reply_max = sizeof(union generic_reply) + batch_data_size( reqs[n]->u.req.request_header.reply_size );
+            if (n && (req_size + size > MAX_BATCH_SIZE || reply_size + reply_max > MAX_BATCH_SIZE)) break;
+            req_size += size;
+            reply_size += reply_max;
+        }
+
+        if (!(buffer = malloc( req_size + reply_size ))) return STATUS_NO_MEMORY;
+        for (i = 0, ptr = buffer; i < n; i++)
+        {
+            memcpy( ptr, &reqs[i]->u.req, sizeof(reqs[i]->u.req) );
+            ptr += sizeof(reqs[i]->u.req);
+            for (j = 0; j < reqs[i]->data_count; j++)
+            {
+                memcpy( ptr, reqs[i]->data[j].ptr, reqs[i]->data[j].size );
+                ptr += reqs[i]->data[j].size;
+            }
+            size = reqs[i]->u.req.request_header.request_size;
+            memset( ptr, 0, batch_data_size( size ) - size );
+            ptr += batch_data_size( size ) - size;
+        }
+
+        SERVER_START_REQ( batch_requests )
+        {
+            wine_server_add_data( req, buffer, req_size );
+            wine_server_set_reply( req, buffer + req_size, reply_size );
+            ret = wine_server_call( req );
+            done = reply->count;
+        }
+        SERVER_END_REQ;
+
+        for (i = 0, ptr = buffer + req_size; i < done; i++)
+        {
+            memcpy( &reqs[i]->u.reply, ptr, sizeof(reqs[i]->u.reply) );
+            ptr += sizeof(reqs[i]->u.reply);
+            if (!(size = reqs[i]->u.reply.reply_header.reply_size)) continue;
+            memcpy( reqs[i]->reply_data, ptr, size );
+            ptr += batch_data_size( size );
+        }
+        free( buffer );
+        if (ret) return ret;
+        if (!done) return STATUS_INTERNAL_ERROR;
+        reqs += done;
+        count -= done;
+    }
+    return STATUS_SUCCESS;
+}
+
+
 /***********************************************************************
  *           server_enter_uninterrupted_section
  */
@@ -887,19 +961,36 @@ union fd_cache_entry
 
 C_ASSERT( sizeof(union fd_cache_entry) == sizeof(LONG64) );
 
+/* the cache is a two-level radix map covering the whole handle space: a static array of
+ * directories, each pointing to blocks of entries, both allocated on first use */
 #define FD_CACHE_BLOCK_SIZE  (65536 / sizeof(union fd_cache_entry))
-#define FD_CACHE_ENTRIES     128
+#define FD_CACHE_ENTRIES     (4096 / sizeof(union fd_cache_entry *))
+#define FD_CACHE_DIRS        (0x40000000 / FD_CACHE_BLOCK_SIZE / FD_CACHE_ENTRIES)
 
-static union fd_cache_entry *fd_cache[FD_CACHE_ENTRIES];
+static union fd_cache_entry **fd_cache[FD_CACHE_DIRS];
+static union fd_cache_entry *fd_cache_initial_dir[FD_CACHE_ENTRIES];
 static union fd_cache_entry fd_cache_initial_block[FD_CACHE_BLOCK_SIZE];
 
-static inline unsigned int handle_to_index( HANDLE handle, unsigned int *entry )
+/* statistics, the hits are only counted when tracing is enabled */
+static LONG fd_cache_hits;
+static unsigned int fd_cache_misses;
+
+static inline unsigned int handle_to_index( HANDLE handle, unsigned int *dir, unsigned int *entry )
 {
-    unsigned int idx = (wine_server_obj_handle(handle) >> 2) - 1;
-    *entry = idx / FD_CACHE_BLOCK_SIZE;
+    unsigned int idx = ((wine_server_obj_handle(handle) >> 2) - 1) & 0x3fffffff;
+    *dir = idx / FD_CACHE_BLOCK_SIZE / FD_CACHE_ENTRIES;
+    *entry = idx / FD_CACHE_BLOCK_SIZE % FD_CACHE_ENTRIES;
     return idx % FD_CACHE_BLOCK_SIZE;
 }
 
+static inline union fd_cache_entry *get_fd_cache_block( unsigned int dir, unsigned int entry )
+{
+    union fd_cache_entry **blocks = fd_cache[dir];
+
+    if (!blocks) return NULL;
+    return blocks[entry];
+}
+
 
 /***********************************************************************
  *           add_fd_to_cache
@@ -909,24 +1000,30 @@ static inline unsigned int handle_to_index( HANDLE handle, unsigned int *entry )
 static BOOL add_fd_to_cache( HANDLE handle, int fd, enum server_fd_type type,
                             unsigned int access, unsigned int options )
 {
-    unsigned int entry, idx = handle_to_index( handle, &entry );
+    unsigned int dir, entry, idx = handle_to_index( handle, &dir, &entry );
     union fd_cache_entry cache;
 
-    if (entry >= FD_CACHE_ENTRIES)
+    if (!fd_cache[dir])  /* do we need to allocate a new directory of blocks? */
     {
-        FIXME( "too many allocated handles, not caching %p\n", handle );
-        return FALSE;
+        if (!dir) fd_cache[0] = fd_cache_initial_dir;
+        else
+        {
+            void *ptr = wine_anon_mmap( NULL, FD_CACHE_ENTRIES * sizeof(union fd_cache_entry *),
+                                        PROT_READ | PROT_WRITE, 0 );
+            if (ptr == MAP_FAILED) return FALSE;
+            fd_cache[dir] = ptr;
+        }
     }
 
-    if (!fd_cache[entry])  /* do we need to allocate a new block of entries? */
+    if (!fd_cache[dir][entry])  /* do we need to allocate a new block of entries? */
     {
-        if (!entry) fd_cache[0] = fd_cache_initial_block;
+        if (!dir && !entry) fd_cache[0][0] = fd_cache_initial_block;
         else
         {
             void *ptr = wine_anon_mmap( NULL, FD_CACHE_BLOCK_SIZE * sizeof(union fd_cache_entry),
                                         PROT_READ | PROT_WRITE, 0 );
             if (ptr == MAP_FAILED) return FALSE;
-            fd_cache[entry] = ptr;
+            fd_cache[dir][entry] = ptr;
         }
     }
 
@@ -935,7 +1032,7 @@ static BOOL add_fd_to_cache( HANDLE handle, int fd, enum server_fd_type type,
     cache.s.type = type;
     cache.s.access = access;
     cache.s.options = options;
-    cache.data = interlocked_xchg64( &fd_cache[entry][idx].data, cache.data );
+    cache.data = interlocked_xchg64( &fd_cache[dir][entry][idx].data, cache.data );
     assert( !cache.s.fd );
     return TRUE;
 }
@@ -947,12 +1044,13 @@ static BOOL add_fd_to_cache( HANDLE handle, int fd, enum server_fd_type type,
 static inline NTSTATUS get_cached_fd( HANDLE handle, int *fd, enum server_fd_type *type,
                                       unsigned int *access, unsigned int *options )
 {
-    unsigned int entry, idx = handle_to_index( handle, &entry );
+    unsigned int dir, entry, idx = handle_to_index( handle, &dir, &entry );
+    union fd_cache_entry *block = get_fd_cache_block( dir, entry );
     union fd_cache_entry cache;
 
-    if (entry >= FD_CACHE_ENTRIES || !fd_cache[entry]) return STATUS_INVALID_HANDLE;
+    if (!block) return STATUS_INVALID_HANDLE;
 
-    cache.data = InterlockedCompareExchange64( &fd_cache[entry][idx].data, 0, 0 );
+    cache.data = InterlockedCompareExchange64( &block[idx].data, 0, 0 );
     if (!cache.data) return STATUS_INVALID_HANDLE;
 
     /* if fd type is invalid, fd stores an error value */
@@ -971,13 +1069,14 @@ static inline NTSTATUS get_cached_fd( HANDLE handle, int *fd, enum server_fd_typ
  */
 static int remove_fd_from_cache( HANDLE handle )
 {
-    unsigned int entry, idx = handle_to_index( handle, &entry );
+    unsigned int dir, entry, idx = handle_to_index( handle, &dir, &entry );
+    union fd_cache_entry *block = get_fd_cache_block( dir, entry );
     int fd = -1;
 
-    if (entry < FD_CACHE_ENTRIES && fd_cache[entry])
+    if (block)
     {
         union fd_cache_entry cache;
-        cache.data = interlocked_xchg64( &fd_cache[entry][idx].data, 0 );
+        cache.data = interlocked_xchg64( &block[idx].data, 0 );
         if (cache.s.type != FD_TYPE_INVALID) fd = cache.s.fd - 1;
     }
 
@@ -1003,12 +1102,18 @@ int server_get_unix_fd( HANDLE handle, unsigned int wanted_access, int *unix_fd,
     wanted_access &= FILE_READ_DATA | FILE_WRITE_DATA | FILE_APPEND_DATA;
 
     ret = get_cached_fd( handle, &fd, type, &access, options );
-    if (ret != STATUS_INVALID_HANDLE) goto done;
+    if (ret != STATUS_INVALID_HANDLE)
+    {
+        if (TRACE_ON(server)) InterlockedIncrement( &fd_cache_hits );
+        goto done;
+    }
 
     server_enter_uninterrupted_section( &fd_cache_mutex, &sigset );
     ret = get_cached_fd( handle, &fd, type, &access, options );
     if (ret == STATUS_INVALID_HANDLE)
     {
+        fd_cache_misses++;
+        TRACE( "fd cache miss for %p, %u hits %u misses\n", handle, (unsigned int)fd_cache_hits, fd_cache_misses );
         SERVER_START_REQ( get_handle_fd )
         {
             req->handle = wine_server_obj_handle( handle );
@@ -1626,6 +1731,43 @@ NTSTATUS WINAPI NtDuplicateObject( HANDLE source_process, HANDLE source, HANDLE
 }
 
 
+/**************************************************************************
+ *           close_handles
+ *
+ * Close several handles in a single server round trip.
+ */
+NTSTATUS close_handles( const HANDLE *handles, unsigned int count )
+{
+    struct __server_request_info *infos, **reqs;
+    NTSTATUS ret;
+    unsigned int i;
+    int fd;
+
+    if (!(infos = malloc( count * (sizeof(*infos) + sizeof(*reqs) )))) return STATUS_NO_MEMORY;
+    reqs = (struct __server_request_info **)(infos + count);
+
+    for (i = 0; i < count; i++)
+    {
+        if ((fd = remove_fd_from_cache( handles[i] )) != -1) close( fd );
+        if (do_fsync()) fsync_close( handles[i] );
+        if (do_esync()) esync_close( handles[i] );
+
+        memset( &infos[i].u.req, 0, sizeof(infos[i].u.req) );
+        infos[i].u.req.request_header.req = REQ_close_handle;
+        infos[i].u.req.close_handle_request.handle = wine_server_obj_handle( handles[i] );
+        infos[i].data_count = 0;
+        reqs[i] = &infos[i];
+    }
+
+    if (!(ret = server_call_batch( reqs, count )))
+    {
+        for (i = 0; i < count && !ret; i++) ret = infos[i].u.reply.reply_header.error;
+    }
+    free( infos );
+    return ret;
+}
+
+
 /**************************************************************************
  *           NtClose
  */
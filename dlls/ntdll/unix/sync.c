@@ -1806,8 +1806,9 @@ NTSTATUS WINAPI NtRemoveIoCompletion( HANDLE handle, ULONG_PTR *key, ULONG_PTR *
 NTSTATUS WINAPI NtRemoveIoCompletionEx( HANDLE handle, FILE_IO_COMPLETION_INFORMATION *info, ULONG count,
                                         ULONG *written, LARGE_INTEGER *timeout, BOOLEAN alertable )
 {
+    completion_msg_t msgs[64];
     NTSTATUS status;
-    ULONG i = 0;
+    ULONG i = 0, j, n = 0, batch;
 
     TRACE( "%p %p %u %p %p %u\n", handle, info, count, written, timeout, alertable );
 
@@ -1815,20 +1816,26 @@ NTSTATUS WINAPI NtRemoveIoCompletionEx( HANDLE handle, FILE_IO_COMPLETION_INFORM
     {
         while (i < count)
         {
-            SERVER_START_REQ( remove_completion )
+            batch = min( count - i, ARRAY_SIZE(msgs) );
+            SERVER_START_REQ( remove_completions )
             {
                 req->handle = wine_server_obj_handle( handle );
+                wine_server_set_reply( req, msgs, batch * sizeof(*msgs) );
                 if (!(status = wine_server_call( req )))
                 {
-                    info[i].CompletionKey             = reply->ckey;
-                    info[i].CompletionValue           = reply->cvalue;
-                    info[i].IoStatusBlock.Information = reply->information;
-                    info[i].IoStatusBlock.u.Status    = reply->status;
+                    n = wine_server_reply_size( reply ) / sizeof(*msgs);
+                    for (j = 0; j < n; j++, i++)
+                    {
+                        info[i].CompletionKey             = msgs[j].ckey;
+                        info[i].CompletionValue           = msgs[j].cvalue;
+                        info[i].IoStatusBlock.Information = msgs[j].information;
+                        info[i].IoStatusBlock.u.Status    = msgs[j].status;
+                    }
                 }
             }
             SERVER_END_REQ;
-            if (status != STATUS_SUCCESS) break;
-            ++i;
+            /* a short reply means that the queue is empty now */
+            if (status != STATUS_SUCCESS || n < batch) break;
         }
         if (i || status != STATUS_PENDING)
         {
@@ -306,6 +306,7 @@ void CDECL exit_thread( int status )
     static void *prev_teb;
     TEB *teb;
 
+    uring_thread_exit();
     pthread_sigmask( SIG_BLOCK, &server_block_set, NULL );
 
     if ((teb = InterlockedExchangePointer( &prev_teb, NtCurrentTeb() )))
@@ -0,0 +1,555 @@
+/*
+ * io_uring based asynchronous file I/O
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#if 0
+#pragma makedep unix
+#endif
+
+#include "config.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef HAVE_SYS_MMAN_H
+# include <sys/mman.h>
+#endif
+#ifdef HAVE_SYS_SYSCALL_H
+# include <sys/syscall.h>
+#endif
+#ifdef HAVE_SYS_UIO_H
+# include <sys/uio.h>
+#endif
+#include <unistd.h>
+
+#include "ntstatus.h"
+#define WIN32_NO_STATUS
+#define NONAMELESSUNION
+#include "windef.h"
+#include "winternl.h"
+#include "wine/list.h"
+#include "wine/debug.h"
+#include "wine/server.h"
+
+#include "unix_private.h"
+
+WINE_DEFAULT_DEBUG_CHANNEL(file);
+
+#ifdef __linux__
+
+#ifndef __NR_io_uring_setup
+#define __NR_io_uring_setup 425
+#endif
+#ifndef __NR_io_uring_enter
+#define __NR_io_uring_enter 426
+#endif
+
+/* kernel interface, see linux/io_uring.h */
+
+struct uring_sqe
+{
+    unsigned char  opcode;
+    unsigned char  flags;
+    unsigned short ioprio;
+    int            fd;
+    ULONGLONG      off;
+    ULONGLONG      addr;
+    unsigned int   len;
+    unsigned int   rw_flags;
+    ULONGLONG      user_data;
+    ULONGLONG      pad[3];
+};
+
+struct uring_cqe
+{
+    ULONGLONG      user_data;
+    int            res;
+    unsigned int   flags;
+};
+
+struct uring_params
+{
+    unsigned int   sq_entries;
+    unsigned int   cq_entries;
+    unsigned int   flags;
+    unsigned int   sq_thread_cpu;
+    unsigned int   sq_thread_idle;
+    unsigned int   features;
+    unsigned int   wq_fd;
+    unsigned int   resv[3];
+    struct
+    {
+        unsigned int head, tail, ring_mask, ring_entries, flags, dropped, array, resv1;
+        ULONGLONG    resv2;
+    } sq_off;
+    struct
+    {
+        unsigned int head, tail, ring_mask, ring_entries, overflow, cqes, flags, resv1;
+        ULONGLONG    resv2;
+    } cq_off;
+};
+
+#define URING_OP_READV          1
+#define URING_OP_WRITEV         2
+#define URING_OP_ASYNC_CANCEL   14
+#define URING_ENTER_GETEVENTS   1
+#define URING_OFF_SQ_RING       0
+#define URING_OFF_CQ_RING       0x8000000
+#define URING_OFF_SQES          0x10000000
+
+/* maximum number of requests in flight; further requests are done synchronously */
+#define URING_ENTRIES 128
+
+struct uring_op
+{
+    struct list       entry;     /* entry in the list of requests in flight */
+    struct iovec      iov;
+    IO_STATUS_BLOCK  *io;
+    HANDLE            handle;    /* handle passed by the caller, used to match cancel requests */
+    HANDLE            file;      /* duplicate of the file handle, for the completion port */
+    HANDLE            event;     /* duplicate of the event handle */
+    ULONG_PTR         cvalue;
+    ULONGLONG         offset;
+    DWORD             tid;       /* thread that submitted the request */
+    int               fd;
+    int               res;
+    BOOL              write;
+    BOOL              cancelled;
+};
+
+static struct
+{
+    int                fd;
+    unsigned int      *sq_head;
+    unsigned int      *sq_tail;
+    unsigned int       sq_mask;
+    unsigned int       sq_entries;
+    unsigned int      *sq_array;
+    struct uring_sqe  *sqes;
+    unsigned int      *cq_head;
+    unsigned int      *cq_tail;
+    unsigned int       cq_mask;
+    struct uring_cqe  *cqes;
+    struct list        ops;       /* requests in flight */
+    unsigned int       pending;   /* number of requests in flight */
+    HANDLE             bell;      /* server handle for the ring fd, polled for completions */
+    HANDLE             owner;     /* thread the doorbell async is bound to */
+    DWORD              owner_tid;
+} ring = { -1 };
+
+static pthread_mutex_t uring_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static NTSTATUS uring_bell_proc( void *user, IO_STATUS_BLOCK *io, NTSTATUS status );
+
+/* server async user data of the doorbell */
+static struct
+{
+    NTSTATUS (*callback)( void *user, IO_STATUS_BLOCK *io, NTSTATUS status );  /* must be the first field */
+    IO_STATUS_BLOCK io;
+} doorbell = { uring_bell_proc };
+
+static BOOL uring_setup(void)
+{
+    struct uring_params params;
+    char *sq_ptr, *cq_ptr;
+    size_t sq_size, cq_size;
+    void *sqes;
+    int fd;
+
+    memset( &params, 0, sizeof(params) );
+    if ((fd = syscall( __NR_io_uring_setup, URING_ENTRIES, &params )) == -1)
+    {
+        WARN( "io_uring not available, errno %d\n", errno );
+        return FALSE;
+    }
+
+    sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+    cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct uring_cqe);
+    sq_ptr = mmap( NULL, sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, URING_OFF_SQ_RING );
+    cq_ptr = mmap( NULL, cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, URING_OFF_CQ_RING );
+    sqes = mmap( NULL, params.sq_entries * sizeof(struct uring_sqe), PROT_READ | PROT_WRITE,
+                 MAP_SHARED | MAP_POPULATE, fd, URING_OFF_SQES );
+    if (sq_ptr == MAP_FAILED || cq_ptr == MAP_FAILED || sqes == MAP_FAILED)
+    {
+        ERR( "failed to map io_uring, errno %d\n", errno );
+        if (sq_ptr != MAP_FAILED) munmap( sq_ptr, sq_size );
+        if (cq_ptr != MAP_FAILED) munmap( cq_ptr, cq_size );
+        if (sqes != MAP_FAILED) munmap( sqes, params.sq_entries * sizeof(struct uring_sqe) );
+        close( fd );
+        return FALSE;
+    }
+
+    ring.sq_head    = (unsigned int *)(sq_ptr + params.sq_off.head);
+    ring.sq_tail    = (unsigned int *)(sq_ptr + params.sq_off.tail);
+    ring.sq_mask    = *(unsigned int *)(sq_ptr + params.sq_off.ring_mask);
+    ring.sq_entries = params.sq_entries;
+    ring.sq_array   = (unsigned int *)(sq_ptr + params.sq_off.array);
+    ring.sqes       = sqes;
+    ring.cq_head    = (unsigned int *)(cq_ptr + params.cq_off.head);
+    ring.cq_tail    = (unsigned int *)(cq_ptr + params.cq_off.tail);
+    ring.cq_mask    = *(unsigned int *)(cq_ptr + params.cq_off.ring_mask);
+    ring.cqes       = (struct uring_cqe *)(cq_ptr + params.cq_off.cqes);
+    ring.fd         = fd;
+    list_init( &ring.ops );
+    return TRUE;
+}
+
+/* returns TRUE if the io_uring engine is enabled; has to be called with uring_mutex held */
+static BOOL uring_init(void)
+{
+    static int enabled = -1;
+
+    if (enabled != -1) return enabled;
+
+    enabled = 0;
+    if (!getenv( "WINEIOURING" ) || !atoi( getenv( "WINEIOURING" ) )) return FALSE;
+    if (!uring_setup()) return FALSE;
+
+    TRACE( "io_uring enabled, fd %d\n", ring.fd );
+    enabled = 1;
+    return TRUE;
+}
+
+/* make sure that a live thread gets woken up for completions; has to be called with uring_mutex held */
+static BOOL uring_arm(void)
+{
+    static const LARGE_INTEGER zero;
+    HANDLE bell, thread;
+    NTSTATUS status;
+
+    if (ring.owner_tid == GetCurrentThreadId()) return TRUE;
+    if (ring.owner && NtWaitForSingleObject( ring.owner, FALSE, &zero ) == STATUS_TIMEOUT) return TRUE;
+
+    /* the server polls the ring fd, and queues the doorbell callback to the current
+     * thread whenever completions are available */
+    if (server_fd_to_handle( ring.fd, GENERIC_READ | SYNCHRONIZE, 0, &bell )) return FALSE;
+    if (NtDuplicateObject( NtCurrentProcess(), GetCurrentThread(), NtCurrentProcess(), &thread,
+                           SYNCHRONIZE, 0, 0 ))
+    {
+        NtClose( bell );
+        return FALSE;
+    }
+
+    SERVER_START_REQ( register_async )
+    {
+        req->type         = ASYNC_TYPE_READ;
+        req->count        = 0;
+        req->async.handle = wine_server_obj_handle( bell );
+        req->async.user   = wine_server_client_ptr( &doorbell );
+        req->async.iosb   = wine_server_client_ptr( &doorbell.io );
+        status = wine_server_call( req );
+    }
+    SERVER_END_REQ;
+
+    if (status != STATUS_PENDING)
+    {
+        ERR( "failed to register the io_uring doorbell, status %#x\n", status );
+        NtClose( bell );
+        NtClose( thread );
+        return FALSE;
+    }
+
+    /* closing the old handle terminates the async of the previous owner */
+    if (ring.bell) NtClose( ring.bell );
+    if (ring.owner) NtClose( ring.owner );
+    ring.bell      = bell;
+    ring.owner     = thread;
+    ring.owner_tid = GetCurrentThreadId();
+    TRACE( "doorbell %p bound to thread %04x\n", bell, ring.owner_tid );
+    return TRUE;
+}
+
+/* get a free submission entry; has to be called with uring_mutex held */
+static struct uring_sqe *uring_get_sqe(void)
+{
+    unsigned int tail = *ring.sq_tail;
+    struct uring_sqe *sqe;
+
+    if (tail - __atomic_load_n( ring.sq_head, __ATOMIC_ACQUIRE ) >= ring.sq_entries) return NULL;
+    sqe = &ring.sqes[tail & ring.sq_mask];
+    memset( sqe, 0, sizeof(*sqe) );
+    ring.sq_array[tail & ring.sq_mask] = tail & ring.sq_mask;
+    return sqe;
+}
+
+/* pass the entries filled by uring_get_sqe() to the kernel; has to be called with uring_mutex held */
+static void uring_submit( unsigned int count )
+{
+    int ret;
+
+    __atomic_store_n( ring.sq_tail, *ring.sq_tail + count, __ATOMIC_RELEASE );
+    while ((ret = syscall( __NR_io_uring_enter, ring.fd, count, 0, 0, NULL, 0 )) == -1 && errno == EINTR) ;
+    /* entries left in the ring are submitted by the next call */
+    if (ret == -1) WARN( "io_uring_enter failed, errno %d\n", errno );
+}
+
+/* move the finished requests to the done list; has to be called with uring_mutex held */
+static void uring_reap( struct list *done )
+{
+    unsigned int head = *ring.cq_head;
+    struct uring_cqe *cqe;
+    struct uring_op *op;
+
+    while (head != __atomic_load_n( ring.cq_tail, __ATOMIC_ACQUIRE ))
+    {
+        cqe = &ring.cqes[head++ & ring.cq_mask];
+        /* cancel requests don't carry an op */
+        if (!(op = (struct uring_op *)(ULONG_PTR)cqe->user_data)) continue;
+        op->res = cqe->res;
+        list_remove( &op->entry );
+        list_add_tail( done, &op->entry );
+        ring.pending--;
+    }
+    __atomic_store_n( ring.cq_head, head, __ATOMIC_RELEASE );
+}
+
+static void free_uring_op( struct uring_op *op )
+{
+    if (op->fd != -1) close( op->fd );
+    if (op->event) NtClose( op->event );
+    if (op->file) NtClose( op->file );
+    free( op );
+}
+
+static void uring_complete( struct uring_op *op )
+{
+    NTSTATUS status;
+    ULONG total = 0;
+    int res = op->res;
+
+    /* the kernel can't fault in write-watched or guard pages, retry the slow way */
+    if (res == -EFAULT)
+    {
+        if (op->write) res = pwrite( op->fd, op->iov.iov_base, op->iov.iov_len, op->offset );
+        else res = virtual_locked_pread( op->fd, op->iov.iov_base, op->iov.iov_len, op->offset );
+        if (res == -1) res = -errno;
+    }
+
+    if (res == -EFAULT && op->write) status = STATUS_INVALID_USER_BUFFER;
+    else if (res < 0 && op->cancelled) status = STATUS_CANCELLED;
+    else if (res < 0) status = errno_to_status( -res );
+    else
+    {
+        total = res;
+        status = (total || !op->iov.iov_len || op->write) ? STATUS_SUCCESS : STATUS_END_OF_FILE;
+    }
+
+    TRACE( "op %p completed, status %#x, %u bytes\n", op, status, total );
+    op->io->Information = total;
+    op->io->u.Status = status;
+    if (op->event) NtSetEvent( op->event, NULL );
+    if (op->cvalue) add_completion( op->file, op->cvalue, status, total, TRUE );
+    free_uring_op( op );
+}
+
+static void uring_complete_list( struct list *done )
+{
+    struct uring_op *op, *next;
+
+    LIST_FOR_EACH_ENTRY_SAFE( op, next, done, struct uring_op, entry ) uring_complete( op );
+}
+
+/* callback of the doorbell async, run in the owner thread when the ring fd is readable */
+static NTSTATUS uring_bell_proc( void *user, IO_STATUS_BLOCK *io, NTSTATUS status )
+{
+    struct list done = LIST_INIT( done );
+    sigset_t sigset;
+
+    /* the doorbell has been replaced, or its handle closed */
+    if (status != STATUS_ALERTED) return status;
+    if (ring.owner_tid != GetCurrentThreadId()) return STATUS_CANCELLED;
+
+    server_enter_uninterrupted_section( &uring_mutex, &sigset );
+    uring_reap( &done );
+    server_leave_uninterrupted_section( &uring_mutex, &sigset );
+
+    uring_complete_list( &done );
+    return STATUS_PENDING;
+}
+
+/***********************************************************************
+ *           uring_submit_rw
+ *
+ * Queue an asynchronous read or write of a regular file. The request is
+ * completed from the doorbell callback. Returns STATUS_NOT_SUPPORTED if
+ * the caller has to do the I/O itself.
+ */
+NTSTATUS uring_submit_rw( HANDLE handle, int fd, HANDLE event, ULONG_PTR cvalue, IO_STATUS_BLOCK *io,
+                          void *buffer, ULONG length, ULONGLONG offset, BOOL write )
+{
+    struct uring_sqe *sqe;
+    struct uring_op *op;
+    sigset_t sigset;
+
+    server_enter_uninterrupted_section( &uring_mutex, &sigset );
+    if (!uring_init() || ring.pending >= URING_ENTRIES)
+    {
+        server_leave_uninterrupted_section( &uring_mutex, &sigset );
+        return STATUS_NOT_SUPPORTED;
+    }
+    server_leave_uninterrupted_section( &uring_mutex, &sigset );
+
+    if (!(op = calloc( 1, sizeof(*op) ))) return STATUS_NOT_SUPPORTED;
+
+    /* the handles may be closed before the request completes, hold our own references */
+    if ((op->fd = dup( fd )) == -1 ||
+        (event && NtDuplicateObject( NtCurrentProcess(), event, NtCurrentProcess(), &op->event,
+                                     0, 0, DUPLICATE_SAME_ACCESS )) ||
+        (cvalue && NtDuplicateObject( NtCurrentProcess(), handle, NtCurrentProcess(), &op->file,
+                                      0, 0, DUPLICATE_SAME_ACCESS )))
+    {
+        free_uring_op( op );
+        return STATUS_NOT_SUPPORTED;
+    }
+    op->iov.iov_base = buffer;
+    op->iov.iov_len  = length;
+    op->io           = io;
+    op->handle       = handle;
+    op->cvalue       = cvalue;
+    op->offset       = offset;
+    op->tid          = GetCurrentThreadId();
+    op->write        = write;
+
+    if (event) NtResetEvent( event, NULL );
+    io->Information = 0;
+    io->u.Status = STATUS_PENDING;
+
+    server_enter_uninterrupted_section( &uring_mutex, &sigset );
+    if (ring.pending >= URING_ENTRIES || !uring_arm() || !(sqe = uring_get_sqe()))
+    {
+        server_leave_uninterrupted_section( &uring_mutex, &sigset );
+        free_uring_op( op );
+        return STATUS_NOT_SUPPORTED;
+    }
+    sqe->opcode    = write ? URING_OP_WRITEV : URING_OP_READV;
+    sqe->fd        = op->fd;
+    sqe->off       = offset;
+    sqe->addr      = (ULONG_PTR)&op->iov;
+    sqe->len       = 1;
+    sqe->user_data = (ULONG_PTR)op;
+    list_add_tail( &ring.ops, &op->entry );
+    ring.pending++;
+    uring_submit( 1 );
+    server_leave_uninterrupted_section( &uring_mutex, &sigset );
+
+    TRACE( "queued %s of %u bytes at %s, op %p\n", write ? "write" : "read", length,
+           wine_dbgstr_longlong(offset), op );
+    return STATUS_PENDING;
+}
+
+/***********************************************************************
+ *           uring_cancel
+ *
+ * Request cancellation of the requests in flight on a handle, optionally
+ * restricted to one IO_STATUS_BLOCK or to the current thread. The requests
+ * complete with STATUS_CANCELLED unless they have already finished.
+ */
+NTSTATUS uring_cancel( HANDLE handle, IO_STATUS_BLOCK *io, BOOL only_thread )
+{
+    struct uring_sqe *sqe;
+    struct uring_op *op;
+    unsigned int count = 0;
+    sigset_t sigset;
+
+    if (ring.fd == -1) return STATUS_NOT_FOUND;
+
+    server_enter_uninterrupted_section( &uring_mutex, &sigset );
+    LIST_FOR_EACH_ENTRY( op, &ring.ops, struct uring_op, entry )
+    {
+        if (op->handle != handle || op->cancelled) continue;
+        if (io && op->io != io) continue;
+        if (only_thread && op->tid != GetCurrentThreadId()) continue;
+        if (!(sqe = uring_get_sqe())) break;
+        sqe->opcode = URING_OP_ASYNC_CANCEL;
+        sqe->addr   = (ULONG_PTR)op;
+        uring_submit( 1 );
+        op->cancelled = TRUE;
+        count++;
+    }
+    server_leave_uninterrupted_section( &uring_mutex, &sigset );
+
+    TRACE( "cancelling %u requests on %p\n", count, handle );
+    return count ? STATUS_SUCCESS : STATUS_NOT_FOUND;
+}
+
+/***********************************************************************
+ *           uring_thread_exit
+ *
+ * Called when a thread exits; if it owns the doorbell, complete the
+ * requests in flight here since nobody else is woken up for them.
+ */
+void uring_thread_exit(void)
+{
+    struct list done = LIST_INIT( done );
+    HANDLE bell, thread;
+    sigset_t sigset;
+
+    if (ring.fd == -1 || ring.owner_tid != GetCurrentThreadId()) return;
+
+    server_enter_uninterrupted_section( &uring_mutex, &sigset );
+    bell = ring.bell;
+    thread = ring.owner;
+    ring.bell = ring.owner = 0;
+    ring.owner_tid = 0;
+    server_leave_uninterrupted_section( &uring_mutex, &sigset );
+    NtClose( bell );
+    NtClose( thread );
+
+    for (;;)
+    {
+        server_enter_uninterrupted_section( &uring_mutex, &sigset );
+        /* stop once another thread has taken over the doorbell */
+        if (!ring.pending || ring.owner_tid)
+        {
+            server_leave_uninterrupted_section( &uring_mutex, &sigset );
+            break;
+        }
+        uring_reap( &done );
+        server_leave_uninterrupted_section( &uring_mutex, &sigset );
+
+        if (list_empty( &done ))
+        {
+            if (syscall( __NR_io_uring_enter, ring.fd, 0, 1, URING_ENTER_GETEVENTS, NULL, 0 ) == -1 &&
+                errno != EINTR)
+                ERR( "io_uring_enter failed, errno %d\n", errno );
+            continue;
+        }
+        uring_complete_list( &done );
+        list_init( &done );
+    }
+}
+
+#else  /* __linux__ */
+
+NTSTATUS uring_submit_rw( HANDLE handle, int fd, HANDLE event, ULONG_PTR cvalue, IO_STATUS_BLOCK *io,
+                          void *buffer, ULONG length, ULONGLONG offset, BOOL write )
+{
+    return STATUS_NOT_SUPPORTED;
+}
+
+NTSTATUS uring_cancel( HANDLE handle, IO_STATUS_BLOCK *io, BOOL only_thread )
+{
+    return STATUS_NOT_FOUND;
+}
+
+void uring_thread_exit(void)
+{
+}
+
+#endif  /* __linux__ */
@@ -245,27 +245,66 @@ void WINAPI mouse_event( DWORD dwFlags, DWORD dx, DWORD dy,
 }
 
 
+/* wait for a consistent snapshot of the desktop shared memory, see update_desktop_shared() */
+static inline unsigned int shared_read_begin( const desktop_shm_t *shared )
+{
+    unsigned int seq;
+
+    for (;;)
+    {
+        __WINE_ATOMIC_LOAD_ACQUIRE( &shared->seq, &seq );
+        if (!(seq & 1)) return seq;
+        NtYieldExecution();
+    }
+}
+
+static inline BOOL shared_read_retry( const desktop_shm_t *shared, unsigned int seq )
+{
+    unsigned int cur;
+
+    __WINE_ATOMIC_FENCE_ACQUIRE();  /* the data must be read before checking the sequence again */
+    __WINE_ATOMIC_LOAD_RELAXED( &shared->seq, &cur );
+    return cur != seq;
+}
+
+
 /***********************************************************************
  *		GetCursorPos (USER32.@)
  */
 BOOL WINAPI DECLSPEC_HOTPATCH GetCursorPos( POINT *pt )
 {
+    const desktop_shm_t *shared;
+    unsigned int seq;
     BOOL ret;
     DWORD last_change;
     UINT dpi;
 
     if (!pt) return FALSE;
 
-    SERVER_START_REQ( set_cursor )
+    if ((shared = get_desktop_shared_memory()))
     {
-        if ((ret = !wine_server_call( req )))
+        do
+        {
+            seq = shared_read_begin( shared );
+            pt->x = shared->cursor_x;
+            pt->y = shared->cursor_y;
+            last_change = shared->cursor_last_change;
+        } while (shared_read_retry( shared, seq ));
+        ret = TRUE;
+    }
+    else
+    {
+        SERVER_START_REQ( set_cursor )
         {
-            pt->x = reply->new_x;
-            pt->y = reply->new_y;
-            last_change = reply->last_change;
+            if ((ret = !wine_server_call( req )))
+            {
+                pt->x = reply->new_x;
+                pt->y = reply->new_y;
+                last_change = reply->last_change;
+            }
         }
+        SERVER_END_REQ;
     }
-    SERVER_END_REQ;
 
     /* query new position from graphics driver if we haven't updated recently */
     if (ret && GetTickCount() - last_change > 100) ret = USER_Driver->pGetCursorPos( pt );
@@ -395,6 +434,7 @@ SHORT WINAPI DECLSPEC_HOTPATCH GetAsyncKeyState( INT key )
 {
     struct user_key_state_info *key_state_info = get_user_thread_info()->key_state;
     INT counter = global_key_state_counter;
+    const desktop_shm_t *shared;
     BYTE prev_key_state;
     SHORT ret;
 
@@ -402,6 +442,13 @@ SHORT WINAPI DECLSPEC_HOTPATCH GetAsyncKeyState( INT key )
 
     check_for_events( QS_INPUT );
 
+    /* the server only needs to be involved to reset the pressed since last call flag */
+    if ((shared = get_desktop_shared_memory()))
+    {
+        BYTE state = shared->keystate[key];
+        if (!(state & 0x40)) return (state & 0x80) ? 0x8000 : 0;
+    }
+
     if (key_state_info && !(key_state_info->state[key] & 0xc0) &&
         key_state_info->counter == counter && GetTickCount() - key_state_info->time < 50)
     {
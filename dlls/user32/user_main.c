@@ -384,6 +384,8 @@ static void thread_detach(void)
     HeapFree( GetProcessHeap(), 0, thread_info->wmchar_data );
     HeapFree( GetProcessHeap(), 0, thread_info->key_state );
     HeapFree( GetProcessHeap(), 0, thread_info->rawinput );
+    if (thread_info->desktop_shm && thread_info->desktop_shm != DESKTOP_SHM_UNAVAILABLE)
+        UnmapViewOfFile( (void *)thread_info->desktop_shm );
 
     exiting_thread_id = 0;
 }
@@ -29,6 +29,7 @@
 #include "winreg.h"
 #include "winternl.h"
 #include "wine/heap.h"
+#include "wine/server_protocol.h"
 #include "wine/unicode.h"
 
 #define GET_WORD(ptr)  (*(const WORD *)(ptr))
@@ -203,8 +204,12 @@ struct user_thread_info
     HWND                          top_window;             /* Desktop window */
     HWND                          msg_window;             /* HWND_MESSAGE parent window */
     struct rawinput_thread_data  *rawinput;               /* RawInput thread local data / buffer */
+    const desktop_shm_t          *desktop_shm;            /* Shared memory of the thread desktop */
 };
 
+/* desktop_shm value when the thread desktop has no shared memory */
+#define DESKTOP_SHM_UNAVAILABLE ((const desktop_shm_t *)~(ULONG_PTR)0)
+
 C_ASSERT( sizeof(struct user_thread_info) <= sizeof(((TEB *)0)->Win32ClientInfo) );
 
 extern INT global_key_state_counter DECLSPEC_HIDDEN;
@@ -251,6 +256,7 @@ extern BOOL set_capture_window( HWND hwnd, UINT gui_flags, HWND *prev_ret ) DECL
 extern void free_dce( struct dce *dce, HWND hwnd ) DECLSPEC_HIDDEN;
 extern void invalidate_dce( struct tagWND *win, const RECT *rect ) DECLSPEC_HIDDEN;
 extern HDC get_display_dc(void) DECLSPEC_HIDDEN;
+extern const desktop_shm_t *get_desktop_shared_memory(void) DECLSPEC_HIDDEN;
 extern void release_display_dc( HDC hdc ) DECLSPEC_HIDDEN;
 extern void erase_now( HWND hwnd, UINT rdw_flags ) DECLSPEC_HIDDEN;
 extern void move_window_bits( HWND hwnd, struct window_surface *old_surface,
@@ -464,11 +464,48 @@ BOOL WINAPI SetThreadDesktop( HDESK handle )
         thread_info->top_window = 0;
         thread_info->msg_window = 0;
         if (key_state_info) key_state_info->time = 0;
+        if (thread_info->desktop_shm && thread_info->desktop_shm != DESKTOP_SHM_UNAVAILABLE)
+            UnmapViewOfFile( (void *)thread_info->desktop_shm );
+        thread_info->desktop_shm = NULL;
     }
     return ret;
 }
 
 
+/***********************************************************************
+ *              get_desktop_shared_memory
+ *
+ * Map the shared state of the thread desktop. Returns NULL if it's not available.
+ */
+const desktop_shm_t *get_desktop_shared_memory(void)
+{
+    struct user_thread_info *thread_info = get_user_thread_info();
+    HANDLE section = 0;
+
+    if (thread_info->desktop_shm == DESKTOP_SHM_UNAVAILABLE) return NULL;
+    if (thread_info->desktop_shm) return thread_info->desktop_shm;
+
+    SERVER_START_REQ( get_desktop_shared_memory )
+    {
+        if (!wine_server_call( req )) section = wine_server_ptr_handle( reply->handle );
+    }
+    SERVER_END_REQ;
+
+    /* don't ask again until the thread desktop changes */
+    if (section)
+    {
+        thread_info->desktop_shm = MapViewOfFile( section, FILE_MAP_READ, 0, 0, 0 );
+        CloseHandle( section );
+    }
+    if (!thread_info->desktop_shm)
+    {
+        thread_info->desktop_shm = DESKTOP_SHM_UNAVAILABLE;
+        return NULL;
+    }
+    return thread_info->desktop_shm;
+}
+
+
 /******************************************************************************
  *              EnumDesktopsA   (USER32.@)
  */
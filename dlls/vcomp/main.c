@@ -41,6 +41,7 @@ static DWORD   vcomp_context_tls = TLS_OUT_OF_INDEXES;
 static HMODULE vcomp_module;
 static int     vcomp_max_threads;
 static int     vcomp_num_threads;
+static int     vcomp_num_procs;
 static BOOL    vcomp_nested_fork = FALSE;
 
 static RTL_CRITICAL_SECTION vcomp_section;
@@ -57,6 +58,9 @@ static RTL_CRITICAL_SECTION vcomp_section = { &critsect_debug, -1, 0, 0, 0, 0 };
 #define VCOMP_DYNAMIC_FLAGS_GUIDED      0x03
 #define VCOMP_DYNAMIC_FLAGS_INCREMENT   0x40
 
+/* number of times to check for the barrier release before sleeping */
+#define VCOMP_BARRIER_SPIN_COUNT        4000
+
 struct vcomp_thread_data
 {
     struct vcomp_team_data  *team;
@@ -94,8 +98,18 @@ struct vcomp_team_data
     __ms_va_list            valist;
 
     /* barrier */
-    unsigned int            barrier;
-    int                     barrier_count;
+    unsigned int volatile   barrier;
+    LONG                    barrier_count;
+    LONG                    barrier_sleepers;
+};
+
+struct vcomp_dynamic_loop
+{
+    unsigned int            first;
+    unsigned int            last;
+    unsigned int            iterations;
+    int                     step;
+    unsigned int            chunksize;
 };
 
 struct vcomp_task_data
@@ -110,11 +124,11 @@ struct vcomp_task_data
 
     /* dynamic */
     unsigned int            dynamic;
-    unsigned int            dynamic_first;
-    unsigned int            dynamic_last;
-    unsigned int            dynamic_iterations;
-    int                     dynamic_step;
-    unsigned int            dynamic_chunksize;
+    /* generation of the current loop in the high part, dispensed iterations in the low part */
+    LONG64 volatile         dynamic_state;
+    /* loop parameters, indexed by the generation parity so that a new loop can be
+     * set up while late threads are still looking at the previous one */
+    struct vcomp_dynamic_loop dynamic_loop[2];
 };
 
 #if defined(__i386__)
@@ -270,6 +284,15 @@ static void CDECL _vcomp_fork_call_wrapper(void *wrapper, int nargs, __ms_va_lis
 
 #endif
 
+static inline void small_pause(void)
+{
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+    __asm__ __volatile__( "rep;nop" : : : "memory" );
+#elif defined(__GNUC__)
+    __asm__ __volatile__( "" : : : "memory" );
+#endif
+}
+
 #if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
 
 static inline char interlocked_cmpxchg8(char *dest, char xchg, char compare)
@@ -395,6 +418,7 @@ static struct vcomp_thread_data *vcomp_init_thread_data(void)
     data->task.single           = 0;
     data->task.section          = 0;
     data->task.dynamic          = 0;
+    data->task.dynamic_state    = 0;
 
     thread_data = &data->thread;
     thread_data->team           = NULL;
@@ -1041,25 +1065,43 @@ void CDECL _vcomp_flush(void)
 void CDECL _vcomp_barrier(void)
 {
     struct vcomp_team_data *team_data = vcomp_init_thread_data()->team;
+    unsigned int barrier;
+    int i;
 
     TRACE("()\n");
 
     if (!team_data)
         return;
 
-    EnterCriticalSection(&vcomp_section);
-    if (++team_data->barrier_count >= team_data->num_threads)
+    barrier = team_data->barrier;
+    if (InterlockedIncrement(&team_data->barrier_count) >= team_data->num_threads)
     {
-        team_data->barrier++;
         team_data->barrier_count = 0;
-        WakeAllConditionVariable(&team_data->cond);
+        InterlockedIncrement((LONG *)&team_data->barrier);
+        if (team_data->barrier_sleepers)
+        {
+            EnterCriticalSection(&vcomp_section);
+            WakeAllConditionVariable(&team_data->cond);
+            LeaveCriticalSection(&vcomp_section);
+        }
+        return;
     }
-    else
+
+    /* spinning only makes sense if the other threads can run meanwhile */
+    if (team_data->num_threads <= vcomp_num_procs)
     {
-        unsigned int barrier = team_data->barrier;
-        while (team_data->barrier == barrier)
-            SleepConditionVariableCS(&team_data->cond, &vcomp_section, INFINITE);
+        for (i = 0; i < VCOMP_BARRIER_SPIN_COUNT; i++)
+        {
+            if (team_data->barrier != barrier) return;
+            small_pause();
+        }
     }
+
+    EnterCriticalSection(&vcomp_section);
+    InterlockedIncrement(&team_data->barrier_sleepers);
+    while (team_data->barrier == barrier)
+        SleepConditionVariableCS(&team_data->cond, &vcomp_section, INFINITE);
+    InterlockedDecrement(&team_data->barrier_sleepers);
     LeaveCriticalSection(&vcomp_section);
 }
 
@@ -1086,20 +1128,17 @@ int CDECL _vcomp_single_begin(int flags)
 {
     struct vcomp_thread_data *thread_data = vcomp_init_thread_data();
     struct vcomp_task_data *task_data = thread_data->task;
-    int ret = FALSE;
+    unsigned int single;
 
     TRACE("(%x): semi-stub\n", flags);
 
-    EnterCriticalSection(&vcomp_section);
     thread_data->single++;
-    if ((int)(thread_data->single - task_data->single) > 0)
+    while ((int)(thread_data->single - (single = task_data->single)) > 0)
     {
-        task_data->single = thread_data->single;
-        ret = TRUE;
+        if (InterlockedCompareExchange((LONG *)&task_data->single, thread_data->single, single) == single)
+            return TRUE;
     }
-    LeaveCriticalSection(&vcomp_section);
-
-    return ret;
+    return FALSE;
 }
 
 void CDECL _vcomp_single_end(void)
@@ -1281,6 +1320,7 @@ void CDECL _vcomp_for_dynamic_init(unsigned int flags, unsigned int first, unsig
     int num_threads = team_data ? team_data->num_threads : 1;
     int thread_num = thread_data->thread_num;
     unsigned int type = flags & ~VCOMP_DYNAMIC_FLAGS_INCREMENT;
+    unsigned int dynamic;
 
     TRACE("(%u, %u, %u, %d, %u)\n", flags, first, last, step, chunksize);
 
@@ -1326,19 +1366,28 @@ void CDECL _vcomp_for_dynamic_init(unsigned int flags, unsigned int first, unsig
             type = VCOMP_DYNAMIC_FLAGS_GUIDED;
         }
 
-        EnterCriticalSection(&vcomp_section);
         thread_data->dynamic++;
         thread_data->dynamic_type = type;
-        if ((int)(thread_data->dynamic - task_data->dynamic) > 0)
+
+        /* the first thread to get here sets up the loop and publishes it */
+        while ((int)(thread_data->dynamic - (dynamic = task_data->dynamic)) > 0)
         {
-            task_data->dynamic              = thread_data->dynamic;
-            task_data->dynamic_first        = first;
-            task_data->dynamic_last         = last;
-            task_data->dynamic_iterations   = iterations;
-            task_data->dynamic_step         = step;
-            task_data->dynamic_chunksize    = chunksize;
+            if (InterlockedCompareExchange((LONG *)&task_data->dynamic, thread_data->dynamic, dynamic) == dynamic)
+            {
+                struct vcomp_dynamic_loop *loop = &task_data->dynamic_loop[thread_data->dynamic & 1];
+                LONG64 state;
+
+                loop->first        = first;
+                loop->last         = last;
+                loop->iterations   = iterations;
+                loop->step         = step;
+                loop->chunksize    = chunksize;
+                do state = task_data->dynamic_state;
+                while (InterlockedCompareExchange64(&task_data->dynamic_state,
+                                                    (LONG64)thread_data->dynamic << 32, state) != state);
+                break;
+            }
         }
-        LeaveCriticalSection(&vcomp_section);
     }
 }
 
@@ -1361,26 +1410,51 @@ int CDECL _vcomp_for_dynamic_next(unsigned int *begin, unsigned int *end)
     else if (thread_data->dynamic_type == VCOMP_DYNAMIC_FLAGS_CHUNKED ||
              thread_data->dynamic_type == VCOMP_DYNAMIC_FLAGS_GUIDED)
     {
-        unsigned int iterations = 0;
-        EnterCriticalSection(&vcomp_section);
-        if (thread_data->dynamic == task_data->dynamic &&
-            task_data->dynamic_iterations != 0)
+        const volatile struct vcomp_dynamic_loop *loop = &task_data->dynamic_loop[thread_data->dynamic & 1];
+        struct vcomp_dynamic_loop params;
+        unsigned int iterations, remaining, done;
+        LONG64 state;
+
+        for (;;)
         {
-            iterations = min(task_data->dynamic_iterations, task_data->dynamic_chunksize);
+            state = task_data->dynamic_state;
+            if ((int)(thread_data->dynamic - (unsigned int)(state >> 32)) > 0)
+            {
+                /* the loop is still being set up by another thread */
+                small_pause();
+                continue;
+            }
+            if ((unsigned int)(state >> 32) != thread_data->dynamic)
+                return 0;
+
+            /* a later loop may reuse the slot once we are done with this one,
+             * so only use a snapshot of the parameters; the state also changes
+             * when a new loop is published, so the snapshot belongs to our loop
+             * if the exchange below succeeds */
+            __WINE_ATOMIC_FENCE_ACQUIRE();
+            params = *loop;
+
+            done = (unsigned int)state;
+            if (done >= params.iterations)
+                return 0;
+
+            remaining  = params.iterations - done;
+            iterations = min(remaining, params.chunksize);
             if (thread_data->dynamic_type == VCOMP_DYNAMIC_FLAGS_GUIDED &&
-                task_data->dynamic_iterations > num_threads * task_data->dynamic_chunksize)
+                remaining > num_threads * params.chunksize)
             {
-                iterations = (task_data->dynamic_iterations + num_threads - 1) / num_threads;
+                iterations = (remaining + num_threads - 1) / num_threads;
             }
-            *begin = task_data->dynamic_first;
-            *end   = task_data->dynamic_first + (iterations - 1) * task_data->dynamic_step;
-            task_data->dynamic_iterations -= iterations;
-            task_data->dynamic_first      += iterations * task_data->dynamic_step;
-            if (!task_data->dynamic_iterations)
-                *end = task_data->dynamic_last;
+
+            if (InterlockedCompareExchange64(&task_data->dynamic_state, state + iterations, state) == state)
+                break;
         }
-        LeaveCriticalSection(&vcomp_section);
-        return iterations != 0;
+
+        *begin = params.first + done * params.step;
+        *end   = *begin + (iterations - 1) * params.step;
+        if (iterations == remaining)
+            *end = params.last;
+        return 1;
     }
 
     return 0;
@@ -1461,10 +1535,12 @@ void WINAPIV _vcomp_fork(BOOL ifval, int nargs, void *wrapper, ...)
     __ms_va_start(team_data.valist, wrapper);
     team_data.barrier           = 0;
     team_data.barrier_count     = 0;
+    team_data.barrier_sleepers  = 0;
 
     task_data.single            = 0;
     task_data.section           = 0;
     task_data.dynamic           = 0;
+    task_data.dynamic_state     = 0;
 
     thread_data.team            = &team_data;
     thread_data.task            = &task_data;
@@ -1680,6 +1756,7 @@ BOOL WINAPI DllMain(HINSTANCE instance, DWORD reason, LPVOID reserved)
             vcomp_module      = instance;
             vcomp_max_threads = sysinfo.dwNumberOfProcessors;
             vcomp_num_threads = sysinfo.dwNumberOfProcessors;
+            vcomp_num_procs   = sysinfo.dwNumberOfProcessors;
             break;
         }
 
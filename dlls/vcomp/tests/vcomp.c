@@ -1315,6 +1315,46 @@ static void test_vcomp_for_dynamic_init(void)
     pomp_set_num_threads(max_threads);
 }
 
+static void CDECL for_dynamic_nowait_cb(LONG *counts)
+{
+    unsigned int begin, end, i;
+    int loop;
+
+    /* back to back loops without barrier, late threads may still be in the previous one */
+    for (loop = 0; loop < 200; loop++)
+    {
+        p_vcomp_for_dynamic_init((loop & 1 ? VCOMP_DYNAMIC_FLAGS_GUIDED : VCOMP_DYNAMIC_FLAGS_CHUNKED) |
+                                 VCOMP_DYNAMIC_FLAGS_INCREMENT, 0, 999, 1, 3);
+        while (p_vcomp_for_dynamic_next(&begin, &end))
+        {
+            for (i = begin; i <= end; i++)
+                InterlockedIncrement(&counts[loop]);
+        }
+    }
+
+    for (loop = 0; loop < 1000; loop++)
+        p_vcomp_barrier();
+}
+
+static void test_vcomp_for_dynamic_nowait(void)
+{
+    int max_threads = pomp_get_max_threads();
+    static LONG counts[200];
+    int i, j;
+
+    for (i = 1; i <= 4; i++)
+    {
+        memset(counts, 0, sizeof(counts));
+        pomp_set_num_threads(i);
+        p_vcomp_fork(TRUE, 1, for_dynamic_nowait_cb, counts);
+
+        for (j = 0; j < ARRAY_SIZE(counts); j++)
+            ok(counts[j] == 1000, "%d threads: expected 1000 iterations in loop %d, got %d\n", i, j, counts[j]);
+    }
+
+    pomp_set_num_threads(max_threads);
+}
+
 static void CDECL master_cb(HANDLE semaphore)
 {
     int num_threads = pomp_get_num_threads();
@@ -2221,6 +2261,7 @@ START_TEST(vcomp)
     test_vcomp_for_static_simple_init();
     test_vcomp_for_static_init();
     test_vcomp_for_dynamic_init();
+    test_vcomp_for_dynamic_nowait();
     test_vcomp_master_begin();
     test_vcomp_single_begin();
     test_vcomp_enter_critsect();
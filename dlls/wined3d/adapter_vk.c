@@ -480,6 +480,101 @@ done:
     return success;
 }
 
+static UINT64 wined3d_adapter_vk_get_pipeline_cache_key(const struct wined3d_adapter_vk *adapter_vk)
+{
+    const struct wined3d_vk_info *vk_info = &adapter_vk->vk_info;
+    static const char tag[] = "VkPipelineCache";
+    VkPhysicalDeviceProperties properties;
+    UINT64 key;
+
+    VK_CALL(vkGetPhysicalDeviceProperties(adapter_vk->physical_device, &properties));
+
+    key = wined3d_shader_cache_hash(WINED3D_SHADER_CACHE_HASH_INIT, tag, sizeof(tag));
+    key = wined3d_shader_cache_hash(key, &properties.vendorID, sizeof(properties.vendorID));
+    key = wined3d_shader_cache_hash(key, &properties.deviceID, sizeof(properties.deviceID));
+    key = wined3d_shader_cache_hash(key, &properties.driverVersion, sizeof(properties.driverVersion));
+    return wined3d_shader_cache_hash(key, properties.pipelineCacheUUID, sizeof(properties.pipelineCacheUUID));
+}
+
+/* Create a pipeline cache from the entry for "key" in the shader cache. The
+ * implementation ignores initial data that doesn't match the device. */
+static VkResult wined3d_device_vk_load_pipeline_cache(struct wined3d_device_vk *device_vk,
+        UINT64 key, VkPipelineCache *vk_pipeline_cache)
+{
+    const struct wined3d_vk_info *vk_info = &device_vk->vk_info;
+    VkPipelineCacheCreateInfo cache_desc;
+    void *data = NULL;
+    SIZE_T size = 0;
+    VkResult vr;
+
+    if (wined3d_shader_cache_enabled())
+        data = wined3d_shader_cache_get(key, &size);
+
+    cache_desc.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    cache_desc.pNext = NULL;
+    cache_desc.flags = 0;
+    cache_desc.initialDataSize = size;
+    cache_desc.pInitialData = data;
+    vr = VK_CALL(vkCreatePipelineCache(device_vk->vk_device, &cache_desc, NULL, vk_pipeline_cache));
+
+    heap_free(data);
+
+    return vr;
+}
+
+static void wined3d_device_vk_create_pipeline_cache(struct wined3d_device_vk *device_vk,
+        const struct wined3d_adapter_vk *adapter_vk)
+{
+    VkResult vr;
+
+    if ((vr = wined3d_device_vk_load_pipeline_cache(device_vk,
+            wined3d_adapter_vk_get_pipeline_cache_key(adapter_vk), &device_vk->vk_pipeline_cache)) < 0)
+    {
+        WARN("Failed to create Vulkan pipeline cache, vr %s.\n", wined3d_debug_vkresult(vr));
+        device_vk->vk_pipeline_cache = VK_NULL_HANDLE;
+    }
+}
+
+static void wined3d_device_vk_destroy_pipeline_cache(struct wined3d_device_vk *device_vk)
+{
+    const struct wined3d_adapter_vk *adapter_vk = wined3d_adapter_vk_const(device_vk->d.adapter);
+    const struct wined3d_vk_info *vk_info = &device_vk->vk_info;
+    VkPipelineCache stored_cache;
+    void *data;
+    size_t size;
+    VkResult vr;
+    UINT64 key;
+
+    if (!device_vk->vk_pipeline_cache)
+        return;
+
+    if (wined3d_shader_cache_enabled())
+    {
+        key = wined3d_adapter_vk_get_pipeline_cache_key(adapter_vk);
+
+        /* Other devices may have stored their pipelines since this cache was
+         * created. Merge them in, so that storing ours doesn't drop them. */
+        if (wined3d_device_vk_load_pipeline_cache(device_vk, key, &stored_cache) == VK_SUCCESS)
+        {
+            if ((vr = VK_CALL(vkMergePipelineCaches(device_vk->vk_device,
+                    device_vk->vk_pipeline_cache, 1, &stored_cache))) < 0)
+                WARN("Failed to merge Vulkan pipeline caches, vr %s.\n", wined3d_debug_vkresult(vr));
+            VK_CALL(vkDestroyPipelineCache(device_vk->vk_device, stored_cache, NULL));
+        }
+
+        if (VK_CALL(vkGetPipelineCacheData(device_vk->vk_device, device_vk->vk_pipeline_cache, &size, NULL))
+                == VK_SUCCESS && size && (data = heap_alloc(size)))
+        {
+            if (VK_CALL(vkGetPipelineCacheData(device_vk->vk_device,
+                    device_vk->vk_pipeline_cache, &size, data)) == VK_SUCCESS)
+                wined3d_shader_cache_put(key, data, size);
+            heap_free(data);
+        }
+    }
+
+    VK_CALL(vkDestroyPipelineCache(device_vk->vk_device, device_vk->vk_pipeline_cache, NULL));
+}
+
 static HRESULT adapter_vk_create_device(struct wined3d *wined3d, const struct wined3d_adapter *adapter,
         enum wined3d_device_type device_type, HWND focus_window, unsigned int flags, BYTE surface_alignment,
         const enum wined3d_feature_level *levels, unsigned int level_count,
@@ -597,6 +692,8 @@ static HRESULT adapter_vk_create_device(struct wined3d *wined3d, const struct wi
         goto fail;
     }
 
+    wined3d_device_vk_create_pipeline_cache(device_vk, adapter_vk);
+
     *device = &device_vk->d;
 
     return WINED3D_OK;
@@ -614,6 +711,7 @@ static void adapter_vk_destroy_device(struct wined3d_device *device)
 
     wined3d_device_cleanup(&device_vk->d);
     wined3d_allocator_cleanup(&device_vk->allocator);
+    wined3d_device_vk_destroy_pipeline_cache(device_vk);
     VK_CALL(vkDestroyDevice(device_vk->vk_device, NULL));
     heap_free(device_vk);
 }
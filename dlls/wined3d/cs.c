@@ -21,6 +21,7 @@
 #include "wined3d_private.h"
 
 WINE_DEFAULT_DEBUG_CHANNEL(d3d);
+WINE_DECLARE_DEBUG_CHANNEL(d3d_perf);
 WINE_DECLARE_DEBUG_CHANNEL(fps);
 
 #define WINED3D_INITIAL_CS_SIZE 4096
@@ -68,6 +69,7 @@ enum wined3d_cs_op
     WINED3D_CS_OP_UNLOAD_RESOURCE,
     WINED3D_CS_OP_MAP,
     WINED3D_CS_OP_UNMAP,
+    WINED3D_CS_OP_UPLOAD_MAP,
     WINED3D_CS_OP_BLT_SUB_RESOURCE,
     WINED3D_CS_OP_UPDATE_SUB_RESOURCE,
     WINED3D_CS_OP_ADD_DIRTY_TEXTURE_REGION,
@@ -392,6 +394,16 @@ struct wined3d_cs_unmap
     HRESULT *hr;
 };
 
+struct wined3d_cs_upload_map
+{
+    enum wined3d_cs_op opcode;
+    struct wined3d_resource *resource;
+    unsigned int sub_resource_idx;
+    struct wined3d_box box;
+    DWORD flags;
+    struct wined3d_upload_data *upload;
+};
+
 struct wined3d_cs_blt_sub_resource
 {
     enum wined3d_cs_op opcode;
@@ -413,6 +425,7 @@ struct wined3d_cs_update_sub_resource
     unsigned int sub_resource_idx;
     struct wined3d_box box;
     struct wined3d_sub_resource_data data;
+    struct wined3d_upload_data *upload;
 };
 
 struct wined3d_cs_add_dirty_texture_region
@@ -535,6 +548,7 @@ static const char *debug_cs_op(enum wined3d_cs_op op)
         WINED3D_TO_STR(WINED3D_CS_OP_UNLOAD_RESOURCE);
         WINED3D_TO_STR(WINED3D_CS_OP_MAP);
         WINED3D_TO_STR(WINED3D_CS_OP_UNMAP);
+        WINED3D_TO_STR(WINED3D_CS_OP_UPLOAD_MAP);
         WINED3D_TO_STR(WINED3D_CS_OP_BLT_SUB_RESOURCE);
         WINED3D_TO_STR(WINED3D_CS_OP_UPDATE_SUB_RESOURCE);
         WINED3D_TO_STR(WINED3D_CS_OP_ADD_DIRTY_TEXTURE_REGION);
@@ -555,6 +569,35 @@ static void wined3d_cs_exec_nop(struct wined3d_cs *cs, const void *data)
 {
 }
 
+static LONGLONG wined3d_cs_get_time_us(void)
+{
+    LARGE_INTEGER counter, frequency;
+
+    QueryPerformanceCounter(&counter);
+    QueryPerformanceFrequency(&frequency);
+
+    return counter.QuadPart / frequency.QuadPart * 1000000
+            + counter.QuadPart % frequency.QuadPart * 1000000 / frequency.QuadPart;
+}
+
+static void wined3d_cs_report_stats(struct wined3d_cs *cs)
+{
+    struct wined3d_cs_stats *stats = &cs->stats;
+    DWORD time = GetTickCount();
+
+    /* every 1.5 seconds */
+    if (time - stats->prev_time <= 1500)
+        return;
+
+    TRACE_(d3d_perf)("cs %p: max queue depth %u bytes, application stalled %u us, "
+            "cs spun %u us, slept %u times, spin limits %u/%u.\n",
+            cs, InterlockedExchange(&stats->max_queue_depth, 0), InterlockedExchange(&stats->client_stall_us, 0),
+            stats->cs_spin_us, stats->cs_sleep_count, cs->spin.limit, cs->client_spin.limit);
+    stats->cs_spin_us = 0;
+    stats->cs_sleep_count = 0;
+    stats->prev_time = time;
+}
+
 static void wined3d_cs_exec_present(struct wined3d_cs *cs, const void *data)
 {
     struct wined3d_texture *logo_texture, *cursor_texture, *back_buffer;
@@ -633,6 +676,9 @@ static void wined3d_cs_exec_present(struct wined3d_cs *cs, const void *data)
         }
     }
 
+    if (TRACE_ON(d3d_perf))
+        wined3d_cs_report_stats(cs);
+
     wined3d_resource_release(&swapchain->front_buffer->resource);
     for (i = 0; i < desc->backbuffer_count; ++i)
     {
@@ -646,6 +692,7 @@ void wined3d_cs_emit_present(struct wined3d_cs *cs, struct wined3d_swapchain *sw
         const RECT *src_rect, const RECT *dst_rect, HWND dst_window_override,
         unsigned int swap_interval, DWORD flags)
 {
+    struct wined3d_cs_wait wait = {0};
     struct wined3d_cs_present *op;
     unsigned int i;
     LONG pending;
@@ -673,9 +720,10 @@ void wined3d_cs_emit_present(struct wined3d_cs *cs, struct wined3d_swapchain *sw
      * ahead of the worker thread. */
     while (pending >= swapchain->max_frame_latency)
     {
-        wined3d_pause();
+        wined3d_cs_wait(cs, &wait);
         pending = InterlockedCompareExchange(&cs->pending_presents, 0, 0);
     }
+    wined3d_cs_wait_done(cs, &wait);
 }
 
 static void wined3d_cs_exec_clear(struct wined3d_cs *cs, const void *data)
@@ -2222,6 +2270,200 @@ static void wined3d_cs_exec_map(struct wined3d_cs *cs, const void *data)
             op->sub_resource_idx, op->map_desc, op->box, op->flags);
 }
 
+struct wined3d_upload_data *wined3d_upload_data_create(unsigned int size)
+{
+    struct wined3d_upload_data *upload;
+
+    if (!(upload = heap_alloc(sizeof(*upload) + size + RESOURCE_ALIGNMENT - 1)))
+        return NULL;
+
+    upload->refcount = 1;
+    upload->size = size;
+    upload->data = (BYTE *)(((ULONG_PTR)(upload + 1) + RESOURCE_ALIGNMENT - 1) & ~(RESOURCE_ALIGNMENT - 1));
+
+    return upload;
+}
+
+void wined3d_upload_data_decref(struct wined3d_upload_data *upload)
+{
+    if (!InterlockedDecrement(&upload->refcount))
+        heap_free(upload);
+}
+
+void wined3d_resource_free_client_uploads(struct wined3d_resource *resource)
+{
+    unsigned int i;
+
+    for (i = 0; i < ARRAY_SIZE(resource->client.upload) && resource->client.upload[i]; ++i)
+    {
+        wined3d_upload_data_decref(resource->client.upload[i]);
+        resource->client.upload[i] = NULL;
+    }
+}
+
+static BOOL wined3d_upload_data_is_idle(struct wined3d_upload_data *upload)
+{
+    return InterlockedCompareExchange(&upload->refcount, 0, 0) == 1;
+}
+
+static BOOL wined3d_cs_is_client_thread(const struct wined3d_cs *cs)
+{
+    return cs->thread && cs->thread_id != GetCurrentThreadId();
+}
+
+/* Drop the client side copies of the resource contents, after an operation
+ * that may modify them on the CS thread. */
+static void wined3d_cs_invalidate_client_data(struct wined3d_cs *cs, struct wined3d_resource *resource)
+{
+    if (!resource || !wined3d_cs_is_client_thread(cs))
+        return;
+
+    wined3d_resource_free_client_uploads(resource);
+}
+
+static void wined3d_cs_exec_upload_map(struct wined3d_cs *cs, const void *data)
+{
+    const struct wined3d_cs_upload_map *op = data;
+    struct wined3d_resource *resource = op->resource;
+    const struct wined3d_box *box = &op->box;
+    struct wined3d_map_desc map_desc;
+    HRESULT hr;
+
+    if (SUCCEEDED(hr = resource->resource_ops->resource_sub_resource_map(resource,
+            op->sub_resource_idx, &map_desc, box, op->flags)))
+    {
+        memcpy(map_desc.data, op->upload->data + box->left, box->right - box->left);
+        resource->resource_ops->resource_sub_resource_unmap(resource, op->sub_resource_idx);
+    }
+    else
+    {
+        ERR("Failed to map resource %p, hr %#x.\n", resource, hr);
+    }
+
+    wined3d_upload_data_decref(op->upload);
+    wined3d_resource_release(resource);
+}
+
+/* Returns a copy of the buffer contents the client can write to for a
+ * DISCARD map. Copies the CS thread is done with are recycled; once
+ * WINED3D_CLIENT_UPLOAD_COUNT copies are in flight, wait for them instead of
+ * allocating more. */
+static struct wined3d_upload_data *wined3d_cs_get_discard_upload(struct wined3d_resource *resource)
+{
+    struct wined3d_upload_data **uploads = resource->client.upload, *upload;
+    unsigned int i;
+
+    for (i = 0; i < WINED3D_CLIENT_UPLOAD_COUNT; ++i)
+    {
+        if (!uploads[i])
+        {
+            if (!(uploads[i] = wined3d_upload_data_create(resource->size)))
+                return NULL;
+            break;
+        }
+        if (wined3d_upload_data_is_idle(uploads[i]))
+            break;
+    }
+
+    if (i == WINED3D_CLIENT_UPLOAD_COUNT)
+    {
+        TRACE("All copies of resource %p are in use, waiting.\n", resource);
+        wined3d_resource_wait_idle(resource);
+        i = 1;
+    }
+
+    upload = uploads[i];
+    uploads[i] = uploads[0];
+    uploads[0] = upload;
+
+    return upload;
+}
+
+/* Map dynamic buffers for DISCARD and NOOVERWRITE writes without waiting for
+ * the CS thread. The application writes to a client side copy of the buffer,
+ * and only the mapped range is uploaded, in order with the other commands,
+ * when it is unmapped. A DISCARD map switches to a copy the CS thread isn't
+ * using, and NOOVERWRITE maps write to the current copy. */
+BOOL wined3d_cs_map_upload(struct wined3d_cs *cs, struct wined3d_resource *resource, unsigned int sub_resource_idx,
+        struct wined3d_map_desc *map_desc, const struct wined3d_box *box, unsigned int flags)
+{
+    struct wined3d_upload_data *upload;
+    struct wined3d_box range;
+
+    if (!wined3d_cs_is_client_thread(cs))
+        return FALSE;
+
+    if (resource->type != WINED3D_RTYPE_BUFFER || sub_resource_idx || resource->client.map_count)
+        return FALSE;
+
+    if ((flags & WINED3D_MAP_READ) || !(flags & (WINED3D_MAP_DISCARD | WINED3D_MAP_NOOVERWRITE)))
+        return FALSE;
+
+    if (resource->bind_flags & (WINED3D_BIND_STREAM_OUTPUT | WINED3D_BIND_UNORDERED_ACCESS))
+        return FALSE;
+
+    if (resource->size > WINED3D_CS_UPLOAD_COPY_MAX)
+        return FALSE;
+
+    /* A d3d9 lock with a zero size maps the rest of the buffer. */
+    if (!box)
+        wined3d_box_set(&range, 0, 0, resource->size, 1, 0, 1);
+    else if (box->right <= box->left)
+        wined3d_box_set(&range, box->left, 0, resource->size, 1, 0, 1);
+    else
+        range = *box;
+    if (range.left >= range.right || range.right > resource->size)
+        return FALSE;
+
+    if (flags & WINED3D_MAP_DISCARD)
+    {
+        if (!(upload = wined3d_cs_get_discard_upload(resource)))
+            return FALSE;
+    }
+    else if (!(upload = resource->client.upload[0]))
+    {
+        return FALSE;
+    }
+
+    TRACE("Mapping resource %p from the client side, range %s, flags %#x.\n",
+            resource, debug_box(&range), flags);
+
+    resource->client.box = range;
+    resource->client.flags = flags;
+    resource->client.map_count = 1;
+
+    map_desc->row_pitch = map_desc->slice_pitch = resource->size;
+    map_desc->data = upload->data + range.left;
+
+    return TRUE;
+}
+
+static BOOL wined3d_cs_unmap_upload(struct wined3d_cs *cs, struct wined3d_resource *resource,
+        unsigned int sub_resource_idx)
+{
+    struct wined3d_cs_upload_map *op;
+
+    if (sub_resource_idx || !resource->client.map_count || !wined3d_cs_is_client_thread(cs))
+        return FALSE;
+
+    resource->client.map_count = 0;
+
+    op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT);
+    op->opcode = WINED3D_CS_OP_UPLOAD_MAP;
+    op->resource = resource;
+    op->sub_resource_idx = sub_resource_idx;
+    op->box = resource->client.box;
+    op->flags = resource->client.flags;
+    op->upload = resource->client.upload[0];
+    InterlockedIncrement(&op->upload->refcount);
+
+    wined3d_resource_acquire(resource);
+
+    wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
+
+    return TRUE;
+}
+
 HRESULT wined3d_cs_map(struct wined3d_cs *cs, struct wined3d_resource *resource, unsigned int sub_resource_idx,
         struct wined3d_map_desc *map_desc, const struct wined3d_box *box, unsigned int flags)
 {
@@ -2232,6 +2474,9 @@ HRESULT wined3d_cs_map(struct wined3d_cs *cs, struct wined3d_resource *resource,
      * increasing the map count would be visible to applications. */
     wined3d_not_from_cs(cs);
 
+    if (flags & WINED3D_MAP_WRITE)
+        wined3d_cs_invalidate_client_data(cs, resource);
+
     op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_MAP);
     op->opcode = WINED3D_CS_OP_MAP;
     op->resource = resource;
@@ -2262,6 +2507,9 @@ HRESULT wined3d_cs_unmap(struct wined3d_cs *cs, struct wined3d_resource *resourc
 
     wined3d_not_from_cs(cs);
 
+    if (wined3d_cs_unmap_upload(cs, resource, sub_resource_idx))
+        return WINED3D_OK;
+
     op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_MAP);
     op->opcode = WINED3D_CS_OP_UNMAP;
     op->resource = resource;
@@ -2382,6 +2630,8 @@ void wined3d_cs_emit_blt_sub_resource(struct wined3d_cs *cs, struct wined3d_reso
 {
     struct wined3d_cs_blt_sub_resource *op;
 
+    wined3d_cs_invalidate_client_data(cs, dst_resource);
+
     op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT);
     op->opcode = WINED3D_CS_OP_BLT_SUB_RESOURCE;
     op->dst_resource = dst_resource;
@@ -2462,14 +2712,63 @@ static void wined3d_cs_exec_update_sub_resource(struct wined3d_cs *cs, const voi
 done:
     context_release(context);
 
+    if (op->upload)
+        wined3d_upload_data_decref(op->upload);
     wined3d_resource_release(resource);
 }
 
+static unsigned int wined3d_cs_get_update_size(const struct wined3d_resource *resource,
+        const struct wined3d_box *box, unsigned int row_pitch, unsigned int slice_pitch)
+{
+    unsigned int row_size, rows_size;
+
+    if (resource->type == WINED3D_RTYPE_BUFFER)
+        return box->right - box->left;
+
+    wined3d_format_calculate_pitch(resource->format, 1, box->right - box->left,
+            box->bottom - box->top, &row_size, &rows_size);
+    if (!row_size)
+        return 0;
+
+    return (box->back - box->front - 1) * slice_pitch + (rows_size / row_size - 1) * row_pitch + row_size;
+}
+
 void wined3d_cs_emit_update_sub_resource(struct wined3d_cs *cs, struct wined3d_resource *resource,
         unsigned int sub_resource_idx, const struct wined3d_box *box, const void *data, unsigned int row_pitch,
         unsigned int slice_pitch)
 {
     struct wined3d_cs_update_sub_resource *op;
+    struct wined3d_upload_data *upload;
+    unsigned int size;
+
+    wined3d_cs_invalidate_client_data(cs, resource);
+
+    /* Copy the data when it's not too large, so that the update can be
+     * executed in order with the other commands without waiting for it. */
+    if (wined3d_cs_is_client_thread(cs)
+            && (size = wined3d_cs_get_update_size(resource, box, row_pitch, slice_pitch))
+            && size <= WINED3D_CS_UPLOAD_COPY_MAX
+            && (upload = wined3d_upload_data_create(size)))
+    {
+        memcpy(upload->data, data, size);
+
+        op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT);
+        op->opcode = WINED3D_CS_OP_UPDATE_SUB_RESOURCE;
+        op->resource = resource;
+        op->sub_resource_idx = sub_resource_idx;
+        op->box = *box;
+        op->data.row_pitch = row_pitch;
+        op->data.slice_pitch = slice_pitch;
+        op->data.data = upload->data;
+        op->upload = upload;
+
+        wined3d_resource_acquire(resource);
+
+        wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
+        return;
+    }
+
+    wined3d_resource_wait_idle(resource);
 
     op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_MAP);
     op->opcode = WINED3D_CS_OP_UPDATE_SUB_RESOURCE;
@@ -2479,6 +2778,7 @@ void wined3d_cs_emit_update_sub_resource(struct wined3d_cs *cs, struct wined3d_r
     op->data.row_pitch = row_pitch;
     op->data.slice_pitch = slice_pitch;
     op->data.data = data;
+    op->upload = NULL;
 
     wined3d_resource_acquire(resource);
 
@@ -2570,6 +2870,8 @@ void wined3d_cs_emit_copy_uav_counter(struct wined3d_cs *cs, struct wined3d_buff
 {
     struct wined3d_cs_copy_uav_counter *op;
 
+    wined3d_cs_invalidate_client_data(cs, &dst_buffer->resource);
+
     op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT);
     op->opcode = WINED3D_CS_OP_COPY_UAV_COUNTER;
     op->buffer = dst_buffer;
@@ -2786,6 +3088,7 @@ static void (* const wined3d_cs_op_handlers[])(struct wined3d_cs *cs, const void
     /* WINED3D_CS_OP_UNLOAD_RESOURCE             */ wined3d_cs_exec_unload_resource,
     /* WINED3D_CS_OP_MAP                         */ wined3d_cs_exec_map,
     /* WINED3D_CS_OP_UNMAP                       */ wined3d_cs_exec_unmap,
+    /* WINED3D_CS_OP_UPLOAD_MAP                  */ wined3d_cs_exec_upload_map,
     /* WINED3D_CS_OP_BLT_SUB_RESOURCE            */ wined3d_cs_exec_blt_sub_resource,
     /* WINED3D_CS_OP_UPDATE_SUB_RESOURCE         */ wined3d_cs_exec_update_sub_resource,
     /* WINED3D_CS_OP_ADD_DIRTY_TEXTURE_REGION    */ wined3d_cs_exec_add_dirty_texture_region,
@@ -2862,17 +3165,89 @@ static BOOL wined3d_cs_queue_is_empty(const struct wined3d_cs *cs, const struct
     return *(volatile LONG *)&queue->head == queue->tail;
 }
 
+static void wined3d_cs_spin_init(struct wined3d_cs_spin *spin)
+{
+    spin->limit = wined3d_settings.cs_spin_count;
+    spin->average = spin->limit / 2;
+}
+
+static void wined3d_cs_spin_update(struct wined3d_cs_spin *spin, unsigned int spin_count, BOOL slept)
+{
+    unsigned int max = wined3d_settings.cs_spin_count;
+
+    if (slept)
+        spin->average -= spin->average / 8;
+    else if (spin_count > spin->average)
+        spin->average += (spin_count - spin->average) / 8;
+    else
+        spin->average -= (spin->average - spin_count) / 8;
+
+    if (max < WINED3D_CS_SPIN_COUNT_MIN || spin->average > (max - WINED3D_CS_SPIN_COUNT_MIN) / 2)
+        spin->limit = max;
+    else
+        spin->limit = 2 * spin->average + WINED3D_CS_SPIN_COUNT_MIN;
+}
+
+/* Wait for the CS thread to make progress. Callers check their condition
+ * between calls, and call wined3d_cs_wait_done() once it is met. */
+void wined3d_cs_wait(struct wined3d_cs *cs, struct wined3d_cs_wait *wait)
+{
+    static const LONG waiting = TRUE;
+
+    if (!wait->spin_count && TRACE_ON(d3d_perf))
+        wait->start = wined3d_cs_get_time_us();
+
+    if (++wait->spin_count < cs->client_spin.limit)
+    {
+        wined3d_pause();
+        return;
+    }
+
+    /* Ask the CS thread to wake us up when it retires its next packet, and
+     * let the caller check its condition once more before sleeping, since
+     * the CS thread may have made progress before the request was visible. */
+    if (!wait->armed)
+    {
+        InterlockedExchange(&cs->waiting_for_progress, TRUE);
+        wait->armed = TRUE;
+        return;
+    }
+
+    RtlWaitOnAddress(&cs->waiting_for_progress, &waiting, sizeof(waiting), NULL);
+    wait->armed = FALSE;
+    wait->slept = TRUE;
+}
+
+void wined3d_cs_wait_done(struct wined3d_cs *cs, struct wined3d_cs_wait *wait)
+{
+    if (!wait->spin_count)
+        return;
+
+    wined3d_cs_spin_update(&cs->client_spin, wait->spin_count, wait->slept);
+
+    if (TRACE_ON(d3d_perf))
+        InterlockedExchangeAdd(&cs->stats.client_stall_us, wined3d_cs_get_time_us() - wait->start);
+}
+
 static void wined3d_cs_queue_submit(struct wined3d_cs_queue *queue, struct wined3d_cs *cs)
 {
     struct wined3d_cs_packet *packet;
     size_t packet_size;
+    LONG depth;
 
     packet = (struct wined3d_cs_packet *)&queue->data[queue->head];
     packet_size = FIELD_OFFSET(struct wined3d_cs_packet, data[packet->size]);
     InterlockedExchange(&queue->head, (queue->head + packet_size) & (WINED3D_CS_QUEUE_SIZE - 1));
 
-    if (InterlockedCompareExchange(&cs->waiting_for_event, FALSE, TRUE))
-        SetEvent(cs->event);
+    if (InterlockedCompareExchange(&cs->waiting_for_work, FALSE, TRUE))
+        RtlWakeAddressSingle(&cs->waiting_for_work);
+
+    if (TRACE_ON(d3d_perf))
+    {
+        depth = (queue->head - *(volatile LONG *)&queue->tail) & (WINED3D_CS_QUEUE_SIZE - 1);
+        if (depth > cs->stats.max_queue_depth)
+            cs->stats.max_queue_depth = depth;
+    }
 }
 
 static void wined3d_cs_mt_submit(struct wined3d_cs *cs, enum wined3d_cs_queue_id queue_id)
@@ -2887,6 +3262,7 @@ static void *wined3d_cs_queue_require_space(struct wined3d_cs_queue *queue, size
 {
     size_t queue_size = ARRAY_SIZE(queue->data);
     size_t header_size, packet_size, remaining;
+    struct wined3d_cs_wait wait = {0};
     struct wined3d_cs_packet *packet;
 
     header_size = FIELD_OFFSET(struct wined3d_cs_packet, data[0]);
@@ -2938,7 +3314,9 @@ static void *wined3d_cs_queue_require_space(struct wined3d_cs_queue *queue, size
 
         TRACE("Waiting for free space. Head %u, tail %u, packet size %lu.\n",
                 head, tail, (unsigned long)packet_size);
+        wined3d_cs_wait(cs, &wait);
     }
+    wined3d_cs_wait_done(cs, &wait);
 
     packet = (struct wined3d_cs_packet *)&queue->data[queue->head];
     packet->size = size;
@@ -2955,11 +3333,14 @@ static void *wined3d_cs_mt_require_space(struct wined3d_cs *cs, size_t size, enu
 
 static void wined3d_cs_mt_finish(struct wined3d_cs *cs, enum wined3d_cs_queue_id queue_id)
 {
+    struct wined3d_cs_wait wait = {0};
+
     if (cs->thread_id == GetCurrentThreadId())
         return wined3d_cs_st_finish(cs, queue_id);
 
     while (cs->queue[queue_id].head != *(volatile LONG *)&cs->queue[queue_id].tail)
-        wined3d_pause();
+        wined3d_cs_wait(cs, &wait);
+    wined3d_cs_wait_done(cs, &wait);
 }
 
 static const struct wined3d_cs_ops wined3d_cs_mt_ops =
@@ -2985,23 +3366,33 @@ static void poll_queries(struct wined3d_cs *cs)
     }
 }
 
-static void wined3d_cs_wait_event(struct wined3d_cs *cs)
+static void wined3d_cs_wait_work(struct wined3d_cs *cs)
 {
-    InterlockedExchange(&cs->waiting_for_event, TRUE);
+    static const LONG waiting = TRUE;
+    LARGE_INTEGER timeout;
+
+    InterlockedExchange(&cs->waiting_for_work, TRUE);
 
     /* The main thread might have enqueued a command and blocked on it after
-     * the CS thread decided to enter wined3d_cs_wait_event(), but before
-     * "waiting_for_event" was set.
-     *
-     * Likewise, we can race with the main thread when resetting
-     * "waiting_for_event", in which case we would need to call
-     * WaitForSingleObject() because the main thread called SetEvent(). */
-    if (!(wined3d_cs_queue_is_empty(cs, &cs->queue[WINED3D_CS_QUEUE_DEFAULT])
+     * the CS thread decided to enter wined3d_cs_wait_work(), but before
+     * "waiting_for_work" was set. */
+    if (wined3d_cs_queue_is_empty(cs, &cs->queue[WINED3D_CS_QUEUE_DEFAULT])
             && wined3d_cs_queue_is_empty(cs, &cs->queue[WINED3D_CS_QUEUE_MAP]))
-            && InterlockedCompareExchange(&cs->waiting_for_event, FALSE, TRUE))
-        return;
+    {
+        /* Keep polling pending queries, at a lower rate. */
+        timeout.QuadPart = -10000;
+        RtlWaitOnAddress(&cs->waiting_for_work, &waiting, sizeof(waiting),
+                list_empty(&cs->query_poll_list) ? NULL : &timeout);
+    }
 
-    WaitForSingleObject(cs->event, INFINITE);
+    InterlockedExchange(&cs->waiting_for_work, FALSE);
+}
+
+static void wined3d_cs_wake_client(struct wined3d_cs *cs)
+{
+    if (*(volatile LONG *)&cs->waiting_for_progress
+            && InterlockedCompareExchange(&cs->waiting_for_progress, FALSE, TRUE))
+        RtlWakeAddressAll(&cs->waiting_for_progress);
 }
 
 static DWORD WINAPI wined3d_cs_run(void *ctx)
@@ -3010,6 +3401,7 @@ static DWORD WINAPI wined3d_cs_run(void *ctx)
     struct wined3d_cs_queue *queue;
     unsigned int spin_count = 0;
     struct wined3d_cs *cs = ctx;
+    LONGLONG spin_start = 0;
     enum wined3d_cs_op opcode;
     HMODULE wined3d_module;
     unsigned int poll = 0;
@@ -3037,12 +3429,30 @@ static DWORD WINAPI wined3d_cs_run(void *ctx)
             queue = &cs->queue[WINED3D_CS_QUEUE_DEFAULT];
             if (wined3d_cs_queue_is_empty(cs, queue))
             {
-                if (++spin_count >= WINED3D_CS_SPIN_COUNT && list_empty(&cs->query_poll_list))
-                    wined3d_cs_wait_event(cs);
+                if (!spin_count && TRACE_ON(d3d_perf))
+                    spin_start = wined3d_cs_get_time_us();
+                if (++spin_count >= cs->spin.limit)
+                {
+                    wined3d_cs_spin_update(&cs->spin, spin_count, TRUE);
+                    if (TRACE_ON(d3d_perf))
+                    {
+                        cs->stats.cs_spin_us += wined3d_cs_get_time_us() - spin_start;
+                        ++cs->stats.cs_sleep_count;
+                    }
+                    wined3d_cs_wait_work(cs);
+                    spin_count = 0;
+                }
                 continue;
             }
         }
-        spin_count = 0;
+
+        if (spin_count)
+        {
+            wined3d_cs_spin_update(&cs->spin, spin_count, FALSE);
+            if (TRACE_ON(d3d_perf))
+                cs->stats.cs_spin_us += wined3d_cs_get_time_us() - spin_start;
+            spin_count = 0;
+        }
 
         tail = queue->tail;
         packet = (struct wined3d_cs_packet *)&queue->data[tail];
@@ -3065,10 +3475,12 @@ static DWORD WINAPI wined3d_cs_run(void *ctx)
         tail += FIELD_OFFSET(struct wined3d_cs_packet, data[packet->size]);
         tail &= (WINED3D_CS_QUEUE_SIZE - 1);
         InterlockedExchange(&queue->tail, tail);
+        wined3d_cs_wake_client(cs);
     }
 
     cs->queue[WINED3D_CS_QUEUE_MAP].tail = cs->queue[WINED3D_CS_QUEUE_MAP].head;
-    cs->queue[WINED3D_CS_QUEUE_DEFAULT].tail = cs->queue[WINED3D_CS_QUEUE_DEFAULT].head;
+    InterlockedExchange(&cs->queue[WINED3D_CS_QUEUE_DEFAULT].tail, cs->queue[WINED3D_CS_QUEUE_DEFAULT].head);
+    wined3d_cs_wake_client(cs);
     TRACE("Stopped.\n");
     FreeLibraryAndExitThread(wined3d_module, 0);
 }
@@ -3083,6 +3495,8 @@ struct wined3d_cs *wined3d_cs_create(struct wined3d_device *device)
 
     cs->ops = &wined3d_cs_st_ops;
     cs->device = device;
+    wined3d_cs_spin_init(&cs->spin);
+    wined3d_cs_spin_init(&cs->client_spin);
 
     state_init(&cs->state, d3d_info, WINED3D_STATE_NO_REF | WINED3D_STATE_INIT_DEFAULT);
 
@@ -3095,18 +3509,10 @@ struct wined3d_cs *wined3d_cs_create(struct wined3d_device *device)
     {
         cs->ops = &wined3d_cs_mt_ops;
 
-        if (!(cs->event = CreateEventW(NULL, FALSE, FALSE, NULL)))
-        {
-            ERR("Failed to create command stream event.\n");
-            heap_free(cs->data);
-            goto fail;
-        }
-
         if (!(GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS,
                 (const WCHAR *)wined3d_cs_run, &cs->wined3d_module)))
         {
             ERR("Failed to get wined3d module handle.\n");
-            CloseHandle(cs->event);
             heap_free(cs->data);
             goto fail;
         }
@@ -3115,7 +3521,6 @@ struct wined3d_cs *wined3d_cs_create(struct wined3d_device *device)
         {
             ERR("Failed to create wined3d command stream thread.\n");
             FreeLibrary(cs->wined3d_module);
-            CloseHandle(cs->event);
             heap_free(cs->data);
             goto fail;
         }
@@ -3135,8 +3540,6 @@ void wined3d_cs_destroy(struct wined3d_cs *cs)
     {
         wined3d_cs_emit_stop(cs);
         CloseHandle(cs->thread);
-        if (!CloseHandle(cs->event))
-            ERR("Closing event failed.\n");
     }
 
     state_cleanup(&cs->state);
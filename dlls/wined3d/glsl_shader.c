@@ -34,6 +34,7 @@
 
 #include <limits.h>
 #include <stdio.h>
+#include <stdlib.h>
 #ifdef HAVE_FLOAT_H
 # include <float.h>
 #endif
@@ -144,6 +145,7 @@ struct shader_glsl_priv
     struct wine_rb_tree ffp_fragment_shaders;
     BOOL ffp_proj_control;
     BOOL legacy_lighting;
+    UINT64 program_cache_driver_key;
 };
 
 struct glsl_vs_program
@@ -642,6 +644,129 @@ void shader_glsl_validate_link(const struct wined3d_gl_info *gl_info, GLuint pro
     print_glsl_info_log(gl_info, program, TRUE);
 }
 
+static int glsl_program_cache_hash_compare(const void *a, const void *b)
+{
+    const UINT64 *h1 = a, *h2 = b;
+
+    return *h1 < *h2 ? -1 : *h1 > *h2;
+}
+
+/* Context activation is done by the caller. */
+static UINT64 shader_glsl_get_program_cache_key(const struct wined3d_gl_info *gl_info,
+        struct shader_glsl_priv *priv, GLuint program_id, unsigned int link_args)
+{
+    static const GLenum driver_strings[] = {GL_VENDOR, GL_RENDERER, GL_VERSION};
+    GLint i, shader_count, source_size = 0, length;
+    UINT64 hashes[8], key;
+    GLuint shaders[8];
+    const char *str;
+    char *source = NULL;
+
+    if (!priv->program_cache_driver_key)
+    {
+        key = WINED3D_SHADER_CACHE_HASH_INIT;
+        for (i = 0; i < ARRAY_SIZE(driver_strings); ++i)
+        {
+            if ((str = (const char *)gl_info->gl_ops.gl.p_glGetString(driver_strings[i])))
+                key = wined3d_shader_cache_hash(key, str, strlen(str));
+        }
+        priv->program_cache_driver_key = key;
+    }
+
+    /* The order of the attached shaders doesn't matter, and
+     * glGetAttachedShaders() doesn't guarantee any. */
+    GL_EXTCALL(glGetAttachedShaders(program_id, ARRAY_SIZE(shaders), &shader_count, shaders));
+    for (i = 0; i < shader_count; ++i)
+    {
+        hashes[i] = WINED3D_SHADER_CACHE_HASH_INIT;
+        GL_EXTCALL(glGetShaderiv(shaders[i], GL_SHADER_SOURCE_LENGTH, &length));
+        if (length > source_size)
+        {
+            heap_free(source);
+            if (!(source = heap_alloc(length)))
+            {
+                source_size = 0;
+                continue;
+            }
+            source_size = length;
+        }
+        GL_EXTCALL(glGetShaderSource(shaders[i], source_size, &length, source));
+        hashes[i] = wined3d_shader_cache_hash(hashes[i], source, length);
+    }
+    heap_free(source);
+    checkGLcall("get program sources");
+    qsort(hashes, shader_count, sizeof(*hashes), glsl_program_cache_hash_compare);
+
+    key = wined3d_shader_cache_hash(priv->program_cache_driver_key, hashes, shader_count * sizeof(*hashes));
+    return wined3d_shader_cache_hash(key, &link_args, sizeof(link_args));
+}
+
+/* Link "program_id", loading the program binary from the shader cache if
+ * possible. "link_args" contains any state besides the shader sources that
+ * affects the result of the link.
+ *
+ * Context activation is done by the caller. */
+static void shader_glsl_link_program(const struct wined3d_gl_info *gl_info, struct shader_glsl_priv *priv,
+        GLuint program_id, BOOL cacheable, unsigned int link_args)
+{
+    GLint binary_size, status = 0;
+    GLenum binary_format;
+    SIZE_T size;
+    GLsizei length;
+    BYTE *data;
+    UINT64 key;
+
+    if (!cacheable || !gl_info->supported[ARB_GET_PROGRAM_BINARY] || !wined3d_shader_cache_enabled())
+    {
+        TRACE("Linking GLSL shader program %u.\n", program_id);
+        GL_EXTCALL(glLinkProgram(program_id));
+        shader_glsl_validate_link(gl_info, program_id);
+        return;
+    }
+
+    key = shader_glsl_get_program_cache_key(gl_info, priv, program_id, link_args);
+    if ((data = wined3d_shader_cache_get(key, &size)))
+    {
+        if (size > sizeof(binary_format))
+        {
+            memcpy(&binary_format, data, sizeof(binary_format));
+            GL_EXTCALL(glProgramBinary(program_id, binary_format,
+                    data + sizeof(binary_format), size - sizeof(binary_format)));
+            GL_EXTCALL(glGetProgramiv(program_id, GL_LINK_STATUS, &status));
+            checkGLcall("glProgramBinary");
+        }
+        heap_free(data);
+
+        if (status)
+        {
+            TRACE("Loaded GLSL shader program %u from the shader cache.\n", program_id);
+            return;
+        }
+        /* E.g. after a driver update. The entry is replaced below. */
+        WARN("Failed to load GLSL shader program %u from the shader cache.\n", program_id);
+    }
+
+    TRACE("Linking GLSL shader program %u.\n", program_id);
+    GL_EXTCALL(glProgramParameteri(program_id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE));
+    GL_EXTCALL(glLinkProgram(program_id));
+    shader_glsl_validate_link(gl_info, program_id);
+
+    GL_EXTCALL(glGetProgramiv(program_id, GL_LINK_STATUS, &status));
+    GL_EXTCALL(glGetProgramiv(program_id, GL_PROGRAM_BINARY_LENGTH, &binary_size));
+    if (!status || binary_size <= 0 || !(data = heap_alloc(sizeof(binary_format) + binary_size)))
+        return;
+
+    GL_EXTCALL(glGetProgramBinary(program_id, binary_size, &length, &binary_format,
+            data + sizeof(binary_format)));
+    checkGLcall("glGetProgramBinary");
+    if (length > 0)
+    {
+        memcpy(data, &binary_format, sizeof(binary_format));
+        wined3d_shader_cache_put(key, data, sizeof(binary_format) + length);
+    }
+    heap_free(data);
+}
+
 static BOOL shader_glsl_use_layout_qualifier(const struct wined3d_gl_info *gl_info)
 {
     /* Layout qualifiers were introduced in GLSL 1.40. The Nvidia Legacy GPU
@@ -10128,9 +10253,7 @@ static HRESULT shader_glsl_compile_compute_shader(struct shader_glsl_priv *priv,
 
     list_add_head(&shader->linked_programs, &entry->cs.shader_entry);
 
-    TRACE("Linking GLSL shader program %u.\n", program_id);
-    GL_EXTCALL(glLinkProgram(program_id));
-    shader_glsl_validate_link(gl_info, program_id);
+    shader_glsl_link_program(gl_info, priv, program_id, TRUE, 0);
 
     GL_EXTCALL(glUseProgram(program_id));
     checkGLcall("glUseProgram");
@@ -10460,10 +10583,10 @@ static void set_glsl_shader_program(const struct wined3d_context_gl *context_gl,
         list_add_head(ps_list, &entry->ps.shader_entry);
     }
 
-    /* Link the program */
-    TRACE("Linking GLSL shader program %u.\n", program_id);
-    GL_EXTCALL(glLinkProgram(program_id));
-    shader_glsl_validate_link(gl_info, program_id);
+    /* Link the program. Transform feedback varyings aren't part of the
+     * shader sources, so those programs aren't cached. */
+    shader_glsl_link_program(gl_info, priv, program_id, !gshader || !gshader->u.gs.so_desc.element_count,
+            state->blend_state && state->blend_state->dual_source);
 
     shader_glsl_init_vs_uniform_locations(gl_info, priv, program_id, &entry->vs,
             vshader ? vshader->limits->constant_float : 0);
@@ -209,6 +209,7 @@ HRESULT resource_init(struct wined3d_resource *resource, struct wined3d_device *
     resource->resource_ops = resource_ops;
     resource->map_binding = WINED3D_LOCATION_SYSMEM;
     resource->heap_memory = NULL;
+    memset(&resource->client, 0, sizeof(resource->client));
 
     if (!(usage & WINED3DUSAGE_PRIVATE))
     {
@@ -254,6 +255,7 @@ void resource_cleanup(struct wined3d_resource *resource)
 
         device_resource_released(resource->device, resource);
     }
+    wined3d_resource_free_client_uploads(resource);
     wined3d_resource_acquire(resource);
     wined3d_cs_destroy_object(resource->device->cs, wined3d_resource_destroy_object, resource);
 }
@@ -371,6 +373,8 @@ HRESULT CDECL wined3d_resource_map(struct wined3d_resource *resource, unsigned i
     }
 
     flags = wined3d_resource_sanitise_map_flags(resource, flags);
+    if (wined3d_cs_map_upload(resource->device->cs, resource, sub_resource_idx, map_desc, box, flags))
+        return WINED3D_OK;
     wined3d_resource_wait_idle(resource);
 
     return wined3d_cs_map(resource->device->cs, resource, sub_resource_idx, map_desc, box, flags);
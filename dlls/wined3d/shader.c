@@ -26,11 +26,13 @@
 #include "wine/port.h"
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "wined3d_private.h"
 
 WINE_DEFAULT_DEBUG_CHANNEL(d3d_shader);
+WINE_DECLARE_DEBUG_CHANNEL(d3d_perf);
 
 const struct wined3d_vec4 wined3d_srgb_const[] =
 {
@@ -567,6 +569,306 @@ void string_buffer_list_cleanup(struct wined3d_string_buffer_list *list)
     list_init(&list->list);
 }
 
+#define WINED3D_SHADER_CACHE_MAGIC      0x43533357u /* "W3SC" */
+#define WINED3D_SHADER_CACHE_VERSION    1
+
+struct wined3d_shader_cache_header
+{
+    DWORD magic;
+    DWORD version;
+    UINT64 build_id;
+    UINT64 key;
+    UINT64 checksum;
+    UINT64 size;
+};
+
+struct wined3d_shader_cache_file
+{
+    char name[32];
+    ULONGLONG size;
+    FILETIME time;
+};
+
+static struct
+{
+    BOOL initialised;
+    BOOL enabled;
+    char path[MAX_PATH];
+    UINT64 build_id;
+    ULONGLONG size, max_size;
+    LONG hits, misses, stores, evictions;
+} shader_cache;
+
+static CRITICAL_SECTION shader_cache_cs;
+static CRITICAL_SECTION_DEBUG shader_cache_cs_debug =
+{
+    0, 0, &shader_cache_cs,
+    {&shader_cache_cs_debug.ProcessLocksList,
+    &shader_cache_cs_debug.ProcessLocksList},
+    0, 0, {(DWORD_PTR)(__FILE__ ": shader_cache_cs")}
+};
+static CRITICAL_SECTION shader_cache_cs = {&shader_cache_cs_debug, -1, 0, 0, 0, 0};
+
+/* FNV-1a. */
+UINT64 wined3d_shader_cache_hash(UINT64 hash, const void *data, SIZE_T size)
+{
+    const BYTE *ptr = data;
+
+    while (size--)
+    {
+        hash ^= *ptr++;
+        hash *= 0x100000001b3ull;
+    }
+
+    return hash;
+}
+
+static void shader_cache_get_entry_path(char *path, UINT64 key)
+{
+    snprintf(path, MAX_PATH, "%s\\%08x%08x.bin", shader_cache.path, (DWORD)(key >> 32), (DWORD)key);
+}
+
+static int shader_cache_file_compare(const void *a, const void *b)
+{
+    const struct wined3d_shader_cache_file *f1 = a, *f2 = b;
+
+    return CompareFileTime(&f1->time, &f2->time);
+}
+
+/* Recompute the size of the cache, and evict the least recently used
+ * entries when it exceeds the limit. Called with shader_cache_cs held. */
+static void shader_cache_trim(void)
+{
+    struct wined3d_shader_cache_file *files = NULL;
+    SIZE_T count = 0, capacity = 0, i;
+    WIN32_FIND_DATAA find_data;
+    char path[MAX_PATH];
+    ULONGLONG size = 0;
+    HANDLE find;
+
+    snprintf(path, sizeof(path), "%s\\*.bin", shader_cache.path);
+    if ((find = FindFirstFileA(path, &find_data)) == INVALID_HANDLE_VALUE)
+    {
+        shader_cache.size = 0;
+        return;
+    }
+
+    do
+    {
+        if (find_data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+            continue;
+        if (!wined3d_array_reserve((void **)&files, &capacity, count + 1, sizeof(*files)))
+            break;
+        lstrcpynA(files[count].name, find_data.cFileName, sizeof(files[count].name));
+        files[count].size = ((ULONGLONG)find_data.nFileSizeHigh << 32) | find_data.nFileSizeLow;
+        files[count].time = find_data.ftLastWriteTime;
+        size += files[count++].size;
+    } while (FindNextFileA(find, &find_data));
+    FindClose(find);
+
+    if (size > shader_cache.max_size)
+    {
+        qsort(files, count, sizeof(*files), shader_cache_file_compare);
+
+        /* Leave some room, so that we don't need to trim again on the next
+         * store. */
+        for (i = 0; i < count && size > shader_cache.max_size / 4 * 3; ++i)
+        {
+            snprintf(path, sizeof(path), "%s\\%s", shader_cache.path, files[i].name);
+            if (!DeleteFileA(path))
+                continue;
+            size -= files[i].size;
+            ++shader_cache.evictions;
+        }
+        TRACE("Trimmed shader cache to %s bytes.\n", wine_dbgstr_longlong(size));
+    }
+
+    shader_cache.size = size;
+    heap_free(files);
+}
+
+static BOOL shader_cache_create_directory(char *path)
+{
+    DWORD attributes;
+    char *p;
+
+    for (p = strchr(path, '\\'); p; p = strchr(p + 1, '\\'))
+    {
+        if (p == path || p[-1] == ':')
+            continue;
+        *p = 0;
+        CreateDirectoryA(path, NULL);
+        *p = '\\';
+    }
+    CreateDirectoryA(path, NULL);
+
+    attributes = GetFileAttributesA(path);
+    return attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_DIRECTORY);
+}
+
+/* Called with shader_cache_cs held. */
+static void shader_cache_init(void)
+{
+    static const char suffix[] = "\\wined3d\\shader_cache";
+    DWORD len;
+
+    if (!wined3d_settings.shader_cache)
+        return;
+
+    if (wined3d_settings.shader_cache_path)
+    {
+        lstrcpynA(shader_cache.path, wined3d_settings.shader_cache_path, sizeof(shader_cache.path));
+    }
+    else
+    {
+        len = GetEnvironmentVariableA("LOCALAPPDATA", shader_cache.path, sizeof(shader_cache.path));
+        if (!len || len + sizeof(suffix) > sizeof(shader_cache.path))
+        {
+            WARN("Failed to get the local application data directory.\n");
+            return;
+        }
+        strcat(shader_cache.path, suffix);
+    }
+
+    if (!shader_cache_create_directory(shader_cache.path))
+    {
+        WARN("Failed to create shader cache directory %s.\n", debugstr_a(shader_cache.path));
+        return;
+    }
+
+    /* Entries written by a different build are discarded. */
+    shader_cache.build_id = wined3d_shader_cache_hash(WINED3D_SHADER_CACHE_HASH_INIT,
+            PACKAGE_VERSION, sizeof(PACKAGE_VERSION));
+    shader_cache.max_size = (ULONGLONG)wined3d_settings.shader_cache_size << 20;
+    shader_cache_trim();
+    shader_cache.enabled = TRUE;
+
+    TRACE("Using shader cache %s, %s bytes.\n",
+            debugstr_a(shader_cache.path), wine_dbgstr_longlong(shader_cache.size));
+}
+
+BOOL wined3d_shader_cache_enabled(void)
+{
+    EnterCriticalSection(&shader_cache_cs);
+    if (!shader_cache.initialised)
+    {
+        shader_cache_init();
+        shader_cache.initialised = TRUE;
+    }
+    LeaveCriticalSection(&shader_cache_cs);
+
+    return shader_cache.enabled;
+}
+
+/* Returns a heap allocated copy of the entry for "key", or NULL. */
+void *wined3d_shader_cache_get(UINT64 key, SIZE_T *size)
+{
+    struct wined3d_shader_cache_header header;
+    LARGE_INTEGER file_size;
+    char path[MAX_PATH];
+    void *data = NULL;
+    FILETIME now;
+    HANDLE file;
+    DWORD count;
+
+    if (!wined3d_shader_cache_enabled())
+        return NULL;
+
+    shader_cache_get_entry_path(path, key);
+    if ((file = CreateFileA(path, GENERIC_READ | FILE_WRITE_ATTRIBUTES,
+            FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, 0, NULL)) == INVALID_HANDLE_VALUE)
+    {
+        TRACE("Shader cache miss for key %s.\n", wine_dbgstr_longlong(key));
+        InterlockedIncrement(&shader_cache.misses);
+        return NULL;
+    }
+
+    if (!GetFileSizeEx(file, &file_size)
+            || !ReadFile(file, &header, sizeof(header), &count, NULL) || count != sizeof(header)
+            || header.magic != WINED3D_SHADER_CACHE_MAGIC || header.version != WINED3D_SHADER_CACHE_VERSION
+            || header.build_id != shader_cache.build_id || header.key != key
+            || header.size != file_size.QuadPart - sizeof(header) || header.size > ~0u
+            || !(data = heap_alloc(header.size))
+            || !ReadFile(file, data, header.size, &count, NULL) || count != header.size
+            || wined3d_shader_cache_hash(WINED3D_SHADER_CACHE_HASH_INIT, data, header.size) != header.checksum)
+    {
+        WARN("Discarding invalid shader cache entry %s.\n", debugstr_a(path));
+        heap_free(data);
+        CloseHandle(file);
+        DeleteFileA(path);
+        InterlockedIncrement(&shader_cache.misses);
+        return NULL;
+    }
+
+    /* Trimming evicts the entries that were used least recently. */
+    GetSystemTimeAsFileTime(&now);
+    SetFileTime(file, NULL, NULL, &now);
+    CloseHandle(file);
+
+    TRACE("Shader cache hit for key %s, %s bytes.\n",
+            wine_dbgstr_longlong(key), wine_dbgstr_longlong(header.size));
+    InterlockedIncrement(&shader_cache.hits);
+    *size = header.size;
+    return data;
+}
+
+void wined3d_shader_cache_put(UINT64 key, const void *data, SIZE_T size)
+{
+    struct wined3d_shader_cache_header header;
+    char path[MAX_PATH], tmp_path[MAX_PATH];
+    HANDLE file;
+    DWORD count;
+    BOOL ret;
+
+    if (!wined3d_shader_cache_enabled() || size > shader_cache.max_size || size > ~0u)
+        return;
+
+    header.magic = WINED3D_SHADER_CACHE_MAGIC;
+    header.version = WINED3D_SHADER_CACHE_VERSION;
+    header.build_id = shader_cache.build_id;
+    header.key = key;
+    header.checksum = wined3d_shader_cache_hash(WINED3D_SHADER_CACHE_HASH_INIT, data, size);
+    header.size = size;
+
+    /* Write to a temporary file first, so that other processes never see
+     * partially written entries. */
+    shader_cache_get_entry_path(path, key);
+    snprintf(tmp_path, sizeof(tmp_path), "%s.%04x%04x.tmp", path, GetCurrentProcessId(), GetCurrentThreadId());
+    if ((file = CreateFileA(tmp_path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, 0, NULL)) == INVALID_HANDLE_VALUE)
+    {
+        WARN("Failed to create shader cache entry %s.\n", debugstr_a(tmp_path));
+        return;
+    }
+    ret = WriteFile(file, &header, sizeof(header), &count, NULL) && count == sizeof(header)
+            && WriteFile(file, data, size, &count, NULL) && count == size;
+    CloseHandle(file);
+
+    if (!ret || !MoveFileExA(tmp_path, path, MOVEFILE_REPLACE_EXISTING))
+    {
+        WARN("Failed to store shader cache entry %s.\n", debugstr_a(path));
+        DeleteFileA(tmp_path);
+        return;
+    }
+
+    TRACE("Stored shader cache entry for key %s, %s bytes.\n",
+            wine_dbgstr_longlong(key), wine_dbgstr_longlong(size));
+    InterlockedIncrement(&shader_cache.stores);
+
+    EnterCriticalSection(&shader_cache_cs);
+    if ((shader_cache.size += sizeof(header) + size) > shader_cache.max_size)
+        shader_cache_trim();
+    LeaveCriticalSection(&shader_cache_cs);
+}
+
+void wined3d_shader_cache_cleanup(void)
+{
+    if (!shader_cache.enabled)
+        return;
+
+    TRACE_(d3d_perf)("Shader cache: %u hits, %u misses, %u stores, %u evictions.\n",
+            shader_cache.hits, shader_cache.misses, shader_cache.stores, shader_cache.evictions);
+}
+
 /* Convert floating point offset relative to a register file to an absolute
  * offset for float constants. */
 static unsigned int shader_get_float_offset(enum wined3d_shader_register_type register_type, UINT register_idx)
@@ -119,6 +119,10 @@ struct wined3d_settings wined3d_settings =
     ~0u,            /* No CS shader model limit by default. */
     WINED3D_RENDERER_AUTO,
     WINED3D_SHADER_BACKEND_AUTO,
+    WINED3D_CS_SPIN_COUNT, /* Maximum number of iterations to spin before sleeping. */
+    FALSE,          /* Don't use the shader cache by default. */
+    256,            /* Limit the shader cache to 256 MiB. */
+    NULL,           /* Shader cache in the default location. */
 };
 
 struct wined3d * CDECL wined3d_create(DWORD flags)
@@ -260,6 +264,8 @@ static BOOL wined3d_dll_init(HINSTANCE hInstDLL)
     {
         if (!get_config_key_dword(hkey, appkey, "csmt", &wined3d_settings.cs_multithreaded))
             ERR_(winediag)("Setting multithreaded command stream to %#x.\n", wined3d_settings.cs_multithreaded);
+        if (!get_config_key_dword(hkey, appkey, "CSSpinCount", &wined3d_settings.cs_spin_count))
+            ERR_(winediag)("Setting command stream spin count to %u.\n", wined3d_settings.cs_spin_count);
         if (!get_config_key_dword(hkey, appkey, "MaxVersionGL", &tmpvalue))
         {
             ERR_(winediag)("Setting maximum allowed wined3d GL version to %u.%u.\n",
@@ -362,6 +368,19 @@ static BOOL wined3d_dll_init(HINSTANCE hInstDLL)
         }
         if (!get_config_key_dword(hkey, appkey, "strict_shader_math", &wined3d_settings.strict_shader_math))
             ERR_(winediag)("Setting strict shader math to %#x.\n", wined3d_settings.strict_shader_math);
+        if (!get_config_key_dword(hkey, appkey, "ShaderCache", &wined3d_settings.shader_cache))
+            ERR_(winediag)("Setting shader cache to %#x.\n", wined3d_settings.shader_cache);
+        if (!get_config_key_dword(hkey, appkey, "ShaderCacheSize", &wined3d_settings.shader_cache_size))
+            TRACE("Limiting shader cache size to %u MiB.\n", wined3d_settings.shader_cache_size);
+        if (!get_config_key(hkey, appkey, "ShaderCachePath", buffer, size))
+        {
+            size_t len = strlen(buffer) + 1;
+
+            if (!(wined3d_settings.shader_cache_path = heap_alloc(len)))
+                ERR("Failed to allocate shader cache path memory.\n");
+            else
+                memcpy(wined3d_settings.shader_cache_path, buffer, len);
+        }
         if (!get_config_key_dword(hkey, appkey, "MaxShaderModelVS", &wined3d_settings.max_sm_vs))
             TRACE("Limiting VS shader model to %u.\n", wined3d_settings.max_sm_vs);
         if (!get_config_key_dword(hkey, appkey, "MaxShaderModelHS", &wined3d_settings.max_sm_hs))
@@ -431,6 +450,8 @@ static BOOL wined3d_dll_destroy(HINSTANCE hInstDLL)
     }
     heap_free(hook_table.hooks);
 
+    wined3d_shader_cache_cleanup();
+    heap_free(wined3d_settings.shader_cache_path);
     heap_free(wined3d_settings.logo);
     UnregisterClassA(WINED3D_OPENGL_WINDOW_CLASS_NAME, hInstDLL);
 
@@ -439,6 +439,10 @@ struct wined3d_settings
     unsigned int max_sm_cs;
     enum wined3d_renderer renderer;
     enum wined3d_shader_backend shader_backend;
+    unsigned int cs_spin_count;
+    unsigned int shader_cache;
+    unsigned int shader_cache_size;
+    char *shader_cache_path;
 };
 
 extern struct wined3d_settings wined3d_settings DECLSPEC_HIDDEN;
@@ -3877,6 +3881,7 @@ struct wined3d_device_vk
     uint32_t timestamp_bits;
 
     struct wined3d_vk_info vk_info;
+    VkPipelineCache vk_pipeline_cache;
 
     struct wined3d_null_resources_vk null_resources_vk;
     struct wined3d_null_views_vk null_views_vk;
@@ -3925,6 +3930,21 @@ struct wined3d_resource_ops
     HRESULT (*resource_sub_resource_unmap)(struct wined3d_resource *resource, unsigned int sub_resource_idx);
 };
 
+/* Staging memory written by the application thread and read by the CS
+ * thread. Each pending upload holds a reference. */
+struct wined3d_upload_data
+{
+    LONG refcount;
+    unsigned int size;
+    BYTE *data;
+};
+
+#define WINED3D_CLIENT_UPLOAD_COUNT 4
+
+struct wined3d_upload_data *wined3d_upload_data_create(unsigned int size) DECLSPEC_HIDDEN;
+void wined3d_upload_data_decref(struct wined3d_upload_data *upload) DECLSPEC_HIDDEN;
+void wined3d_resource_free_client_uploads(struct wined3d_resource *resource) DECLSPEC_HIDDEN;
+
 struct wined3d_resource
 {
     LONG ref;
@@ -3951,6 +3971,15 @@ struct wined3d_resource
     DWORD priority;
     void *heap_memory;
 
+    /* Only accessed from the application thread. */
+    struct
+    {
+        struct wined3d_upload_data *upload[WINED3D_CLIENT_UPLOAD_COUNT]; /* the first one is current */
+        unsigned int map_count;
+        struct wined3d_box box;
+        DWORD flags;
+    } client;
+
     void *parent;
     const struct wined3d_parent_ops *parent_ops;
     const struct wined3d_resource_ops *resource_ops;
@@ -4542,6 +4571,8 @@ enum wined3d_push_constants
 #define WINED3D_CS_QUERY_POLL_INTERVAL  10u
 #define WINED3D_CS_QUEUE_SIZE           0x100000u
 #define WINED3D_CS_SPIN_COUNT           10000000u
+#define WINED3D_CS_SPIN_COUNT_MIN       1000u
+#define WINED3D_CS_UPLOAD_COPY_MAX      0x400000u
 
 struct wined3d_cs_queue
 {
@@ -4549,6 +4580,34 @@ struct wined3d_cs_queue
     BYTE data[WINED3D_CS_QUEUE_SIZE];
 };
 
+/* Adaptive spin budget for one side of the command stream. "average" follows
+ * the length of waits that ended while spinning, and decays when spinning
+ * runs out and the thread has to sleep. */
+struct wined3d_cs_spin
+{
+    unsigned int limit;
+    unsigned int average;
+};
+
+/* State of a single wait of the application thread for the CS thread. */
+struct wined3d_cs_wait
+{
+    unsigned int spin_count;
+    BOOL armed;
+    BOOL slept;
+    LONGLONG start;
+};
+
+/* Only collected while the d3d_perf channel is enabled. */
+struct wined3d_cs_stats
+{
+    LONG max_queue_depth;
+    LONG client_stall_us;
+    LONG cs_spin_us;
+    LONG cs_sleep_count;
+    DWORD prev_time;
+};
+
 struct wined3d_cs_ops
 {
     void *(*require_space)(struct wined3d_cs *cs, size_t size, enum wined3d_cs_queue_id queue_id);
@@ -4573,8 +4632,15 @@ struct wined3d_cs
     struct list query_poll_list;
     BOOL queries_flushed;
 
-    HANDLE event;
-    BOOL waiting_for_event;
+    /* Doorbells. The application thread wakes the CS thread when it submits
+     * a packet while "waiting_for_work" is set, the CS thread wakes the
+     * application thread when it retires a packet while
+     * "waiting_for_progress" is set. */
+    LONG waiting_for_work;
+    LONG waiting_for_progress;
+    struct wined3d_cs_spin spin;
+    struct wined3d_cs_spin client_spin;
+    struct wined3d_cs_stats stats;
     LONG pending_presents;
 };
 
@@ -4670,8 +4736,12 @@ void wined3d_cs_init_object(struct wined3d_cs *cs,
         void (*callback)(void *object), void *object) DECLSPEC_HIDDEN;
 HRESULT wined3d_cs_map(struct wined3d_cs *cs, struct wined3d_resource *resource, unsigned int sub_resource_idx,
         struct wined3d_map_desc *map_desc, const struct wined3d_box *box, unsigned int flags) DECLSPEC_HIDDEN;
+BOOL wined3d_cs_map_upload(struct wined3d_cs *cs, struct wined3d_resource *resource, unsigned int sub_resource_idx,
+        struct wined3d_map_desc *map_desc, const struct wined3d_box *box, unsigned int flags) DECLSPEC_HIDDEN;
 HRESULT wined3d_cs_unmap(struct wined3d_cs *cs, struct wined3d_resource *resource,
         unsigned int sub_resource_idx) DECLSPEC_HIDDEN;
+void wined3d_cs_wait(struct wined3d_cs *cs, struct wined3d_cs_wait *wait) DECLSPEC_HIDDEN;
+void wined3d_cs_wait_done(struct wined3d_cs *cs, struct wined3d_cs_wait *wait) DECLSPEC_HIDDEN;
 
 static inline void wined3d_cs_finish(struct wined3d_cs *cs, enum wined3d_cs_queue_id queue_id)
 {
@@ -4696,13 +4766,15 @@ static inline void wined3d_cs_push_constants(struct wined3d_cs *cs, enum wined3d
 
 static inline void wined3d_resource_wait_idle(struct wined3d_resource *resource)
 {
-    const struct wined3d_cs *cs = resource->device->cs;
+    struct wined3d_cs *cs = resource->device->cs;
+    struct wined3d_cs_wait wait = {0};
 
     if (!cs->thread || cs->thread_id == GetCurrentThreadId())
         return;
 
     while (InterlockedCompareExchange(&resource->access_count, 0, 0))
-        wined3d_pause();
+        wined3d_cs_wait(cs, &wait);
+    wined3d_cs_wait_done(cs, &wait);
 }
 
 /* TODO: Add tests and support for FLOAT16_4 POSITIONT, D3DCOLOR position, other
@@ -5255,6 +5327,16 @@ int shader_addline(struct wined3d_string_buffer *buffer, const char *fmt, ...) P
 BOOL string_buffer_resize(struct wined3d_string_buffer *buffer, int rc) DECLSPEC_HIDDEN;
 int shader_vaddline(struct wined3d_string_buffer *buffer, const char *fmt, va_list args) DECLSPEC_HIDDEN;
 
+/* Persistent cache of compiled shader blobs, shared by all processes using
+ * the same cache directory. Keys are built with wined3d_shader_cache_hash(). */
+#define WINED3D_SHADER_CACHE_HASH_INIT 0xcbf29ce484222325ull
+
+UINT64 wined3d_shader_cache_hash(UINT64 hash, const void *data, SIZE_T size) DECLSPEC_HIDDEN;
+BOOL wined3d_shader_cache_enabled(void) DECLSPEC_HIDDEN;
+void *wined3d_shader_cache_get(UINT64 key, SIZE_T *size) DECLSPEC_HIDDEN;
+void wined3d_shader_cache_put(UINT64 key, const void *data, SIZE_T size) DECLSPEC_HIDDEN;
+void wined3d_shader_cache_cleanup(void) DECLSPEC_HIDDEN;
+
 struct wined3d_shader_phase
 {
     const DWORD *start;
@@ -6693,6 +6693,118 @@ static DWORD CALLBACK write_watch_thread( void *arg )
     return 0;
 }
 
+static void test_poll_many_sockets(void)
+{
+    struct
+    {
+        u_int fd_count;
+        SOCKET fd_array[100];
+    } set;
+    SOCKET sockets[100], src;
+    struct sockaddr_in addr;
+    struct timeval timeout;
+    WSAPOLLFD fds[100];
+    int i, j, ret, len;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+
+    for (i = 0; i < ARRAY_SIZE(sockets); i++)
+    {
+        sockets[i] = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+        ok(sockets[i] != INVALID_SOCKET, "failed to create socket, error %u\n", WSAGetLastError());
+        ret = bind(sockets[i], (struct sockaddr *)&addr, sizeof(addr));
+        ok(!ret, "failed to bind, error %u\n", WSAGetLastError());
+    }
+
+    src = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    len = sizeof(addr);
+    ret = getsockname(sockets[50], (struct sockaddr *)&addr, &len);
+    ok(!ret, "failed to get address, error %u\n", WSAGetLastError());
+    ret = sendto(src, "data", 4, 0, (struct sockaddr *)&addr, sizeof(addr));
+    ok(ret == 4, "got %d, error %u\n", ret, WSAGetLastError());
+
+    set.fd_count = ARRAY_SIZE(sockets);
+    memcpy(set.fd_array, sockets, sizeof(sockets));
+    timeout.tv_sec = 1;
+    timeout.tv_usec = 0;
+    ret = select(0, (fd_set *)&set, NULL, NULL, &timeout);
+    ok(ret == 1, "got %d\n", ret);
+    ok(set.fd_count == 1, "got count %u\n", set.fd_count);
+    ok(set.fd_array[0] == sockets[50], "got socket %#lx\n", set.fd_array[0]);
+
+    if (pWSAPoll)
+    {
+        for (i = 0; i < ARRAY_SIZE(fds); i++)
+        {
+            fds[i].fd = sockets[i];
+            fds[i].events = POLLRDNORM;
+        }
+
+        /* repeated calls with the same set give the same results */
+        for (j = 0; j < 2; j++)
+        {
+            ret = pWSAPoll(fds, ARRAY_SIZE(fds), 0);
+            ok(ret == 1, "%u: got %d\n", j, ret);
+            ok(fds[50].revents == POLLRDNORM, "%u: got events %#x\n", j, fds[50].revents);
+            ok(!fds[49].revents, "%u: got events %#x\n", j, fds[49].revents);
+        }
+    }
+    else
+        skip("WSAPoll is unsupported, some tests will be skipped.\n");
+
+    timeout.tv_sec = 0;
+    for (j = 0; j < 2; j++)
+    {
+        set.fd_count = ARRAY_SIZE(sockets);
+        memcpy(set.fd_array, sockets, sizeof(sockets));
+        ret = select(0, (fd_set *)&set, NULL, NULL, &timeout);
+        ok(ret == 1, "%u: got %d\n", j, ret);
+        ok(set.fd_array[0] == sockets[50], "%u: got socket %#lx\n", j, set.fd_array[0]);
+    }
+
+    /* a socket closed in the meantime is noticed */
+    closesocket(sockets[50]);
+
+    if (pWSAPoll)
+    {
+        ret = pWSAPoll(fds, ARRAY_SIZE(fds), 0);
+        ok(fds[50].revents == POLLNVAL, "got events %#x\n", fds[50].revents);
+        ok(!fds[49].revents, "got events %#x\n", fds[49].revents);
+    }
+
+    set.fd_count = ARRAY_SIZE(sockets);
+    memcpy(set.fd_array, sockets, sizeof(sockets));
+    SetLastError(0xdeadbeef);
+    ret = select(0, (fd_set *)&set, NULL, NULL, &timeout);
+    ok(ret == SOCKET_ERROR, "got %d\n", ret);
+    ok(WSAGetLastError() == WSAENOTSOCK, "got error %u\n", WSAGetLastError());
+
+    /* a new socket, possibly with the same handle value, doesn't inherit the old state */
+    sockets[50] = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    ok(sockets[50] != INVALID_SOCKET, "failed to create socket, error %u\n", WSAGetLastError());
+    addr.sin_port = 0;
+    ret = bind(sockets[50], (struct sockaddr *)&addr, sizeof(addr));
+    ok(!ret, "failed to bind, error %u\n", WSAGetLastError());
+    set.fd_count = ARRAY_SIZE(sockets);
+    memcpy(set.fd_array, sockets, sizeof(sockets));
+    ret = select(0, (fd_set *)&set, NULL, NULL, &timeout);
+    ok(!ret, "got %d\n", ret);
+
+    if (pWSAPoll)
+    {
+        fds[50].fd = sockets[50];
+        ret = pWSAPoll(fds, ARRAY_SIZE(fds), 0);
+        ok(!ret, "got %d\n", ret);
+        ok(!fds[50].revents, "got events %#x\n", fds[50].revents);
+    }
+
+    for (i = 0; i < ARRAY_SIZE(sockets); i++)
+        closesocket(sockets[i]);
+    closesocket(src);
+}
+
 static void test_write_watch(void)
 {
     SOCKET src, dest;
@@ -11402,6 +11514,7 @@ START_TEST( sock )
     test_WSASendTo();
     test_WSARecv();
     test_WSAPoll();
+    test_poll_many_sockets();
     test_write_watch();
     test_iocp();
 
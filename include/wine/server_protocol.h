@@ -255,6 +255,17 @@ typedef struct
 } rectangle_t;
 
 
+typedef volatile struct
+{
+    unsigned int    seq;
+    int             cursor_x;
+    int             cursor_y;
+    unsigned int    cursor_last_change;
+    rectangle_t     cursor_clip;
+    unsigned char   keystate[256];
+} desktop_shm_t;
+
+
 typedef struct
 {
     obj_handle_t    handle;
@@ -794,6 +805,15 @@ typedef struct
     lparam_t info;
 } cursor_pos_t;
 
+typedef struct
+{
+    apc_param_t   ckey;
+    apc_param_t   cvalue;
+    apc_param_t   information;
+    unsigned int  status;
+    int           __pad;
+} completion_msg_t;
+
 
 
 
@@ -1205,6 +1225,22 @@ struct close_handle_reply
 
 
 
+struct batch_requests_request
+{
+    struct request_header __header;
+    /* VARARG(requests,bytes); */
+    char __pad_12[4];
+};
+struct batch_requests_reply
+{
+    struct reply_header __header;
+    unsigned int   count;
+    /* VARARG(replies,bytes); */
+    char __pad_12[4];
+};
+
+
+
 struct set_handle_info_request
 {
     struct request_header __header;
@@ -3975,6 +4011,20 @@ struct set_thread_desktop_reply
 
 
 
+struct get_desktop_shared_memory_request
+{
+    struct request_header __header;
+    char __pad_12[4];
+};
+struct get_desktop_shared_memory_reply
+{
+    struct reply_header __header;
+    obj_handle_t handle;
+    char __pad_12[4];
+};
+
+
+
 struct enum_desktop_request
 {
     struct request_header __header;
@@ -5253,6 +5303,19 @@ struct remove_completion_reply
 
 
 
+struct remove_completions_request
+{
+    struct request_header __header;
+    obj_handle_t handle;
+};
+struct remove_completions_reply
+{
+    struct reply_header __header;
+    /* VARARG(msgs,completion_msgs); */
+};
+
+
+
 struct query_completion_request
 {
     struct request_header __header;
@@ -5646,8 +5709,8 @@ struct create_esync_request
     int          initval;
     int          type;
     int          max;
+    int          defer_fd;
     /* VARARG(objattr,object_attributes); */
-    char __pad_28[4];
 };
 struct create_esync_reply
 {
@@ -5665,8 +5728,8 @@ struct open_esync_request
     unsigned int attributes;
     obj_handle_t rootdir;
     int          type;
+    int          defer_fd;
     /* VARARG(name,unicode_str); */
-    char __pad_28[4];
 };
 struct open_esync_reply
 {
@@ -5723,6 +5786,12 @@ enum fsync_type
     FSYNC_QUEUE,
 };
 
+/* Every fsync object owns a slot in the shared memory section; the first two
+ * ints hold the object state, followed by a generation count which the server
+ * increments whenever the slot is freed for reuse. */
+#define FSYNC_SHM_SLOT_SIZE  16
+#define FSYNC_SHM_GEN_OFFSET 8
+
 
 struct create_fsync_request
 {
@@ -5824,6 +5893,7 @@ enum request
     REQ_queue_apc,
     REQ_get_apc_result,
     REQ_close_handle,
+    REQ_batch_requests,
     REQ_set_handle_info,
     REQ_dup_handle,
     REQ_make_temporary,
@@ -5989,6 +6059,7 @@ enum request
     REQ_close_desktop,
     REQ_get_thread_desktop,
     REQ_set_thread_desktop,
+    REQ_get_desktop_shared_memory,
     REQ_enum_desktop,
     REQ_set_user_object_info,
     REQ_register_hotkey,
@@ -6065,6 +6136,7 @@ enum request
     REQ_open_completion,
     REQ_add_completion,
     REQ_remove_completion,
+    REQ_remove_completions,
     REQ_query_completion,
     REQ_set_completion_info,
     REQ_add_fd_completion,
@@ -6130,6 +6202,7 @@ union generic_request
     struct queue_apc_request queue_apc_request;
     struct get_apc_result_request get_apc_result_request;
     struct close_handle_request close_handle_request;
+    struct batch_requests_request batch_requests_request;
     struct set_handle_info_request set_handle_info_request;
     struct dup_handle_request dup_handle_request;
     struct make_temporary_request make_temporary_request;
@@ -6295,6 +6368,7 @@ union generic_request
     struct close_desktop_request close_desktop_request;
     struct get_thread_desktop_request get_thread_desktop_request;
     struct set_thread_desktop_request set_thread_desktop_request;
+    struct get_desktop_shared_memory_request get_desktop_shared_memory_request;
     struct enum_desktop_request enum_desktop_request;
     struct set_user_object_info_request set_user_object_info_request;
     struct register_hotkey_request register_hotkey_request;
@@ -6371,6 +6445,7 @@ union generic_request
     struct open_completion_request open_completion_request;
     struct add_completion_request add_completion_request;
     struct remove_completion_request remove_completion_request;
+    struct remove_completions_request remove_completions_request;
     struct query_completion_request query_completion_request;
     struct set_completion_info_request set_completion_info_request;
     struct add_fd_completion_request add_fd_completion_request;
@@ -6434,6 +6509,7 @@ union generic_reply
     struct queue_apc_reply queue_apc_reply;
     struct get_apc_result_reply get_apc_result_reply;
     struct close_handle_reply close_handle_reply;
+    struct batch_requests_reply batch_requests_reply;
     struct set_handle_info_reply set_handle_info_reply;
     struct dup_handle_reply dup_handle_reply;
     struct make_temporary_reply make_temporary_reply;
@@ -6599,6 +6675,7 @@ union generic_reply
     struct close_desktop_reply close_desktop_reply;
     struct get_thread_desktop_reply get_thread_desktop_reply;
     struct set_thread_desktop_reply set_thread_desktop_reply;
+    struct get_desktop_shared_memory_reply get_desktop_shared_memory_reply;
     struct enum_desktop_reply enum_desktop_reply;
     struct set_user_object_info_reply set_user_object_info_reply;
     struct register_hotkey_reply register_hotkey_reply;
@@ -6675,6 +6752,7 @@ union generic_reply
     struct open_completion_reply open_completion_reply;
     struct add_completion_reply add_completion_reply;
     struct remove_completion_reply remove_completion_reply;
+    struct remove_completions_reply remove_completions_reply;
     struct query_completion_reply query_completion_reply;
     struct set_completion_info_reply set_completion_info_reply;
     struct add_fd_completion_reply add_fd_completion_reply;
@@ -6714,7 +6792,7 @@ union generic_reply
 
 /* ### protocol_version begin ### */
 
-#define SERVER_PROTOCOL_VERSION 635
+#define SERVER_PROTOCOL_VERSION 640
 
 /* ### protocol_version end ### */
 
@@ -190,6 +190,23 @@ extern "C" {
 #define __WINE_ALLOC_SIZE(x)
 #endif
 
+#if defined(__clang__) || (defined(__GNUC__) && ((__GNUC__ > 4) || ((__GNUC__ == 4) && (__GNUC_MINOR__ >= 7))))
+#define __WINE_ATOMIC_LOAD_ACQUIRE(ptr, ret) __atomic_load(ptr, ret, __ATOMIC_ACQUIRE)
+#define __WINE_ATOMIC_LOAD_RELAXED(ptr, ret) __atomic_load(ptr, ret, __ATOMIC_RELAXED)
+#define __WINE_ATOMIC_STORE_RELEASE(ptr, val) __atomic_store(ptr, val, __ATOMIC_RELEASE)
+#define __WINE_ATOMIC_STORE_RELAXED(ptr, val) __atomic_store(ptr, val, __ATOMIC_RELAXED)
+#define __WINE_ATOMIC_FENCE_ACQUIRE() __atomic_thread_fence(__ATOMIC_ACQUIRE)
+#define __WINE_ATOMIC_FENCE_RELEASE() __atomic_thread_fence(__ATOMIC_RELEASE)
+#else
+/* only for 32-bit values; the interlocked functions are full barriers */
+#define __WINE_ATOMIC_LOAD_ACQUIRE(ptr, ret) (*(ret) = InterlockedCompareExchange((LONG volatile *)(ptr), 0, 0))
+#define __WINE_ATOMIC_LOAD_RELAXED(ptr, ret) (*(ret) = *(LONG volatile *)(ptr))
+#define __WINE_ATOMIC_STORE_RELEASE(ptr, val) InterlockedExchange((LONG volatile *)(ptr), *(val))
+#define __WINE_ATOMIC_STORE_RELAXED(ptr, val) (*(LONG volatile *)(ptr) = *(val))
+#define __WINE_ATOMIC_FENCE_ACQUIRE() do { LONG __wine_fence; InterlockedExchange(&__wine_fence, 0); } while (0)
+#define __WINE_ATOMIC_FENCE_RELEASE() do { LONG __wine_fence; InterlockedExchange(&__wine_fence, 0); } while (0)
+#endif
+
 /* Anonymous union/struct handling */
 
 #ifndef NONAMELESSSTRUCT
@@ -67,6 +67,7 @@
 #include <winternl.h>
 #include <ddk/wdm.h>
 #include <sddl.h>
+#include <wincrypt.h>
 #include <wine/svcctl.h>
 #include <wine/asm.h>
 #include <wine/debug.h>
@@ -1390,6 +1391,432 @@ static void update_win_version(void)
     }
 }
 
+/* registry hives saved in a prefix template, named like the prefix files */
+static const struct
+{
+    const WCHAR *file;
+    const WCHAR *key;  /* NULL for the current user key */
+} template_hives[] =
+{
+    { L"system.reg",  L"\\Registry\\Machine" },
+    { L"userdef.reg", L"\\Registry\\User\\.Default" },
+    { L"user.reg",    NULL },
+};
+
+/* directories of the system drive saved in a prefix template; the user profiles
+ * are left out, they contain links to the Unix home directory */
+static const WCHAR * const template_dirs[] =
+{
+    L"windows", L"Program Files", L"Program Files (x86)", L"ProgramData"
+};
+
+static WCHAR *get_path_in_dir( const WCHAR *dir, const WCHAR *name )
+{
+    WCHAR *path = HeapAlloc( GetProcessHeap(), 0, (lstrlenW(dir) + lstrlenW(name) + 2) * sizeof(WCHAR) );
+
+    if (!path) return NULL;
+    lstrcpyW( path, dir );
+    lstrcatW( path, L"\\" );
+    lstrcatW( path, name );
+    return path;
+}
+
+static WCHAR *prefix_template;      /* template directory of a new prefix */
+static BOOL prefix_template_loaded;  /* whether the new prefix was populated from it */
+
+/* retrieve the prefix template directory, if one is configured */
+static WCHAR *get_prefix_template_dir(void)
+{
+    const char *dir = getenv( "WINEPREFIXTEMPLATE" );
+
+    if (!dir || !*dir) return NULL;
+    return wine_get_dos_file_name( dir );
+}
+
+static BOOL has_timestamp( const WCHAR *dir )
+{
+    WCHAR *file = get_path_in_dir( dir, L".update-timestamp" );
+    BOOL ret;
+
+    if (!file) return FALSE;
+    ret = GetFileAttributesW( file ) != INVALID_FILE_ATTRIBUTES;
+    HeapFree( GetProcessHeap(), 0, file );
+    return ret;
+}
+
+/* contents of the template timestamp file; besides the wine.inf time, it records the
+ * architecture and the user, the registry contains paths to the user profile */
+static int get_template_stamp( unsigned long timestamp, char *buffer, int size )
+{
+    WCHAR user[256];
+    DWORD len = ARRAY_SIZE(user);
+    int count;
+
+    if (!GetUserNameW( user, &len )) return 0;
+    count = snprintf( buffer, size, "%lu\n%s\n", timestamp, is_64bit ? "win64" : "win32" );
+    if (count <= 0 || count >= size - 1) return 0;
+    if (!(len = WideCharToMultiByte( CP_UTF8, 0, user, -1, buffer + count, size - count - 1, NULL, NULL )))
+        return 0;
+    count += len - 1;
+    buffer[count++] = '\n';
+    buffer[count] = 0;
+    return count;
+}
+
+static BOOL write_template_stamp( const WCHAR *dir, unsigned long timestamp )
+{
+    WCHAR *file = get_path_in_dir( dir, L".update-timestamp" );
+    char buffer[1024];
+    int fd, count;
+    BOOL ret = FALSE;
+
+    if (!file) return FALSE;
+    if ((count = get_template_stamp( timestamp, buffer, sizeof(buffer) )) &&
+        (fd = _wopen( file, O_WRONLY | O_CREAT | O_TRUNC, 0666 )) != -1)
+    {
+        ret = write( fd, buffer, count ) == count;
+        close( fd );
+    }
+    HeapFree( GetProcessHeap(), 0, file );
+    return ret;
+}
+
+/* check whether the template has been completely created from the same wine.inf,
+ * for the same architecture and user */
+static BOOL is_template_valid( const WCHAR *dir, unsigned long timestamp )
+{
+    WCHAR *file = get_path_in_dir( dir, L".update-timestamp" );
+    char buffer[1024], expect[1024];
+    int fd, count;
+    BOOL ret = FALSE;
+
+    if (!file) return FALSE;
+    if (get_template_stamp( timestamp, expect, sizeof(expect) ) && (fd = _wopen( file, O_RDONLY )) != -1)
+    {
+        if ((count = read( fd, buffer, sizeof(buffer) - 1 )) > 0)
+        {
+            buffer[count] = 0;
+            ret = !strcmp( buffer, expect );
+            if (!ret) WINE_TRACE( "template %s doesn't match: %s\n", debugstr_w(dir), debugstr_a(buffer) );
+        }
+        close( fd );
+    }
+    HeapFree( GetProcessHeap(), 0, file );
+    return ret;
+}
+
+static BOOL get_template_hive_key( unsigned int index, UNICODE_STRING *name )
+{
+    if (!template_hives[index].key) return !RtlFormatCurrentUserKeyPath( name );
+    RtlInitUnicodeString( name, template_hives[index].key );
+    return TRUE;
+}
+
+static void free_template_hive_key( unsigned int index, UNICODE_STRING *name )
+{
+    if (!template_hives[index].key) RtlFreeUnicodeString( name );
+}
+
+static BOOL save_template_hive( const WCHAR *dir, unsigned int index )
+{
+    OBJECT_ATTRIBUTES attr;
+    UNICODE_STRING name;
+    NTSTATUS status = STATUS_NO_MEMORY;
+    HANDLE key, file;
+    WCHAR *path;
+
+    if (!(path = get_path_in_dir( dir, template_hives[index].file ))) return FALSE;
+
+    if (get_template_hive_key( index, &name ))
+    {
+        InitializeObjectAttributes( &attr, &name, OBJ_CASE_INSENSITIVE, 0, NULL );
+        if (!(status = NtOpenKey( &key, KEY_READ, &attr )))
+        {
+            file = CreateFileW( path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, 0 );
+            if (file != INVALID_HANDLE_VALUE)
+            {
+                status = NtSaveKey( key, file );
+                CloseHandle( file );
+            }
+            else status = STATUS_UNSUCCESSFUL;
+            NtClose( key );
+        }
+        free_template_hive_key( index, &name );
+    }
+    if (status) WINE_WARN( "failed to save %s, status %x\n", debugstr_w(path), status );
+    HeapFree( GetProcessHeap(), 0, path );
+    return !status;
+}
+
+static BOOL load_template_hive( const WCHAR *dir, unsigned int index )
+{
+    OBJECT_ATTRIBUTES attr, file_attr;
+    UNICODE_STRING name, file_name;
+    NTSTATUS status = STATUS_NO_MEMORY;
+    WCHAR *path;
+
+    if (!(path = get_path_in_dir( dir, template_hives[index].file ))) return FALSE;
+    if (RtlDosPathNameToNtPathName_U( path, &file_name, NULL, NULL ))
+    {
+        if (get_template_hive_key( index, &name ))
+        {
+            InitializeObjectAttributes( &attr, &name, OBJ_CASE_INSENSITIVE, 0, NULL );
+            InitializeObjectAttributes( &file_attr, &file_name, OBJ_CASE_INSENSITIVE, 0, NULL );
+            status = NtLoadKey( &attr, &file_attr );
+            free_template_hive_key( index, &name );
+        }
+        RtlFreeUnicodeString( &file_name );
+    }
+    if (status) WINE_WARN( "failed to load %s, status %x\n", debugstr_w(path), status );
+    HeapFree( GetProcessHeap(), 0, path );
+    return !status;
+}
+
+/* recursively copy a directory tree, leaving out symlinks */
+static BOOL copy_template_dir( const WCHAR *src, const WCHAR *dst )
+{
+    WIN32_FIND_DATAW data;
+    WCHAR *pattern, *src_path, *dst_path;
+    HANDLE handle;
+    BOOL ret = TRUE;
+
+    if (!CreateDirectoryW( dst, NULL ) && GetLastError() != ERROR_ALREADY_EXISTS) return FALSE;
+    if (!(pattern = get_path_in_dir( src, L"*" ))) return FALSE;
+    handle = FindFirstFileW( pattern, &data );
+    HeapFree( GetProcessHeap(), 0, pattern );
+    if (handle == INVALID_HANDLE_VALUE) return GetLastError() == ERROR_FILE_NOT_FOUND;
+
+    do
+    {
+        if (!wcscmp( data.cFileName, L"." ) || !wcscmp( data.cFileName, L".." )) continue;
+        if (data.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) continue;
+
+        src_path = get_path_in_dir( src, data.cFileName );
+        dst_path = get_path_in_dir( dst, data.cFileName );
+        if (!src_path || !dst_path) ret = FALSE;
+        else if (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) ret = copy_template_dir( src_path, dst_path );
+        else if (!(ret = CopyFileW( src_path, dst_path, FALSE )))
+            WINE_WARN( "failed to copy %s to %s, error %u\n", debugstr_w(src_path), debugstr_w(dst_path), GetLastError() );
+        HeapFree( GetProcessHeap(), 0, src_path );
+        HeapFree( GetProcessHeap(), 0, dst_path );
+    } while (ret && FindNextFileW( handle, &data ));
+
+    FindClose( handle );
+    return ret;
+}
+
+/* recursively delete a directory tree, without following symlinks */
+static void delete_template_dir( const WCHAR *dir )
+{
+    WIN32_FIND_DATAW data;
+    WCHAR *pattern, *path;
+    HANDLE handle;
+
+    if (!(pattern = get_path_in_dir( dir, L"*" ))) return;
+    handle = FindFirstFileW( pattern, &data );
+    HeapFree( GetProcessHeap(), 0, pattern );
+    if (handle == INVALID_HANDLE_VALUE) return;
+
+    do
+    {
+        if (!wcscmp( data.cFileName, L"." ) || !wcscmp( data.cFileName, L".." )) continue;
+        if (!(path = get_path_in_dir( dir, data.cFileName ))) continue;
+        if (data.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT)
+        {
+            if (!DeleteFileW( path )) RemoveDirectoryW( path );
+        }
+        else if (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) delete_template_dir( path );
+        else
+        {
+            SetFileAttributesW( path, FILE_ATTRIBUTE_NORMAL );
+            DeleteFileW( path );
+        }
+        HeapFree( GetProcessHeap(), 0, path );
+    } while (FindNextFileW( handle, &data ));
+
+    FindClose( handle );
+    RemoveDirectoryW( dir );
+}
+
+/* copy the system drive directories between the prefix and the template */
+static BOOL copy_template_drive( const WCHAR *dir, BOOL save )
+{
+    WCHAR root[] = L"C:", *drive, *src, *dst;
+    unsigned int i;
+    BOOL ret = TRUE;
+
+    root[0] = windowsdir[0];
+    if (!(drive = get_path_in_dir( dir, L"drive_c" ))) return FALSE;
+    if (save)
+    {
+        delete_template_dir( drive );
+        CreateDirectoryW( drive, NULL );
+    }
+
+    for (i = 0; ret && i < ARRAY_SIZE(template_dirs); i++)
+    {
+        WCHAR *prefix_path = get_path_in_dir( root, template_dirs[i] );
+        WCHAR *template_path = get_path_in_dir( drive, template_dirs[i] );
+
+        src = save ? prefix_path : template_path;
+        dst = save ? template_path : prefix_path;
+        if (!src || !dst) ret = FALSE;
+        else if (GetFileAttributesW( src ) != INVALID_FILE_ATTRIBUTES) ret = copy_template_dir( src, dst );
+        HeapFree( GetProcessHeap(), 0, prefix_path );
+        HeapFree( GetProcessHeap(), 0, template_path );
+    }
+    HeapFree( GetProcessHeap(), 0, drive );
+    return ret;
+}
+
+/* get the name of a sibling of the template directory, private to this process */
+static WCHAR *get_template_sibling( const WCHAR *dir, const WCHAR *suffix )
+{
+    unsigned int len = lstrlenW( dir ) + lstrlenW( suffix ) + 12;
+    WCHAR *path = HeapAlloc( GetProcessHeap(), 0, len * sizeof(WCHAR) );
+
+    if (path) swprintf( path, len, L"%s.%s.%x", dir, suffix, GetCurrentProcessId() );
+    return path;
+}
+
+/* lock the template directory; a shared lock keeps it from being replaced while it is read */
+static HANDLE lock_prefix_template( const WCHAR *dir, BOOL exclusive )
+{
+    OVERLAPPED ov;
+    HANDLE file;
+    WCHAR *path;
+
+    if (!(path = HeapAlloc( GetProcessHeap(), 0, lstrlenW(dir) * sizeof(WCHAR) + sizeof(L".lock") )))
+        return INVALID_HANDLE_VALUE;
+    lstrcpyW( path, dir );
+    lstrcatW( path, L".lock" );
+    file = CreateFileW( path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                        NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, 0 );
+    if (file != INVALID_HANDLE_VALUE)
+    {
+        memset( &ov, 0, sizeof(ov) );
+        if (!LockFileEx( file, exclusive ? LOCKFILE_EXCLUSIVE_LOCK : 0, 0, 1, 0, &ov ))
+        {
+            CloseHandle( file );
+            file = INVALID_HANDLE_VALUE;
+        }
+    }
+    if (file == INVALID_HANDLE_VALUE)
+        WINE_WARN( "failed to lock %s, error %u\n", debugstr_w(path), GetLastError() );
+    HeapFree( GetProcessHeap(), 0, path );
+    return file;
+}
+
+/* store the result of the wine.inf installation into the template directory */
+static void save_prefix_template( const WCHAR *dir, unsigned long timestamp )
+{
+    WCHAR *new_dir = get_template_sibling( dir, L"new" );
+    WCHAR *old_dir = get_template_sibling( dir, L"old" );
+    BOOLEAN enabled;
+    unsigned int i;
+    HANDLE lock;
+    BOOL ret = FALSE;
+
+    if (!new_dir || !old_dir) goto done;
+
+    /* build the template in a private directory, so that concurrent runs don't see it half done */
+    delete_template_dir( new_dir );
+    if (!CreateDirectoryW( new_dir, NULL )) goto done;
+    RtlAdjustPrivilege( SE_BACKUP_PRIVILEGE, TRUE, FALSE, &enabled );
+    for (i = 0, ret = TRUE; ret && i < ARRAY_SIZE(template_hives); i++) ret = save_template_hive( new_dir, i );
+    RtlAdjustPrivilege( SE_BACKUP_PRIVILEGE, enabled, FALSE, &enabled );
+    ret = ret && copy_template_drive( new_dir, TRUE ) && write_template_stamp( new_dir, timestamp );
+
+    /* then move it into place, unless another run got there first */
+    if (ret && (lock = lock_prefix_template( dir, TRUE )) != INVALID_HANDLE_VALUE)
+    {
+        if (!is_template_valid( dir, timestamp ))
+        {
+            if (!MoveFileExW( dir, old_dir, 0 ) && GetLastError() != ERROR_FILE_NOT_FOUND &&
+                GetLastError() != ERROR_PATH_NOT_FOUND)
+                ret = FALSE;
+            else if (!(ret = MoveFileExW( new_dir, dir, 0 )))
+                MoveFileExW( old_dir, dir, 0 );
+        }
+        CloseHandle( lock );
+    }
+    else ret = FALSE;
+
+    if (ret) WINE_TRACE( "saved prefix template to %s\n", debugstr_w(dir) );
+    else WINE_WARN( "failed to save prefix template to %s\n", debugstr_w(dir) );
+
+done:
+    if (new_dir) delete_template_dir( new_dir );
+    if (old_dir) delete_template_dir( old_dir );
+    HeapFree( GetProcessHeap(), 0, new_dir );
+    HeapFree( GetProcessHeap(), 0, old_dir );
+}
+
+/* replace the values that must be unique to each prefix after loading a template */
+static void reset_machine_values(void)
+{
+    HCRYPTPROV prov;
+    HKEY key;
+
+    if (!RegOpenKeyExW( HKEY_LOCAL_MACHINE, L"Software\\Microsoft\\Cryptography", 0,
+                        KEY_ALL_ACCESS | KEY_WOW64_64KEY, &key ))
+    {
+        RegDeleteValueW( key, L"MachineGuid" );
+        RegCloseKey( key );
+    }
+    /* acquiring a context creates a new MachineGuid */
+    if (CryptAcquireContextW( &prov, NULL, NULL, PROV_RSA_FULL, CRYPT_VERIFYCONTEXT ))
+        CryptReleaseContext( prov, 0 );
+    else
+        WINE_WARN( "failed to acquire a cryptographic context, error %u\n", GetLastError() );
+}
+
+/* populate a new prefix from the template directory */
+static BOOL load_prefix_template( const WCHAR *dir )
+{
+    BOOLEAN enabled;
+    unsigned int i;
+    BOOL ret;
+
+    RtlAdjustPrivilege( SE_RESTORE_PRIVILEGE, TRUE, FALSE, &enabled );
+    for (i = 0, ret = TRUE; ret && i < ARRAY_SIZE(template_hives); i++) ret = load_template_hive( dir, i );
+    RtlAdjustPrivilege( SE_RESTORE_PRIVILEGE, enabled, FALSE, &enabled );
+
+    return ret && copy_template_drive( dir, FALSE );
+}
+
+/* populate a new prefix from the template, before services get started */
+static void init_prefix_template(void)
+{
+    const WCHAR *config_dir = _wgetenv( L"WINECONFIGDIR" );
+    WCHAR *inf_path;
+    struct stat st;
+    HANDLE lock;
+    int fd;
+
+    if (!config_dir || has_timestamp( config_dir )) return;
+    if (!(prefix_template = get_prefix_template_dir())) return;
+    if (!(inf_path = get_wine_inf_path())) return;
+
+    if ((fd = _wopen( inf_path, O_RDONLY )) != -1)
+    {
+        fstat( fd, &st );
+        close( fd );
+        if ((lock = lock_prefix_template( prefix_template, FALSE )) != INVALID_HANDLE_VALUE)
+        {
+            if (is_template_valid( prefix_template, st.st_mtime ))
+                prefix_template_loaded = load_prefix_template( prefix_template );
+            CloseHandle( lock );
+        }
+        if (prefix_template_loaded)
+        {
+            WINE_TRACE( "loaded prefix template %s\n", debugstr_w(prefix_template) );
+            reset_machine_values();
+        }
+    }
+    HeapFree( GetProcessHeap(), 0, inf_path );
+}
+
 /* execute rundll32 on the wine.inf file if necessary */
 static void update_wineprefix( BOOL force )
 {
@@ -1417,7 +1844,7 @@ static void update_wineprefix( BOOL force )
         HANDLE process;
         DWORD count = 0;
 
-        if ((process = start_rundll32( inf_path, FALSE )))
+        if (!prefix_template_loaded && (process = start_rundll32( inf_path, FALSE )))
         {
 /*            HWND hwnd = show_wait_window();*/
             for (;;)
@@ -1433,7 +1860,11 @@ static void update_wineprefix( BOOL force )
             }
 /*            DestroyWindow( hwnd );*/
         }
-        install_root_pnp_devices();
+        if (!prefix_template_loaded)
+        {
+            install_root_pnp_devices();
+            if (prefix_template) save_prefix_template( prefix_template, st.st_mtime );
+        }
         update_user_profile();
         update_win_version();
 
@@ -1630,6 +2061,7 @@ int __cdecl main( int argc, char *argv[] )
     ResetEvent( event );  /* in case this is a restart */
 
     create_user_shared_data();
+    if (init) init_prefix_template();
     create_hardware_registry_keys();
     create_dynamic_registry_keys();
     create_environment_registry_keys();
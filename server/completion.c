@@ -261,6 +261,40 @@ DECL_HANDLER(remove_completion)
     release_object( completion );
 }
 
+/* get several completions from completion port */
+DECL_HANDLER(remove_completions)
+{
+    struct completion* completion = get_completion_obj( current->process, req->handle, IO_COMPLETION_MODIFY_STATE );
+    data_size_t count, i;
+    completion_msg_t *data;
+    struct list *entry;
+    struct comp_msg *msg;
+
+    if (!completion) return;
+
+    count = min( completion->depth, get_reply_max_size() / sizeof(*data) );
+    if (!count)
+        set_error( STATUS_PENDING );
+    else if ((data = set_reply_data_size( count * sizeof(*data) )))
+    {
+        for (i = 0; i < count; i++)
+        {
+            entry = list_head( &completion->queue );
+            list_remove( entry );
+            completion->depth--;
+            msg = LIST_ENTRY( entry, struct comp_msg, queue_entry );
+            data[i].ckey        = msg->ckey;
+            data[i].cvalue      = msg->cvalue;
+            data[i].information = msg->information;
+            data[i].status      = msg->status;
+            data[i].__pad       = 0;
+            free( msg );
+        }
+    }
+
+    release_object( completion );
+}
+
 /* get queue depth for completion port */
 DECL_HANDLER(query_completion)
 {
@@ -338,6 +338,7 @@ static void console_input_events_destroy( struct object *obj )
     free_async_queue( &evts->read_q );
     if (evts->fd) release_object( evts->fd );
     free( evts->events );
+    if (do_fsync()) fsync_free_shm( evts->fsync_idx );
 }
 
 static struct fd *console_input_events_get_fd( struct object* obj )
@@ -385,7 +386,7 @@ static int get_renderer_events( struct console_input_events* evts, struct async
 static int console_input_events_get_esync_fd( struct object *obj, enum esync_type *type )
 {
     struct console_input_events *evts = (struct console_input_events *)obj;
-    *type = ESYNC_MANUAL_SERVER;
+    if (type) *type = ESYNC_MANUAL_SERVER;
     return evts->esync_fd;
 }
 
@@ -455,6 +456,7 @@ static struct object *create_console_input_events(void)
     if (!(evt = alloc_object( &console_input_events_ops ))) return NULL;
     evt->num_alloc = evt->num_used = 0;
     evt->events = NULL;
+    evt->fsync_idx = 0;
     init_async_queue( &evt->read_q );
     if (!(evt->fd = alloc_pseudo_fd( &console_input_events_fd_ops, &evt->obj, 0 )))
     {
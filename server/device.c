@@ -793,7 +793,7 @@ static int device_manager_signaled( struct object *obj, struct wait_queue_entry
 static int device_manager_get_esync_fd( struct object *obj, enum esync_type *type )
 {
     struct device_manager *manager = (struct device_manager *)obj;
-    *type = ESYNC_MANUAL_SERVER;
+    if (type) *type = ESYNC_MANUAL_SERVER;
     return manager->esync_fd;
 }
 
@@ -841,6 +841,9 @@ static void device_manager_destroy( struct object *obj )
 
     if (do_esync())
         close( manager->esync_fd );
+
+    if (do_fsync())
+        fsync_free_shm( manager->fsync_idx );
 }
 
 static struct device_manager *create_device_manager(void)
@@ -106,12 +106,54 @@ void esync_init(void)
     atexit( shm_cleanup );
 }
 
+/* shm slots of destroyed objects, reused before growing the section */
+static unsigned int *shm_free_slots;
+static unsigned int shm_free_count;
+static unsigned int shm_free_size;  /* length of the allocated shm_free_slots array */
+static unsigned int shm_idx_counter = 1;  /* we keep index 0 reserved */
+
+static unsigned int alloc_shm_idx(void)
+{
+    unsigned int idx;
+
+    if (shm_free_count) return shm_free_slots[--shm_free_count];
+
+    idx = shm_idx_counter++;
+    while (idx * 8 >= shm_size)
+    {
+        /* Better expand the shm section. */
+        shm_size += pagesize;
+        if (ftruncate( shm_fd, shm_size ) == -1)
+        {
+            fprintf( stderr, "esync: couldn't expand %s to size %ld: ",
+                shm_name, shm_size );
+            perror( "ftruncate" );
+        }
+    }
+    return idx;
+}
+
+static void free_shm_idx( unsigned int idx )
+{
+    if (shm_free_count == shm_free_size)
+    {
+        unsigned int new_size = max( shm_free_size * 2, 64 );
+        unsigned int *new_slots;
+
+        /* if we can't remember the slot, just never reuse it */
+        if (!(new_slots = realloc( shm_free_slots, new_size * sizeof(shm_free_slots[0]) ))) return;
+        shm_free_slots = new_slots;
+        shm_free_size = new_size;
+    }
+    shm_free_slots[shm_free_count++] = idx;
+}
+
 static struct list mutex_list = LIST_INIT(mutex_list);
 
 struct esync
 {
     struct object   obj;            /* object header */
-    int             fd;             /* eventfd file descriptor */
+    int             fd;             /* eventfd file descriptor, created on demand */
     enum esync_type type;
     unsigned int    shm_idx;        /* index into the shared memory section */
     struct list     mutex_entry;    /* entry in the mutex list (if applicable) */
@@ -154,13 +196,6 @@ static void esync_dump( struct object *obj, int verbose )
     fprintf( stderr, "esync fd=%d\n", esync->fd );
 }
 
-static int esync_get_esync_fd( struct object *obj, enum esync_type *type )
-{
-    struct esync *esync = (struct esync *)obj;
-    *type = esync->type;
-    return esync->fd;
-}
-
 static unsigned int esync_map_access( struct object *obj, unsigned int access )
 {
     /* Sync objects have the same flags. */
@@ -176,7 +211,8 @@ static void esync_destroy( struct object *obj )
     struct esync *esync = (struct esync *)obj;
     if (esync->type == ESYNC_MUTEX)
         list_remove( &esync->mutex_entry );
-    close( esync->fd );
+    if (esync->fd != -1) close( esync->fd );
+    free_shm_idx( esync->shm_idx );
 }
 
 static int type_matches( enum esync_type type1, enum esync_type type2 )
@@ -243,6 +279,50 @@ struct event
 };
 C_ASSERT(sizeof(struct event) == 8);
 
+/* The eventfd is only created once a client asks for it. Until then no client
+ * can operate on the object, so the shm section holds its complete state. */
+static int esync_get_esync_fd( struct object *obj, enum esync_type *type )
+{
+    struct esync *esync = (struct esync *)obj;
+    int initval = 0, flags = 0;
+
+    if (!type) return esync->fd;
+
+    *type = esync->type;
+    if (esync->fd != -1) return esync->fd;
+
+    switch (esync->type)
+    {
+    case ESYNC_SEMAPHORE:
+    {
+        struct semaphore *semaphore = get_shm( esync->shm_idx );
+        initval = semaphore->count;
+#ifdef HAVE_SYS_EVENTFD_H
+        flags = EFD_SEMAPHORE;
+#endif
+        break;
+    }
+    case ESYNC_AUTO_EVENT:
+    case ESYNC_MANUAL_EVENT:
+    {
+        struct event *event = get_shm( esync->shm_idx );
+        initval = event->signaled;
+        break;
+    }
+    case ESYNC_MUTEX:
+    {
+        struct mutex *mutex = get_shm( esync->shm_idx );
+        initval = !mutex->count;
+        break;
+    }
+    default:
+        assert( 0 );
+    }
+
+    esync->fd = esync_create_fd( initval, flags );
+    return esync->fd;
+}
+
 struct esync *create_esync( struct object *root, const struct unicode_str *name,
                             unsigned int attr, int initval, int max, enum esync_type type,
                             const struct security_descriptor *sd )
@@ -254,36 +334,10 @@ struct esync *create_esync( struct object *root, const struct unicode_str *name,
     {
         if (get_error() != STATUS_OBJECT_NAME_EXISTS)
         {
-            int flags = EFD_CLOEXEC | EFD_NONBLOCK;
-
-            if (type == ESYNC_SEMAPHORE)
-                flags |= EFD_SEMAPHORE;
-
             /* initialize it if it didn't already exist */
-            esync->fd = eventfd( initval, flags );
-            if (esync->fd == -1)
-            {
-                perror( "eventfd" );
-                file_set_error();
-                release_object( esync );
-                return NULL;
-            }
+            esync->fd = -1;
             esync->type = type;
-
-            /* Use the fd as index, since that'll be unique across all
-             * processes, but should hopefully end up also allowing reuse. */
-            esync->shm_idx = esync->fd + 1; /* we keep index 0 reserved */
-            while (esync->shm_idx * 8 >= shm_size)
-            {
-                /* Better expand the shm section. */
-                shm_size += pagesize;
-                if (ftruncate( shm_fd, shm_size ) == -1)
-                {
-                    fprintf( stderr, "esync: couldn't expand %s to size %ld: ",
-                        shm_name, shm_size );
-                    perror( "ftruncate" );
-                }
-            }
+            esync->shm_idx = alloc_shm_idx();
 
             /* Initialize the shared memory portion. We want to do this on the
              * server side to avoid a potential though unlikely race whereby
@@ -367,20 +421,19 @@ void esync_wake_fd( int fd )
 /* Wake up a server-side esync object. */
 void esync_wake_up( struct object *obj )
 {
-    enum esync_type dummy;
     int fd;
 
-    if (obj->ops->get_esync_fd)
-    {
-        fd = obj->ops->get_esync_fd( obj, &dummy );
+    /* objects whose fd hasn't been created yet will get it in the right state */
+    if (obj->ops->get_esync_fd && (fd = obj->ops->get_esync_fd( obj, NULL )) != -1)
         esync_wake_fd( fd );
-    }
 }
 
 void esync_clear( int fd )
 {
     uint64_t value;
 
+    if (fd == -1) return;
+
     /* we don't care about the return value */
     read( fd, &value, sizeof(value) );
 }
@@ -413,7 +466,7 @@ void esync_set_event( struct esync *esync )
             small_pause();
     }
 
-    if (!__atomic_exchange_n( &event->signaled, 1, __ATOMIC_SEQ_CST ))
+    if (!__atomic_exchange_n( &event->signaled, 1, __ATOMIC_SEQ_CST ) && esync->fd != -1)
     {
         if (write( esync->fd, &value, sizeof(value) ) == -1)
             perror( "esync: write" );
@@ -445,7 +498,7 @@ void esync_reset_event( struct esync *esync )
     }
 
     /* Only bother signaling the fd if we weren't already signaled. */
-    if (__atomic_exchange_n( &event->signaled, 0, __ATOMIC_SEQ_CST ))
+    if (__atomic_exchange_n( &event->signaled, 0, __ATOMIC_SEQ_CST ) && esync->fd != -1)
     {
         /* we don't care about the return value */
         read( esync->fd, &value, sizeof(value) );
@@ -472,11 +525,28 @@ void esync_abandon_mutexes( struct thread *thread )
                 fprintf( stderr, "esync_abandon_mutexes() fd=%d\n", esync->fd );
             mutex->tid = ~0;
             mutex->count = 0;
-            esync_wake_fd( esync->fd );
+            if (esync->fd != -1) esync_wake_fd( esync->fd );
         }
     }
 }
 
+/* Send the esync fd of a freshly opened handle, creating it if needed. If that
+ * fails, close the handle again and return 0. */
+static obj_handle_t send_esync_fd( struct object *obj, obj_handle_t handle )
+{
+    enum esync_type type;
+    int fd;
+
+    if ((fd = obj->ops->get_esync_fd( obj, &type )) == -1)
+    {
+        file_set_error();
+        close_handle( current->process, handle );
+        return 0;
+    }
+    send_client_fd( current->process, fd, handle );
+    return handle;
+}
+
 DECL_HANDLER(create_esync)
 {
     struct esync *esync;
@@ -509,7 +579,8 @@ DECL_HANDLER(create_esync)
 
         reply->type = esync->type;
         reply->shm_idx = esync->shm_idx;
-        send_client_fd( current->process, esync->fd, reply->handle );
+        if (reply->handle && !req->defer_fd)
+            reply->handle = send_esync_fd( &esync->obj, reply->handle );
         release_object( esync );
     }
 
@@ -542,7 +613,8 @@ DECL_HANDLER(open_esync)
         reply->type = esync->type;
         reply->shm_idx = esync->shm_idx;
 
-        send_client_fd( current->process, esync->fd, reply->handle );
+        if (!req->defer_fd)
+            reply->handle = send_esync_fd( &esync->obj, reply->handle );
         release_object( esync );
     }
 }
@@ -560,7 +632,12 @@ DECL_HANDLER(get_esync_fd)
 
     if (obj->ops->get_esync_fd)
     {
-        fd = obj->ops->get_esync_fd( obj, &type );
+        if ((fd = obj->ops->get_esync_fd( obj, &type )) == -1)
+        {
+            file_set_error();
+            release_object( obj );
+            return;
+        }
         reply->type = type;
         if (obj->ops == &esync_ops)
         {
@@ -139,8 +139,7 @@ struct event *create_event( struct object *root, const struct unicode_str *name,
             if (do_fsync())
                 event->fsync_idx = fsync_alloc_shm( initial_state, 0 );
 
-            if (do_esync())
-                event->esync_fd = esync_create_fd( initial_state, 0 );
+            event->esync_fd = -1;
         }
     }
     return event;
@@ -236,7 +235,10 @@ static int event_signaled( struct object *obj, struct wait_queue_entry *entry )
 static int event_get_esync_fd( struct object *obj, enum esync_type *type )
 {
     struct event *event = (struct event *)obj;
+
+    if (!type) return event->esync_fd;
     *type = event->manual_reset ? ESYNC_MANUAL_SERVER : ESYNC_AUTO_SERVER;
+    if (event->esync_fd == -1) event->esync_fd = esync_create_fd( event->signaled, 0 );
     return event->esync_fd;
 }
 
@@ -288,8 +290,11 @@ static void event_destroy( struct object *obj )
 {
     struct event *event = (struct event *)obj;
 
-    if (do_esync())
+    if (event->esync_fd != -1)
         close( event->esync_fd );
+
+    if (do_fsync())
+        fsync_free_shm( event->fsync_idx );
 }
 
 struct keyed_event *create_keyed_event( struct object *root, const struct unicode_str *name,
@@ -21,6 +21,7 @@
 
 #include "config.h"
 #include "wine/port.h"
+#include "wine/rbtree.h"
 
 #include <assert.h>
 #include <dirent.h>
@@ -383,14 +384,32 @@ static file_pos_t max_unix_offset = OFF_T_MAX;
 
 struct timeout_user
 {
-    struct list           entry;      /* entry in sorted timeout list */
+    struct wine_rb_entry  entry;      /* entry in sorted timeout tree */
+    struct list           expired;    /* entry in expired list while callbacks are run */
+    int                   is_expired; /* whether the timeout was moved to the expired list */
     abstime_t             when;       /* timeout expiry */
+    unsigned long long    seq;        /* insertion sequence, to order timeouts with the same expiry */
     timeout_callback      callback;   /* callback function */
     void                 *private;    /* callback private data */
 };
 
-static struct list abs_timeout_list = LIST_INIT(abs_timeout_list); /* sorted absolute timeouts list */
-static struct list rel_timeout_list = LIST_INIT(rel_timeout_list); /* sorted relative timeouts list */
+/* sort timeouts by expiry; absolute and relative timeouts are kept in separate trees */
+static int compare_timeout( const void *key, const struct wine_rb_entry *entry )
+{
+    const struct timeout_user *a = key;
+    const struct timeout_user *b = WINE_RB_ENTRY_VALUE( entry, const struct timeout_user, entry );
+    abstime_t when_a = a->when > 0 ? a->when : -a->when;
+    abstime_t when_b = b->when > 0 ? b->when : -b->when;
+
+    if (when_a != when_b) return when_a < when_b ? -1 : 1;
+    /* timeouts with the same expiry fire most recently added first, as they used to in the sorted list */
+    if (a->seq != b->seq) return a->seq > b->seq ? -1 : 1;
+    return 0;
+}
+
+static struct wine_rb_tree abs_timeout_tree = { compare_timeout }; /* sorted absolute timeouts */
+static struct wine_rb_tree rel_timeout_tree = { compare_timeout }; /* sorted relative timeouts */
+static unsigned long long timeout_seq; /* sequence number of the next timeout */
 timeout_t current_time;
 timeout_t monotonic_time;
 
@@ -444,43 +463,32 @@ void set_current_time(void)
     if (user_shared_data) set_user_shared_data_time();
 }
 
+/* return the tree containing a given timeout */
+static inline struct wine_rb_tree *get_timeout_tree( abstime_t when )
+{
+    return when > 0 ? &abs_timeout_tree : &rel_timeout_tree;
+}
+
 /* add a timeout user */
 struct timeout_user *add_timeout_user( timeout_t when, timeout_callback func, void *private )
 {
     struct timeout_user *user;
-    struct list *ptr;
 
     if (!(user = mem_alloc( sizeof(*user) ))) return NULL;
-    user->when     = timeout_to_abstime( when );
-    user->callback = func;
-    user->private  = private;
-
-    /* Now insert it in the linked list */
-
-    if (user->when > 0)
-    {
-        LIST_FOR_EACH( ptr, &abs_timeout_list )
-        {
-            struct timeout_user *timeout = LIST_ENTRY( ptr, struct timeout_user, entry );
-            if (timeout->when >= user->when) break;
-        }
-    }
-    else
-    {
-        LIST_FOR_EACH( ptr, &rel_timeout_list )
-        {
-            struct timeout_user *timeout = LIST_ENTRY( ptr, struct timeout_user, entry );
-            if (timeout->when <= user->when) break;
-        }
-    }
-    list_add_before( ptr, &user->entry );
+    user->when       = timeout_to_abstime( when );
+    user->callback   = func;
+    user->private    = private;
+    user->is_expired = 0;
+    user->seq        = timeout_seq++;
+    wine_rb_put( get_timeout_tree( user->when ), user, &user->entry );
     return user;
 }
 
 /* remove a timeout user */
 void remove_timeout_user( struct timeout_user *user )
 {
-    list_remove( &user->entry );
+    if (user->is_expired) list_remove( &user->expired );
+    else wine_rb_remove( get_timeout_tree( user->when ), &user->entry );
     free( user );
 }
 
@@ -928,57 +936,54 @@ static int get_next_timeout(void)
 {
     int ret = user_shared_data ? user_shared_data_timeout : -1;
 
-    if (!list_empty( &abs_timeout_list ) || !list_empty( &rel_timeout_list ))
+    if (abs_timeout_tree.root || rel_timeout_tree.root)
     {
         struct list expired_list, *ptr;
+        struct wine_rb_entry *entry;
 
-        /* first remove all expired timers from the list */
+        /* first remove all expired timers from the trees */
 
         list_init( &expired_list );
-        while ((ptr = list_head( &abs_timeout_list )) != NULL)
+        while ((entry = wine_rb_head( abs_timeout_tree.root )))
         {
-            struct timeout_user *timeout = LIST_ENTRY( ptr, struct timeout_user, entry );
+            struct timeout_user *timeout = WINE_RB_ENTRY_VALUE( entry, struct timeout_user, entry );
 
-            if (timeout->when <= current_time)
-            {
-                list_remove( &timeout->entry );
-                list_add_tail( &expired_list, &timeout->entry );
-            }
-            else break;
+            if (timeout->when > current_time) break;
+            wine_rb_remove( &abs_timeout_tree, &timeout->entry );
+            list_add_tail( &expired_list, &timeout->expired );
+            timeout->is_expired = 1;
         }
-        while ((ptr = list_head( &rel_timeout_list )) != NULL)
+        while ((entry = wine_rb_head( rel_timeout_tree.root )))
         {
-            struct timeout_user *timeout = LIST_ENTRY( ptr, struct timeout_user, entry );
+            struct timeout_user *timeout = WINE_RB_ENTRY_VALUE( entry, struct timeout_user, entry );
 
-            if (-timeout->when <= monotonic_time)
-            {
-                list_remove( &timeout->entry );
-                list_add_tail( &expired_list, &timeout->entry );
-            }
-            else break;
+            if (-timeout->when > monotonic_time) break;
+            wine_rb_remove( &rel_timeout_tree, &timeout->entry );
+            list_add_tail( &expired_list, &timeout->expired );
+            timeout->is_expired = 1;
         }
 
         /* now call the callback for all the removed timers */
 
         while ((ptr = list_head( &expired_list )) != NULL)
         {
-            struct timeout_user *timeout = LIST_ENTRY( ptr, struct timeout_user, entry );
-            list_remove( &timeout->entry );
+            struct timeout_user *timeout = LIST_ENTRY( ptr, struct timeout_user, expired );
+            list_remove( &timeout->expired );
             timeout->callback( timeout->private );
             free( timeout );
         }
 
-        if ((ptr = list_head( &abs_timeout_list )) != NULL)
+        if ((entry = wine_rb_head( abs_timeout_tree.root )))
         {
-            struct timeout_user *timeout = LIST_ENTRY( ptr, struct timeout_user, entry );
+            struct timeout_user *timeout = WINE_RB_ENTRY_VALUE( entry, struct timeout_user, entry );
             int diff = (timeout->when - current_time + 9999) / 10000;
             if (diff < 0) diff = 0;
             if (ret == -1 || diff < ret) ret = diff;
         }
 
-        if ((ptr = list_head( &rel_timeout_list )) != NULL)
+        if ((entry = wine_rb_head( rel_timeout_tree.root )))
         {
-            struct timeout_user *timeout = LIST_ENTRY( ptr, struct timeout_user, entry );
+            struct timeout_user *timeout = WINE_RB_ENTRY_VALUE( entry, struct timeout_user, entry );
             int diff = (-timeout->when - monotonic_time + 9999) / 10000;
             if (diff < 0) diff = 0;
             if (ret == -1 || diff < ret) ret = diff;
@@ -1595,8 +1600,11 @@ static void fd_destroy( struct object *obj )
         free( fd->unix_name );
     }
 
-    if (do_esync())
+    if (fd->esync_fd != -1)
         close( fd->esync_fd );
+
+    if (do_fsync())
+        fsync_free_shm( fd->fsync_idx );
 }
 
 /* check if the desired access is possible without violating */
@@ -1719,9 +1727,6 @@ static struct fd *alloc_fd_object(void)
     list_init( &fd->inode_entry );
     list_init( &fd->locks );
 
-    if (do_esync())
-        fd->esync_fd = esync_create_fd( 1, 0 );
-
     if (do_fsync())
         fd->fsync_idx = fsync_alloc_shm( 1, 0 );
 
@@ -1767,9 +1772,6 @@ struct fd *alloc_pseudo_fd( const struct fd_ops *fd_user_ops, struct object *use
     if (do_fsync())
         fd->fsync_idx = fsync_alloc_shm( 0, 0 );
 
-    if (do_esync())
-        fd->esync_fd = esync_create_fd( 0, 0 );
-
     return fd;
 }
 
@@ -2273,8 +2275,14 @@ int default_fd_signaled( struct object *obj, struct wait_queue_entry *entry )
 int default_fd_get_esync_fd( struct object *obj, enum esync_type *type )
 {
     struct fd *fd = get_obj_fd( obj );
-    int ret = fd->esync_fd;
-    *type = ESYNC_MANUAL_SERVER;
+    int ret;
+
+    if (type)
+    {
+        *type = ESYNC_MANUAL_SERVER;
+        if (fd->esync_fd == -1) fd->esync_fd = esync_create_fd( fd->signaled, 0 );
+    }
+    ret = fd->esync_fd;
     release_object( fd );
     return ret;
 }
@@ -90,8 +90,22 @@ static long pagesize;
 
 static int is_fsync_initialized;
 
+/* slots released by destroyed objects, reused before growing the section */
+static unsigned int *shm_free_slots;
+static unsigned int shm_free_count;
+static unsigned int shm_free_size;  /* length of the allocated shm_free_slots array */
+static unsigned int shm_idx_counter = 1;  /* first never used slot */
+static unsigned int shm_live_count;
+
+static void fsync_dump_shm_stats(void)
+{
+    fprintf( stderr, "fsync: %u live slots, %u free slots, %u slots used at most, section size %jd\n",
+             shm_live_count, shm_free_count, shm_idx_counter - 1, shm_size );
+}
+
 static void shm_cleanup(void)
 {
+    if (debug_level) fsync_dump_shm_stats();
     close( shm_fd );
     if (shm_unlink( shm_name ) == -1)
         perror( "shm_unlink" );
@@ -201,12 +215,13 @@ static void fsync_destroy( struct object *obj )
     struct fsync *fsync = (struct fsync *)obj;
     if (fsync->type == FSYNC_MUTEX)
         list_remove( &fsync->mutex_entry );
+    fsync_free_shm( fsync->shm_idx );
 }
 
 static void *get_shm( unsigned int idx )
 {
-    int entry  = (idx * 8) / pagesize;
-    int offset = (idx * 8) % pagesize;
+    int entry  = (idx * FSYNC_SHM_SLOT_SIZE) / pagesize;
+    int offset = (idx * FSYNC_SHM_SLOT_SIZE) % pagesize;
 
     if (entry >= shm_addrs_size)
     {
@@ -239,13 +254,29 @@ static void *get_shm( unsigned int idx )
     return (void *)((unsigned long)shm_addrs[entry] + offset);
 }
 
-/* FIXME: This is rather inefficient... */
-static unsigned int shm_idx_counter = 1;
+static void grow_shm( unsigned int shm_idx )
+{
+    off_t new_size = shm_size;
+
+    /* grow geometrically to keep the number of ftruncate calls logarithmic */
+    while (shm_idx * FSYNC_SHM_SLOT_SIZE >= new_size) new_size *= 2;
+
+    if (ftruncate( shm_fd, new_size ) == -1)
+    {
+        fprintf( stderr, "fsync: couldn't expand %s to size %jd: ",
+            shm_name, new_size );
+        perror( "ftruncate" );
+        return;
+    }
+    shm_size = new_size;
+
+    if (debug_level) fsync_dump_shm_stats();
+}
 
 unsigned int fsync_alloc_shm( int low, int high )
 {
 #ifdef __linux__
-    int shm_idx;
+    unsigned int shm_idx;
     int *shm;
 
     /* this is arguably a bit of a hack, but we need some way to prevent
@@ -253,19 +284,15 @@ unsigned int fsync_alloc_shm( int low, int high )
     if (!is_fsync_initialized)
         return 0;
 
-    shm_idx = shm_idx_counter++;
-
-    while (shm_idx * 8 >= shm_size)
+    if (shm_free_count)
+        shm_idx = shm_free_slots[--shm_free_count];
+    else
     {
-        /* Better expand the shm section. */
-        shm_size += pagesize;
-        if (ftruncate( shm_fd, shm_size ) == -1)
-        {
-            fprintf( stderr, "fsync: couldn't expand %s to size %jd: ",
-                shm_name, shm_size );
-            perror( "ftruncate" );
-        }
+        shm_idx = shm_idx_counter++;
+        if (shm_idx * FSYNC_SHM_SLOT_SIZE >= shm_size)
+            grow_shm( shm_idx );
     }
+    shm_live_count++;
 
     shm = get_shm( shm_idx );
     assert(shm);
@@ -278,6 +305,39 @@ unsigned int fsync_alloc_shm( int low, int high )
 #endif
 }
 
+/* Release a slot allocated by fsync_alloc_shm(). The generation count is
+ * bumped so that clients still caching the slot for a closed handle notice
+ * that it has been recycled. */
+void fsync_free_shm( unsigned int shm_idx )
+{
+#ifdef __linux__
+    int *shm;
+
+    if (!shm_idx) return;
+
+    shm = get_shm( shm_idx );
+    __atomic_add_fetch( (int *)((char *)shm + FSYNC_SHM_GEN_OFFSET), 1, __ATOMIC_SEQ_CST );
+
+    if (shm_free_count == shm_free_size)
+    {
+        unsigned int new_size = max( shm_free_size * 2, 64 );
+        unsigned int *new_slots;
+
+        if (!(new_slots = realloc( shm_free_slots, new_size * sizeof(shm_free_slots[0]) )))
+        {
+            /* leak the slot, it is still safe to never reuse it */
+            fprintf( stderr, "fsync: couldn't expand free slot array to size %u\n", new_size );
+            shm_live_count--;
+            return;
+        }
+        shm_free_slots = new_slots;
+        shm_free_size = new_size;
+    }
+    shm_free_slots[shm_free_count++] = shm_idx;
+    shm_live_count--;
+#endif
+}
+
 static int type_matches( enum fsync_type type1, enum fsync_type type2 )
 {
     return (type1 == type2) ||
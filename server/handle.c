@@ -47,12 +47,15 @@ struct handle_entry
 
 struct handle_table
 {
-    struct object        obj;         /* object header */
-    struct process      *process;     /* process owning this table */
-    int                  count;       /* number of allocated entries */
-    int                  last;        /* last used entry */
-    int                  free;        /* first entry that may be free */
-    struct handle_entry *entries;     /* handle entries */
+    struct object         obj;         /* object header */
+    struct process       *process;     /* process owning this table */
+    int                   count;       /* number of allocated entries */
+    int                   last;        /* last used entry */
+    int                   free;        /* first free entry (count if none) */
+    int                   max_blocks;  /* size of the blocks array */
+    struct handle_entry **blocks;      /* blocks of HANDLE_BLOCK_SIZE handle entries */
+    unsigned int         *free_map;    /* bitmap of free entries */
+    unsigned int         *free_words;  /* bitmap of free_map words that have a free entry */
 };
 
 static struct handle_table *global_table;
@@ -63,9 +66,18 @@ static struct handle_table *global_table;
 #define RESERVED_CLOSE_PROTECT (HANDLE_FLAG_PROTECT_FROM_CLOSE << RESERVED_SHIFT)
 #define RESERVED_ALL           (RESERVED_INHERIT | RESERVED_CLOSE_PROTECT)
 
-#define MIN_HANDLE_ENTRIES  32
 #define MAX_HANDLE_ENTRIES  0x00ffffff
 
+/* entries are allocated in fixed-size blocks so that growing the table never moves them */
+#define HANDLE_BLOCK_SHIFT  8
+#define HANDLE_BLOCK_SIZE   (1 << HANDLE_BLOCK_SHIFT)
+#define MIN_HANDLE_BLOCKS   4
+#define MAX_HANDLE_BLOCKS   (MAX_HANDLE_ENTRIES >> HANDLE_BLOCK_SHIFT)
+
+/* number of free_map words per block, and number of free_words words for a given number of blocks */
+#define FREE_MAP_BLOCK_WORDS  (HANDLE_BLOCK_SIZE / 32)
+#define FREE_WORDS_COUNT(blocks) (((blocks) * FREE_MAP_BLOCK_WORDS + 31) / 32)
+
 
 /* handle to table index conversion */
 
@@ -140,6 +152,66 @@ static const struct object_ops handle_table_ops =
     handle_table_destroy             /* destroy */
 };
 
+/* return the entry for a given table index */
+static inline struct handle_entry *get_entry( struct handle_table *table, int index )
+{
+    return table->blocks[index >> HANDLE_BLOCK_SHIFT] + (index & (HANDLE_BLOCK_SIZE - 1));
+}
+
+/* mark an entry as free in the free bitmaps */
+static inline void set_entry_free( struct handle_table *table, int index )
+{
+    unsigned int word = index / 32;
+
+    table->free_map[word] |= 1u << (index % 32);
+    table->free_words[word / 32] |= 1u << (word % 32);
+    if (index < table->free) table->free = index;
+}
+
+/* mark an entry as used in the free bitmaps */
+static inline void set_entry_used( struct handle_table *table, int index )
+{
+    unsigned int word = index / 32;
+
+    if (!(table->free_map[word] &= ~(1u << (index % 32))))
+        table->free_words[word / 32] &= ~(1u << (word % 32));
+}
+
+/* mark all the entries of a block as free or used in the free bitmaps */
+static void set_block_free( struct handle_table *table, int block, int free )
+{
+    unsigned int i, word = block * FREE_MAP_BLOCK_WORDS;
+
+    for (i = word; i < word + FREE_MAP_BLOCK_WORDS; i++)
+    {
+        table->free_map[i] = free ? ~0u : 0;
+        if (free) table->free_words[i / 32] |= 1u << (i % 32);
+        else table->free_words[i / 32] &= ~(1u << (i % 32));
+    }
+}
+
+/* find the first free entry at or after a given index, return count if none */
+static int find_free_entry( struct handle_table *table, int index )
+{
+    unsigned int i, word, bits, count = table->count / 32;
+
+    if (index >= table->count) return table->count;
+    word = index / 32;
+    if ((bits = table->free_map[word] & (~0u << (index % 32))))
+        return word * 32 + ffs( bits ) - 1;
+
+    for (word++, i = word / 32; i < (count + 31) / 32; i++)
+    {
+        bits = table->free_words[i];
+        if (i == word / 32) bits &= ~0u << (word % 32);
+        if (!bits) continue;
+        word = i * 32 + ffs( bits ) - 1;
+        if (word >= count) break;
+        return word * 32 + ffs( table->free_map[word] ) - 1;
+    }
+    return table->count;
+}
+
 /* dump a handle table */
 static void handle_table_dump( struct object *obj, int verbose )
 {
@@ -152,9 +224,9 @@ static void handle_table_dump( struct object *obj, int verbose )
     fprintf( stderr, "Handle table last=%d count=%d process=%p\n",
              table->last, table->count, table->process );
     if (!verbose) return;
-    entry = table->entries;
-    for (i = 0; i <= table->last; i++, entry++)
+    for (i = 0; i <= table->last; i++)
     {
+        entry = get_entry( table, i );
         if (!entry->ptr) continue;
         fprintf( stderr, "    %04x: %p %08x ",
                  index_to_handle(i), entry->ptr, entry->access );
@@ -175,20 +247,25 @@ static void handle_table_destroy( struct object *obj )
     /* first notify all objects that handles are being closed */
     if (table->process)
     {
-        for (i = 0, entry = table->entries; i <= table->last; i++, entry++)
+        for (i = 0; i <= table->last; i++)
         {
-            struct object *obj = entry->ptr;
+            struct object *obj = get_entry( table, i )->ptr;
             if (obj) obj->ops->close_handle( obj, table->process, index_to_handle(i) );
         }
     }
 
-    for (i = 0, entry = table->entries; i <= table->last; i++, entry++)
+    for (i = 0; i <= table->last; i++)
     {
-        struct object *obj = entry->ptr;
+        struct object *obj;
+        entry = get_entry( table, i );
+        obj = entry->ptr;
         entry->ptr = NULL;
         if (obj) release_object_from_handle( obj );
     }
-    free( table->entries );
+    for (i = 0; i < table->count >> HANDLE_BLOCK_SHIFT; i++) free( table->blocks[i] );
+    free( table->blocks );
+    free( table->free_map );
+    free( table->free_words );
 }
 
 /* close all the process handles and free the handle table */
@@ -200,55 +277,78 @@ void close_process_handles( struct process *process )
     if (table) release_object( table );
 }
 
+/* resize the blocks array and the free bitmaps */
+static int resize_block_array( struct handle_table *table, int max_blocks )
+{
+    struct handle_entry **blocks;
+    unsigned int *map;
+
+    if (!(blocks = realloc( table->blocks, max_blocks * sizeof(*blocks) ))) return 0;
+    table->blocks = blocks;
+    if (!(map = realloc( table->free_map, max_blocks * FREE_MAP_BLOCK_WORDS * sizeof(*map) ))) return 0;
+    table->free_map = map;
+    if (!(map = realloc( table->free_words, FREE_WORDS_COUNT( max_blocks ) * sizeof(*map) ))) return 0;
+    /* clear the summary bits that may be past the end of the previous array */
+    if (max_blocks > table->max_blocks)
+        memset( map + FREE_WORDS_COUNT( table->max_blocks ), 0,
+                (FREE_WORDS_COUNT( max_blocks ) - FREE_WORDS_COUNT( table->max_blocks )) * sizeof(*map) );
+    table->free_words = map;
+    table->max_blocks = max_blocks;
+    return 1;
+}
+
+/* grow a handle table by one block of entries */
+static int grow_handle_table( struct handle_table *table )
+{
+    int block = table->count >> HANDLE_BLOCK_SHIFT;
+
+    if (block >= MAX_HANDLE_BLOCKS) goto error;
+    if (block >= table->max_blocks &&
+        !resize_block_array( table, min( table->max_blocks * 2, MAX_HANDLE_BLOCKS ))) goto error;
+    if (!(table->blocks[block] = malloc( HANDLE_BLOCK_SIZE * sizeof(struct handle_entry) ))) goto error;
+    memset( table->blocks[block], 0, HANDLE_BLOCK_SIZE * sizeof(struct handle_entry) );
+    set_block_free( table, block, 1 );
+    table->count += HANDLE_BLOCK_SIZE;
+    return 1;
+
+error:
+    set_error( STATUS_INSUFFICIENT_RESOURCES );
+    return 0;
+}
+
 /* allocate a new handle table */
 struct handle_table *alloc_handle_table( struct process *process, int count )
 {
     struct handle_table *table;
+    int blocks = max( MIN_HANDLE_BLOCKS, (count + HANDLE_BLOCK_SIZE - 1) >> HANDLE_BLOCK_SHIFT );
 
-    if (count < MIN_HANDLE_ENTRIES) count = MIN_HANDLE_ENTRIES;
     if (!(table = alloc_object( &handle_table_ops )))
         return NULL;
-    table->process = process;
-    table->count   = count;
-    table->last    = -1;
-    table->free    = 0;
-    if ((table->entries = mem_alloc( count * sizeof(*table->entries) ))) return table;
+    table->process    = process;
+    table->count      = 0;
+    table->last       = -1;
+    table->free       = 0;
+    table->max_blocks = 0;
+    table->blocks     = NULL;
+    table->free_map   = NULL;
+    table->free_words = NULL;
+    if (resize_block_array( table, min( blocks, MAX_HANDLE_BLOCKS ) ) && grow_handle_table( table ))
+        return table;
     release_object( table );
     return NULL;
 }
 
-/* grow a handle table */
-static int grow_handle_table( struct handle_table *table )
-{
-    struct handle_entry *new_entries;
-    int count = min( table->count * 2, MAX_HANDLE_ENTRIES );
-
-    if (count == table->count ||
-        !(new_entries = realloc( table->entries, count * sizeof(struct handle_entry) )))
-    {
-        set_error( STATUS_INSUFFICIENT_RESOURCES );
-        return 0;
-    }
-    table->entries = new_entries;
-    table->count   = count;
-    return 1;
-}
-
 /* allocate the first free entry in the handle table */
 static obj_handle_t alloc_entry( struct handle_table *table, void *obj, unsigned int access )
 {
-    struct handle_entry *entry = table->entries + table->free;
-    int i;
+    struct handle_entry *entry;
+    int i = table->free;
 
-    for (i = table->free; i <= table->last; i++, entry++) if (!entry->ptr) goto found;
-    if (i >= table->count)
-    {
-        if (!grow_handle_table( table )) return 0;
-        entry = table->entries + i;  /* the entries may have moved */
-    }
-    table->last = i;
- found:
-    table->free = i + 1;
+    if (i >= table->count && !grow_handle_table( table )) return 0;
+    set_entry_used( table, i );
+    if (i > table->last) table->last = i;
+    table->free = find_free_entry( table, i + 1 );
+    entry = get_entry( table, i );
     entry->ptr    = grab_object_for_handle( obj );
     entry->access = access;
     return index_to_handle(i);
@@ -329,7 +429,7 @@ static struct handle_entry *get_handle( struct process *process, obj_handle_t ha
     index = handle_to_index( handle );
     if (index < 0) return NULL;
     if (index > table->last) return NULL;
-    entry = table->entries + index;
+    entry = get_entry( table, index );
     if (!entry->ptr) return NULL;
     return entry;
 }
@@ -337,22 +437,22 @@ static struct handle_entry *get_handle( struct process *process, obj_handle_t ha
 /* attempt to shrink a table */
 static void shrink_handle_table( struct handle_table *table )
 {
-    struct handle_entry *entry = table->entries + table->last;
-    struct handle_entry *new_entries;
-    int count = table->count;
+    int blocks = table->count >> HANDLE_BLOCK_SHIFT;
 
     while (table->last >= 0)
     {
-        if (entry->ptr) break;
+        if (get_entry( table, table->last )->ptr) break;
         table->last--;
-        entry--;
     }
-    if (table->last >= count / 4) return;  /* no need to shrink */
-    if (count < MIN_HANDLE_ENTRIES * 2) return;  /* too small to shrink */
-    count /= 2;
-    if (!(new_entries = realloc( table->entries, count * sizeof(*new_entries) ))) return;
-    table->count   = count;
-    table->entries = new_entries;
+    /* keep one spare block past the last used one */
+    while (blocks > MIN_HANDLE_BLOCKS && blocks > (table->last >> HANDLE_BLOCK_SHIFT) + 2)
+    {
+        blocks--;
+        set_block_free( table, blocks, 0 );
+        free( table->blocks[blocks] );
+        table->count -= HANDLE_BLOCK_SIZE;
+    }
+    if (table->free > table->count) table->free = table->count;
 }
 
 /* copy the handle table of the parent process */
@@ -361,25 +461,32 @@ struct handle_table *copy_handle_table( struct process *process, struct process
 {
     struct handle_table *parent_table = parent->handles;
     struct handle_table *table;
+    struct handle_entry *ptr;
     int i;
 
     assert( parent_table );
     assert( parent_table->obj.ops == &handle_table_ops );
 
-    if (!(table = alloc_handle_table( process, parent_table->count )))
+    if (!(table = alloc_handle_table( process, parent_table->last + 1 )))
         return NULL;
 
-    if ((table->last = parent_table->last) >= 0)
+    while (table->count <= parent_table->last)
     {
-        struct handle_entry *ptr = table->entries;
-        memcpy( ptr, parent_table->entries, (table->last + 1) * sizeof(struct handle_entry) );
-        for (i = 0; i <= table->last; i++, ptr++)
-        {
-            if (!ptr->ptr) continue;
-            if (ptr->access & RESERVED_INHERIT) grab_object_for_handle( ptr->ptr );
-            else ptr->ptr = NULL; /* don't inherit this entry */
-        }
+        if (grow_handle_table( table )) continue;
+        release_object( table );
+        return NULL;
+    }
+
+    for (i = 0; i <= parent_table->last; i++)
+    {
+        ptr = get_entry( parent_table, i );
+        if (!ptr->ptr || !(ptr->access & RESERVED_INHERIT)) continue;  /* don't inherit this entry */
+        *get_entry( table, i ) = *ptr;
+        grab_object_for_handle( ptr->ptr );
+        set_entry_used( table, i );
+        table->last = i;
     }
+    table->free = find_free_entry( table, 0 );
     /* attempt to shrink the table */
     shrink_handle_table( table );
     return table;
@@ -391,15 +498,25 @@ unsigned int close_handle( struct process *process, obj_handle_t handle )
     struct handle_table *table;
     struct handle_entry *entry;
     struct object *obj;
+    int index;
 
     if (!(entry = get_handle( process, handle ))) return STATUS_INVALID_HANDLE;
     if (entry->access & RESERVED_CLOSE_PROTECT) return STATUS_HANDLE_NOT_CLOSABLE;
     obj = entry->ptr;
     if (!obj->ops->close_handle( obj, process, handle )) return STATUS_HANDLE_NOT_CLOSABLE;
     entry->ptr = NULL;
-    table = handle_is_global(handle) ? global_table : process->handles;
-    if (entry < table->entries + table->free) table->free = entry - table->entries;
-    if (entry == table->entries + table->last) shrink_handle_table( table );
+    if (handle_is_global(handle))
+    {
+        table = global_table;
+        index = handle_to_index( handle_global_to_local( handle ));
+    }
+    else
+    {
+        table = process->handles;
+        index = handle_to_index( handle );
+    }
+    set_entry_free( table, index );
+    if (index == table->last) shrink_handle_table( table );
     release_object_from_handle( obj );
     return STATUS_SUCCESS;
 }
@@ -479,8 +596,9 @@ obj_handle_t find_inherited_handle( struct process *process, const struct object
 
     if (!table) return 0;
 
-    for (i = 0, ptr = table->entries; i <= table->last; i++, ptr++)
+    for (i = 0; i <= table->last; i++)
     {
+        ptr = get_entry( table, i );
         if (!ptr->ptr) continue;
         if (ptr->ptr->ops != ops) continue;
         if (ptr->access & RESERVED_INHERIT) return index_to_handle(i);
@@ -499,8 +617,9 @@ obj_handle_t enumerate_handles( struct process *process, const struct object_ops
 
     if (!table) return 0;
 
-    for (i = *index, entry = &table->entries[i]; i <= table->last; i++, entry++)
+    for (i = *index; (int)i <= table->last; i++)
     {
+        entry = get_entry( table, i );
         if (!entry->ptr) continue;
         if (entry->ptr->ops != ops) continue;
         *index = i + 1;
@@ -797,8 +916,9 @@ static int enum_handles( struct process *process, void *user )
     if (!table)
         return 0;
 
-    for (i = 0, entry = table->entries; i <= table->last; i++, entry++)
+    for (i = 0; (int)i <= table->last; i++)
     {
+        entry = get_entry( table, i );
         if (!entry->ptr) continue;
         if (!info->handle)
         {
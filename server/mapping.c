@@ -978,6 +978,23 @@ struct object *create_user_data_mapping( struct object *root, const struct unico
     return &mapping->obj;
 }
 
+/* create an anonymous mapping that is also mapped in the server address space */
+struct object *create_shared_mapping( mem_size_t size, void **ptr )
+{
+    static const struct unicode_str empty_str;
+    struct mapping *mapping;
+
+    if (!(mapping = create_mapping( NULL, &empty_str, 0, size, SEC_COMMIT, 0,
+                                    FILE_READ_DATA | FILE_WRITE_DATA, NULL ))) return NULL;
+    *ptr = mmap( NULL, mapping->size, PROT_READ | PROT_WRITE, MAP_SHARED, get_unix_fd( mapping->fd ), 0 );
+    if (*ptr == MAP_FAILED)
+    {
+        release_object( mapping );
+        return NULL;
+    }
+    return &mapping->obj;
+}
+
 /* create a file mapping */
 DECL_HANDLER(create_mapping)
 {
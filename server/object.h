@@ -68,7 +68,8 @@ struct object_ops
     void (*remove_queue)(struct object *,struct wait_queue_entry *);
     /* is object signaled? */
     int  (*signaled)(struct object *,struct wait_queue_entry *);
-    /* return the esync fd for this object */
+    /* return the esync fd for this object, creating it if needed; with a NULL
+     * type, only return the fd if it already exists and -1 otherwise */
     int (*get_esync_fd)(struct object *, enum esync_type *type);
     /* return the fsync shm idx for this object */
     unsigned int (*get_fsync_idx)(struct object *, enum fsync_type *type);
@@ -655,6 +655,7 @@ static void process_destroy( struct object *obj )
     if (process->token) release_object( process->token );
     free( process->dir_cache );
     if (do_esync()) close( process->esync_fd );
+    if (do_fsync()) fsync_free_shm( process->fsync_idx );
 }
 
 /* dump a process on stdout for debugging purposes */
@@ -682,7 +683,7 @@ static int process_signaled( struct object *obj, struct wait_queue_entry *entry
 static int process_get_esync_fd( struct object *obj, enum esync_type *type )
 {
     struct process *process = (struct process *)obj;
-    *type = ESYNC_MANUAL_SERVER;
+    if (type) *type = ESYNC_MANUAL_SERVER;
     return process->esync_fd;
 }
 
@@ -401,6 +401,7 @@ static int update_desktop_cursor_pos( struct desktop *desktop, int x, int y )
     desktop->cursor.x = x;
     desktop->cursor.y = y;
     desktop->cursor.last_change = get_tick_count();
+    update_desktop_shared( desktop );
 
     return updated;
 }
@@ -454,6 +455,7 @@ static void set_clip_rectangle( struct desktop *desktop, const rectangle_t *rect
         desktop->cursor.clip = new_rect;
     }
     else desktop->cursor.clip = top_rect;
+    update_desktop_shared( desktop );
 
     if (desktop->cursor.clip_msg && send_clip_msg)
         post_desktop_message( desktop, desktop->cursor.clip_msg, rect != NULL, 0 );
@@ -1027,7 +1029,7 @@ static int msg_queue_signaled( struct object *obj, struct wait_queue_entry *entr
 static int msg_queue_get_esync_fd( struct object *obj, enum esync_type *type )
 {
     struct msg_queue *queue = (struct msg_queue *)obj;
-    *type = ESYNC_QUEUE;
+    if (type) *type = ESYNC_QUEUE;
     return queue->esync_fd;
 }
 
@@ -1081,6 +1083,7 @@ static void msg_queue_destroy( struct object *obj )
     release_object( queue->input );
     if (queue->hooks) release_object( queue->hooks );
     if (queue->fd) release_object( queue->fd );
+    if (do_fsync()) fsync_free_shm( queue->fsync_idx );
 }
 
 static void msg_queue_poll_event( struct fd *fd, int event )
@@ -1409,6 +1412,7 @@ static void update_input_key_state( struct desktop *desktop, unsigned char *keys
         }
         break;
     }
+    if (keystate == desktop->keystate) update_desktop_shared( desktop );
 }
 
 /* update the desktop key state according to a mouse message flags */
@@ -3101,6 +3105,7 @@ DECL_HANDLER(get_key_state)
         {
             reply->state = desktop->keystate[req->key & 0xff];
             desktop->keystate[req->key & 0xff] &= ~0x40;
+            update_desktop_shared( desktop );
         }
         set_reply_data( desktop->keystate, size );
         release_object( desktop );
@@ -3142,6 +3147,7 @@ DECL_HANDLER(set_key_state)
     {
         if (!(desktop = get_thread_desktop( current, 0 ))) return;
         memcpy( desktop->keystate, get_req_data(), size );
+        update_desktop_shared( desktop );
         release_object( desktop );
     }
     else
@@ -3151,6 +3157,7 @@ DECL_HANDLER(set_key_state)
         if (req->async && (desktop = get_thread_desktop( thread, 0 )))
         {
             memcpy( desktop->keystate, get_req_data(), size );
+            update_desktop_shared( desktop );
             release_object( desktop );
         }
         release_object( thread );
@@ -331,6 +331,106 @@ static void call_req_handler( struct thread *thread )
     current = NULL;
 }
 
+/* check whether a request can be submitted through batch_requests */
+static int is_batch_request_allowed( enum request req )
+{
+    switch (req)
+    {
+    case REQ_close_handle:
+    case REQ_enum_key:
+    case REQ_enum_key_value:
+    case REQ_get_key_value:
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+/* size of a request or reply var data once padded in a batch */
+static inline data_size_t batch_data_size( data_size_t size )
+{
+    return (size + 7) & ~7;
+}
+
+/* perform several requests in a single round trip */
+DECL_HANDLER(batch_requests)
+{
+    const char *data = get_req_data();
+    const char *end = data + get_req_data_size();
+    data_size_t reply_max = get_reply_max_size(), reply_pos = 0;
+    union generic_request batch = current->req;
+    void *batch_data = current->req_data;
+    union generic_reply sub_reply;
+    char *replies = NULL;
+    unsigned int error = STATUS_SUCCESS;
+
+    reply->count = 0;
+    if (reply_max && !(replies = mem_alloc( reply_max ))) return;
+
+    while (data < end)
+    {
+        data_size_t size;
+        enum request sub_req;
+
+        if (end - data < sizeof(current->req))
+        {
+            error = STATUS_INVALID_PARAMETER;
+            break;
+        }
+        memcpy( &current->req, data, sizeof(current->req) );
+        sub_req = current->req.request_header.req;
+        size = current->req.request_header.request_size;
+        if (size > end - data - sizeof(current->req))
+        {
+            error = STATUS_INVALID_PARAMETER;
+            break;
+        }
+        /* stop when the reply doesn't fit, the client will resubmit the remaining requests */
+        if (sizeof(sub_reply) + batch_data_size( current->req.request_header.reply_size ) >
+            reply_max - reply_pos) break;
+
+        current->req_data   = (void *)(data + sizeof(current->req));
+        current->reply_data = NULL;
+        current->reply_size = 0;
+        clear_error();
+        memset( &sub_reply, 0, sizeof(sub_reply) );
+
+        if (debug_level) trace_request();
+        if (is_batch_request_allowed( sub_req ))
+            req_handlers[sub_req]( &current->req, &sub_reply );
+        else
+            set_error( STATUS_NOT_SUPPORTED );
+
+        sub_reply.reply_header.error = current->error;
+        sub_reply.reply_header.reply_size = current->reply_size;
+        if (debug_level) trace_reply( sub_req, &sub_reply );
+
+        memcpy( replies + reply_pos, &sub_reply, sizeof(sub_reply) );
+        reply_pos += sizeof(sub_reply);
+        if (current->reply_size)
+        {
+            size = batch_data_size( current->reply_size );
+            memcpy( replies + reply_pos, current->reply_data, current->reply_size );
+            memset( replies + reply_pos + current->reply_size, 0, size - current->reply_size );
+            reply_pos += size;
+            free( current->reply_data );
+        }
+        reply->count++;
+
+        size = batch_data_size( current->req.request_header.request_size );
+        if (size >= end - data - sizeof(current->req)) break;
+        data += sizeof(current->req) + size;
+    }
+
+    current->req        = batch;
+    current->req_data   = batch_data;
+    current->reply_data = NULL;
+    current->reply_size = 0;
+    set_error( error );
+    if (reply_pos) set_reply_data_ptr( replies, reply_pos );
+    else free( replies );
+}
+
 /* read a request from a thread */
 void read_request( struct thread *thread )
 {
@@ -142,6 +142,7 @@ DECL_HANDLER(unload_dll);
 DECL_HANDLER(queue_apc);
 DECL_HANDLER(get_apc_result);
 DECL_HANDLER(close_handle);
+DECL_HANDLER(batch_requests);
 DECL_HANDLER(set_handle_info);
 DECL_HANDLER(dup_handle);
 DECL_HANDLER(make_temporary);
@@ -307,6 +308,7 @@ DECL_HANDLER(open_input_desktop);
 DECL_HANDLER(close_desktop);
 DECL_HANDLER(get_thread_desktop);
 DECL_HANDLER(set_thread_desktop);
+DECL_HANDLER(get_desktop_shared_memory);
 DECL_HANDLER(enum_desktop);
 DECL_HANDLER(set_user_object_info);
 DECL_HANDLER(register_hotkey);
@@ -383,6 +385,7 @@ DECL_HANDLER(create_completion);
 DECL_HANDLER(open_completion);
 DECL_HANDLER(add_completion);
 DECL_HANDLER(remove_completion);
+DECL_HANDLER(remove_completions);
 DECL_HANDLER(query_completion);
 DECL_HANDLER(set_completion_info);
 DECL_HANDLER(add_fd_completion);
@@ -447,6 +450,7 @@ static const req_handler req_handlers[REQ_NB_REQUESTS] =
     (req_handler)req_queue_apc,
     (req_handler)req_get_apc_result,
     (req_handler)req_close_handle,
+    (req_handler)req_batch_requests,
     (req_handler)req_set_handle_info,
     (req_handler)req_dup_handle,
     (req_handler)req_make_temporary,
@@ -612,6 +616,7 @@ static const req_handler req_handlers[REQ_NB_REQUESTS] =
     (req_handler)req_close_desktop,
     (req_handler)req_get_thread_desktop,
     (req_handler)req_set_thread_desktop,
+    (req_handler)req_get_desktop_shared_memory,
     (req_handler)req_enum_desktop,
     (req_handler)req_set_user_object_info,
     (req_handler)req_register_hotkey,
@@ -688,6 +693,7 @@ static const req_handler req_handlers[REQ_NB_REQUESTS] =
     (req_handler)req_open_completion,
     (req_handler)req_add_completion,
     (req_handler)req_remove_completion,
+    (req_handler)req_remove_completions,
     (req_handler)req_query_completion,
     (req_handler)req_set_completion_info,
     (req_handler)req_add_fd_completion,
@@ -911,6 +917,9 @@ C_ASSERT( FIELD_OFFSET(struct get_apc_result_reply, result) == 8 );
 C_ASSERT( sizeof(struct get_apc_result_reply) == 48 );
 C_ASSERT( FIELD_OFFSET(struct close_handle_request, handle) == 12 );
 C_ASSERT( sizeof(struct close_handle_request) == 16 );
+C_ASSERT( sizeof(struct batch_requests_request) == 16 );
+C_ASSERT( FIELD_OFFSET(struct batch_requests_reply, count) == 8 );
+C_ASSERT( sizeof(struct batch_requests_reply) == 16 );
 C_ASSERT( FIELD_OFFSET(struct set_handle_info_request, handle) == 12 );
 C_ASSERT( FIELD_OFFSET(struct set_handle_info_request, flags) == 16 );
 C_ASSERT( FIELD_OFFSET(struct set_handle_info_request, mask) == 20 );
@@ -1823,6 +1832,9 @@ C_ASSERT( FIELD_OFFSET(struct get_thread_desktop_reply, handle) == 8 );
 C_ASSERT( sizeof(struct get_thread_desktop_reply) == 16 );
 C_ASSERT( FIELD_OFFSET(struct set_thread_desktop_request, handle) == 12 );
 C_ASSERT( sizeof(struct set_thread_desktop_request) == 16 );
+C_ASSERT( sizeof(struct get_desktop_shared_memory_request) == 16 );
+C_ASSERT( FIELD_OFFSET(struct get_desktop_shared_memory_reply, handle) == 8 );
+C_ASSERT( sizeof(struct get_desktop_shared_memory_reply) == 16 );
 C_ASSERT( FIELD_OFFSET(struct enum_desktop_request, winstation) == 12 );
 C_ASSERT( FIELD_OFFSET(struct enum_desktop_request, index) == 16 );
 C_ASSERT( sizeof(struct enum_desktop_request) == 24 );
@@ -2270,6 +2282,9 @@ C_ASSERT( FIELD_OFFSET(struct remove_completion_reply, cvalue) == 16 );
 C_ASSERT( FIELD_OFFSET(struct remove_completion_reply, information) == 24 );
 C_ASSERT( FIELD_OFFSET(struct remove_completion_reply, status) == 32 );
 C_ASSERT( sizeof(struct remove_completion_reply) == 40 );
+C_ASSERT( FIELD_OFFSET(struct remove_completions_request, handle) == 12 );
+C_ASSERT( sizeof(struct remove_completions_request) == 16 );
+C_ASSERT( sizeof(struct remove_completions_reply) == 8 );
 C_ASSERT( FIELD_OFFSET(struct query_completion_request, handle) == 12 );
 C_ASSERT( sizeof(struct query_completion_request) == 16 );
 C_ASSERT( FIELD_OFFSET(struct query_completion_reply, depth) == 8 );
@@ -2379,6 +2394,7 @@ C_ASSERT( FIELD_OFFSET(struct create_esync_request, access) == 12 );
 C_ASSERT( FIELD_OFFSET(struct create_esync_request, initval) == 16 );
 C_ASSERT( FIELD_OFFSET(struct create_esync_request, type) == 20 );
 C_ASSERT( FIELD_OFFSET(struct create_esync_request, max) == 24 );
+C_ASSERT( FIELD_OFFSET(struct create_esync_request, defer_fd) == 28 );
 C_ASSERT( sizeof(struct create_esync_request) == 32 );
 C_ASSERT( FIELD_OFFSET(struct create_esync_reply, handle) == 8 );
 C_ASSERT( FIELD_OFFSET(struct create_esync_reply, type) == 12 );
@@ -2388,6 +2404,7 @@ C_ASSERT( FIELD_OFFSET(struct open_esync_request, access) == 12 );
 C_ASSERT( FIELD_OFFSET(struct open_esync_request, attributes) == 16 );
 C_ASSERT( FIELD_OFFSET(struct open_esync_request, rootdir) == 20 );
 C_ASSERT( FIELD_OFFSET(struct open_esync_request, type) == 24 );
+C_ASSERT( FIELD_OFFSET(struct open_esync_request, defer_fd) == 28 );
 C_ASSERT( sizeof(struct open_esync_request) == 32 );
 C_ASSERT( FIELD_OFFSET(struct open_esync_reply, handle) == 8 );
 C_ASSERT( FIELD_OFFSET(struct open_esync_reply, type) == 12 );
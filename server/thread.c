@@ -231,6 +231,7 @@ static inline void init_thread_structure( struct thread *thread )
     thread->esync_fd        = -1;
     thread->esync_apc_fd    = -1;
     thread->fsync_idx       = 0;
+    thread->fsync_apc_idx   = 0;
     thread->debug_ctx       = NULL;
     thread->system_regs     = 0;
     thread->queue           = NULL;
@@ -460,6 +461,12 @@ static void destroy_thread( struct object *obj )
 
     if (do_esync())
         close( thread->esync_fd );
+
+    if (do_fsync())
+    {
+        fsync_free_shm( thread->fsync_idx );
+        fsync_free_shm( thread->fsync_apc_idx );
+    }
 }
 
 /* dump a thread on stdout for debugging purposes */
@@ -488,7 +495,7 @@ static int thread_signaled( struct object *obj, struct wait_queue_entry *entry )
 static int thread_get_esync_fd( struct object *obj, enum esync_type *type )
 {
     struct thread *thread = (struct thread *)obj;
-    *type = ESYNC_MANUAL_SERVER;
+    if (type) *type = ESYNC_MANUAL_SERVER;
     return thread->esync_fd;
 }
 
@@ -110,9 +110,6 @@ static struct timer *create_timer( struct object *root, const struct unicode_str
 
             if (do_fsync())
                 timer->fsync_idx = fsync_alloc_shm( 0, 0 );
-
-            if (do_esync())
-                timer->esync_fd = esync_create_fd( 0, 0 );
         }
     }
     return timer;
@@ -228,7 +225,10 @@ static int timer_signaled( struct object *obj, struct wait_queue_entry *entry )
 static int timer_get_esync_fd( struct object *obj, enum esync_type *type )
 {
     struct timer *timer = (struct timer *)obj;
+
+    if (!type) return timer->esync_fd;
     *type = timer->manual ? ESYNC_MANUAL_SERVER : ESYNC_AUTO_SERVER;
+    if (timer->esync_fd == -1) timer->esync_fd = esync_create_fd( timer->signaled, 0 );
     return timer->esync_fd;
 }
 
@@ -262,6 +262,8 @@ static void timer_destroy( struct object *obj )
 
     if (timer->timeout) remove_timeout_user( timer->timeout );
     if (timer->thread) release_object( timer->thread );
+    if (timer->esync_fd != -1) close( timer->esync_fd );
+    if (do_fsync()) fsync_free_shm( timer->fsync_idx );
 }
 
 /* create a timer */
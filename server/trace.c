@@ -903,6 +903,25 @@ static void dump_varargs_cursor_positions( const char *prefix, data_size_t size
     remove_data( size );
 }
 
+static void dump_varargs_completion_msgs( const char *prefix, data_size_t size )
+{
+    const completion_msg_t *msg = cur_data;
+    data_size_t len = size / sizeof(*msg);
+
+    fprintf( stderr, "%s{", prefix );
+    while (len > 0)
+    {
+        dump_uint64( "{ckey=", &msg->ckey );
+        dump_uint64( ",cvalue=", &msg->cvalue );
+        dump_uint64( ",information=", &msg->information );
+        fprintf( stderr, ",status=%s}", get_status_name( msg->status ) );
+        msg++;
+        if (--len) fputc( ',', stderr );
+    }
+    fputc( '}', stderr );
+    remove_data( size );
+}
+
 static void dump_varargs_message_data( const char *prefix, data_size_t size )
 {
     /* FIXME: dump the structured data */
@@ -1585,6 +1604,17 @@ static void dump_close_handle_request( const struct close_handle_request *req )
     fprintf( stderr, " handle=%04x", req->handle );
 }
 
+static void dump_batch_requests_request( const struct batch_requests_request *req )
+{
+    dump_varargs_bytes( " requests=", cur_size );
+}
+
+static void dump_batch_requests_reply( const struct batch_requests_reply *req )
+{
+    fprintf( stderr, " count=%08x", req->count );
+    dump_varargs_bytes( ", replies=", cur_size );
+}
+
 static void dump_set_handle_info_request( const struct set_handle_info_request *req )
 {
     fprintf( stderr, " handle=%04x", req->handle );
@@ -3419,6 +3449,15 @@ static void dump_set_thread_desktop_request( const struct set_thread_desktop_req
     fprintf( stderr, " handle=%04x", req->handle );
 }
 
+static void dump_get_desktop_shared_memory_request( const struct get_desktop_shared_memory_request *req )
+{
+}
+
+static void dump_get_desktop_shared_memory_reply( const struct get_desktop_shared_memory_reply *req )
+{
+    fprintf( stderr, " handle=%04x", req->handle );
+}
+
 static void dump_enum_desktop_request( const struct enum_desktop_request *req )
 {
     fprintf( stderr, " winstation=%04x", req->winstation );
@@ -4322,6 +4361,16 @@ static void dump_remove_completion_reply( const struct remove_completion_reply *
     fprintf( stderr, ", status=%08x", req->status );
 }
 
+static void dump_remove_completions_request( const struct remove_completions_request *req )
+{
+    fprintf( stderr, " handle=%04x", req->handle );
+}
+
+static void dump_remove_completions_reply( const struct remove_completions_reply *req )
+{
+    dump_varargs_completion_msgs( " msgs=", cur_size );
+}
+
 static void dump_query_completion_request( const struct query_completion_request *req )
 {
     fprintf( stderr, " handle=%04x", req->handle );
@@ -4545,6 +4594,7 @@ static void dump_create_esync_request( const struct create_esync_request *req )
     fprintf( stderr, ", initval=%d", req->initval );
     fprintf( stderr, ", type=%d", req->type );
     fprintf( stderr, ", max=%d", req->max );
+    fprintf( stderr, ", defer_fd=%d", req->defer_fd );
     dump_varargs_object_attributes( ", objattr=", cur_size );
 }
 
@@ -4561,6 +4611,7 @@ static void dump_open_esync_request( const struct open_esync_request *req )
     fprintf( stderr, ", attributes=%08x", req->attributes );
     fprintf( stderr, ", rootdir=%04x", req->rootdir );
     fprintf( stderr, ", type=%d", req->type );
+    fprintf( stderr, ", defer_fd=%d", req->defer_fd );
     dump_varargs_unicode_str( ", name=", cur_size );
 }
 
@@ -4672,6 +4723,7 @@ static const dump_func req_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_queue_apc_request,
     (dump_func)dump_get_apc_result_request,
     (dump_func)dump_close_handle_request,
+    (dump_func)dump_batch_requests_request,
     (dump_func)dump_set_handle_info_request,
     (dump_func)dump_dup_handle_request,
     (dump_func)dump_make_temporary_request,
@@ -4837,6 +4889,7 @@ static const dump_func req_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_close_desktop_request,
     (dump_func)dump_get_thread_desktop_request,
     (dump_func)dump_set_thread_desktop_request,
+    (dump_func)dump_get_desktop_shared_memory_request,
     (dump_func)dump_enum_desktop_request,
     (dump_func)dump_set_user_object_info_request,
     (dump_func)dump_register_hotkey_request,
@@ -4913,6 +4966,7 @@ static const dump_func req_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_open_completion_request,
     (dump_func)dump_add_completion_request,
     (dump_func)dump_remove_completion_request,
+    (dump_func)dump_remove_completions_request,
     (dump_func)dump_query_completion_request,
     (dump_func)dump_set_completion_info_request,
     (dump_func)dump_add_fd_completion_request,
@@ -4974,6 +5028,7 @@ static const dump_func reply_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_queue_apc_reply,
     (dump_func)dump_get_apc_result_reply,
     NULL,
+    (dump_func)dump_batch_requests_reply,
     (dump_func)dump_set_handle_info_reply,
     (dump_func)dump_dup_handle_reply,
     NULL,
@@ -5139,6 +5194,7 @@ static const dump_func reply_dumpers[REQ_NB_REQUESTS] = {
     NULL,
     (dump_func)dump_get_thread_desktop_reply,
     NULL,
+    (dump_func)dump_get_desktop_shared_memory_reply,
     (dump_func)dump_enum_desktop_reply,
     (dump_func)dump_set_user_object_info_reply,
     (dump_func)dump_register_hotkey_reply,
@@ -5215,6 +5271,7 @@ static const dump_func reply_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_open_completion_reply,
     NULL,
     (dump_func)dump_remove_completion_reply,
+    (dump_func)dump_remove_completions_reply,
     (dump_func)dump_query_completion_reply,
     NULL,
     NULL,
@@ -5276,6 +5333,7 @@ static const char * const req_names[REQ_NB_REQUESTS] = {
     "queue_apc",
     "get_apc_result",
     "close_handle",
+    "batch_requests",
     "set_handle_info",
     "dup_handle",
     "make_temporary",
@@ -5441,6 +5499,7 @@ static const char * const req_names[REQ_NB_REQUESTS] = {
     "close_desktop",
     "get_thread_desktop",
     "set_thread_desktop",
+    "get_desktop_shared_memory",
     "enum_desktop",
     "set_user_object_info",
     "register_hotkey",
@@ -5517,6 +5576,7 @@ static const char * const req_names[REQ_NB_REQUESTS] = {
     "open_completion",
     "add_completion",
     "remove_completion",
+    "remove_completions",
     "query_completion",
     "set_completion_info",
     "add_fd_completion",
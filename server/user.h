@@ -77,6 +77,8 @@ struct desktop
     unsigned int         users;            /* processes and threads using this desktop */
     struct global_cursor cursor;           /* global cursor information */
     unsigned char        keystate[256];    /* asynchronous key state */
+    struct object       *shared_mapping;   /* mapping of the shared desktop state */
+    desktop_shm_t       *shared;           /* shared desktop state, mirrored for the clients */
 };
 
 /* user handles functions */
@@ -189,6 +191,7 @@ extern void set_process_default_desktop( struct process *process, struct desktop
                                          obj_handle_t handle );
 extern void close_process_desktop( struct process *process );
 extern void close_thread_desktop( struct thread *thread );
+extern void update_desktop_shared( struct desktop *desktop );
 
 static inline int is_rect_empty( const rectangle_t *rect )
 {
@@ -23,6 +23,11 @@
 
 #include <stdio.h>
 #include <stdarg.h>
+#include <string.h>
+#include <sys/types.h>
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
 
 #include "ntstatus.h"
 #define WIN32_NO_STATUS
@@ -217,6 +222,7 @@ static struct desktop *create_desktop( const struct unicode_str *name, unsigned
                                        unsigned int flags, struct winstation *winstation )
 {
     struct desktop *desktop;
+    void *shared;
 
     if ((desktop = create_named_object( &winstation->obj, &desktop_ops, name, attr, NULL )))
     {
@@ -235,6 +241,13 @@ static struct desktop *create_desktop( const struct unicode_str *name, unsigned
             memset( desktop->keystate, 0, sizeof(desktop->keystate) );
             list_add_tail( &winstation->desktops, &desktop->entry );
             list_init( &desktop->hotkeys );
+            /* the desktop is still usable without shared memory, clients then fall back to requests */
+            if ((desktop->shared_mapping = create_shared_mapping( sizeof(*desktop->shared), &shared )))
+                desktop->shared = shared;
+            else
+                desktop->shared = NULL;
+            update_desktop_shared( desktop );
+            clear_error();
         }
         else clear_error();
     }
@@ -296,6 +309,29 @@ static void desktop_destroy( struct object *obj )
     if (desktop->close_timeout) remove_timeout_user( desktop->close_timeout );
     list_remove( &desktop->entry );
     release_object( desktop->winstation );
+    if (desktop->shared) munmap( (void *)desktop->shared, sizeof(*desktop->shared) );
+    if (desktop->shared_mapping) release_object( desktop->shared_mapping );
+}
+
+/* mirror the read-mostly desktop state in the shared memory */
+void update_desktop_shared( struct desktop *desktop )
+{
+    desktop_shm_t *shared = desktop->shared;
+    unsigned int seq;
+
+    if (!shared) return;
+
+    /* odd sequence numbers tell the clients that an update is in progress */
+    seq = shared->seq + 1;
+    __WINE_ATOMIC_STORE_RELAXED( &shared->seq, &seq );
+    __WINE_ATOMIC_FENCE_RELEASE();  /* the odd sequence must be visible before any of the data */
+    shared->cursor_x           = desktop->cursor.x;
+    shared->cursor_y           = desktop->cursor.y;
+    shared->cursor_last_change = desktop->cursor.last_change;
+    shared->cursor_clip        = desktop->cursor.clip;
+    memcpy( (void *)shared->keystate, desktop->keystate, sizeof(shared->keystate) );
+    seq++;
+    __WINE_ATOMIC_STORE_RELEASE( &shared->seq, &seq );
 }
 
 static unsigned int desktop_map_access( struct object *obj, unsigned int access )
@@ -651,6 +687,21 @@ DECL_HANDLER(set_thread_desktop)
 }
 
 
+/* get a section mapping the shared memory of the thread current desktop */
+DECL_HANDLER(get_desktop_shared_memory)
+{
+    struct desktop *desktop;
+
+    if (!(desktop = get_thread_desktop( current, 0 ))) return;
+    if (desktop->shared_mapping)
+        reply->handle = alloc_handle( current->process, desktop->shared_mapping,
+                                      SECTION_MAP_READ | SECTION_QUERY, 0 );
+    else
+        set_error( STATUS_NOT_SUPPORTED );
+    release_object( desktop );
+}
+
+
 /* get/set information about a user object (window station or desktop) */
 DECL_HANDLER(set_user_object_info)
 {